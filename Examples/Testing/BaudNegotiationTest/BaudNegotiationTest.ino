@@ -0,0 +1,290 @@
+/*
+	Library Baud Negotiation Testing Project.
+	Two NegotiatedUartInterface endpoints over a simulated link with rate-dependent faults.
+	Checks the settled rate against the cable's clean rate, the fallback on a degrading cable,
+	 and that application traffic flows after each negotiation.
+	Host only (e.g. EpoxyDuino), the whole stack runs from the VirtualClock through _TASK_EXTERNAL_TIME.
+	UartInterfaceTask depends on TaskScheduler (https://github.com/arkhipenko/TaskScheduler).
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#define _TASK_EXTERNAL_TIME
+#define _TASK_OO_CALLBACKS
+#include <TScheduler.hpp>
+
+#include <UartInterface.h>
+#include <UartInterfaceTask.h>
+#include <UartInterfaceSimulation.h>
+#include <UartInterfaceNegotiation.h>
+
+using namespace UartInterface;
+using namespace UartInterface::Negotiation;
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint8_t AppHeader = 1;
+	static constexpr uint8_t AppPayloadSize = 16;
+	static constexpr uint32_t StepNanos = 2000;
+	static constexpr uint32_t SettleTimeoutMillis = 3000;
+	static constexpr uint32_t TrafficMillis = 200;
+
+	static constexpr uint32_t BitFlipPpm = 2000;
+
+	using UartDefinitions = TemplateUartDefinitions<115200>;
+	using BaudRates = TemplateBaudRates<115200, 460800, 1000000, 2000000>;
+	using LinkType = Simulation::SimulatedLink<256, 64>;
+	using InterfaceType = NegotiatedUartInterface<LinkType::Endpoint, UartDefinitions, BaudRates>;
+}
+
+Simulation::VirtualClock Clock{};
+
+uint32_t external_millis()
+{
+	return Clock.Millis();
+}
+
+uint32_t external_micros()
+{
+	return Clock.Micros();
+}
+
+/// <summary>
+/// Counts application deliveries, negotiation frames must never show up here.
+/// </summary>
+struct AppListener : UartListener
+{
+	uint32_t Received = 0;
+	uint32_t Foreign = 0;
+
+	void OnUartStateChange(const bool connected) final {}
+
+	void OnUartRx(const uint8_t header) final
+	{
+		Foreign++;
+	}
+
+	void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+	{
+		if (header == Definitions::AppHeader
+			&& payloadSize == Definitions::AppPayloadSize)
+		{
+			Received++;
+		}
+		else
+		{
+			Foreign++;
+		}
+	}
+
+	void OnUartTx() final {}
+	void OnUartRxError(const RxErrorEnum error) final {}
+	void OnUartTxError(const TxErrorEnum error) final {}
+};
+
+TS::Scheduler SchedulerBase{};
+Definitions::LinkType Link(Clock, 1000, 7);
+AppListener Listener1{};
+AppListener Listener2{};
+Definitions::InterfaceType Interface1(SchedulerBase, Link.A, &Listener1, Definitions::Key, Definitions::KeySize);
+Definitions::InterfaceType Interface2(SchedulerBase, Link.B, &Listener2, Definitions::Key, Definitions::KeySize);
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+/// <summary>
+/// Cable with bit errors above cleanBaudrate, 0 for a clean cable at every rate.
+/// </summary>
+void SetCable(const uint32_t cleanBaudrate)
+{
+	Simulation::FaultConfig faults{};
+	faults.BitFlipPpm = (cleanBaudrate > 0) ? Definitions::BitFlipPpm : 0;
+	faults.CleanBaudrate = cleanBaudrate;
+	Link.SetFaults(faults);
+}
+
+void Step()
+{
+	SchedulerBase.execute();
+	Clock.Advance(Definitions::StepNanos);
+}
+
+bool WaitSettled()
+{
+	const uint32_t start = Clock.Millis();
+	while (Clock.Millis() - start < Definitions::SettleTimeoutMillis)
+	{
+		Step();
+		if (!Interface1.IsNegotiating()
+			&& !Interface2.IsNegotiating()
+			&& Interface1.GetBaudrate() == Interface2.GetBaudrate())
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/// <summary>
+/// Both ends send application frames whenever they can.
+/// </summary>
+void RunTraffic(const uint32_t durationMillis)
+{
+	uint8_t payload[Definitions::AppPayloadSize]{};
+
+	const uint32_t start = Clock.Millis();
+	while (Clock.Millis() - start < durationMillis)
+	{
+		Interface1.SendMessage(Definitions::AppHeader, payload, sizeof(payload));
+		Interface2.SendMessage(Definitions::AppHeader, payload, sizeof(payload));
+		Step();
+	}
+}
+
+void PrintState()
+{
+	Serial.print(F("Rate "));
+	Serial.print(Interface1.GetBaudrate());
+	Serial.print('/');
+	Serial.print(Interface2.GetBaudrate());
+	Serial.print(F("\tSwitches "));
+	Serial.print(Interface1.GetSwitchCount());
+	Serial.print('/');
+	Serial.print(Interface2.GetSwitchCount());
+	Serial.print(F("\tFallbacks "));
+	Serial.print(Interface1.GetFallbackCount());
+	Serial.print('/');
+	Serial.print(Interface2.GetFallbackCount());
+	Serial.print(F("\tReceived "));
+	Serial.print(Listener1.Received);
+	Serial.print('/');
+	Serial.print(Listener2.Received);
+	Serial.print(F("\tElapsed "));
+	Serial.print(Clock.Millis());
+	Serial.println(F(" ms"));
+}
+
+/// <summary>
+/// Restarts both ends, negotiates and checks the settled rate, then runs application traffic over it.
+/// </summary>
+bool RunScenario(const uint32_t cleanBaudrate, const uint8_t supported2, const uint32_t expectedBaudrate)
+{
+	SetCable(cleanBaudrate);
+	Interface2.SetSupportedRates(supported2);
+	Listener1.Received = 0;
+	Listener2.Received = 0;
+
+	Interface1.Start();
+	Interface2.Start();
+
+	const bool settled = WaitSettled();
+	RunTraffic(Definitions::TrafficMillis);
+	PrintState();
+
+	return settled
+		&& Interface1.GetBaudrate() == expectedBaudrate
+		&& Interface2.GetBaudrate() == expectedBaudrate
+		&& Listener1.Received > 0
+		&& Listener2.Received > 0
+		&& Listener1.Foreign == 0
+		&& Listener2.Foreign == 0;
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface Baud Negotiation Test Start"));
+	Serial.println();
+
+	if (!Interface1.Setup() ||
+		!Interface2.Setup())
+	{
+		Serial.println(F("Setup Failed!"));
+		OnFail();
+	}
+
+	// Clean cable, both ends reach the fastest candidate on the first try.
+	if (!RunScenario(0, Definitions::BaudRates::GetAllMask(), 2000000)
+		|| Interface1.GetSwitchCount() != 1
+		|| Interface1.GetFallbackCount() != 0)
+	{
+		OnFail();
+	}
+
+	// The reserved negotiation header is refused once settled.
+	const uint32_t reservedStart = Clock.Millis();
+	while (!Interface1.CanSendMessage()
+		&& Clock.Millis() - reservedStart < Definitions::SettleTimeoutMillis)
+	{
+		Step();
+	}
+	if (!Interface1.CanSendMessage()
+		|| Interface1.SendMessage(TemplateNegotiationDefinitions<>::Header))
+	{
+		OnFail();
+	}
+
+	// One end only supports up to 460800.
+	if (!RunScenario(0, 0x03, 460800)
+		|| Interface1.GetFallbackCount() != 0)
+	{
+		OnFail();
+	}
+
+	// Cable only clean up to 1 Mbaud, 2 Mbaud fails verification on every attempt and is excluded.
+	if (!RunScenario(1000000, Definitions::BaudRates::GetAllMask(), 1000000)
+		|| Interface1.GetFallbackCount() < 2)
+	{
+		OnFail();
+	}
+
+	// The cable degrades under traffic, the error burst drops both ends to the base rate and they renegotiate.
+	const uint32_t fallbacks = Interface1.GetFallbackCount();
+	const uint32_t received1 = Listener1.Received;
+	SetCable(460800);
+	RunTraffic(Definitions::TrafficMillis);
+	if (!WaitSettled())
+	{
+		OnFail();
+	}
+	RunTraffic(Definitions::TrafficMillis);
+	PrintState();
+
+	if (Interface1.GetBaudrate() != 460800
+		|| Interface2.GetBaudrate() != 460800
+		|| Interface1.GetFallbackCount() <= fallbacks
+		|| Listener1.Received <= received1
+		|| Listener1.Foreign > 0
+		|| Listener2.Foreign > 0)
+	{
+		OnFail();
+	}
+
+	// Faulty at every rate above the base, the link settles back at the base rate.
+	if (!RunScenario(Definitions::UartDefinitions::Baudrate, Definitions::BaudRates::GetAllMask(), Definitions::UartDefinitions::Baudrate))
+	{
+		OnFail();
+	}
+
+	Serial.println();
+	Serial.println(F("All tests passed."));
+	Serial.println();
+}
+
+void loop()
+{
+}
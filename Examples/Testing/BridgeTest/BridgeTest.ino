@@ -0,0 +1,729 @@
+/*
+	Library Frame Bridge Testing Project.
+	A host and a device, each on its own simulated link to a FrameBridge in between.
+	Every message must cross the bridge intact, both ways, with cut-through and with store-and-forward.
+	Routes must split frames between forwarding and local delivery, by header.
+	With bit errors on the host link, cut-through frames that fail validation must be aborted, and never reach the device.
+	Then reports the forwarding latency in byte times, against a relay that re-sends each message from OnUartRx(),
+	 and the CPU time per forwarded frame of each.
+	Host only (e.g. EpoxyDuino), the whole stack runs from the VirtualClock through _TASK_EXTERNAL_TIME.
+	UartInterfaceTask depends on TaskScheduler (https://github.com/arkhipenko/TaskScheduler).
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#define _TASK_EXTERNAL_TIME
+#define _TASK_OO_CALLBACKS
+#include <TScheduler.hpp>
+
+#include <UartInterface.h>
+#include <UartInterfaceTask.h>
+#include <UartInterfaceBridge.h>
+#include <UartInterfaceSimulation.h>
+
+#include <chrono>
+
+using namespace UartInterface;
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint32_t Baudrate = 115200;
+	static constexpr uint32_t ByteNanos = (10 * 1000000000ULL) / Baudrate;
+	static constexpr uint8_t MaxPayloadSize = 64;
+	static constexpr uint32_t StepNanos = 2000;
+
+	static constexpr uint16_t Messages = 200;
+	static constexpr uint16_t FaultMessages = 400;
+	static constexpr uint16_t CostFrames = 20000;
+
+	// Local headers, for the routing test.
+	static constexpr uint8_t LocalFirst = 0xC0;
+	static constexpr uint8_t SharedHeader = 0xBF;
+
+	using UartDefinitions = TemplateUartDefinitions<Baudrate, MaxPayloadSize>;
+
+	using CutThroughDefinitions = Bridge::TemplateBridgeDefinitions<true>;
+	using StoreDefinitions = Bridge::TemplateBridgeDefinitions<false>;
+
+	using LinkType = Simulation::SimulatedLink<64, 64>;
+}
+
+Simulation::VirtualClock Clock{};
+
+uint32_t external_millis()
+{
+	return Clock.Millis();
+}
+
+uint32_t external_micros()
+{
+	return Clock.Micros();
+}
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+/// <summary>
+/// Message content from its sequence number, with delimiters in it.
+/// </summary>
+uint8_t FillPayload(uint8_t* payload, const uint16_t sequence)
+{
+	const uint8_t size = 2 + (sequence % (Definitions::MaxPayloadSize - 1));
+	payload[0] = (uint8_t)sequence;
+	payload[1] = (uint8_t)(sequence >> 8);
+	for (uint8_t i = 2; i < size; i++)
+	{
+		payload[i] = ((i + sequence) % 5 == 0) ? 0 : (uint8_t)(sequence * 31 + i * 7);
+	}
+
+	return size;
+}
+
+uint8_t GetHeader(const uint16_t sequence)
+{
+	return (uint8_t)(sequence % 0x80);
+}
+
+struct CheckListener : UartListener
+{
+	uint32_t SentMicros[Definitions::FaultMessages]{};
+	uint64_t LatencySum = 0;
+	uint32_t Received = 0;
+	uint32_t Errors = 0;
+	uint32_t Rejected = 0;
+	uint32_t Local = 0;
+
+	void OnUartStateChange(const bool connected) final {}
+
+	void OnUartRx(const uint8_t header) final
+	{
+		Errors++;
+	}
+
+	void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+	{
+		if (header >= Definitions::LocalFirst
+			|| header == Definitions::SharedHeader)
+		{
+			Local++;
+			return;
+		}
+
+		uint8_t expected[Definitions::MaxPayloadSize];
+		const uint16_t sequence = payload[0] | ((uint16_t)payload[1] << 8);
+		if (sequence >= Definitions::FaultMessages
+			|| header != GetHeader(sequence)
+			|| payloadSize != FillPayload(expected, sequence)
+			|| memcmp(payload, expected, payloadSize) != 0)
+		{
+			Errors++;
+			return;
+		}
+
+		LatencySum += Clock.Micros() - SentMicros[sequence];
+		Received++;
+	}
+
+	void OnUartTx() final {}
+	void OnUartRxError(const RxErrorEnum error) final { Rejected++; }
+	void OnUartTxError(const TxErrorEnum error) final { Errors++; }
+};
+
+/// <summary>
+/// Forwards from OnUartRx(), copying and re-encoding each message.
+/// </summary>
+template<typename InterfaceType>
+struct RelayListener : UartListener
+{
+	InterfaceType* Target = nullptr;
+	uint32_t Dropped = 0;
+
+	void OnUartStateChange(const bool connected) final {}
+
+	void OnUartRx(const uint8_t header) final
+	{
+		if (!Target->SendMessage(header))
+		{
+			Dropped++;
+		}
+	}
+
+	void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+	{
+		if (!Target->SendMessage(header, payload, payloadSize))
+		{
+			Dropped++;
+		}
+	}
+
+	void OnUartTx() final {}
+	void OnUartRxError(const RxErrorEnum error) final {}
+	void OnUartTxError(const TxErrorEnum error) final {}
+};
+
+struct RunResult
+{
+	uint32_t Received;
+	uint32_t LatencyMicros;
+};
+
+template<typename HostType, typename DeviceType>
+void Run(TS::Scheduler& scheduler, HostType& host, DeviceType& device, CheckListener& hostListener, CheckListener& deviceListener,
+	const uint16_t messages, const bool bothWays)
+{
+	uint8_t payload[Definitions::MaxPayloadSize];
+	uint16_t hostSent = 0;
+	uint16_t deviceSent = 0;
+	uint32_t idleSince = Clock.Millis();
+	while (hostSent < messages
+		|| (bothWays && deviceSent < messages)
+		|| Clock.Millis() - idleSince < 20)
+	{
+		if (hostSent < messages
+			&& host.CanSendMessage())
+		{
+			const uint8_t size = FillPayload(payload, hostSent);
+			deviceListener.SentMicros[hostSent] = Clock.Micros();
+			if (host.SendMessage(GetHeader(hostSent), payload, size))
+			{
+				hostSent++;
+				idleSince = Clock.Millis();
+			}
+		}
+
+		if (bothWays
+			&& deviceSent < messages
+			&& device.CanSendMessage())
+		{
+			const uint8_t size = FillPayload(payload, deviceSent);
+			hostListener.SentMicros[deviceSent] = Clock.Micros();
+			if (device.SendMessage(GetHeader(deviceSent), payload, size))
+			{
+				deviceSent++;
+				idleSince = Clock.Millis();
+			}
+		}
+
+		scheduler.execute();
+		Clock.Advance(Definitions::StepNanos);
+	}
+}
+
+/// <summary>
+/// Both ways at once, each side sending as fast as it can.
+/// </summary>
+template<typename BridgeDefinitions>
+RunResult TestBridge(const char* name)
+{
+	using InterfaceType = UartInterfaceTask<Definitions::LinkType::Endpoint, Definitions::UartDefinitions>;
+	using BridgeType = Bridge::FrameBridge<Definitions::LinkType::Endpoint, Definitions::LinkType::Endpoint, Definitions::UartDefinitions, BridgeDefinitions>;
+
+	CheckListener hostListener{};
+	CheckListener deviceListener{};
+
+	Clock.Reset();
+	TS::Scheduler scheduler{};
+	Definitions::LinkType hostLink(Clock, 1000, 1);
+	Definitions::LinkType deviceLink(Clock, 1000, 2);
+
+	InterfaceType host(scheduler, hostLink.A, &hostListener, Definitions::Key, Definitions::KeySize);
+	InterfaceType device(scheduler, deviceLink.B, &deviceListener, Definitions::Key, Definitions::KeySize);
+	BridgeType bridge(scheduler, hostLink.B, nullptr, deviceLink.A, nullptr, Definitions::Key, Definitions::KeySize);
+	if (!host.Setup() || !device.Setup() || !bridge.Setup())
+	{
+		OnFail();
+	}
+	host.Start();
+	device.Start();
+	bridge.Start();
+
+	Run(scheduler, host, device, hostListener, deviceListener, Definitions::Messages, true);
+
+	const Bridge::BridgeStats& toDevice = bridge.GetStats(Bridge::SideEnum::A);
+	const Bridge::BridgeStats& toHost = bridge.GetStats(Bridge::SideEnum::B);
+
+	Serial.print(name);
+	Serial.print(F("\tTo device "));
+	Serial.print(deviceListener.Received);
+	Serial.print(F(" (cut-through "));
+	Serial.print(toDevice.CutThrough);
+	Serial.print(F(")\tTo host "));
+	Serial.print(hostListener.Received);
+	Serial.print(F(" (cut-through "));
+	Serial.print(toHost.CutThrough);
+	Serial.println(')');
+
+	if (deviceListener.Received != Definitions::Messages
+		|| hostListener.Received != Definitions::Messages
+		|| deviceListener.Errors > 0 || hostListener.Errors > 0
+		|| deviceListener.Rejected > 0 || hostListener.Rejected > 0
+		|| toDevice.Forwarded != Definitions::Messages
+		|| toHost.Forwarded != Definitions::Messages
+		|| toDevice.Aborted > 0 || toHost.Aborted > 0
+		|| (!BridgeDefinitions::CutThrough && (toDevice.CutThrough > 0 || toHost.CutThrough > 0))
+		|| (BridgeDefinitions::CutThrough && (toDevice.CutThrough == 0 || toHost.CutThrough == 0)))
+	{
+		OnFail();
+	}
+
+	// One way, one message at a time, for the latency.
+	CheckListener quietListener{};
+	InterfaceType quietDevice(scheduler, deviceLink.B, &quietListener, Definitions::Key, Definitions::KeySize);
+	device.Stop();
+	quietDevice.Setup();
+	quietDevice.Start();
+
+	uint8_t payload[Definitions::MaxPayloadSize];
+	for (uint16_t i = 0; i < Definitions::Messages; i++)
+	{
+		const uint8_t size = FillPayload(payload, i);
+		quietListener.SentMicros[i] = Clock.Micros();
+		if (!host.SendMessage(GetHeader(i), payload, size))
+		{
+			OnFail();
+		}
+		const uint32_t start = Clock.Millis();
+		while (Clock.Millis() - start < 10)
+		{
+			scheduler.execute();
+			Clock.Advance(Definitions::StepNanos);
+		}
+	}
+
+	if (quietListener.Received != Definitions::Messages)
+	{
+		OnFail();
+	}
+
+	return RunResult{ quietListener.Received, (uint32_t)(quietListener.LatencySum / quietListener.Received) };
+}
+
+/// <summary>
+/// The same one way traffic, straight or through a relay.
+/// </summary>
+template<bool Relayed>
+RunResult TestReference()
+{
+	using InterfaceType = UartInterfaceTask<Definitions::LinkType::Endpoint, Definitions::UartDefinitions>;
+
+	CheckListener deviceListener{};
+	RelayListener<InterfaceType> relayListener{};
+
+	Clock.Reset();
+	TS::Scheduler scheduler{};
+	Definitions::LinkType hostLink(Clock, 1000, 1);
+	Definitions::LinkType deviceLink(Clock, 1000, 2);
+
+	InterfaceType host(scheduler, hostLink.A, nullptr, Definitions::Key, Definitions::KeySize);
+	InterfaceType device(scheduler, Relayed ? deviceLink.B : hostLink.B, &deviceListener, Definitions::Key, Definitions::KeySize);
+	InterfaceType relayIn(scheduler, hostLink.B, &relayListener, Definitions::Key, Definitions::KeySize);
+	InterfaceType relayOut(scheduler, deviceLink.A, nullptr, Definitions::Key, Definitions::KeySize);
+	relayListener.Target = &relayOut;
+	host.Setup();
+	device.Setup();
+	host.Start();
+	device.Start();
+	if (Relayed)
+	{
+		relayIn.Setup();
+		relayOut.Setup();
+		relayIn.Start();
+		relayOut.Start();
+	}
+
+	uint8_t payload[Definitions::MaxPayloadSize];
+	for (uint16_t i = 0; i < Definitions::Messages; i++)
+	{
+		const uint8_t size = FillPayload(payload, i);
+		deviceListener.SentMicros[i] = Clock.Micros();
+		while (!host.SendMessage(GetHeader(i), payload, size))
+		{
+			scheduler.execute();
+			Clock.Advance(Definitions::StepNanos);
+		}
+		const uint32_t start = Clock.Millis();
+		while (Clock.Millis() - start < 10)
+		{
+			scheduler.execute();
+			Clock.Advance(Definitions::StepNanos);
+		}
+	}
+
+	if (deviceListener.Received != Definitions::Messages
+		|| deviceListener.Errors > 0)
+	{
+		OnFail();
+	}
+
+	return RunResult{ deviceListener.Received, (uint32_t)(deviceListener.LatencySum / deviceListener.Received) };
+}
+
+/// <summary>
+/// Headers from LocalFirst up are only delivered to the bridge, SharedHeader goes both ways.
+/// </summary>
+void TestRoutes()
+{
+	using InterfaceType = UartInterfaceTask<Definitions::LinkType::Endpoint, Definitions::UartDefinitions>;
+	using BridgeType = Bridge::FrameBridge<Definitions::LinkType::Endpoint, Definitions::LinkType::Endpoint, Definitions::UartDefinitions>;
+
+	CheckListener hostListener{};
+	CheckListener deviceListener{};
+	CheckListener bridgeListener{};
+
+	Clock.Reset();
+	TS::Scheduler scheduler{};
+	Definitions::LinkType hostLink(Clock, 1000, 1);
+	Definitions::LinkType deviceLink(Clock, 1000, 2);
+
+	InterfaceType host(scheduler, hostLink.A, &hostListener, Definitions::Key, Definitions::KeySize);
+	InterfaceType device(scheduler, deviceLink.B, &deviceListener, Definitions::Key, Definitions::KeySize);
+	BridgeType bridge(scheduler, hostLink.B, &bridgeListener, deviceLink.A, nullptr, Definitions::Key, Definitions::KeySize);
+	bridge.SetRoute(Bridge::SideEnum::A, Definitions::LocalFirst, UINT8_MAX, Bridge::RouteEnum::Local);
+	bridge.SetRoute(Bridge::SideEnum::A, Definitions::SharedHeader, Bridge::RouteEnum::ForwardAndLocal);
+	if (!host.Setup() || !device.Setup() || !bridge.Setup()
+		|| bridge.GetRoute(Bridge::SideEnum::A, 0) != Bridge::RouteEnum::Forward
+		|| bridge.GetRoute(Bridge::SideEnum::A, UINT8_MAX) != Bridge::RouteEnum::Local)
+	{
+		OnFail();
+	}
+	host.Start();
+	device.Start();
+	bridge.Start();
+
+	// Half the messages are local, a quarter of those shared.
+	uint8_t payload[Definitions::MaxPayloadSize];
+	uint16_t sent = 0;
+	uint16_t local = 0;
+	uint16_t shared = 0;
+	uint32_t idleSince = 0;
+	while (sent < Definitions::Messages
+		|| Clock.Millis() - idleSince < 20)
+	{
+		if (sent < Definitions::Messages
+			&& host.CanSendMessage())
+		{
+			const uint8_t size = FillPayload(payload, sent);
+			const bool isLocal = (sent % 2) == 1;
+			const bool isShared = (sent % 8) == 1;
+			const uint8_t header = isShared ? Definitions::SharedHeader
+				: (isLocal ? (uint8_t)(Definitions::LocalFirst + (sent % 64)) : GetHeader(sent));
+			deviceListener.SentMicros[sent] = Clock.Micros();
+			if (host.SendMessage(header, payload, size))
+			{
+				local += isLocal;
+				shared += isShared;
+				sent++;
+				idleSince = Clock.Millis();
+			}
+		}
+
+		scheduler.execute();
+		Clock.Advance(Definitions::StepNanos);
+	}
+
+	Serial.print(F("Routes\t\tLocal "));
+	Serial.print(bridgeListener.Local);
+	Serial.print('/');
+	Serial.print(local);
+	Serial.print(F("\tForwarded "));
+	Serial.print(deviceListener.Received + deviceListener.Local);
+	Serial.print('/');
+	Serial.println(sent - local + shared);
+
+	if (bridgeListener.Local != local
+		|| bridgeListener.Received > 0
+		|| deviceListener.Local != shared
+		|| deviceListener.Received != (uint32_t)(sent - local)
+		|| deviceListener.Errors > 0
+		|| bridge.GetStats(Bridge::SideEnum::A).Forwarded != (uint32_t)(sent - local + shared))
+	{
+		OnFail();
+	}
+}
+
+/// <summary>
+/// Bit errors on the host link only: whatever reaches the device must be intact.
+/// </summary>
+void TestAbort()
+{
+	using InterfaceType = UartInterfaceTask<Definitions::LinkType::Endpoint, Definitions::UartDefinitions>;
+	using BridgeType = Bridge::FrameBridge<Definitions::LinkType::Endpoint, Definitions::LinkType::Endpoint, Definitions::UartDefinitions>;
+
+	CheckListener hostListener{};
+	CheckListener deviceListener{};
+
+	Clock.Reset();
+	TS::Scheduler scheduler{};
+	Definitions::LinkType hostLink(Clock, 1000, 3);
+	Definitions::LinkType deviceLink(Clock, 1000, 4);
+
+	Simulation::FaultConfig faults{};
+	faults.BitFlipPpm = 200;
+	hostLink.SetFaults(faults);
+
+	InterfaceType host(scheduler, hostLink.A, &hostListener, Definitions::Key, Definitions::KeySize);
+	InterfaceType device(scheduler, deviceLink.B, &deviceListener, Definitions::Key, Definitions::KeySize);
+	BridgeType bridge(scheduler, hostLink.B, nullptr, deviceLink.A, nullptr, Definitions::Key, Definitions::KeySize);
+	if (!host.Setup() || !device.Setup() || !bridge.Setup())
+	{
+		OnFail();
+	}
+	host.Start();
+	device.Start();
+	bridge.Start();
+
+	Run(scheduler, host, device, hostListener, deviceListener, Definitions::FaultMessages, false);
+
+	const Bridge::BridgeStats& stats = bridge.GetStats(Bridge::SideEnum::A);
+
+	Serial.print(F("Bit errors\tDelivered "));
+	Serial.print(deviceListener.Received);
+	Serial.print('/');
+	Serial.print(Definitions::FaultMessages);
+	Serial.print(F("\tAborted "));
+	Serial.print(stats.Aborted);
+	Serial.print(F("\tRejected at device "));
+	Serial.println(deviceListener.Rejected);
+
+	if (deviceListener.Errors > 0
+		|| deviceListener.Received != stats.Forwarded
+		|| stats.Aborted == 0
+		|| deviceListener.Rejected < stats.Aborted)
+	{
+		OnFail();
+	}
+}
+
+/// <summary>
+/// Serial stand-in from memory: frames go in only when the previous one has gone out, and whatever is written is counted.
+/// </summary>
+struct MemorySerial
+{
+	const uint8_t* In = nullptr;
+	uint16_t InSize = 0;
+	uint16_t InIndex = 0;
+	uint32_t Written = 0;
+	uint32_t Delimiters = 0;
+
+	operator bool() { return true; }
+	void begin(const unsigned long baudrate) {}
+	int available() { return InSize - InIndex; }
+	int peek() { return (InIndex < InSize) ? In[InIndex] : -1; }
+	int read() { return (InIndex < InSize) ? In[InIndex++] : -1; }
+	int availableForWrite() { return 256; }
+	size_t write(const uint8_t value) { Written++; Delimiters += (value == 0); return 1; }
+	size_t write(const uint8_t* buffer, const size_t size)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			Delimiters += (buffer[i] == 0);
+		}
+		Written += size;
+		return size;
+	}
+	void flush() {}
+	void clearWriteError() {}
+};
+
+/// <summary>
+/// Encoded frames of payload size 48, from a core writing to memory.
+/// </summary>
+uint16_t EncodeFrames(uint8_t* frames, uint8_t* sizes, const uint8_t count)
+{
+	struct CaptureSerial
+	{
+		uint8_t* Out = nullptr;
+		uint16_t Size = 0;
+		operator bool() { return true; }
+		void begin(const unsigned long baudrate) {}
+		int available() { return 0; }
+		int peek() { return -1; }
+		int read() { return -1; }
+		int availableForWrite() { return 256; }
+		size_t write(const uint8_t value) { Out[Size++] = value; return 1; }
+		size_t write(const uint8_t* buffer, const size_t size) { memcpy(&Out[Size], buffer, size); Size += size; return size; }
+		void flush() {}
+		void clearWriteError() {}
+	};
+
+	uint16_t total = 0;
+	for (uint8_t i = 0; i < count; i++)
+	{
+		CaptureSerial serial{};
+		serial.Out = &frames[total];
+		UartInterfaceCore<CaptureSerial, Definitions::UartDefinitions> core(serial, nullptr, Definitions::Key, Definitions::KeySize);
+		core.Setup();
+		core.Start();
+		while (!core.CanSendMessage())
+		{
+			core.Poll(0);
+		}
+
+		uint8_t payload[48];
+		for (uint8_t j = 0; j < sizeof(payload); j++)
+		{
+			payload[j] = (uint8_t)(i * 13 + j * 7);
+		}
+		core.SendMessage(i, payload, sizeof(payload));
+		while (core.IsTxPolling())
+		{
+			core.PollTx(0);
+		}
+		sizes[i] = (uint8_t)serial.Size;
+		total += serial.Size;
+	}
+
+	return total;
+}
+
+/// <summary>
+/// CPU time per forwarded frame, the serials in memory, each frame fed once the previous one is out.
+/// </summary>
+double MeasureCost(TS::Scheduler& scheduler, MemorySerial& in, MemorySerial& out,
+	const uint8_t* frames, const uint8_t* sizes, const uint8_t count)
+{
+	// Connects.
+	for (uint8_t i = 0; i < 10; i++)
+	{
+		scheduler.execute();
+		Clock.Advance(Definitions::StepNanos);
+	}
+
+	uint16_t offset = 0;
+	uint8_t next = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for (uint16_t frame = 0; frame < Definitions::CostFrames; frame++)
+	{
+		in.In = &frames[offset];
+		in.InSize = sizes[next];
+		in.InIndex = 0;
+		offset += sizes[next];
+		if (++next >= count)
+		{
+			next = 0;
+			offset = 0;
+		}
+
+		const uint32_t target = (frame + 1) * 2;
+		while (out.Delimiters < target)
+		{
+			scheduler.execute();
+			Clock.Advance(Definitions::StepNanos);
+		}
+	}
+	const auto end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::nano>(end - start).count() / Definitions::CostFrames;
+}
+
+static constexpr uint8_t CostFrameCount = 16;
+uint8_t CostFrames[CostFrameCount * 64];
+uint8_t CostSizes[CostFrameCount];
+
+double BenchmarkBridge()
+{
+	using BridgeType = Bridge::FrameBridge<MemorySerial, MemorySerial, Definitions::UartDefinitions>;
+
+	Clock.Reset();
+	TS::Scheduler scheduler{};
+	MemorySerial in{};
+	MemorySerial out{};
+	BridgeType bridge(scheduler, in, nullptr, out, nullptr, Definitions::Key, Definitions::KeySize);
+	bridge.Setup();
+	bridge.Start();
+
+	const double nanos = MeasureCost(scheduler, in, out, CostFrames, CostSizes, CostFrameCount);
+	if (bridge.GetStats(Bridge::SideEnum::A).Forwarded != Definitions::CostFrames)
+	{
+		OnFail();
+	}
+
+	return nanos;
+}
+
+double BenchmarkRelay()
+{
+	using InterfaceType = UartInterfaceTask<MemorySerial, Definitions::UartDefinitions>;
+
+	Clock.Reset();
+	TS::Scheduler scheduler{};
+	MemorySerial in{};
+	MemorySerial out{};
+	RelayListener<InterfaceType> relayListener{};
+	InterfaceType relayIn(scheduler, in, &relayListener, Definitions::Key, Definitions::KeySize);
+	InterfaceType relayOut(scheduler, out, nullptr, Definitions::Key, Definitions::KeySize);
+	relayListener.Target = &relayOut;
+	relayIn.Setup();
+	relayOut.Setup();
+	relayIn.Start();
+	relayOut.Start();
+
+	const double nanos = MeasureCost(scheduler, in, out, CostFrames, CostSizes, CostFrameCount);
+	if (relayListener.Dropped > 0)
+	{
+		OnFail();
+	}
+
+	return nanos;
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface Frame Bridge Test Start"));
+	Serial.println();
+
+	const RunResult cutThrough = TestBridge<Definitions::CutThroughDefinitions>("Cut-through");
+	const RunResult store = TestBridge<Definitions::StoreDefinitions>("Store-forward");
+	TestRoutes();
+	TestAbort();
+
+	const RunResult direct = TestReference<false>();
+	const RunResult relay = TestReference<true>();
+
+	Serial.println();
+	Serial.print(F("Forwarding latency, byte times\tCut-through "));
+	Serial.print(((cutThrough.LatencyMicros - direct.LatencyMicros) * 1000.0) / Definitions::ByteNanos, 1);
+	Serial.print(F("\tStore-forward "));
+	Serial.print(((store.LatencyMicros - direct.LatencyMicros) * 1000.0) / Definitions::ByteNanos, 1);
+	Serial.print(F("\tRelay "));
+	Serial.println(((relay.LatencyMicros - direct.LatencyMicros) * 1000.0) / Definitions::ByteNanos, 1);
+
+	// A few byte times, against a whole frame.
+	if (cutThrough.LatencyMicros > direct.LatencyMicros + (8 * Definitions::ByteNanos) / 1000
+		|| store.LatencyMicros >= relay.LatencyMicros + (2 * Definitions::ByteNanos) / 1000)
+	{
+		OnFail();
+	}
+
+	EncodeFrames(CostFrames, CostSizes, CostFrameCount);
+	const double bridgeNanos = BenchmarkBridge();
+	const double relayNanos = BenchmarkRelay();
+
+	Serial.print(F("CPU per forwarded frame\t\tBridge "));
+	Serial.print(bridgeNanos, 0);
+	Serial.print(F(" ns\tRelay "));
+	Serial.print(relayNanos, 0);
+	Serial.println(F(" ns"));
+
+	Serial.println();
+	Serial.println(F("All tests passed."));
+	Serial.println();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,356 @@
+/*
+	Library Coalescing Testing Project.
+	A producer updates a few state headers much faster than the link can carry them, alongside occasional event messages.
+	With CoalescingUartInterface, each state header has at most one message waiting, always with its newest value.
+	Compared against the same producer queueing every update in its own FIFO: the received state must be far fresher,
+	 every event must still arrive, and the final value of each state header must be the last one produced.
+	Host only (e.g. EpoxyDuino), the whole stack runs from the VirtualClock through _TASK_EXTERNAL_TIME.
+	UartInterfaceTask depends on TaskScheduler (https://github.com/arkhipenko/TaskScheduler).
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#define _TASK_EXTERNAL_TIME
+#define _TASK_OO_CALLBACKS
+#include <TScheduler.hpp>
+
+#include <UartInterface.h>
+#include <UartInterfaceTask.h>
+#include <UartInterfaceSimulation.h>
+#include <UartInterfaceCoalescing.h>
+
+using namespace UartInterface;
+using namespace UartInterface::Coalescing;
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint32_t StepNanos = 5000;
+	static constexpr uint32_t DurationMillis = 1000;
+	static constexpr uint32_t DrainMillis = 100;
+
+	// 4 state headers, updated every 200 us in turn: several times what 115200 baud carries.
+	static constexpr uint8_t StateCount = 4;
+	static constexpr uint8_t StateHeaderFirst = 1;
+	static constexpr uint32_t UpdatePeriodMicros = 200;
+
+	static constexpr uint8_t EventHeader = 100;
+	static constexpr uint32_t EventPeriodMillis = 5;
+
+	static constexpr uint8_t FifoSize = 32;
+	static constexpr uint8_t FreshnessGain = 4;
+
+	struct StateMessage
+	{
+		uint32_t Micros;
+		uint32_t Value;
+	};
+
+	using UartDefinitions = TemplateUartDefinitions<115200, 16>;
+	using LinkType = Simulation::SimulatedLink<64, 64>;
+	using CoalescingType = CoalescingUartInterface<LinkType::Endpoint, UartDefinitions, TemplateCoalescingDefinitions<StateCount>>;
+	using ReceiverType = UartInterfaceTask<LinkType::Endpoint, UartDefinitions>;
+}
+
+Simulation::VirtualClock Clock{};
+
+uint32_t external_millis()
+{
+	return Clock.Millis();
+}
+
+uint32_t external_micros()
+{
+	return Clock.Micros();
+}
+
+struct StateListener : UartListener
+{
+	uint64_t AgeSum = 0;
+	uint32_t AgeMax = 0;
+	uint32_t StateReceived = 0;
+	uint32_t EventReceived = 0;
+	uint32_t Errors = 0;
+	uint32_t LastValue[Definitions::StateCount]{};
+
+	void Clear()
+	{
+		*this = StateListener{};
+	}
+
+	void OnUartStateChange(const bool connected) final {}
+
+	void OnUartRx(const uint8_t header) final
+	{
+		if (header == Definitions::EventHeader)
+		{
+			EventReceived++;
+		}
+		else
+		{
+			Errors++;
+		}
+	}
+
+	void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+	{
+		const uint8_t index = header - Definitions::StateHeaderFirst;
+		if (index >= Definitions::StateCount
+			|| payloadSize != sizeof(Definitions::StateMessage))
+		{
+			Errors++;
+			return;
+		}
+
+		Definitions::StateMessage message;
+		memcpy(&message, payload, sizeof(message));
+
+		const uint32_t age = Clock.Micros() - message.Micros;
+		AgeSum += age;
+		if (age > AgeMax)
+		{
+			AgeMax = age;
+		}
+		StateReceived++;
+		LastValue[index] = message.Value;
+	}
+
+	void OnUartTx() final {}
+	void OnUartRxError(const RxErrorEnum error) final { Errors++; }
+	void OnUartTxError(const TxErrorEnum error) final { Errors++; }
+};
+
+/// <summary>
+/// Application side FIFO of state updates, what a producer does without coalescing.
+/// Full: the newest update is dropped.
+/// </summary>
+struct UpdateFifo
+{
+	struct Entry
+	{
+		Definitions::StateMessage Message;
+		uint8_t Header;
+	};
+
+	Entry Entries[Definitions::FifoSize]{};
+	uint8_t Head = 0;
+	uint8_t Count = 0;
+
+	void Push(const uint8_t header, const Definitions::StateMessage& message)
+	{
+		if (Count < Definitions::FifoSize)
+		{
+			Entries[(Head + Count) % Definitions::FifoSize] = Entry{ message, header };
+			Count++;
+		}
+	}
+
+	void Pop()
+	{
+		Head = (Head + 1) % Definitions::FifoSize;
+		Count--;
+	}
+};
+
+struct RunResult
+{
+	uint32_t Produced = 0;
+	uint32_t StateReceived = 0;
+	uint32_t AgeAverage = 0;
+	uint32_t AgeMax = 0;
+	uint32_t EventSent = 0;
+	uint32_t EventReceived = 0;
+	uint32_t Errors = 0;
+	uint8_t PendingMax = 0;
+	bool Final = true;
+};
+
+TS::Scheduler Scheduler{};
+
+StateListener Listener{};
+
+Definitions::LinkType Link(Clock, 1000, 1);
+
+Definitions::CoalescingType Sender(Scheduler, Link.A, nullptr, Definitions::Key, Definitions::KeySize);
+Definitions::ReceiverType Receiver(Scheduler, Link.B, &Listener, Definitions::Key, Definitions::KeySize);
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+RunResult Run(const bool coalescing)
+{
+	for (uint8_t i = 0; i < Definitions::StateCount; i++)
+	{
+		Sender.SetCoalescing(Definitions::StateHeaderFirst + i, coalescing);
+	}
+
+	Listener.Clear();
+	Sender.Start();
+	Receiver.Start();
+
+	RunResult result{};
+	UpdateFifo fifo{};
+	uint32_t lastValue[Definitions::StateCount]{};
+	const uint32_t start = Clock.Millis();
+	uint32_t lastUpdate = Clock.Micros();
+	uint32_t lastEvent = start;
+	bool eventPending = false;
+	while (Clock.Millis() - start < (Definitions::DurationMillis + Definitions::DrainMillis))
+	{
+		const bool producing = Clock.Millis() - start < Definitions::DurationMillis;
+
+		if (producing
+			&& Clock.Micros() - lastUpdate >= Definitions::UpdatePeriodMicros)
+		{
+			lastUpdate = Clock.Micros();
+			const uint8_t index = result.Produced % Definitions::StateCount;
+			const Definitions::StateMessage message{ Clock.Micros(), ++lastValue[index] };
+			result.Produced++;
+
+			if (coalescing)
+			{
+				if (!Sender.SendMessage(Definitions::StateHeaderFirst + index, message))
+				{
+					OnFail();
+				}
+			}
+			else
+			{
+				fifo.Push(Definitions::StateHeaderFirst + index, message);
+			}
+		}
+
+		if (producing
+			&& Clock.Millis() - lastEvent >= Definitions::EventPeriodMillis)
+		{
+			lastEvent = Clock.Millis();
+			eventPending = true;
+		}
+
+		// Events go first, then queued updates, whenever the serial is free.
+		if (eventPending
+			&& Sender.SendMessage(Definitions::EventHeader))
+		{
+			eventPending = false;
+			result.EventSent++;
+		}
+
+		if (fifo.Count > 0)
+		{
+			// Sent stamped as produced, it has been waiting since.
+			const UpdateFifo::Entry& entry = fifo.Entries[fifo.Head];
+			if (Sender.SendMessage(entry.Header, entry.Message))
+			{
+				fifo.Pop();
+			}
+		}
+
+		if (Sender.GetPendingCount() > result.PendingMax)
+		{
+			result.PendingMax = Sender.GetPendingCount();
+		}
+
+		Scheduler.execute();
+		Clock.Advance(Definitions::StepNanos);
+	}
+
+	Sender.Stop();
+	Receiver.Stop();
+
+	result.StateReceived = Listener.StateReceived;
+	result.AgeAverage = (Listener.StateReceived > 0) ? (uint32_t)(Listener.AgeSum / Listener.StateReceived) : 0;
+	result.AgeMax = Listener.AgeMax;
+	result.EventReceived = Listener.EventReceived;
+	result.Errors = Listener.Errors;
+	for (uint8_t i = 0; i < Definitions::StateCount; i++)
+	{
+		if (Listener.LastValue[i] != lastValue[i])
+		{
+			result.Final = false;
+		}
+	}
+
+	return result;
+}
+
+void PrintResult(const RunResult& result)
+{
+	Serial.print(F("Produced "));
+	Serial.print(result.Produced);
+	Serial.print(F("\tReceived "));
+	Serial.print(result.StateReceived);
+	Serial.print(F("\tAge avg "));
+	Serial.print(result.AgeAverage);
+	Serial.print(F(" us\tmax "));
+	Serial.print(result.AgeMax);
+	Serial.print(F(" us\tEvents "));
+	Serial.print(result.EventReceived);
+	Serial.print('/');
+	Serial.print(result.EventSent);
+	Serial.print(F("\tPending max "));
+	Serial.print(result.PendingMax);
+	Serial.print(F("\tFinal "));
+	Serial.println(result.Final ? F("newest") : F("stale"));
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface Coalescing Test Start"));
+	Serial.println();
+
+	if (!Sender.Setup()
+		|| !Receiver.Setup())
+	{
+		Serial.println(F("Setup Failed!"));
+		OnFail();
+	}
+
+	const RunResult fifo = Run(false);
+	Serial.print(F("Fifo\t\t"));
+	PrintResult(fifo);
+	if (fifo.Errors > 0
+		|| fifo.EventReceived != fifo.EventSent
+		|| fifo.PendingMax > 0)
+	{
+		OnFail();
+	}
+
+	const RunResult coalesced = Run(true);
+	Serial.print(F("Coalesced\t"));
+	PrintResult(coalesced);
+	Serial.print(F("\t\tCoalesced "));
+	Serial.print(Sender.GetCoalescedCount());
+	Serial.print(F("\tDeferred "));
+	Serial.println(Sender.GetDeferredCount());
+	if (coalesced.Errors > 0
+		|| coalesced.EventReceived != coalesced.EventSent
+		|| coalesced.EventSent == 0
+		|| coalesced.PendingMax > Definitions::StateCount
+		|| !coalesced.Final
+		|| Sender.GetCoalescedCount() == 0
+		|| (coalesced.AgeAverage * Definitions::FreshnessGain) > fifo.AgeAverage)
+	{
+		OnFail();
+	}
+
+	Serial.println();
+	Serial.println(F("All tests passed."));
+	Serial.println();
+}
+
+void loop()
+{
+}
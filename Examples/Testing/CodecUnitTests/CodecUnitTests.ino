@@ -48,6 +48,151 @@ void OnFail()
 	while (true);;
 }
 
+static constexpr uint16_t FixedBenchmarkIterations = 1000;
+
+/// <summary>
+/// Fixed size codec must produce the same frame as the generic codec, and decode it back.
+/// </summary>
+template<uint8_t PayloadSize>
+bool FixedMessageMatch()
+{
+	FixedMessageCodec<PayloadSize> fixedCodec(Key, KeySize);
+	if (!fixedCodec.Setup())
+	{
+		return false;
+	}
+
+	static constexpr uint8_t messageSize = MessageDefinition::GetMessageSize(PayloadSize);
+	for (uint8_t i = (uint8_t)MessageDefinition::FieldIndexEnum::Header; i < messageSize; i++)
+	{
+		// Include delimiters in the data.
+		testBuffer[i] = (i % 3 == 0) ? 0 : (i * 7 + PayloadSize);
+		testOutMessage[i] = testBuffer[i];
+		testInMessage[i] = testBuffer[i];
+	}
+
+	const uint16_t genericSize = Codec.EncodeMessageAndCrcInPlace(testBuffer, messageSize);
+	const uint8_t fixedSize = fixedCodec.EncodeMessageAndCrcInPlace(testInMessage);
+
+	if (fixedSize != FixedMessageCodec<PayloadSize>::BufferSize
+		|| genericSize != fixedSize
+		|| memcmp(testBuffer, testInMessage, fixedSize) != 0)
+	{
+		return false;
+	}
+
+	if (!fixedCodec.DecodeMessageInPlaceIfValid(testInMessage)
+		|| memcmp(&testInMessage[(uint8_t)MessageDefinition::FieldIndexEnum::Header],
+			&testOutMessage[(uint8_t)MessageDefinition::FieldIndexEnum::Header],
+			messageSize - (uint8_t)MessageDefinition::FieldIndexEnum::Header) != 0)
+	{
+		return false;
+	}
+
+	// Corrupted frame must be rejected.
+	testBuffer[fixedSize - 1] ^= 0x10;
+
+	return !fixedCodec.DecodeMessageInPlaceIfValid(testBuffer);
+}
+
+/// <summary>
+/// Compile-time encoded frame must match the runtime encoding of the same message.
+/// </summary>
+template<typename FrameType, uint8_t Header, uint8_t... Payload>
+bool PreEncodedFrameMatch()
+{
+	static constexpr uint8_t payload[sizeof...(Payload) + 1]{ Payload... };
+	static constexpr uint8_t messageSize = MessageDefinition::GetMessageSize(sizeof...(Payload));
+
+	testBuffer[(uint8_t)MessageDefinition::FieldIndexEnum::Header] = Header;
+	memcpy(&testBuffer[(uint8_t)MessageDefinition::FieldIndexEnum::Payload], payload, sizeof...(Payload));
+
+	const uint16_t encodedSize = Codec.EncodeMessageAndCrcInPlace(testBuffer, messageSize);
+
+	return encodedSize == FrameType::BufferSize
+		&& memcmp(testBuffer, FrameType::GetBuffer(), encodedSize) == 0;
+}
+
+using PingFrame = PreEncodedFrame<Key, KeySize, 0x42>;
+using ZeroFrame = PreEncodedFrame<Key, KeySize, 0, 0, 0, 5, 0>;
+using RequestFrame = PreEncodedFrame<Key, KeySize, 0xFF, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 0xFF, 0x80>;
+
+// Built by the compiler.
+static_assert(PingFrame::BufferType::Data[0] != MessageDefinition::Delimiter, "Pre-encoded frame not constant.");
+
+void PreEncodedFrameEncodeMatch()
+{
+	if (!PreEncodedFrameMatch<PingFrame, 0x42>()
+		|| !PreEncodedFrameMatch<ZeroFrame, 0, 0, 0, 5, 0>()
+		|| !PreEncodedFrameMatch<RequestFrame, 0xFF, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 0xFF, 0x80>())
+	{
+		Serial.println(F("Pre-encoded frame mismatch."));
+		OnFail();
+	}
+}
+
+template<uint8_t PayloadSize>
+void FixedMessageSizeBenchmark()
+{
+	FixedMessageCodec<PayloadSize> fixedCodec(Key, KeySize);
+	fixedCodec.Setup();
+
+	static constexpr uint8_t messageSize = MessageDefinition::GetMessageSize(PayloadSize);
+	uint32_t genericMicros = 0;
+	uint32_t fixedMicros = 0;
+	uint32_t start = 0;
+
+	for (uint16_t n = 0; n < FixedBenchmarkIterations; n++)
+	{
+		testBuffer[(uint8_t)MessageDefinition::FieldIndexEnum::Header] = (uint8_t)n;
+		start = micros();
+		const uint16_t encodedSize = Codec.EncodeMessageAndCrcInPlace(testBuffer, messageSize);
+		Codec.DecodeMessageInPlaceIfValid(testBuffer, encodedSize);
+		genericMicros += micros() - start;
+
+		testInMessage[(uint8_t)MessageDefinition::FieldIndexEnum::Header] = (uint8_t)n;
+		start = micros();
+		fixedCodec.EncodeMessageAndCrcInPlace(testInMessage);
+		fixedCodec.DecodeMessageInPlaceIfValid(testInMessage);
+		fixedMicros += micros() - start;
+	}
+
+	Serial.print(F("Message Encode+Decode "));
+	Serial.print(PayloadSize);
+	Serial.print(F(" byte payload x"));
+	Serial.print(FixedBenchmarkIterations);
+	Serial.print(F(" generic "));
+	Serial.print(genericMicros);
+	Serial.print(F(" us, fixed "));
+	Serial.print(fixedMicros);
+	Serial.println(F(" us"));
+}
+
+void FixedMessageEncodeAndDecodeMatch()
+{
+	if (!FixedMessageMatch<0>()
+		|| !FixedMessageMatch<1>()
+		|| !FixedMessageMatch<4>()
+		|| !FixedMessageMatch<8>()
+		|| !FixedMessageMatch<16>()
+		|| !FixedMessageMatch<32>()
+		|| !FixedMessageMatch<64>()
+		|| !FixedMessageMatch<MessageDefinition::PayloadSizeMax>())
+	{
+		Serial.println(F("Fixed message mismatch."));
+		OnFail();
+	}
+}
+
+void FixedMessageBenchmark()
+{
+	FixedMessageSizeBenchmark<4>();
+	FixedMessageSizeBenchmark<8>();
+	FixedMessageSizeBenchmark<16>();
+	FixedMessageSizeBenchmark<32>();
+	Serial.println();
+}
+
 void setup()
 {
 	Serial.begin(SERIAL_BAUD_RATE);
@@ -65,6 +210,8 @@ void setup()
 
 	CobsEncodeAndDecodeMatch();
 	MessageEncodeAndDecodeMatch();
+	FixedMessageEncodeAndDecodeMatch();
+	PreEncodedFrameEncodeMatch();
 
 	Serial.println();
 	Serial.println(F("All tests passed."));
@@ -72,6 +219,7 @@ void setup()
 
 	CobsBenchmark();
 	MessageEncodeAndDecodeBenchmark();
+	FixedMessageBenchmark();
 
 	Serial.println(F("All benchmarks complete."));
 	Serial.println();
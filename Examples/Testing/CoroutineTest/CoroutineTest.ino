@@ -0,0 +1,232 @@
+/*
+	Library Coroutine Testing Project.
+	Ping-pong between two CoroutineUartInterface endpoints over a simulated link, with co_await Send()/Receive().
+	An exception thrown in a coroutine must reach the code that resumed it, and free its frame.
+	Host only (e.g. EpoxyDuino) and C++20, the whole stack runs from the VirtualClock through _TASK_EXTERNAL_TIME.
+	UartInterfaceTask depends on TaskScheduler (https://github.com/arkhipenko/TaskScheduler).
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#define _TASK_EXTERNAL_TIME
+#define _TASK_OO_CALLBACKS
+#include <TScheduler.hpp>
+
+#include <UartInterface.h>
+#include <UartInterfaceTask.h>
+#include <UartInterfaceSimulation.h>
+#include <UartInterfaceCoroutine.h>
+
+#include <stdexcept>
+
+using namespace UartInterface;
+using namespace UartInterface::Coroutine;
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint8_t PingHeader = 1;
+	static constexpr uint8_t PongHeader = 2;
+	static constexpr uint8_t SilentHeader = 3;
+	static constexpr uint16_t PingCount = 100;
+	static constexpr uint32_t StepNanos = 5000;
+
+	using UartDefinitions = TemplateUartDefinitions<1000000>;
+	using LinkType = Simulation::SimulatedLink<64, 64>;
+	using InterfaceType = CoroutineUartInterface<LinkType::Endpoint, UartDefinitions>;
+}
+
+Simulation::VirtualClock Clock{};
+
+uint32_t external_millis()
+{
+	return Clock.Millis();
+}
+
+uint32_t external_micros()
+{
+	return Clock.Micros();
+}
+
+TS::Scheduler SchedulerBase{};
+Definitions::LinkType Link(Clock);
+Definitions::InterfaceType Interface1(SchedulerBase, Link.A, nullptr, Definitions::Key, Definitions::KeySize);
+Definitions::InterfaceType Interface2(SchedulerBase, Link.B, nullptr, Definitions::Key, Definitions::KeySize);
+
+uint16_t Pongs = 0;
+uint16_t Failures = 0;
+bool PingDone = false;
+
+UartCoroutine PingLoop(Definitions::InterfaceType& interface)
+{
+	for (uint16_t i = 0; i < Definitions::PingCount; i++)
+	{
+		const uint8_t payload[2]{ (uint8_t)i, (uint8_t)(i >> 8) };
+
+		if (co_await interface.Send(Definitions::PingHeader, payload, sizeof(payload)) != SendResultEnum::Sent)
+		{
+			Failures++;
+			continue;
+		}
+
+		const auto reply = co_await interface.Receive(Definitions::PongHeader, 100);
+		if (reply.Valid
+			&& reply.PayloadSize == sizeof(payload)
+			&& reply.Payload[0] == payload[0]
+			&& reply.Payload[1] == payload[1])
+		{
+			Pongs++;
+		}
+		else
+		{
+			Failures++;
+		}
+	}
+
+	PingDone = true;
+}
+
+UartCoroutine PongLoop(Definitions::InterfaceType& interface)
+{
+	while (true)
+	{
+		const auto request = co_await interface.Receive(Definitions::PingHeader);
+
+		co_await interface.Send(Definitions::PongHeader, request.Payload, request.PayloadSize);
+	}
+}
+
+UartCoroutine ThrowingLoop(Definitions::InterfaceType& interface, const bool immediately)
+{
+	if (immediately)
+	{
+		throw std::runtime_error("Before the first suspension.");
+	}
+
+	co_await interface.Receive(Definitions::SilentHeader, 10);
+
+	throw std::runtime_error("Resumed by the interface.");
+}
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface Coroutine Test Start"));
+	Serial.println();
+
+	if (!Interface1.Setup() ||
+		!Interface2.Setup())
+	{
+		Serial.println(F("Setup Failed!"));
+		OnFail();
+	}
+
+	Interface1.Start();
+	Interface2.Start();
+
+	// Let both endpoints connect.
+	while (!Interface1.GetInterface().CanSendMessage()
+		|| !Interface2.GetInterface().CanSendMessage())
+	{
+		SchedulerBase.execute();
+		Clock.Advance(Definitions::StepNanos);
+	}
+
+	if (!PongLoop(Interface2).Valid()
+		|| !PingLoop(Interface1).Valid())
+	{
+		Serial.println(F("Frame pool exhausted."));
+		OnFail();
+	}
+
+	while (!PingDone
+		&& Clock.Millis() < 10000)
+	{
+		SchedulerBase.execute();
+		Clock.Advance(Definitions::StepNanos);
+	}
+
+	Serial.print(F("Pongs "));
+	Serial.print(Pongs);
+	Serial.print(F("\tFailures "));
+	Serial.print(Failures);
+	Serial.print(F("\tElapsed "));
+	Serial.print(Clock.Millis());
+	Serial.println(F(" ms"));
+
+	// Only the pong loop still holds a frame.
+	if (!PingDone
+		|| Pongs != Definitions::PingCount
+		|| UartCoroutine::GetFreeFrames() != 7)
+	{
+		OnFail();
+	}
+
+	// Thrown to the caller.
+	bool caught = false;
+	try
+	{
+		ThrowingLoop(Interface1, true);
+	}
+	catch (const std::runtime_error&)
+	{
+		caught = true;
+	}
+	if (!caught
+		|| UartCoroutine::GetFreeFrames() != 7)
+	{
+		OnFail();
+	}
+
+	// Thrown out of the scheduler, on the receive timeout.
+	caught = false;
+	if (!ThrowingLoop(Interface1, false).Valid())
+	{
+		OnFail();
+	}
+	const uint32_t throwStart = Clock.Millis();
+	while (!caught
+		&& Clock.Millis() - throwStart < 100)
+	{
+		try
+		{
+			SchedulerBase.execute();
+		}
+		catch (const std::runtime_error&)
+		{
+			caught = true;
+		}
+		Clock.Advance(Definitions::StepNanos);
+	}
+
+	Serial.print(F("Exceptions caught\tFree frames "));
+	Serial.println(UartCoroutine::GetFreeFrames());
+	if (!caught
+		|| UartCoroutine::GetFreeFrames() != 7)
+	{
+		OnFail();
+	}
+
+	Serial.println();
+	Serial.println(F("All tests passed."));
+	Serial.println();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,263 @@
+/*
+	Library End-to-End Benchmark Project.
+	Measures what the application sees: two UartInterfaceTask endpoints over a simulated link, cross-wired.
+	Sweeps baud rate, payload size and send rate.
+	MaxSerialStepOut/MaxSerialStepIn are left at their defaults: a scheduler pass here is shorter than a byte on the wire, so they never bind.
+	Reports goodput, drops/rejections and enqueue-to-OnUartRx latency percentiles, as a diffable table.
+	Host only (e.g. EpoxyDuino), the whole stack runs from the VirtualClock through _TASK_EXTERNAL_TIME.
+	UartInterfaceTask depends on TaskScheduler (https://github.com/arkhipenko/TaskScheduler).
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#define _TASK_EXTERNAL_TIME
+#define _TASK_OO_CALLBACKS
+#include <TScheduler.hpp>
+
+#include <UartInterface.h>
+#include <UartInterfaceTask.h>
+#include <UartInterfaceSimulation.h>
+
+#include <stdlib.h>
+
+using namespace UartInterface;
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	/// <summary>
+	/// Simulated time of one scheduler pass.
+	/// </summary>
+	static constexpr uint32_t PassNanos = 2000;
+	static constexpr uint32_t DurationMillis = 1000;
+	static constexpr uint32_t DrainMillis = 100;
+
+	static constexpr uint8_t MaxPayloadSize = 64;
+	static constexpr uint16_t MaxSamples = 16384;
+
+	using LinkType = Simulation::SimulatedLink<64, 64>;
+}
+
+Simulation::VirtualClock Clock{};
+
+uint32_t external_millis()
+{
+	return Clock.Millis();
+}
+
+uint32_t external_micros()
+{
+	return Clock.Micros();
+}
+
+struct BenchmarkResult
+{
+	uint32_t Sent;
+	uint32_t Rejected;
+	uint32_t Received;
+	uint32_t RxErrors;
+	uint32_t PayloadBytes;
+	uint16_t SampleCount;
+	uint32_t SendMicros[UINT16_MAX + 1];
+	uint32_t Latencies[Definitions::MaxSamples];
+};
+
+BenchmarkResult Result{};
+
+/// <summary>
+/// Records enqueue-to-delivery latency, from the sequence number in the first 2 payload bytes.
+/// </summary>
+struct LatencyListener : UartListener
+{
+	void OnUartStateChange(const bool connected) final {}
+
+	void OnUartRx(const uint8_t header) final
+	{
+		Result.Received++;
+	}
+
+	void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+	{
+		Result.Received++;
+		Result.PayloadBytes += payloadSize;
+
+		if (payloadSize >= sizeof(uint16_t)
+			&& Result.SampleCount < Definitions::MaxSamples)
+		{
+			const uint16_t sequence = (uint16_t)payload[0] | ((uint16_t)payload[1] << 8);
+			Result.Latencies[Result.SampleCount++] = Clock.Micros() - Result.SendMicros[sequence];
+		}
+	}
+
+	void OnUartTx() final {}
+
+	void OnUartRxError(const RxErrorEnum error) final
+	{
+		Result.RxErrors++;
+	}
+
+	void OnUartTxError(const TxErrorEnum error) final {}
+};
+
+int CompareLatency(const void* a, const void* b)
+{
+	const uint32_t left = *(const uint32_t*)a;
+	const uint32_t right = *(const uint32_t*)b;
+
+	return (left > right) - (left < right);
+}
+
+uint32_t GetPercentile(const uint8_t percentile)
+{
+	if (Result.SampleCount == 0)
+	{
+		return 0;
+	}
+
+	return Result.Latencies[((uint32_t)(Result.SampleCount - 1) * percentile) / 100];
+}
+
+void PrintHeader()
+{
+	Serial.println(F("Baud\tPayload\tPeriod\tSent\tReject\tRecv\tLost\tMsg/s\tGood%\tp50us\tp99us\tMaxus"));
+}
+
+/// <summary>
+/// Runs one benchmark case.
+/// </summary>
+/// <param name="payloadSize">Payload size, at least 2 bytes for the sequence number.</param>
+/// <param name="sendPeriodMicros">Period between send attempts, 0 to saturate the link.</param>
+template<uint32_t Baudrate>
+void RunCase(const uint8_t payloadSize, const uint32_t sendPeriodMicros)
+{
+	using UartDefinitions = TemplateUartDefinitions<Baudrate, Definitions::MaxPayloadSize>;
+	using UartInterfaceTaskType = UartInterfaceTask<Definitions::LinkType::Endpoint, UartDefinitions>;
+
+	memset(&Result, 0, sizeof(Result));
+	Clock.Reset();
+
+	LatencyListener listener{};
+	TS::Scheduler scheduler{};
+	Definitions::LinkType link(Clock);
+
+	UartInterfaceTaskType sender(scheduler, link.A, nullptr, Definitions::Key, Definitions::KeySize);
+	UartInterfaceTaskType receiver(scheduler, link.B, &listener, Definitions::Key, Definitions::KeySize);
+
+	if (!sender.Setup() || !receiver.Setup())
+	{
+		Serial.println(F("Setup Failed!"));
+		return;
+	}
+
+	sender.Start();
+	receiver.Start();
+
+	uint8_t payload[Definitions::MaxPayloadSize]{};
+	uint32_t nextSend = 0;
+	while (Clock.Millis() < (Definitions::DurationMillis + Definitions::DrainMillis))
+	{
+		const uint32_t now = Clock.Micros();
+		if (Clock.Millis() < Definitions::DurationMillis)
+		{
+			const bool due = (sendPeriodMicros == 0) ? sender.CanSendMessage() : (int32_t)(now - nextSend) >= 0;
+			if (due)
+			{
+				const uint16_t sequence = (uint16_t)Result.Sent;
+				payload[0] = (uint8_t)sequence;
+				payload[1] = (uint8_t)(sequence >> 8);
+				Result.SendMicros[sequence] = now;
+				nextSend += sendPeriodMicros;
+
+				if (sender.SendMessage(0, payload, payloadSize))
+				{
+					Result.Sent++;
+				}
+				else
+				{
+					Result.Rejected++;
+				}
+			}
+		}
+
+		scheduler.execute();
+		Clock.Advance(Definitions::PassNanos);
+	}
+
+	sender.Stop();
+	receiver.Stop();
+
+	qsort(Result.Latencies, Result.SampleCount, sizeof(uint32_t), CompareLatency);
+
+	const uint32_t messagesPerSecond = ((uint64_t)Result.Received * 1000) / Definitions::DurationMillis;
+	const uint32_t goodputBytesPerSecond = ((uint64_t)Result.PayloadBytes * 1000) / Definitions::DurationMillis;
+	const uint32_t goodputPercent = ((uint64_t)goodputBytesPerSecond * 100) / (Baudrate / 10);
+
+	Serial.print(Baudrate);
+	Serial.print('\t');
+	Serial.print(payloadSize);
+	Serial.print('\t');
+	Serial.print(sendPeriodMicros);
+	Serial.print('\t');
+	Serial.print(Result.Sent);
+	Serial.print('\t');
+	Serial.print(Result.Rejected);
+	Serial.print('\t');
+	Serial.print(Result.Received);
+	Serial.print('\t');
+	Serial.print(Result.Sent - Result.Received);
+	Serial.print('\t');
+	Serial.print(messagesPerSecond);
+	Serial.print('\t');
+	Serial.print(goodputPercent);
+	Serial.print('\t');
+	Serial.print(GetPercentile(50));
+	Serial.print('\t');
+	Serial.print(GetPercentile(99));
+	Serial.print('\t');
+	Serial.println(GetPercentile(100));
+}
+
+template<uint32_t Baudrate>
+void RunSweep()
+{
+	static constexpr uint8_t PayloadSizes[]{ 2, 16, 64 };
+	static constexpr uint32_t SendPeriods[]{ 0, 2000 };
+
+	for (uint8_t i = 0; i < sizeof(PayloadSizes); i++)
+	{
+		for (uint8_t j = 0; j < sizeof(SendPeriods) / sizeof(SendPeriods[0]); j++)
+		{
+			RunCase<Baudrate>(PayloadSizes[i], SendPeriods[j]);
+		}
+	}
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface End-to-End Benchmark Start"));
+	Serial.print(F("Simulated "));
+	Serial.print(Definitions::DurationMillis);
+	Serial.print(F(" ms per case, "));
+	Serial.print(Definitions::PassNanos);
+	Serial.println(F(" ns per scheduler pass."));
+	Serial.println();
+
+	PrintHeader();
+	RunSweep<115200>();
+	RunSweep<1000000>();
+
+	Serial.println();
+	Serial.println(F("All benchmarks complete."));
+	Serial.println();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,265 @@
+/*
+	Library Event-Driven Idle Testing Project.
+	Runs the same traffic and quiet period with polled idle, event-driven idle, and event-driven idle with a safety net.
+	Event-driven idle must deliver the same messages as promptly, with no RX polls and no scheduler wakeups while the link is quiet.
+	Disconnect and reconnect must still be noticed, through OnConnectionChange().
+	Host only (e.g. EpoxyDuino), the whole stack runs from the VirtualClock through _TASK_EXTERNAL_TIME.
+	UartInterfaceTask depends on TaskScheduler (https://github.com/arkhipenko/TaskScheduler).
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#define _TASK_EXTERNAL_TIME
+#define _TASK_OO_CALLBACKS
+#include <TScheduler.hpp>
+
+#include <UartInterface.h>
+#include <UartInterfaceTask.h>
+#include <UartInterfaceSimulation.h>
+
+using namespace UartInterface;
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint32_t Baudrate = 115200;
+	static constexpr uint32_t StepNanos = 5000;
+
+	static constexpr uint8_t Messages = 50;
+	static constexpr uint32_t MessagePeriodMillis = 20;
+	static constexpr uint32_t IdleMillis = 2000;
+	static constexpr uint32_t SafetyMillis = 100;
+
+	// A frame time, rounded up to the scheduler's millisecond, and one more.
+	static constexpr uint32_t LatencyMaxMicros = 3000;
+
+	using PolledDefinitions = TemplateUartDefinitions<Baudrate>;
+	struct EventDefinitions : TemplateUartDefinitions<Baudrate>
+	{
+		static constexpr bool EventDrivenIdle = true;
+	};
+
+	struct SafetyDefinitions : EventDefinitions
+	{
+		static constexpr uint32_t IdleSafetyMillis = SafetyMillis;
+	};
+
+	using LinkType = Simulation::SimulatedLink<64, 64>;
+}
+
+Simulation::VirtualClock Clock{};
+
+uint32_t external_millis()
+{
+	return Clock.Millis();
+}
+
+uint32_t external_micros()
+{
+	return Clock.Micros();
+}
+
+struct IdleListener : UartListener
+{
+	uint32_t SentMicros = 0;
+	uint32_t LatencyMax = 0;
+	uint32_t Received = 0;
+	uint32_t Errors = 0;
+	uint8_t Connects = 0;
+	uint8_t Disconnects = 0;
+
+	void OnUartStateChange(const bool connected) final
+	{
+		connected ? Connects++ : Disconnects++;
+	}
+
+	void OnUartRx(const uint8_t header) final
+	{
+		Errors++;
+	}
+
+	void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+	{
+		const uint32_t latency = Clock.Micros() - SentMicros;
+		if (latency > LatencyMax)
+		{
+			LatencyMax = latency;
+		}
+		Received++;
+	}
+
+	void OnUartTx() final {}
+	void OnUartRxError(const RxErrorEnum error) final { Errors++; }
+	void OnUartTxError(const TxErrorEnum error) final { Errors++; }
+};
+
+struct IdleResult
+{
+	uint32_t Received = 0;
+	uint32_t LatencyMax = 0;
+	uint32_t IdlePolls = 0;
+	uint32_t IdleWakeups = 0;
+	bool ReconnectSeen = false;
+};
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+/// <summary>
+/// Steps the scheduler, with the serial RX interrupt standing in as OnSerialEvent() on each byte arrival.
+/// </summary>
+/// <returns>Scheduler passes that ran a task.</returns>
+template<typename InterfaceType>
+uint32_t Run(TS::Scheduler& scheduler, Definitions::LinkType& link, InterfaceType& sender, InterfaceType& receiver, const uint32_t durationMicros)
+{
+	static int lastSender = 0;
+	static int lastReceiver = 0;
+
+	uint32_t wakeups = 0;
+	const uint32_t start = Clock.Micros();
+	while (Clock.Micros() - start < durationMicros)
+	{
+		const int senderAvailable = link.A.available();
+		const int receiverAvailable = link.B.available();
+		if (senderAvailable > lastSender)
+		{
+			sender.OnSerialEvent();
+		}
+		if (receiverAvailable > lastReceiver)
+		{
+			receiver.OnSerialEvent();
+		}
+
+		if (!scheduler.execute())
+		{
+			wakeups++;
+		}
+
+		lastSender = link.A.available();
+		lastReceiver = link.B.available();
+		Clock.Advance(Definitions::StepNanos);
+	}
+
+	return wakeups;
+}
+
+template<typename UartDefinitions>
+IdleResult RunScenario(const char* name)
+{
+	using InterfaceType = UartInterfaceTask<Definitions::LinkType::Endpoint, UartDefinitions>;
+
+	IdleResult result{};
+	IdleListener listener{};
+
+	Clock.Reset();
+	TS::Scheduler scheduler{};
+	Definitions::LinkType link(Clock, 1000, 1);
+
+	InterfaceType sender(scheduler, link.A, nullptr, Definitions::Key, Definitions::KeySize);
+	InterfaceType receiver(scheduler, link.B, &listener, Definitions::Key, Definitions::KeySize);
+	if (!sender.Setup() || !receiver.Setup())
+	{
+		OnFail();
+	}
+
+	sender.Start();
+	receiver.Start();
+	Run(scheduler, link, sender, receiver, 10000);
+
+	// Traffic, spaced out so each message finds the receiver idle.
+	uint8_t payload[8]{};
+	for (uint8_t i = 0; i < Definitions::Messages; i++)
+	{
+		listener.SentMicros = Clock.Micros();
+		if (!sender.SendMessage(i, payload, sizeof(payload)))
+		{
+			OnFail();
+		}
+		Run(scheduler, link, sender, receiver, Definitions::MessagePeriodMillis * 1000);
+	}
+
+	// Lets the read timeouts run out.
+	Run(scheduler, link, sender, receiver, (Definitions::PolledDefinitions::ReadTimeoutMillis * 2 + 10) * 1000);
+
+	const uint32_t polls = sender.GetRxPollCount() + receiver.GetRxPollCount();
+	result.IdleWakeups = Run(scheduler, link, sender, receiver, Definitions::IdleMillis * 1000);
+	result.IdlePolls = sender.GetRxPollCount() + receiver.GetRxPollCount() - polls;
+
+	// Connection changes, notified.
+	link.Disconnect();
+	sender.OnConnectionChange();
+	receiver.OnConnectionChange();
+	Run(scheduler, link, sender, receiver, 10000);
+	link.Connect();
+	sender.OnConnectionChange();
+	receiver.OnConnectionChange();
+	Run(scheduler, link, sender, receiver, 10000);
+	result.ReconnectSeen = listener.Disconnects == 1 && listener.Connects == 2 && sender.CanSendMessage();
+
+	result.Received = listener.Received;
+	result.LatencyMax = listener.LatencyMax;
+
+	Serial.print(name);
+	Serial.print(F("\tReceived "));
+	Serial.print(result.Received);
+	Serial.print('/');
+	Serial.print(Definitions::Messages);
+	Serial.print(F("\tLatency max "));
+	Serial.print(result.LatencyMax);
+	Serial.print(F(" us\tIdle RX polls/s "));
+	Serial.print((result.IdlePolls * 1000) / Definitions::IdleMillis);
+	Serial.print(F("\tIdle wakeups/s "));
+	Serial.println((result.IdleWakeups * 1000) / Definitions::IdleMillis);
+
+	if (listener.Errors > 0
+		|| result.Received != Definitions::Messages
+		|| result.LatencyMax > Definitions::LatencyMaxMicros
+		|| !result.ReconnectSeen)
+	{
+		OnFail();
+	}
+
+	return result;
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface Event-Driven Idle Test Start"));
+	Serial.println();
+
+	const IdleResult polled = RunScenario<Definitions::PolledDefinitions>("Polled\t");
+	const IdleResult event = RunScenario<Definitions::EventDefinitions>("Event-driven");
+	const IdleResult safety = RunScenario<Definitions::SafetyDefinitions>("Safety net");
+
+	// Two endpoints, each polling every PollPeriodMillis.
+	static constexpr uint32_t SafetyPolls = (2 * Definitions::IdleMillis) / Definitions::SafetyMillis;
+	if (polled.IdlePolls < Definitions::IdleMillis
+		|| event.IdlePolls > 0
+		|| event.IdleWakeups > 0
+		|| safety.IdlePolls > SafetyPolls + 2
+		|| safety.IdlePolls + 2 < SafetyPolls)
+	{
+		OnFail();
+	}
+
+	Serial.println();
+	Serial.println(F("All tests passed."));
+	Serial.println();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,550 @@
+/*
+	Library Forward Error Correction Benchmark Project.
+	Checks that the Reed-Solomon stage corrects every frame with up to ParitySize / 2 byte errors, and never delivers a wrong one.
+	Reports the encode and decode cost per frame for each parity size,
+	 and the goodput over a simulated link with injected bit errors, with and without parity.
+	Host only (e.g. EpoxyDuino), the link runs from the VirtualClock through _TASK_EXTERNAL_TIME.
+	UartInterfaceTask depends on TaskScheduler (https://github.com/arkhipenko/TaskScheduler).
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#define _TASK_EXTERNAL_TIME
+#define _TASK_OO_CALLBACKS
+#include <TScheduler.hpp>
+
+#include <UartInterface.h>
+#include <UartInterfaceTask.h>
+#include <UartInterfaceSimulation.h>
+
+#include <chrono>
+
+using namespace UartInterface;
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint8_t PayloadSize = 32;
+	static constexpr uint32_t CorrectionRuns = 20000;
+	static constexpr uint32_t CostRuns = 200000;
+
+	static constexpr uint32_t Baudrate = 115200;
+	static constexpr uint32_t PropagationNanos = 2000;
+	static constexpr uint32_t StepNanos = 5000;
+	static constexpr uint32_t DurationMillis = 2000;
+	static constexpr uint32_t DrainMillis = 50;
+
+	static constexpr uint32_t BitFlipPpms[]{ 0, 100, 500, 1000, 2000 };
+
+	using LinkType = Simulation::SimulatedLink<64, 64>;
+
+	template<uint8_t ParitySize>
+	struct UartDefinitions : TemplateUartDefinitions<Baudrate, PayloadSize>
+	{
+		static constexpr uint8_t FecParitySize = ParitySize;
+	};
+}
+
+Simulation::VirtualClock Clock{};
+
+uint32_t external_millis()
+{
+	return Clock.Millis();
+}
+
+uint32_t external_micros()
+{
+	return Clock.Micros();
+}
+
+/// <summary>
+/// Deterministic xorshift, for reproducible runs.
+/// </summary>
+struct Random
+{
+	uint32_t State;
+
+	Random(const uint32_t seed)
+		: State(seed)
+	{
+	}
+
+	uint32_t Next()
+	{
+		State ^= State << 13;
+		State ^= State >> 17;
+		State ^= State << 5;
+
+		return State;
+	}
+
+	uint8_t NextNonZero()
+	{
+		return (uint8_t)(1 + (Next() % UINT8_MAX));
+	}
+};
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+void FillMessage(uint8_t* message, const uint8_t header, Random& random)
+{
+	message[(uint8_t)MessageDefinition::FieldIndexEnum::Header] = header;
+	for (uint8_t i = 0; i < Definitions::PayloadSize; i++)
+	{
+		message[(uint8_t)MessageDefinition::FieldIndexEnum::Payload + i] = (uint8_t)random.Next();
+	}
+}
+
+/// <summary>
+/// Marks the COBS code bytes of a clean encoded buffer.
+/// </summary>
+void MarkCodes(const uint8_t* buffer, const uint8_t size, bool* codes)
+{
+	memset(codes, 0, size);
+	uint16_t index = 0;
+	while (index < size)
+	{
+		codes[index] = true;
+		index += buffer[index];
+	}
+}
+
+/// <summary>
+/// Corrupts count distinct bytes of the encoded buffer, never into a delimiter.
+/// With skipCodes, COBS codes are left alone: each error then stays a single byte error after decoding.
+/// </summary>
+void Corrupt(uint8_t* buffer, const uint8_t size, const uint8_t count, const bool skipCodes, Random& random)
+{
+	bool codes[UartCobsCodec::BufferSizeMax];
+	MarkCodes(buffer, size, codes);
+
+	bool hit[UartCobsCodec::BufferSizeMax]{};
+	uint8_t corrupted = 0;
+	while (corrupted < count)
+	{
+		const uint8_t index = (uint8_t)(random.Next() % size);
+		if (hit[index]
+			|| (skipCodes && codes[index]))
+		{
+			continue;
+		}
+
+		uint8_t value = buffer[index];
+		while (value == buffer[index])
+		{
+			value = random.NextNonZero();
+		}
+		buffer[index] = value;
+		hit[index] = true;
+		corrupted++;
+	}
+}
+
+/// <summary>
+/// Raw codewords with up to t random byte errors must all be corrected, t + 1 must never pass as corrected.
+/// </summary>
+template<uint8_t ParitySize>
+void TestCodeword()
+{
+	static constexpr uint8_t t = ReedSolomon<ParitySize>::CorrectableErrors;
+	static constexpr uint8_t DataSize = 255 - ParitySize;
+
+	ReedSolomon<ParitySize> code{};
+	if (!code.Setup())
+	{
+		OnFail();
+	}
+
+	Random random(ParitySize);
+	uint8_t clean[255];
+	uint8_t codeword[255];
+	uint32_t detected = 0;
+	for (uint32_t run = 0; run < Definitions::CorrectionRuns / 4; run++)
+	{
+		// Shortened and full length codewords.
+		const uint8_t dataSize = (run % 2) ? DataSize : (uint8_t)(1 + (random.Next() % DataSize));
+		const uint8_t size = dataSize + ParitySize;
+		for (uint8_t i = 0; i < dataSize; i++)
+		{
+			clean[i] = (uint8_t)random.Next();
+		}
+		code.Encode(clean, dataSize, &clean[dataSize]);
+
+		const uint8_t errors = (uint8_t)(random.Next() % (t + 2));
+		memcpy(codeword, clean, size);
+		bool hit[255]{};
+		for (uint8_t e = 0; e < errors && e < size; e++)
+		{
+			uint8_t index = (uint8_t)(random.Next() % size);
+			while (hit[index])
+			{
+				index = (uint8_t)(random.Next() % size);
+			}
+			hit[index] = true;
+			codeword[index] ^= random.NextNonZero();
+		}
+
+		const bool decoded = code.Decode(codeword, size);
+		const bool match = memcmp(codeword, clean, size) == 0;
+		if (errors <= t)
+		{
+			if (!decoded || !match)
+			{
+				OnFail();
+			}
+		}
+		else if (!decoded)
+		{
+			detected++;
+		}
+		else if (match)
+		{
+			OnFail();
+		}
+	}
+
+	Serial.print(F("Codeword\tParity "));
+	Serial.print(ParitySize);
+	Serial.print(F("\tCorrected bytes "));
+	Serial.print(code.GetStats().CorrectedBytes);
+	Serial.print(F("\tDetected beyond t "));
+	Serial.println(detected);
+}
+
+/// <summary>
+/// Whole messages through MessageCodec, corrupted after encoding.
+/// Up to t errors in data bytes are always corrected, beyond that the CRC must reject what the code can't.
+/// </summary>
+template<uint8_t ParitySize>
+void TestMessage()
+{
+	static constexpr uint8_t t = ReedSolomon<ParitySize>::CorrectableErrors;
+	static constexpr uint8_t MessageSize = MessageDefinition::GetMessageSize(Definitions::PayloadSize);
+
+	MessageCodec<Definitions::PayloadSize, ParitySize> codec(Definitions::Key, Definitions::KeySize);
+	if (!codec.Setup())
+	{
+		OnFail();
+	}
+
+	Random random(1000 + ParitySize);
+	uint8_t message[MessageCodec<Definitions::PayloadSize, ParitySize>::BufferSize];
+	uint8_t clean[MessageSize];
+	uint32_t accepted = 0;
+	uint32_t rejected = 0;
+	for (uint32_t run = 0; run < Definitions::CorrectionRuns; run++)
+	{
+		FillMessage(message, (uint8_t)run, random);
+		memcpy(clean, message, MessageSize);
+
+		const uint8_t size = codec.EncodeMessageAndCrcInPlace(message, MessageSize);
+		if (size != MessageDefinition::GetBufferSizeFromMessage(MessageSize + ParitySize))
+		{
+			OnFail();
+		}
+
+		// Code bytes included, beyond the guarantee.
+		const bool guaranteed = (run % 2) == 0;
+		const uint8_t errors = guaranteed ? (uint8_t)(random.Next() % (t + 1)) : (uint8_t)(1 + (random.Next() % (ParitySize + 1)));
+		Corrupt(message, size, errors, guaranteed, random);
+
+		const bool valid = codec.DecodeMessageInPlaceIfValid(message, size);
+		if (valid && memcmp(&message[(uint8_t)MessageDefinition::FieldIndexEnum::Header],
+			&clean[(uint8_t)MessageDefinition::FieldIndexEnum::Header], MessageSize - MessageDefinition::CrcSize) != 0)
+		{
+			OnFail();
+		}
+
+		if (guaranteed && !valid)
+		{
+			OnFail();
+		}
+
+		if (!guaranteed)
+		{
+			valid ? accepted++ : rejected++;
+		}
+	}
+
+	Serial.print(F("Message\t\tParity "));
+	Serial.print(ParitySize);
+	Serial.print(F("\tCorrected frames "));
+	Serial.print(codec.GetFecStats().CorrectedFrames);
+	Serial.print(F("\tBeyond t, recovered "));
+	Serial.print(accepted);
+	Serial.print(F(" rejected "));
+	Serial.println(rejected);
+}
+
+/// <summary>
+/// Encode and decode time per frame, clean and with t byte errors.
+/// </summary>
+template<uint8_t ParitySize>
+void BenchmarkCost()
+{
+	static constexpr uint8_t t = ReedSolomon<ParitySize>::CorrectableErrors;
+	static constexpr uint8_t MessageSize = MessageDefinition::GetMessageSize(Definitions::PayloadSize);
+	static constexpr uint8_t Frames = 64;
+
+	MessageCodec<Definitions::PayloadSize, ParitySize> codec(Definitions::Key, Definitions::KeySize);
+	codec.Setup();
+
+	Random random(7);
+	uint8_t encoded[Frames][MessageCodec<Definitions::PayloadSize, ParitySize>::BufferSize];
+	uint8_t corrupted[Frames][MessageCodec<Definitions::PayloadSize, ParitySize>::BufferSize];
+	uint8_t work[MessageCodec<Definitions::PayloadSize, ParitySize>::BufferSize];
+	uint8_t size = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t run = 0; run < Definitions::CostRuns; run++)
+	{
+		uint8_t* message = encoded[run % Frames];
+		FillMessage(message, (uint8_t)run, random);
+		size = codec.EncodeMessageAndCrcInPlace(message, MessageSize);
+	}
+	const double encodeNanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / Definitions::CostRuns;
+
+	for (uint8_t i = 0; i < Frames; i++)
+	{
+		memcpy(corrupted[i], encoded[i], size);
+		Corrupt(corrupted[i], size, t, true, random);
+	}
+
+	uint32_t valid = 0;
+	start = std::chrono::steady_clock::now();
+	for (uint32_t run = 0; run < Definitions::CostRuns; run++)
+	{
+		memcpy(work, encoded[run % Frames], size);
+		valid += codec.DecodeMessageInPlaceIfValid(work, size);
+	}
+	const double decodeNanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / Definitions::CostRuns;
+
+	start = std::chrono::steady_clock::now();
+	for (uint32_t run = 0; run < Definitions::CostRuns; run++)
+	{
+		memcpy(work, corrupted[run % Frames], size);
+		valid += codec.DecodeMessageInPlaceIfValid(work, size);
+	}
+	const double correctNanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / Definitions::CostRuns;
+
+	Serial.print(F("Cost\t\tParity "));
+	Serial.print(ParitySize);
+	Serial.print(F("\tFrame "));
+	Serial.print(size + 2);
+	Serial.print(F(" bytes\tEncode "));
+	Serial.print(encodeNanos, 0);
+	Serial.print(F(" ns\tDecode "));
+	Serial.print(decodeNanos, 0);
+	Serial.print(F(" ns\tDecode with "));
+	Serial.print(t);
+	Serial.print(F(" errors "));
+	Serial.print(correctNanos, 0);
+	Serial.println(F(" ns"));
+
+	// Without parity, t is 0 and the frames are left clean.
+	if (valid != 2 * Definitions::CostRuns)
+	{
+		OnFail();
+	}
+}
+
+struct GoodputListener : UartListener
+{
+	uint32_t PayloadBytes = 0;
+	uint32_t Wrong = 0;
+	uint32_t RxErrors = 0;
+
+	void OnUartStateChange(const bool connected) final {}
+
+	void OnUartRx(const uint8_t header) final
+	{
+		Wrong++;
+	}
+
+	void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+	{
+		for (uint8_t i = 0; i < payloadSize; i++)
+		{
+			if (payload[i] != (uint8_t)(header + i))
+			{
+				Wrong++;
+				return;
+			}
+		}
+		PayloadBytes += payloadSize;
+	}
+
+	void OnUartTx() final {}
+	void OnUartRxError(const RxErrorEnum error) final { RxErrors++; }
+	void OnUartTxError(const TxErrorEnum error) final {}
+};
+
+struct GoodputResult
+{
+	uint32_t BytesPerSecond = 0;
+	uint32_t RxErrors = 0;
+	uint32_t Corrected = 0;
+};
+
+/// <summary>
+/// Back to back messages over a link with bit errors, goodput is the valid payload delivered.
+/// </summary>
+template<uint8_t ParitySize>
+GoodputResult RunGoodput(const uint32_t bitFlipPpm)
+{
+	using InterfaceType = UartInterfaceTask<Definitions::LinkType::Endpoint, Definitions::UartDefinitions<ParitySize>>;
+
+	GoodputListener listener{};
+
+	Clock.Reset();
+	TS::Scheduler scheduler{};
+	Definitions::LinkType link(Clock, Definitions::PropagationNanos, 1);
+	Simulation::FaultConfig faults{};
+	faults.BitFlipPpm = bitFlipPpm;
+	link.SetFaults(faults);
+
+	InterfaceType sender(scheduler, link.A, nullptr, Definitions::Key, Definitions::KeySize);
+	InterfaceType receiver(scheduler, link.B, &listener, Definitions::Key, Definitions::KeySize);
+	if (!sender.Setup() || !receiver.Setup())
+	{
+		OnFail();
+	}
+
+	sender.Start();
+	receiver.Start();
+
+	uint8_t payload[Definitions::PayloadSize];
+	uint8_t header = 0;
+	while (Clock.Millis() < (Definitions::DurationMillis + Definitions::DrainMillis))
+	{
+		if (Clock.Millis() < Definitions::DurationMillis
+			&& sender.CanSendMessage())
+		{
+			for (uint8_t i = 0; i < sizeof(payload); i++)
+			{
+				payload[i] = (uint8_t)(header + i);
+			}
+			if (sender.SendMessage(header, payload, sizeof(payload)))
+			{
+				header++;
+			}
+		}
+
+		scheduler.execute();
+		Clock.Advance(Definitions::StepNanos);
+	}
+
+	sender.Stop();
+	receiver.Stop();
+
+	if (listener.Wrong > 0)
+	{
+		OnFail();
+	}
+
+	GoodputResult result{};
+	result.BytesPerSecond = (uint32_t)(((uint64_t)listener.PayloadBytes * 1000) / Definitions::DurationMillis);
+	result.RxErrors = listener.RxErrors;
+	result.Corrected = receiver.GetFecStats().CorrectedFrames;
+
+	return result;
+}
+
+template<uint8_t ParitySize>
+void PrintGoodput(const GoodputResult& result)
+{
+	Serial.print(F("\tParity "));
+	Serial.print(ParitySize);
+	Serial.print(F(" "));
+	Serial.print(result.BytesPerSecond);
+	Serial.print(F(" B/s ("));
+	Serial.print(result.Corrected);
+	Serial.print(F(" corrected, "));
+	Serial.print(result.RxErrors);
+	Serial.print(F(" lost)"));
+}
+
+void BenchmarkGoodput()
+{
+	GoodputResult clean[3]{};
+	GoodputResult noisiest[3]{};
+
+	for (uint8_t i = 0; i < sizeof(Definitions::BitFlipPpms) / sizeof(Definitions::BitFlipPpms[0]); i++)
+	{
+		const uint32_t ppm = Definitions::BitFlipPpms[i];
+		const GoodputResult none = RunGoodput<0>(ppm);
+		const GoodputResult small = RunGoodput<4>(ppm);
+		const GoodputResult large = RunGoodput<8>(ppm);
+
+		Serial.print(F("Goodput\t\tBit errors "));
+		Serial.print(ppm);
+		Serial.print(F(" ppm"));
+		PrintGoodput<0>(none);
+		PrintGoodput<4>(small);
+		PrintGoodput<8>(large);
+		Serial.println();
+
+		if (ppm == 0)
+		{
+			clean[0] = none;
+			clean[1] = small;
+			clean[2] = large;
+		}
+		noisiest[0] = none;
+		noisiest[1] = small;
+		noisiest[2] = large;
+	}
+
+	// Parity costs goodput on a clean link, and pays for itself on a noisy one.
+	if (clean[0].RxErrors > 0
+		|| clean[1].Corrected > 0
+		|| clean[0].BytesPerSecond <= clean[2].BytesPerSecond
+		|| noisiest[1].Corrected == 0
+		|| noisiest[2].BytesPerSecond <= noisiest[0].BytesPerSecond
+		|| noisiest[1].BytesPerSecond <= noisiest[0].BytesPerSecond)
+	{
+		OnFail();
+	}
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface FEC Benchmark Start"));
+	Serial.println();
+
+	TestCodeword<2>();
+	TestCodeword<8>();
+	TestCodeword<32>();
+
+	TestMessage<4>();
+	TestMessage<8>();
+
+	BenchmarkCost<0>();
+	BenchmarkCost<4>();
+	BenchmarkCost<8>();
+	BenchmarkCost<16>();
+
+	BenchmarkGoodput();
+
+	Serial.println();
+	Serial.println(F("All tests passed."));
+	Serial.println();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,367 @@
+/*
+	Library Flow Control Testing Project.
+	A fast sender streams to a slow receiver, which only services its serial every SlowPeriodMicros, a few bytes at a time.
+	Without flow control the receiver's RX FIFO overruns; with CreditedUartInterface on both ends there must be no overrun,
+	 every frame must arrive in order, and the goodput must be many times that of the overrun link.
+	Also checks that credit recovers from a noisy link, without stalling.
+	Host only (e.g. EpoxyDuino), the whole stack runs from the VirtualClock through _TASK_EXTERNAL_TIME.
+	UartInterfaceTask depends on TaskScheduler (https://github.com/arkhipenko/TaskScheduler).
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#define _TASK_EXTERNAL_TIME
+#define _TASK_OO_CALLBACKS
+#include <TScheduler.hpp>
+
+#include <UartInterface.h>
+#include <UartInterfaceTask.h>
+#include <UartInterfaceSimulation.h>
+#include <UartInterfaceFlowControl.h>
+
+using namespace UartInterface;
+using namespace UartInterface::FlowControl;
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint32_t StepNanos = 2000;
+	static constexpr uint32_t SlowPeriodMicros = 500;
+	static constexpr uint32_t DurationMillis = 1000;
+	static constexpr uint32_t DrainMillis = 100;
+	static constexpr uint32_t ReversePeriodMillis = 10;
+
+	static constexpr uint8_t MaxPayloadSize = 32;
+	static constexpr uint8_t SlowStepIn = 16;
+	static constexpr uint8_t GoodputGain = 10;
+
+	// Fast gateway and slow MCU, on the same 1 Mbaud link, 256 byte RX FIFOs.
+	using FastDefinitions = TemplateUartDefinitions<1000000, MaxPayloadSize>;
+	using SlowDefinitions = TemplateUartDefinitions<1000000, MaxPayloadSize, 32, SlowStepIn>;
+	using LinkType = Simulation::SimulatedLink<256, 64>;
+	using FlowDefinitions = TemplateFlowControlDefinitions<UINT8_MAX - 1, 224>;
+
+	using FastPlainType = UartInterfaceTask<LinkType::Endpoint, FastDefinitions>;
+	using SlowPlainType = UartInterfaceTask<LinkType::Endpoint, SlowDefinitions>;
+	using FastCreditedType = CreditedUartInterface<LinkType::Endpoint, FastDefinitions, FlowDefinitions>;
+	using SlowCreditedType = CreditedUartInterface<LinkType::Endpoint, SlowDefinitions, FlowDefinitions>;
+}
+
+Simulation::VirtualClock Clock{};
+
+uint32_t external_millis()
+{
+	return Clock.Millis();
+}
+
+uint32_t external_micros()
+{
+	return Clock.Micros();
+}
+
+/// <summary>
+/// Checks the sequence of the stream, header and first byte follow the sender's count.
+/// </summary>
+struct SequenceListener : UartListener
+{
+	uint32_t Received = 0;
+	uint32_t ReceivedBytes = 0;
+	uint32_t OutOfOrder = 0;
+	uint32_t Errors = 0;
+	uint32_t Expected = 0;
+	uint32_t LastReceivedMillis = 0;
+
+	void Clear()
+	{
+		*this = SequenceListener{};
+	}
+
+	void OnUartStateChange(const bool connected) final {}
+
+	void OnUartRx(const uint8_t header) final
+	{
+		OutOfOrder++;
+	}
+
+	void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+	{
+		if (header != GetHeader(Expected))
+		{
+			// Resumes from the received frame, after a loss.
+			OutOfOrder++;
+			Expected += (uint8_t)(header - GetHeader(Expected)) % HeaderCount;
+		}
+		else if (payloadSize != GetPayloadSize(Expected)
+			|| payload[0] != (uint8_t)(Expected * 3))
+		{
+			OutOfOrder++;
+		}
+		Expected++;
+		Received++;
+		ReceivedBytes += payloadSize;
+		LastReceivedMillis = Clock.Millis();
+	}
+
+	void OnUartTx() final {}
+
+	void OnUartRxError(const RxErrorEnum error) final
+	{
+		Errors++;
+	}
+
+	void OnUartTxError(const TxErrorEnum error) final {}
+
+	/// <summary>
+	/// Application headers stay clear of the reserved credit header.
+	/// </summary>
+	static constexpr uint8_t HeaderCount = 128;
+
+	static uint8_t GetHeader(const uint32_t sequence)
+	{
+		return (uint8_t)(sequence % HeaderCount);
+	}
+
+	static uint8_t GetPayloadSize(const uint32_t sequence)
+	{
+		return 1 + (sequence % Definitions::MaxPayloadSize);
+	}
+};
+
+/// <summary>
+/// Reverse traffic from the slow end, only counted.
+/// </summary>
+struct CountListener : UartListener
+{
+	uint32_t Received = 0;
+
+	void OnUartStateChange(const bool connected) final {}
+	void OnUartRx(const uint8_t header) final { Received++; }
+	void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final { Received++; }
+	void OnUartTx() final {}
+	void OnUartRxError(const RxErrorEnum error) final {}
+	void OnUartTxError(const TxErrorEnum error) final {}
+};
+
+struct RunResult
+{
+	uint32_t Sent = 0;
+	uint32_t Received = 0;
+	uint32_t OutOfOrder = 0;
+	uint32_t Errors = 0;
+	uint32_t Overruns = 0;
+	uint32_t Goodput = 0;
+	uint32_t Reverse = 0;
+	uint32_t LastReceivedMillis = 0;
+};
+
+TS::Scheduler FastScheduler{};
+TS::Scheduler SlowScheduler{};
+
+SequenceListener SlowListener{};
+CountListener FastListener{};
+
+Definitions::LinkType PlainLink(Clock, 1000, 1);
+Definitions::LinkType CreditedLink(Clock, 1000, 2);
+Definitions::LinkType NoisyLink(Clock, 1000, 3);
+
+Definitions::FastPlainType FastPlain(FastScheduler, PlainLink.A, &FastListener, Definitions::Key, Definitions::KeySize);
+Definitions::SlowPlainType SlowPlain(SlowScheduler, PlainLink.B, &SlowListener, Definitions::Key, Definitions::KeySize);
+
+Definitions::FastCreditedType FastCredited(FastScheduler, CreditedLink.A, &FastListener, Definitions::Key, Definitions::KeySize);
+Definitions::SlowCreditedType SlowCredited(SlowScheduler, CreditedLink.B, &SlowListener, Definitions::Key, Definitions::KeySize);
+
+Definitions::FastCreditedType FastNoisy(FastScheduler, NoisyLink.A, &FastListener, Definitions::Key, Definitions::KeySize);
+Definitions::SlowCreditedType SlowNoisy(SlowScheduler, NoisyLink.B, &SlowListener, Definitions::Key, Definitions::KeySize);
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+/// <summary>
+/// The fast end sends back to back, the slow end sends a small reverse message every ReversePeriodMillis.
+/// Only the slow scheduler is throttled.
+/// </summary>
+template<typename FastType, typename SlowType>
+RunResult Run(FastType& fast, SlowType& slow, Definitions::LinkType& link)
+{
+	SlowListener.Clear();
+	FastListener.Received = 0;
+
+	const uint32_t start = Clock.Millis();
+	const uint32_t overrunsStart = link.A.GetStats().RxOverruns;
+
+	fast.Start();
+	slow.Start();
+
+	uint8_t payload[Definitions::MaxPayloadSize]{};
+	uint32_t sent = 0;
+	uint32_t lastSlow = Clock.Micros();
+	uint32_t lastReverse = start;
+	while (Clock.Millis() - start < (Definitions::DurationMillis + Definitions::DrainMillis))
+	{
+		if (Clock.Millis() - start < Definitions::DurationMillis)
+		{
+			const uint8_t payloadSize = SequenceListener::GetPayloadSize(sent);
+			payload[0] = (uint8_t)(sent * 3);
+			for (uint8_t i = 1; i < payloadSize; i++)
+			{
+				payload[i] = (uint8_t)(sent + i);
+			}
+
+			if (fast.SendMessage(SequenceListener::GetHeader(sent), payload, payloadSize))
+			{
+				sent++;
+			}
+		}
+
+		FastScheduler.execute();
+
+		if (Clock.Micros() - lastSlow >= Definitions::SlowPeriodMicros)
+		{
+			lastSlow = Clock.Micros();
+			if (Clock.Millis() - lastReverse >= Definitions::ReversePeriodMillis
+				&& slow.SendMessage(0))
+			{
+				lastReverse = Clock.Millis();
+			}
+			SlowScheduler.execute();
+		}
+
+		Clock.Advance(Definitions::StepNanos);
+	}
+
+	fast.Stop();
+	slow.Stop();
+
+	RunResult result{};
+	result.Sent = sent;
+	result.Received = SlowListener.Received;
+	result.OutOfOrder = SlowListener.OutOfOrder;
+	result.Errors = SlowListener.Errors;
+	result.Overruns = link.A.GetStats().RxOverruns - overrunsStart;
+	result.Goodput = (uint32_t)(((uint64_t)SlowListener.ReceivedBytes * 1000) / Definitions::DurationMillis);
+	result.Reverse = FastListener.Received;
+	result.LastReceivedMillis = SlowListener.LastReceivedMillis - start;
+
+	return result;
+}
+
+void PrintResult(const RunResult& result)
+{
+	Serial.print(F("Sent "));
+	Serial.print(result.Sent);
+	Serial.print(F("\tReceived "));
+	Serial.print(result.Received);
+	Serial.print(F("\tOutOfOrder "));
+	Serial.print(result.OutOfOrder);
+	Serial.print(F("\tErrors "));
+	Serial.print(result.Errors);
+	Serial.print(F("\tOverruns "));
+	Serial.print(result.Overruns);
+	Serial.print(F("\tReverse "));
+	Serial.print(result.Reverse);
+	Serial.print(F("\tGoodput "));
+	Serial.print(result.Goodput);
+	Serial.println(F(" B/s"));
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface Flow Control Test Start"));
+	Serial.println();
+
+	if (!FastPlain.Setup()
+		|| !SlowPlain.Setup()
+		|| !FastCredited.Setup()
+		|| !SlowCredited.Setup()
+		|| !FastNoisy.Setup()
+		|| !SlowNoisy.Setup())
+	{
+		Serial.println(F("Setup Failed!"));
+		OnFail();
+	}
+
+	// Without flow control, the slow end loses bytes.
+	const RunResult plain = Run(FastPlain, SlowPlain, PlainLink);
+	Serial.print(F("Plain\t\t"));
+	PrintResult(plain);
+	if (plain.Overruns == 0
+		|| plain.Errors == 0)
+	{
+		OnFail();
+	}
+
+	// With credit, nothing is lost and every frame is in order.
+	const RunResult credited = Run(FastCredited, SlowCredited, CreditedLink);
+	Serial.print(F("Credited\t"));
+	PrintResult(credited);
+	Serial.print(F("\t\tStalls "));
+	Serial.print(FastCredited.GetStallCount());
+	Serial.print(F("\tCredit frames "));
+	Serial.println(SlowCredited.GetCreditFrameCount());
+	if (credited.Overruns > 0
+		|| credited.Errors > 0
+		|| credited.OutOfOrder > 0
+		|| credited.Received != credited.Sent
+		|| credited.Reverse == 0
+		|| credited.Goodput < (plain.Goodput * Definitions::GoodputGain))
+	{
+		OnFail();
+	}
+
+	// The reserved credit header is refused, even with credit to send it.
+	FastCredited.Start();
+	SlowCredited.Start();
+	const uint32_t reservedStart = Clock.Millis();
+	while (!FastCredited.CanSendMessage(sizeof(uint32_t))
+		&& Clock.Millis() - reservedStart < Definitions::DrainMillis)
+	{
+		FastScheduler.execute();
+		SlowScheduler.execute();
+		Clock.Advance(Definitions::StepNanos);
+	}
+	const uint32_t reserved = 0;
+	if (!FastCredited.CanSendMessage(sizeof(reserved))
+		|| FastCredited.SendMessage(Definitions::FlowDefinitions::Header, reserved))
+	{
+		OnFail();
+	}
+	FastCredited.Stop();
+	SlowCredited.Stop();
+
+	// Lost bytes and credit frames only delay credit.
+	Simulation::FaultConfig faults{};
+	faults.BitFlipPpm = 200;
+	faults.DropPpm = 200;
+	NoisyLink.SetFaults(faults);
+	const RunResult noisy = Run(FastNoisy, SlowNoisy, NoisyLink);
+	Serial.print(F("Noisy\t\t"));
+	PrintResult(noisy);
+	if (noisy.Overruns > 0
+		|| noisy.Errors == 0
+		|| noisy.Received < (credited.Received / 2)
+		|| noisy.LastReceivedMillis < (Definitions::DurationMillis - 50))
+	{
+		OnFail();
+	}
+
+	Serial.println();
+	Serial.println(F("All tests passed."));
+	Serial.println();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,491 @@
+/*
+	Library Multi-Drop Testing Project.
+	Addressed frames on a shared bus: nodes only decode their own and broadcast frames, the rest is skipped.
+	Half-duplex line driver turnaround, checked against the simulated wire timing.
+	Host only (e.g. EpoxyDuino), runs the scheduler-free cores.
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#include <UartInterface.h>
+#include <UartInterfaceCore.h>
+#include <UartInterfaceSimulation.h>
+
+#include <new>
+
+using namespace UartInterface;
+
+/// <summary>
+/// Ideal shared bus, every node reads every byte written, including its own.
+/// Writes only have room as far as the slowest node has read, so a writer can't lap the readers.
+/// </summary>
+template<uint16_t Capacity>
+class SimulatedBus
+{
+private:
+	static constexpr uint8_t NodesMax = 8;
+	static constexpr uint16_t WriteWindow = 64;
+
+	uint8_t Log[Capacity]{};
+	uint32_t Head = 0;
+
+	const uint32_t* Cursors[NodesMax]{};
+	uint8_t NodeCount = 0;
+
+public:
+	int AvailableForWrite() const
+	{
+		uint32_t unread = 0;
+		for (uint8_t i = 0; i < NodeCount; i++)
+		{
+			if (Head - *Cursors[i] > unread)
+			{
+				unread = Head - *Cursors[i];
+			}
+		}
+
+		return (unread < WriteWindow) ? (int)(WriteWindow - unread) : 0;
+	}
+
+	void Write(const uint8_t* data, const size_t size)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			Log[(Head++) % Capacity] = data[i];
+		}
+	}
+
+	class Node
+	{
+	private:
+		SimulatedBus& Bus;
+		uint32_t Cursor = 0;
+
+	public:
+		Node(SimulatedBus& bus) : Bus(bus)
+		{
+			if (Bus.NodeCount < NodesMax)
+			{
+				Bus.Cursors[Bus.NodeCount++] = &Cursor;
+			}
+		}
+
+		operator bool() { return true; }
+		void begin(const unsigned long baudrate) { Cursor = Bus.Head; }
+		void clearWriteError() {}
+
+		int available() { return Bus.Head - Cursor; }
+		int availableForWrite() { return Bus.AvailableForWrite(); }
+		int read() { return (Cursor < Bus.Head) ? Bus.Log[(Cursor++) % Capacity] : -1; }
+
+		uint16_t ReadSpan(const uint8_t*& data)
+		{
+			const uint16_t index = Cursor % Capacity;
+			const uint32_t size = Bus.Head - Cursor;
+			data = &Bus.Log[index];
+
+			return (size < (uint32_t)(Capacity - index)) ? (uint16_t)size : (Capacity - index);
+		}
+
+		void Consume(const uint16_t size) { Cursor += size; }
+
+		size_t write(const uint8_t value) { return write(&value, 1); }
+
+		size_t write(const uint8_t* buffer, const size_t size)
+		{
+			Bus.Write(buffer, size);
+
+			return size;
+		}
+	};
+};
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint8_t MasterAddress = 0x10;
+	static constexpr uint8_t NodeCount = 4;
+	static constexpr uint8_t Destinations[]{ 1, 2, 3, 4, MessageDefinition::AddressBroadcast };
+	static constexpr uint32_t FrameCount = 2000;
+	static constexpr uint8_t PayloadSize = 24;
+	static constexpr uint32_t TurnaroundMicros = 200;
+
+	using BusType = SimulatedBus<1024>;
+
+	struct BusDefinitions : UartDefaults
+	{
+		static constexpr bool Addressed = true;
+	};
+	using BusCoreType = UartInterfaceCore<BusType::Node, BusDefinitions>;
+
+	using LinkType = Simulation::SimulatedLink<64, 64>;
+
+	struct HalfDuplexDefinitions : BusDefinitions
+	{
+		static constexpr uint32_t TurnaroundMicros = Definitions::TurnaroundMicros;
+	};
+	using HalfDuplexCoreType = UartInterfaceCore<LinkType::Endpoint, HalfDuplexDefinitions>;
+}
+
+struct NodeListener : UartListener
+{
+	uint8_t Address = 0;
+	uint32_t Received = 0;
+	uint32_t Misdelivered = 0;
+	uint32_t RxErrors = 0;
+
+	void OnUartStateChange(const bool connected) final {}
+
+	void OnUartRx(const uint8_t header) final
+	{
+		OnUartRx(header, nullptr, 0);
+	}
+
+	// The header carries the destination the frame was sent to.
+	void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+	{
+		Received++;
+		if (Address != MessageDefinition::AddressPromiscuous
+			&& header != Address
+			&& header != MessageDefinition::AddressBroadcast)
+		{
+			Misdelivered++;
+		}
+	}
+
+	void OnUartTx() final {}
+	void OnUartRxError(const RxErrorEnum error) final { RxErrors++; }
+	void OnUartTxError(const TxErrorEnum error) final {}
+};
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+/// <summary>
+/// Master sends round-robin to each node and broadcast.
+/// Each node must get exactly its own and the broadcast frames, and skip the rest undecoded.
+/// </summary>
+void TestBusAddressing()
+{
+	Definitions::BusType bus{};
+	Definitions::BusType::Node masterSerial(bus);
+	Definitions::BusType::Node sniffSerial(bus);
+	Definitions::BusType::Node nodeSerials[Definitions::NodeCount]{ { bus }, { bus }, { bus }, { bus } };
+
+	NodeListener sniffListener{};
+	NodeListener nodeListeners[Definitions::NodeCount]{};
+
+	Definitions::BusCoreType master(masterSerial, nullptr, Definitions::Key, Definitions::KeySize);
+	Definitions::BusCoreType sniffer(sniffSerial, &sniffListener, Definitions::Key, Definitions::KeySize);
+	Definitions::BusCoreType* nodes[Definitions::NodeCount]{};
+	alignas(Definitions::BusCoreType) uint8_t nodeStorage[Definitions::NodeCount][sizeof(Definitions::BusCoreType)];
+
+	master.SetAddress(Definitions::MasterAddress);
+	sniffListener.Address = MessageDefinition::AddressPromiscuous;
+	if (!master.Setup() || !sniffer.Setup())
+	{
+		OnFail();
+	}
+	master.Start();
+	sniffer.Start();
+
+	for (uint8_t i = 0; i < Definitions::NodeCount; i++)
+	{
+		nodes[i] = new (nodeStorage[i]) Definitions::BusCoreType(nodeSerials[i], &nodeListeners[i], Definitions::Key, Definitions::KeySize);
+		nodeListeners[i].Address = i + 1;
+		nodes[i]->SetAddress(i + 1);
+		if (!nodes[i]->Setup())
+		{
+			OnFail();
+		}
+		nodes[i]->Start();
+	}
+
+	uint8_t payload[Definitions::PayloadSize]{};
+	uint32_t sent = 0;
+	uint32_t now = 0;
+	uint32_t nodeMicros = 0;
+	uint32_t sniffMicros = 0;
+	while (sent < Definitions::FrameCount
+		|| master.IsTxPolling())
+	{
+		if (sent < Definitions::FrameCount
+			&& master.CanSendMessage())
+		{
+			const uint8_t destination = Definitions::Destinations[sent % sizeof(Definitions::Destinations)];
+			if (master.SendMessageTo(destination, destination, payload, sizeof(payload)))
+			{
+				sent++;
+			}
+		}
+
+		master.Poll(now);
+
+		uint32_t start = micros();
+		sniffer.Poll(now);
+		sniffMicros += micros() - start;
+
+		start = micros();
+		for (uint8_t i = 0; i < Definitions::NodeCount; i++)
+		{
+			nodes[i]->Poll(now);
+		}
+		nodeMicros += micros() - start;
+
+		now += 20;
+	}
+
+	for (uint16_t i = 0; i < 100; i++)
+	{
+		sniffer.Poll(now);
+		for (uint8_t n = 0; n < Definitions::NodeCount; n++)
+		{
+			nodes[n]->Poll(now);
+		}
+		now += 20;
+	}
+
+	const uint32_t perNode = Definitions::FrameCount / sizeof(Definitions::Destinations);
+	for (uint8_t i = 0; i < Definitions::NodeCount; i++)
+	{
+		Serial.print(F("\tNode "));
+		Serial.print(i + 1);
+		Serial.print(F("\tReceived "));
+		Serial.print(nodeListeners[i].Received);
+		Serial.print(F("\tSkipped "));
+		Serial.print(nodes[i]->GetSkippedCount());
+		Serial.print(F("\tErrors "));
+		Serial.println(nodeListeners[i].RxErrors);
+
+		if (nodeListeners[i].Received != (perNode * 2)
+			|| nodeListeners[i].Misdelivered > 0
+			|| nodeListeners[i].RxErrors > 0
+			|| nodes[i]->GetSkippedCount() != (Definitions::FrameCount - (perNode * 2)))
+		{
+			OnFail();
+		}
+	}
+
+	Serial.print(F("\tSniffer\tReceived "));
+	Serial.print(sniffListener.Received);
+	Serial.print(F("\tErrors "));
+	Serial.println(sniffListener.RxErrors);
+	Serial.print(F("\tPoll us: 4 addressed nodes "));
+	Serial.print(nodeMicros);
+	Serial.print(F("\t1 promiscuous node "));
+	Serial.println(sniffMicros);
+
+	if (sniffListener.Received != Definitions::FrameCount
+		|| sniffListener.RxErrors > 0
+		|| master.GetSkippedCount() != (Definitions::FrameCount - perNode))
+	{
+		OnFail();
+	}
+
+	// A frame for node 1 with its address byte changed to 2 must fail node 2's CRC.
+	MessageCodec<Definitions::PayloadSize> codec(Definitions::Key, Definitions::KeySize);
+	uint8_t frame[MessageDefinition::GetBufferSizeFromPayload(Definitions::PayloadSize)]{};
+	codec.Setup();
+	frame[(uint8_t)MessageDefinition::FieldIndexEnum::Header] = 2;
+	const uint8_t frameSize = codec.EncodeMessageAndCrcInPlace(frame, MessageDefinition::GetMessageSize(0), 1);
+	const uint8_t delimiter = MessageDefinition::Delimiter;
+	const uint8_t wrongAddress = 2;
+	bus.Write(&delimiter, 1);
+	bus.Write(&wrongAddress, 1);
+	bus.Write(frame, frameSize);
+	bus.Write(&delimiter, 1);
+
+	const uint32_t receivedBefore = nodeListeners[1].Received;
+	for (uint16_t i = 0; i < 100; i++)
+	{
+		nodes[1]->Poll(now);
+		now += 20;
+	}
+
+	Serial.print(F("\tForged address\tErrors "));
+	Serial.println(nodeListeners[1].RxErrors);
+	if (nodeListeners[1].Received != receivedBefore
+		|| nodeListeners[1].RxErrors != 1)
+	{
+		OnFail();
+	}
+
+	// An oversized frame for node 2 is dropped up to its delimiter, its tail never read as another frame.
+	uint8_t filler[200];
+	memset(filler, 1, sizeof(filler));
+	const uint32_t skippedBefore = nodes[1]->GetSkippedCount();
+	bus.Write(&delimiter, 1);
+	bus.Write(&wrongAddress, 1);
+	bus.Write(filler, sizeof(filler));
+	bus.Write(&delimiter, 1);
+
+	for (uint16_t i = 0; i < 100; i++)
+	{
+		for (uint8_t n = 0; n < Definitions::NodeCount; n++)
+		{
+			nodes[n]->Poll(now);
+		}
+		now += 20;
+	}
+
+	Serial.print(F("\tOversized frame\tErrors "));
+	Serial.print(nodeListeners[1].RxErrors);
+	Serial.print(F("\tSkipped "));
+	Serial.println(nodes[1]->GetSkippedCount() - skippedBefore);
+	if (nodeListeners[1].Received != receivedBefore
+		|| nodeListeners[1].RxErrors != 2
+		|| nodes[1]->GetSkippedCount() != skippedBefore
+		|| nodeListeners[0].RxErrors > 0)
+	{
+		OnFail();
+	}
+
+	for (uint8_t i = 0; i < Definitions::NodeCount; i++)
+	{
+		nodes[i]->~UartInterfaceCore();
+	}
+}
+
+/// <summary>
+/// Records the line driver edges against the simulated wire.
+/// </summary>
+struct DriverRecorder : LineDriver
+{
+	Simulation::VirtualClock& Clock;
+	Definitions::LinkType::Endpoint& Endpoint;
+
+	bool Enabled = false;
+	uint32_t Edges = 0;
+	uint32_t EnabledMicros = 0;
+	uint32_t LastWritten = 0;
+	uint32_t Violations = 0;
+
+	DriverRecorder(Simulation::VirtualClock& clock, Definitions::LinkType::Endpoint& endpoint)
+		: Clock(clock)
+		, Endpoint(endpoint)
+	{
+	}
+
+	void OnLineDriverEnable(const bool enabled) final
+	{
+		if (enabled == Enabled)
+		{
+			Violations++;
+		}
+		Enabled = enabled;
+		Edges++;
+
+		if (enabled)
+		{
+			EnabledMicros = Clock.Micros();
+		}
+		else if (Endpoint.Pending() > 0)
+		{
+			// Released with bytes still to go out.
+			Violations++;
+		}
+	}
+
+	/// <summary>
+	/// Called every step, bytes may only be written with the driver enabled for at least the turnaround.
+	/// </summary>
+	void Check()
+	{
+		const uint32_t written = Endpoint.GetStats().BytesWritten;
+		if (written != LastWritten
+			&& (!Enabled || (Clock.Micros() - EnabledMicros) < Definitions::TurnaroundMicros))
+		{
+			Violations++;
+		}
+		LastWritten = written;
+	}
+};
+
+void TestHalfDuplex()
+{
+	Simulation::VirtualClock clock{};
+	Definitions::LinkType link(clock);
+
+	NodeListener listener{};
+	listener.Address = MessageDefinition::AddressPromiscuous;
+
+	Definitions::HalfDuplexCoreType sender(link.A, nullptr, Definitions::Key, Definitions::KeySize);
+	Definitions::HalfDuplexCoreType receiver(link.B, &listener, Definitions::Key, Definitions::KeySize);
+	DriverRecorder driver(clock, link.A);
+
+	sender.SetLineDriver(&driver);
+	if (!sender.Setup() || !receiver.Setup())
+	{
+		OnFail();
+	}
+	sender.Start();
+	receiver.Start();
+
+	uint8_t payload[Definitions::PayloadSize]{};
+	uint32_t sent = 0;
+	while (clock.Millis() < 500)
+	{
+		if (sender.CanSendMessage()
+			&& sender.SendMessageTo(1, MessageDefinition::AddressBroadcast, payload, sizeof(payload)))
+		{
+			sent++;
+		}
+
+		sender.Poll(clock.Micros());
+		receiver.Poll(clock.Micros());
+		driver.Check();
+
+		clock.Advance(1000);
+	}
+
+	Serial.print(F("\tSent "));
+	Serial.print(sent);
+	Serial.print(F("\tReceived "));
+	Serial.print(listener.Received);
+	Serial.print(F("\tDriver edges "));
+	Serial.print(driver.Edges);
+	Serial.print(F("\tViolations "));
+	Serial.println(driver.Violations);
+
+	if (sent == 0
+		|| listener.Received + 1 < sent
+		|| listener.RxErrors > 0
+		|| driver.Violations > 0
+		|| driver.Edges < (sent * 2) - 1)
+	{
+		OnFail();
+	}
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface Multi-Drop Test Start"));
+	Serial.println();
+
+	Serial.println(F("Bus addressing"));
+	TestBusAddressing();
+
+	Serial.println(F("Half-duplex turnaround"));
+	TestHalfDuplex();
+
+	Serial.println();
+	Serial.println(F("All tests passed."));
+	Serial.println();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,413 @@
+/*
+	Library Periodic Publisher Testing Project.
+	Registers messages at different periods and deadlines with a PeriodicPublisher, next to unscheduled application traffic.
+	Every message must be sent once per period, within its deadline, and filled just in time.
+	Registration must reject what the link can't carry.
+	An interface refusing sends it could take must be retried on the poll period, not in a busy loop.
+	Host only (e.g. EpoxyDuino), the whole stack runs from the VirtualClock through _TASK_EXTERNAL_TIME.
+	UartInterfaceTask depends on TaskScheduler (https://github.com/arkhipenko/TaskScheduler).
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#define _TASK_EXTERNAL_TIME
+#define _TASK_OO_CALLBACKS
+#include <TScheduler.hpp>
+
+#include <UartInterface.h>
+#include <UartInterfaceTask.h>
+#include <UartInterfaceSimulation.h>
+#include <UartInterfacePublish.h>
+
+using namespace UartInterface;
+using namespace UartInterface::Publish;
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint32_t StepNanos = 5000;
+	static constexpr uint32_t DurationMillis = 2000;
+
+	static constexpr uint8_t MaxPayloadSize = 16;
+	static constexpr uint8_t PublishPayloadSize = 8;
+
+	struct Schedule
+	{
+		uint8_t Header;
+		uint32_t PeriodMillis;
+		uint32_t DeadlineMillis;
+	};
+
+	static constexpr Schedule Schedules[]{
+		{ 1, 2, 0 },
+		{ 2, 5, 3 },
+		{ 3, 10, 0 },
+		{ 4, 20, 0 }
+	};
+	static constexpr uint8_t ScheduleCount = sizeof(Schedules) / sizeof(Schedules[0]);
+
+	static constexpr uint8_t AppHeader = 100;
+	static constexpr uint32_t AppPeriodMicros = 3000;
+
+	// A few frame times.
+	static constexpr uint32_t FreshMicros = 1000;
+	static constexpr uint32_t JitterMaxMicros = 500;
+
+	using UartDefinitions = TemplateUartDefinitions<1000000, MaxPayloadSize>;
+	using LinkType = Simulation::SimulatedLink<64, 64>;
+	using InterfaceType = UartInterfaceTask<LinkType::Endpoint, UartDefinitions>;
+	using PublisherType = PeriodicPublisher<InterfaceType, UartDefinitions>;
+}
+
+Simulation::VirtualClock Clock{};
+
+uint32_t external_millis()
+{
+	return Clock.Millis();
+}
+
+uint32_t external_micros()
+{
+	return Clock.Micros();
+}
+
+/// <summary>
+/// Stamps each message with the time it was filled.
+/// </summary>
+struct ClockSource : PublishSource
+{
+	uint32_t Filled = 0;
+
+	uint8_t OnPublish(const uint8_t header, uint8_t* payload) final
+	{
+		const uint32_t now = Clock.Micros();
+		memcpy(payload, &now, sizeof(now));
+		memset(&payload[sizeof(now)], header, Definitions::PublishPayloadSize - sizeof(now));
+		Filled++;
+
+		return Definitions::PublishPayloadSize;
+	}
+};
+
+struct PublishListener : UartListener
+{
+	uint32_t Received[Definitions::ScheduleCount]{};
+	uint32_t AppReceived = 0;
+	uint32_t AgeMax = 0;
+	uint32_t Errors = 0;
+
+	void OnUartStateChange(const bool connected) final {}
+
+	void OnUartRx(const uint8_t header) final
+	{
+		Errors++;
+	}
+
+	void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+	{
+		if (header == Definitions::AppHeader)
+		{
+			AppReceived++;
+			return;
+		}
+
+		const uint8_t index = header - Definitions::Schedules[0].Header;
+		if (index >= Definitions::ScheduleCount
+			|| payloadSize != Definitions::PublishPayloadSize)
+		{
+			Errors++;
+			return;
+		}
+
+		uint32_t filled;
+		memcpy(&filled, payload, sizeof(filled));
+		const uint32_t age = Clock.Micros() - filled;
+		if (age > AgeMax)
+		{
+			AgeMax = age;
+		}
+		Received[index]++;
+	}
+
+	void OnUartTx() final {}
+	void OnUartRxError(const RxErrorEnum error) final { Errors++; }
+	void OnUartTxError(const TxErrorEnum error) final { Errors++; }
+};
+
+/// <summary>
+/// Always ready, never takes the message, as a credited interface without credit for its size.
+/// </summary>
+struct RefusingInterface
+{
+	uint32_t Attempts = 0;
+
+	bool CanSendMessage() const { return true; }
+
+	bool SendMessage(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize)
+	{
+		Attempts++;
+
+		return false;
+	}
+};
+
+TS::Scheduler Scheduler{};
+
+ClockSource Source{};
+PublishListener Listener{};
+
+Definitions::LinkType Link(Clock, 1000, 1);
+
+Definitions::InterfaceType Sender(Scheduler, Link.A, nullptr, Definitions::Key, Definitions::KeySize);
+Definitions::InterfaceType Receiver(Scheduler, Link.B, &Listener, Definitions::Key, Definitions::KeySize);
+Definitions::PublisherType Publisher(Scheduler, Sender);
+
+RefusingInterface Refusing{};
+PeriodicPublisher<RefusingInterface, Definitions::UartDefinitions> RefusedPublisher(Scheduler, Refusing);
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+/// <summary>
+/// Fills a publisher until it rejects a message, the accepted load must fit in the budget.
+/// </summary>
+void TestAdmission()
+{
+	static constexpr uint32_t BudgetPermille = 800;
+
+	TS::Scheduler scheduler{};
+	Definitions::PublisherType publisher(scheduler, Sender);
+
+	if (publisher.Register(1, Definitions::PublishPayloadSize, 0, &Source)
+		|| publisher.Register(1, Definitions::PublishPayloadSize, 5, nullptr)
+		|| publisher.Register(1, Definitions::PublishPayloadSize, 5, &Source, 10)
+		|| publisher.Register(1, Definitions::MaxPayloadSize + 1, 5, &Source))
+	{
+		OnFail();
+	}
+
+	if (!publisher.Register(1, Definitions::PublishPayloadSize, 5, &Source)
+		|| publisher.Register(1, Definitions::PublishPayloadSize, 5, &Source))
+	{
+		OnFail();
+	}
+
+	// 1 ms messages, until the link is full.
+	uint8_t accepted = 1;
+	uint32_t load = publisher.GetLoadPermille();
+	while (publisher.Register(1 + accepted, Definitions::MaxPayloadSize, 1, &Source))
+	{
+		if (publisher.GetLoadPermille() <= load
+			|| publisher.GetLoadPermille() > BudgetPermille)
+		{
+			OnFail();
+		}
+		load = publisher.GetLoadPermille();
+		accepted++;
+	}
+
+	Serial.print(F("Admission\tAccepted "));
+	Serial.print(accepted);
+	Serial.print(F("\tLoad "));
+	Serial.print(load);
+	Serial.print(F(" permille\tFrame "));
+	Serial.print(Definitions::PublisherType::GetFrameMicros(Definitions::MaxPayloadSize));
+	Serial.println(F(" us"));
+
+	// The rejected message didn't fit, and wasn't kept.
+	// A 1 ms message's permille of the link is its frame time in micros.
+	if (accepted < 2
+		|| (load + Definitions::PublisherType::GetFrameMicros(Definitions::MaxPayloadSize)) <= BudgetPermille
+		|| publisher.GetStats(1 + accepted) != nullptr)
+	{
+		OnFail();
+	}
+
+	publisher.Unregister(2);
+	if (publisher.GetStats(2) != nullptr
+		|| publisher.GetLoadPermille() >= load
+		|| !publisher.Register(2, Definitions::MaxPayloadSize, 1, &Source))
+	{
+		OnFail();
+	}
+}
+
+/// <summary>
+/// Publishes the schedules, with application messages competing for the serial.
+/// </summary>
+void TestSchedule()
+{
+	for (uint8_t i = 0; i < Definitions::ScheduleCount; i++)
+	{
+		if (!Publisher.Register(Definitions::Schedules[i].Header, Definitions::PublishPayloadSize,
+			Definitions::Schedules[i].PeriodMillis, &Source, Definitions::Schedules[i].DeadlineMillis))
+		{
+			OnFail();
+		}
+	}
+
+	Sender.Start();
+	Receiver.Start();
+
+	// Until connected.
+	while (!Sender.CanSendMessage())
+	{
+		Scheduler.execute();
+		Clock.Advance(Definitions::StepNanos);
+	}
+
+	Publisher.Start();
+
+	const uint32_t start = Clock.Millis();
+	uint32_t lastApp = Clock.Micros();
+	uint32_t appSent = 0;
+	uint8_t payload[Definitions::MaxPayloadSize]{};
+	while (Clock.Millis() - start < Definitions::DurationMillis)
+	{
+		if (Clock.Micros() - lastApp >= Definitions::AppPeriodMicros
+			&& Sender.SendMessage(Definitions::AppHeader, payload, sizeof(payload)))
+		{
+			lastApp = Clock.Micros();
+			appSent++;
+		}
+
+		Scheduler.execute();
+		Clock.Advance(Definitions::StepNanos);
+	}
+	Publisher.Stop();
+
+	// Drain.
+	const uint32_t drainStart = Clock.Millis();
+	while (Clock.Millis() - drainStart < 10)
+	{
+		Scheduler.execute();
+		Clock.Advance(Definitions::StepNanos);
+	}
+
+	Serial.print(F("Schedule\tLoad "));
+	Serial.print(Publisher.GetLoadPermille());
+	Serial.print(F(" permille\tApp "));
+	Serial.print(Listener.AppReceived);
+	Serial.print('/');
+	Serial.print(appSent);
+	Serial.print(F("\tAge max "));
+	Serial.print(Listener.AgeMax);
+	Serial.println(F(" us"));
+
+	if (Listener.Errors > 0
+		|| Listener.AppReceived != appSent
+		|| Listener.AgeMax > Definitions::FreshMicros
+		|| Source.Filled == 0)
+	{
+		OnFail();
+	}
+
+	for (uint8_t i = 0; i < Definitions::ScheduleCount; i++)
+	{
+		const Definitions::Schedule& schedule = Definitions::Schedules[i];
+		const PublishStats* stats = Publisher.GetStats(schedule.Header);
+		const uint32_t deadlineMicros = ((schedule.DeadlineMillis > 0) ? schedule.DeadlineMillis : schedule.PeriodMillis) * 1000;
+		const uint32_t expected = Definitions::DurationMillis / schedule.PeriodMillis;
+
+		Serial.print(F("\tHeader "));
+		Serial.print(schedule.Header);
+		Serial.print(F("\tPeriod "));
+		Serial.print(schedule.PeriodMillis);
+		Serial.print(F(" ms\tSent "));
+		Serial.print(stats->Sent);
+		Serial.print(F("\tReceived "));
+		Serial.print(Listener.Received[i]);
+		Serial.print(F("\tJitter max "));
+		Serial.print(stats->JitterMaxMicros);
+		Serial.print(F(" us\tMisses "));
+		Serial.println(stats->DeadlineMisses);
+
+		if (stats->Sent < expected
+			|| stats->Sent > expected + 1
+			|| Listener.Received[i] != stats->Sent
+			|| stats->DeadlineMisses > 0
+			|| stats->Skipped > 0
+			|| stats->JitterMaxMicros > deadlineMicros
+			|| stats->JitterMaxMicros > Definitions::JitterMaxMicros)
+		{
+			OnFail();
+		}
+	}
+}
+
+/// <summary>
+/// A refused message is retried once per poll period, and counted.
+/// </summary>
+void TestRefused()
+{
+	static constexpr uint32_t RunMillis = 100;
+
+	if (!RefusedPublisher.Register(Definitions::Schedules[0].Header, Definitions::PublishPayloadSize,
+		Definitions::Schedules[0].PeriodMillis, &Source))
+	{
+		OnFail();
+	}
+	RefusedPublisher.Start();
+
+	const uint32_t start = Clock.Millis();
+	while (Clock.Millis() - start < RunMillis)
+	{
+		Scheduler.execute();
+		Clock.Advance(Definitions::StepNanos);
+	}
+	RefusedPublisher.Stop();
+
+	const PublishStats* stats = RefusedPublisher.GetStats(Definitions::Schedules[0].Header);
+
+	Serial.print(F("Refused\tAttempts "));
+	Serial.print(Refusing.Attempts);
+	Serial.print(F("\tin "));
+	Serial.print(RunMillis);
+	Serial.println(F(" ms"));
+
+	if (Refusing.Attempts == 0
+		|| Refusing.Attempts > (RunMillis / Definitions::UartDefinitions::PollPeriodMillis) + 1
+		|| stats->Refused != Refusing.Attempts
+		|| stats->Sent > 0)
+	{
+		OnFail();
+	}
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface Periodic Publisher Test Start"));
+	Serial.println();
+
+	if (!Sender.Setup()
+		|| !Receiver.Setup())
+	{
+		Serial.println(F("Setup Failed!"));
+		OnFail();
+	}
+
+	TestAdmission();
+	TestSchedule();
+	TestRefused();
+
+	Serial.println();
+	Serial.println(F("All tests passed."));
+	Serial.println();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,391 @@
+/*
+	Library RX Batch Delivery Testing Project.
+	Feeds bursts of small frames, with a corrupted one among them, to receivers delivering each frame with OnUartRx(),
+	 and all the frames of an RX pass together with OnUartRxBatch().
+	Every frame must arrive intact and in order, through both, and through the OnUartRxBatch() default.
+	Then reports the CPU time per frame for a listener that pushes frames into a locked queue.
+	Host only (e.g. EpoxyDuino), runs the scheduler-free cores.
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#include <UartInterface.h>
+#include <UartInterfaceCore.h>
+
+#include <chrono>
+#include <mutex>
+
+using namespace UartInterface;
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint8_t MaxPayloadSize = 8;
+	static constexpr uint16_t FrameCount = 2000;
+	static constexpr uint16_t CorruptFrame = 1234;
+	static constexpr uint16_t BurstSize = 100;
+	static constexpr uint32_t CostRuns = 200;
+
+	static constexpr uint8_t BatchSize = 8;
+	static constexpr uint8_t StepIn = 128;
+
+	static constexpr uint32_t StreamSize = (uint32_t)FrameCount * (MessageDefinition::GetBufferSizeFromPayload(MaxPayloadSize) + 2);
+
+	using SenderDefinitions = TemplateUartDefinitions<1000000, MaxPayloadSize>;
+	using SingleDefinitions = TemplateUartDefinitions<1000000, MaxPayloadSize, 32, StepIn>;
+
+	struct BatchDefinitions : TemplateUartDefinitions<1000000, MaxPayloadSize, 32, StepIn>
+	{
+		static constexpr uint8_t RxPoolSize = BatchSize;
+		static constexpr uint8_t RxBatchSize = BatchSize;
+	};
+}
+
+uint8_t Stream[Definitions::StreamSize];
+uint32_t StreamSize = 0;
+
+/// <summary>
+/// Writes go to the Stream, reads come from it up to the bytes Arrived.
+/// </summary>
+struct StreamSerial
+{
+	uint32_t Index = 0;
+	uint32_t Arrived = 0;
+
+	operator bool() { return true; }
+	void begin(const unsigned long baudrate) {}
+	void clearWriteError() {}
+
+	int available() { return Arrived - Index; }
+	int peek() { return (Index < Arrived) ? Stream[Index] : -1; }
+	int read() { return (Index < Arrived) ? Stream[Index++] : -1; }
+
+	uint16_t ReadSpan(const uint8_t*& data)
+	{
+		data = &Stream[Index];
+
+		return (uint16_t)(((Arrived - Index) < UINT16_MAX) ? (Arrived - Index) : UINT16_MAX);
+	}
+
+	void Consume(const uint16_t size) { Index += size; }
+
+	int availableForWrite() { return 1024; }
+
+	size_t write(const uint8_t value)
+	{
+		return write(&value, 1);
+	}
+
+	size_t write(const uint8_t* buffer, const size_t size)
+	{
+		memcpy(&Stream[StreamSize], buffer, size);
+		StreamSize += size;
+
+		return size;
+	}
+};
+
+struct CheckListener : UartListener
+{
+	uint32_t Frames = 0;
+	uint32_t Callbacks = 0;
+	uint32_t Batches = 0;
+	uint32_t CrcErrors = 0;
+	uint32_t Errors = 0;
+	uint8_t MaxBatch = 0;
+	uint16_t Next = 0;
+
+	void OnUartStateChange(const bool connected) final {}
+
+	void OnUartRx(const uint8_t header) final
+	{
+		OnUartRx(header, nullptr, 0);
+	}
+
+	void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+	{
+		Callbacks++;
+		Check(header, payload, payloadSize);
+	}
+
+	void OnUartTx() final {}
+	void OnUartRxError(const RxErrorEnum error) final
+	{
+		if (error == RxErrorEnum::Crc)
+		{
+			CrcErrors++;
+		}
+		else
+		{
+			Errors++;
+		}
+	}
+	void OnUartTxError(const TxErrorEnum error) final { Errors++; }
+
+	void Check(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize)
+	{
+		if (Next == Definitions::CorruptFrame)
+		{
+			Next++;
+		}
+
+		if (header != (uint8_t)Next
+			|| payloadSize != Next % (Definitions::MaxPayloadSize + 1))
+		{
+			Errors++;
+		}
+		for (uint8_t i = 0; i < payloadSize; i++)
+		{
+			if (payload[i] != (uint8_t)(Next + i))
+			{
+				Errors++;
+				break;
+			}
+		}
+		Next++;
+		Frames++;
+	}
+};
+
+/// <summary>
+/// Overrides OnUartRxBatch().
+/// </summary>
+struct BatchCheckListener : CheckListener
+{
+	void OnUartRxBatch(const RxFrame* frames, const uint8_t count) final
+	{
+		Batches++;
+		if (count > MaxBatch)
+		{
+			MaxBatch = count;
+		}
+
+		for (uint8_t i = 0; i < count; i++)
+		{
+			Check(frames[i].Header, frames[i].Payload, frames[i].PayloadSize);
+		}
+	}
+};
+
+/// <summary>
+/// Copies every frame into a queue under a lock, as one shared with another thread would be.
+/// </summary>
+struct QueueListener : UartListener
+{
+	static constexpr uint16_t QueueSize = 256;
+
+	struct Entry
+	{
+		uint8_t Header;
+		uint8_t PayloadSize;
+		uint8_t Payload[Definitions::MaxPayloadSize];
+	};
+
+	std::mutex Lock;
+	Entry Queue[QueueSize];
+	uint16_t Head = 0;
+	uint32_t Frames = 0;
+
+	void OnUartStateChange(const bool connected) final {}
+
+	void OnUartRx(const uint8_t header) final
+	{
+		OnUartRx(header, nullptr, 0);
+	}
+
+	void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+	{
+		std::lock_guard<std::mutex> guard(Lock);
+		Push(header, payload, payloadSize);
+	}
+
+	void OnUartRxBatch(const RxFrame* frames, const uint8_t count) final
+	{
+		std::lock_guard<std::mutex> guard(Lock);
+		for (uint8_t i = 0; i < count; i++)
+		{
+			Push(frames[i].Header, frames[i].Payload, frames[i].PayloadSize);
+		}
+	}
+
+	void OnUartTx() final {}
+	void OnUartRxError(const RxErrorEnum error) final {}
+	void OnUartTxError(const TxErrorEnum error) final {}
+
+	void Push(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize)
+	{
+		Entry& entry = Queue[Head++ % QueueSize];
+		entry.Header = header;
+		entry.PayloadSize = payloadSize;
+		memcpy(entry.Payload, payload, payloadSize);
+		Frames++;
+	}
+};
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+/// <summary>
+/// Encodes every frame into the Stream, then corrupts one.
+/// </summary>
+void BuildStream()
+{
+	StreamSerial serial{};
+	UartInterfaceCore<StreamSerial, Definitions::SenderDefinitions> sender(serial, nullptr, Definitions::Key, Definitions::KeySize);
+	if (!sender.Setup())
+	{
+		OnFail();
+	}
+	sender.Start();
+	while (!sender.CanSendMessage())
+	{
+		sender.Poll(0);
+	}
+
+	uint32_t corruptIndex = 0;
+	uint8_t payload[Definitions::MaxPayloadSize];
+	for (uint16_t i = 0; i < Definitions::FrameCount; i++)
+	{
+		const uint8_t size = i % (Definitions::MaxPayloadSize + 1);
+		for (uint8_t j = 0; j < size; j++)
+		{
+			payload[j] = (uint8_t)(i + j);
+		}
+
+		if (i == Definitions::CorruptFrame)
+		{
+			corruptIndex = StreamSize + 3;
+		}
+
+		if (!sender.SendMessage((uint8_t)i, payload, size))
+		{
+			OnFail();
+		}
+		while (sender.IsTxPolling())
+		{
+			sender.PollTx(0);
+		}
+	}
+
+	// Any non-delimiter value keeps the framing.
+	Stream[corruptIndex] = (Stream[corruptIndex] == 0x55) ? 0x56 : 0x55;
+}
+
+/// <returns>RX passes.</returns>
+template<typename UartDefinitions, typename ListenerType>
+uint32_t Receive(ListenerType& listener)
+{
+	StreamSerial serial{};
+	UartInterfaceCore<StreamSerial, UartDefinitions> receiver(serial, &listener, Definitions::Key, Definitions::KeySize);
+	if (!receiver.Setup())
+	{
+		OnFail();
+	}
+	receiver.Start();
+
+	uint32_t now = 0;
+	while (serial.Index < StreamSize)
+	{
+		// A burst arrives while the receiver is busy elsewhere.
+		if (serial.Arrived == serial.Index)
+		{
+			serial.Arrived += (StreamSize - serial.Arrived < Definitions::BurstSize) ? (StreamSize - serial.Arrived) : Definitions::BurstSize;
+		}
+		receiver.PollRx(now);
+		now += 10;
+	}
+
+	// Deliver the last one.
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		receiver.PollRx(now);
+	}
+
+	return receiver.GetRxPollCount();
+}
+
+template<typename UartDefinitions, typename ListenerType>
+void TestDelivery(const char* name, const bool batched)
+{
+	ListenerType listener{};
+	const uint32_t passes = Receive<UartDefinitions>(listener);
+
+	Serial.print(name);
+	Serial.print(F("\tFrames "));
+	Serial.print(listener.Frames);
+	Serial.print(F("\tCallbacks "));
+	Serial.print(batched ? listener.Batches : listener.Callbacks);
+	Serial.print(F("\tLargest batch "));
+	Serial.print(listener.MaxBatch);
+	Serial.print(F("\tRX passes "));
+	Serial.println(passes);
+
+	if (listener.Frames != Definitions::FrameCount - 1
+		|| listener.CrcErrors != 1
+		|| listener.Errors > 0
+		|| (batched && (listener.Callbacks > 0 || listener.Batches >= listener.Frames || listener.MaxBatch > Definitions::BatchSize))
+		|| (!batched && listener.Batches > 0))
+	{
+		OnFail();
+	}
+}
+
+template<typename UartDefinitions>
+void BenchmarkQueue(const char* name)
+{
+	QueueListener listener{};
+
+	const auto start = std::chrono::steady_clock::now();
+	for (uint32_t run = 0; run < Definitions::CostRuns; run++)
+	{
+		Receive<UartDefinitions>(listener);
+	}
+	const auto end = std::chrono::steady_clock::now();
+
+	if (listener.Frames != Definitions::CostRuns * (Definitions::FrameCount - 1))
+	{
+		OnFail();
+	}
+
+	Serial.print(name);
+	Serial.print(F("\tns/frame "));
+	Serial.println(std::chrono::duration<double, std::nano>(end - start).count() / listener.Frames, 1);
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface RX Batch Delivery Test Start"));
+	Serial.println();
+
+	BuildStream();
+
+	TestDelivery<Definitions::SingleDefinitions, CheckListener>("OnUartRx()\t", false);
+	TestDelivery<Definitions::BatchDefinitions, BatchCheckListener>("OnUartRxBatch()\t", true);
+
+	// No override, frame by frame through the default.
+	TestDelivery<Definitions::BatchDefinitions, CheckListener>("Batch default\t", false);
+
+	BenchmarkQueue<Definitions::SingleDefinitions>("Locked queue, each frame");
+	BenchmarkQueue<Definitions::BatchDefinitions>("Locked queue, batched");
+
+	Serial.println();
+	Serial.println(F("All tests passed."));
+	Serial.println();
+}
+
+void loop()
+{
+}
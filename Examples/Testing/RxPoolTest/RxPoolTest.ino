@@ -0,0 +1,426 @@
+/*
+	Library RX Pool Testing Project.
+	The receiver's listener leases each frame instead of copying it, and only releases it some time later.
+	Leased frames must stay intact while the next frames accumulate in the rest of the pool.
+	Checks both exhaustion policies: refusing the last free buffer, and dropping incoming frames.
+	Host only (e.g. EpoxyDuino), runs the scheduler-free cores.
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#include <UartInterface.h>
+#include <UartInterfaceCore.h>
+#include <UartInterfaceSimulation.h>
+
+using namespace UartInterface;
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint32_t Baudrate = 115200;
+	static constexpr uint8_t MaxPayloadSize = 32;
+	static constexpr uint32_t StepNanos = 5000;
+	static constexpr uint32_t FrameCount = 500;
+	static constexpr uint32_t DrainMillis = 100;
+
+	// About five frame times.
+	static constexpr uint32_t HoldMicros = 10000;
+
+	static constexpr uint8_t PoolSize = 4;
+
+	using LinkType = Simulation::SimulatedLink<64, 64>;
+	using SenderDefinitions = TemplateUartDefinitions<Baudrate, MaxPayloadSize>;
+	struct RefuseDefinitions : SenderDefinitions
+	{
+		static constexpr uint8_t RxPoolSize = PoolSize;
+	};
+
+	struct DropDefinitions : RefuseDefinitions
+	{
+		static constexpr bool RxPoolDropNewest = true;
+	};
+	using SingleDefinitions = SenderDefinitions;
+
+	using SenderType = UartInterfaceCore<LinkType::Endpoint, SenderDefinitions>;
+}
+
+Simulation::VirtualClock Clock{};
+
+struct RunResult
+{
+	uint32_t Sent = 0;
+	uint32_t Received = 0;
+	uint32_t Leased = 0;
+	uint32_t Copied = 0;
+	uint32_t Corrupted = 0;
+	uint32_t OutOfOrder = 0;
+	uint32_t PoolExhausted = 0;
+	uint32_t OtherErrors = 0;
+	uint32_t Drops = 0;
+	uint8_t MaxHeld = 0;
+};
+
+static uint8_t GetPayloadSize(const uint8_t sequence)
+{
+	return 1 + (sequence % Definitions::MaxPayloadSize);
+}
+
+static bool IsIntact(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize)
+{
+	if (payloadSize != GetPayloadSize(header))
+	{
+		return false;
+	}
+
+	for (uint8_t i = 0; i < payloadSize; i++)
+	{
+		if (payload[i] != (uint8_t)(header * 7 + i))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Leases every frame and releases it HoldMicros later, checking it is still intact.
+/// Frames that can't be leased are checked right away, as if copied.
+/// </summary>
+template<typename CoreType>
+struct LeasingListener : UartListener
+{
+	struct Held
+	{
+		const uint8_t* Payload;
+		uint32_t Micros;
+		uint8_t Lease;
+		uint8_t Header;
+		uint8_t PayloadSize;
+	};
+
+	static constexpr uint8_t HeldMax = 8;
+
+	CoreType* Core = nullptr;
+	RunResult* Result = nullptr;
+	uint32_t HoldMicros = 0;
+	uint8_t Expected = 0;
+
+	Held Queue[HeldMax]{};
+	uint8_t Count = 0;
+
+	void OnUartStateChange(const bool connected) final {}
+
+	void OnUartRx(const uint8_t header) final
+	{
+		Result->Corrupted++;
+	}
+
+	void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+	{
+		Result->Received++;
+		if (header != Expected)
+		{
+			Result->OutOfOrder++;
+		}
+		Expected = header + 1;
+
+		const uint8_t lease = Core->LeaseRx();
+		if (lease == CoreType::RxLeaseNone
+			|| Count >= HeldMax)
+		{
+			Core->ReleaseRx(lease);
+			Result->Copied++;
+			if (!IsIntact(header, payload, payloadSize))
+			{
+				Result->Corrupted++;
+			}
+
+			return;
+		}
+
+		Result->Leased++;
+		Queue[Count++] = Held{ payload, Clock.Micros(), lease, header, payloadSize };
+		if (Count > Result->MaxHeld)
+		{
+			Result->MaxHeld = Count;
+		}
+	}
+
+	void OnUartTx() final {}
+
+	void OnUartRxError(const RxErrorEnum error) final
+	{
+		if (error == RxErrorEnum::PoolExhausted)
+		{
+			Result->PoolExhausted++;
+		}
+		else
+		{
+			Result->OtherErrors++;
+		}
+	}
+
+	void OnUartTxError(const TxErrorEnum error) final {}
+
+	/// <summary>
+	/// Releases the oldest held frames, once their time is up (or all of them).
+	/// </summary>
+	void Process(const bool flush)
+	{
+		while (Count > 0
+			&& (flush || (Clock.Micros() - Queue[0].Micros) >= HoldMicros))
+		{
+			ReleaseOldest();
+		}
+	}
+
+	void ReleaseOldest()
+	{
+		if (!IsIntact(Queue[0].Header, Queue[0].Payload, Queue[0].PayloadSize))
+		{
+			Result->Corrupted++;
+		}
+		Core->ReleaseRx(Queue[0].Lease);
+
+		Count--;
+		for (uint8_t i = 0; i < Count; i++)
+		{
+			Queue[i] = Queue[i + 1];
+		}
+	}
+};
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+template<typename ReceiverDefinitions>
+RunResult Run(const uint32_t holdMicros, const uint32_t seed)
+{
+	using ReceiverType = UartInterfaceCore<Definitions::LinkType::Endpoint, ReceiverDefinitions>;
+
+	RunResult result{};
+	Definitions::LinkType link(Clock, 1000, seed);
+	LeasingListener<ReceiverType> listener{};
+
+	Definitions::SenderType sender(link.A, nullptr, Definitions::Key, Definitions::KeySize);
+	ReceiverType receiver(link.B, &listener, Definitions::Key, Definitions::KeySize);
+	listener.Core = &receiver;
+	listener.Result = &result;
+	listener.HoldMicros = holdMicros;
+
+	if (!sender.Setup()
+		|| !receiver.Setup())
+	{
+		Serial.println(F("Setup Failed!"));
+		OnFail();
+	}
+	sender.Start();
+	receiver.Start();
+
+	uint8_t payload[Definitions::MaxPayloadSize]{};
+	uint32_t drainStart = 0;
+	while (result.Sent < Definitions::FrameCount
+		|| (Clock.Millis() - drainStart) < Definitions::DrainMillis)
+	{
+		const uint32_t now = Clock.Micros();
+
+		if (result.Sent < Definitions::FrameCount
+			&& sender.CanSendMessage())
+		{
+			const uint8_t header = (uint8_t)result.Sent;
+			const uint8_t payloadSize = GetPayloadSize(header);
+			for (uint8_t i = 0; i < payloadSize; i++)
+			{
+				payload[i] = (uint8_t)(header * 7 + i);
+			}
+
+			if (sender.SendMessage(header, payload, payloadSize))
+			{
+				result.Sent++;
+				drainStart = Clock.Millis();
+			}
+		}
+
+		sender.Poll(now);
+		receiver.Poll(now);
+		listener.Process(false);
+
+		Clock.Advance(Definitions::StepNanos);
+	}
+	listener.Process(true);
+
+	result.Drops = receiver.GetRxPoolDropCount();
+	if (receiver.GetRxPoolFree() != ReceiverDefinitions::RxPoolSize)
+	{
+		result.Corrupted++;
+	}
+
+	return result;
+}
+
+void PrintResult(const RunResult& result)
+{
+	Serial.print(F("Sent "));
+	Serial.print(result.Sent);
+	Serial.print(F("\tReceived "));
+	Serial.print(result.Received);
+	Serial.print(F("\tLeased "));
+	Serial.print(result.Leased);
+	Serial.print(F("\tCopied "));
+	Serial.print(result.Copied);
+	Serial.print(F("\tMaxHeld "));
+	Serial.print(result.MaxHeld);
+	Serial.print(F("\tDrops "));
+	Serial.print(result.Drops);
+	Serial.print(F("\tCorrupted "));
+	Serial.println(result.Corrupted);
+}
+
+/// <summary>
+/// Leases the whole pool, then releases one buffer between frames.
+/// The next frame must get it, instead of being dropped.
+/// Frames are only followed by a delimiter, so nothing but the release can free a buffer before the next one.
+/// </summary>
+void TestReleaseWhileLeased()
+{
+	using ReceiverType = UartInterfaceCore<Definitions::LinkType::Endpoint, Definitions::DropDefinitions>;
+
+	RunResult result{};
+	Definitions::LinkType link(Clock, 1000, 4);
+	LeasingListener<ReceiverType> listener{};
+
+	MessageCodec<Definitions::MaxPayloadSize> codec(Definitions::Key, Definitions::KeySize);
+	ReceiverType receiver(link.B, &listener, Definitions::Key, Definitions::KeySize);
+	listener.Core = &receiver;
+	listener.Result = &result;
+
+	if (!codec.Setup()
+		|| !receiver.Setup())
+	{
+		OnFail();
+	}
+	receiver.Start();
+	link.A.begin(Definitions::Baudrate);
+
+	uint8_t frame[MessageDefinition::GetBufferSizeFromPayload(Definitions::MaxPayloadSize)]{};
+	const uint8_t delimiter = MessageDefinition::Delimiter;
+	for (uint8_t header = 0; header <= Definitions::PoolSize; header++)
+	{
+		if (header == Definitions::PoolSize)
+		{
+			if (receiver.GetRxPoolFree() > 0)
+			{
+				OnFail();
+			}
+			listener.ReleaseOldest();
+		}
+
+		const uint8_t payloadSize = GetPayloadSize(header);
+		frame[(uint8_t)MessageDefinition::FieldIndexEnum::Header] = header;
+		for (uint8_t i = 0; i < payloadSize; i++)
+		{
+			frame[(uint8_t)MessageDefinition::FieldIndexEnum::Payload + i] = (uint8_t)(header * 7 + i);
+		}
+		const uint8_t frameSize = codec.EncodeMessageAndCrcInPlace(frame, MessageDefinition::GetMessageSize(payloadSize));
+		link.A.write(frame, frameSize);
+		link.A.write(delimiter);
+		result.Sent++;
+
+		const uint32_t start = Clock.Millis();
+		while ((Clock.Millis() - start) < Definitions::DrainMillis)
+		{
+			receiver.Poll(Clock.Micros());
+
+			Clock.Advance(Definitions::StepNanos);
+		}
+	}
+	listener.Process(true);
+
+	Serial.print(F("Release\t"));
+	PrintResult(result);
+	if (result.Received != Definitions::PoolSize + 1
+		|| result.Leased != Definitions::PoolSize + 1
+		|| result.PoolExhausted > 0
+		|| result.OtherErrors > 0
+		|| result.Corrupted > 0
+		|| receiver.GetRxPoolDropCount() > 0
+		|| receiver.GetRxPoolFree() != Definitions::PoolSize)
+	{
+		OnFail();
+	}
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface RX Pool Test Start"));
+	Serial.println();
+
+	// Leases are granted but the last free buffer, the listener copies instead and the link stays lossless.
+	const RunResult refuse = Run<Definitions::RefuseDefinitions>(Definitions::HoldMicros, 1);
+	Serial.print(F("Refuse\t"));
+	PrintResult(refuse);
+	if (refuse.Received != refuse.Sent
+		|| refuse.Leased == 0
+		|| refuse.Copied == 0
+		|| refuse.MaxHeld != (Definitions::PoolSize - 1)
+		|| refuse.Drops > 0
+		|| refuse.PoolExhausted > 0
+		|| refuse.OtherErrors > 0
+		|| refuse.OutOfOrder > 0
+		|| refuse.Corrupted > 0)
+	{
+		OnFail();
+	}
+
+	// Long hold: the whole pool is leased, and frames arriving meanwhile are dropped and reported.
+	const RunResult drop = Run<Definitions::DropDefinitions>(Definitions::HoldMicros, 2);
+	Serial.print(F("Drop\t"));
+	PrintResult(drop);
+	if (drop.Drops == 0
+		|| drop.Drops != drop.PoolExhausted
+		|| (drop.Received + drop.Drops) != drop.Sent
+		|| drop.MaxHeld != Definitions::PoolSize
+		|| drop.Copied > 0
+		|| drop.OtherErrors > 0
+		|| drop.Corrupted > 0)
+	{
+		OnFail();
+	}
+
+	// A single buffer is never leased, the listener always copies.
+	const RunResult single = Run<Definitions::SingleDefinitions>(Definitions::HoldMicros, 3);
+	Serial.print(F("Single\t"));
+	PrintResult(single);
+	if (single.Received != single.Sent
+		|| single.Leased > 0
+		|| single.Copied != single.Sent
+		|| single.Drops > 0
+		|| single.Corrupted > 0)
+	{
+		OnFail();
+	}
+
+	TestReleaseWhileLeased();
+
+	Serial.println();
+	Serial.println(F("All tests passed."));
+	Serial.println();
+}
+
+void loop()
+{
+}
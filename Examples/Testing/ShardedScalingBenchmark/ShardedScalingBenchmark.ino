@@ -0,0 +1,390 @@
+/*
+	Library Sharded Runtime Scaling Benchmark.
+	128 loopback ports on the ShardedPortRuntime, frames/sec against worker count.
+	Each port echoes its own TX into its RX at memory speed, so the figures are the protocol's CPU cost.
+	The application thread keeps one send in flight per port and drains the decoded frames.
+	First checks that back to back sends to one port all arrive, held in the TX queue while the port is busy.
+	Last checks that a port that never drains, and one that is disconnected, don't hold back a burst on their worker.
+	Linux host only (e.g. EpoxyDuino), link with -pthread.
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#include <UartInterface.h>
+#include <UartInterfaceRuntime.h>
+#include <UartInterfaceSimulation.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace UartInterface;
+
+/// <summary>
+/// Serial that receives its own writes, owned by a single worker.
+/// A stalled serial never takes a byte.
+/// </summary>
+class LoopbackSerial
+{
+private:
+	Simulation::ByteFifo<256> Fifo{};
+
+public:
+	std::atomic<bool> Stalled{ false };
+	std::atomic<bool> Connected{ true };
+
+public:
+	operator bool() { return Connected.load(); }
+
+	void begin(const unsigned long baudrate) { Fifo.Clear(); }
+	void end() {}
+	void clearWriteError() {}
+
+	int available() { return Fifo.Size(); }
+	int availableForWrite() { return Stalled.load() ? 0 : Fifo.Free(); }
+	int read() { return (Fifo.Size() > 0) ? Fifo.Pop() : -1; }
+
+	uint16_t ReadSpan(const uint8_t*& data) { return Fifo.ReadSpan(data); }
+	void Consume(const uint16_t size) { Fifo.Consume(size); }
+
+	uint16_t WriteSpan(uint8_t*& data) { return Stalled.load() ? 0 : Fifo.WriteSpan(data); }
+	void Commit(const uint16_t size) { Fifo.Commit(size); }
+
+	size_t write(const uint8_t value)
+	{
+		return (!Stalled.load() && Fifo.Push(value)) ? 1 : 0;
+	}
+
+	size_t write(const uint8_t* buffer, const size_t size)
+	{
+		size_t written = 0;
+		while (!Stalled.load() && written < size && Fifo.Push(buffer[written]))
+		{
+			written++;
+		}
+
+		return written;
+	}
+};
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint8_t PortCount = 128;
+	static constexpr uint8_t PayloadSize = 32;
+	static constexpr uint32_t DurationMillis = 1000;
+	static constexpr uint8_t WorkerCounts[]{ 1, 2, 4, 8, 16 };
+	static constexpr uint8_t BurstSize = 64;
+	static constexpr uint8_t StalledPort = 1;
+	static constexpr uint8_t DisconnectedPort = 2;
+	static constexpr uint32_t BurstTimeoutMillis = 1000;
+
+	using UartDefinitions = TemplateUartDefinitions<1000000>;
+	using RuntimeType = Runtime::ShardedPortRuntime<LoopbackSerial, UartDefinitions, PortCount>;
+}
+
+LoopbackSerial Ports[Definitions::PortCount]{};
+Definitions::RuntimeType PortRuntime{};
+
+struct BenchmarkResult
+{
+	uint32_t Frames = 0;
+	uint32_t Corrupted = 0;
+	uint32_t Dropped = 0;
+	uint32_t Errors = 0;
+	uint32_t ElapsedMicros = 0;
+};
+
+void SumStats(uint32_t& dropped, uint32_t& errors)
+{
+	dropped = 0;
+	errors = 0;
+	for (uint8_t port = 0; port < Definitions::PortCount; port++)
+	{
+		const Definitions::RuntimeType::PortStats stats = PortRuntime.GetStats(port);
+		dropped += stats.RxDropped;
+		errors += stats.RxErrors + stats.TxErrors;
+	}
+}
+
+BenchmarkResult RunWorkers(const uint8_t workerCount)
+{
+	using ClockType = std::chrono::steady_clock;
+
+	BenchmarkResult result{};
+	uint32_t submitted[Definitions::PortCount]{};
+	uint32_t completed[Definitions::PortCount]{};
+	uint8_t payload[Definitions::PayloadSize]{};
+
+	uint32_t droppedStart, errorsStart;
+	SumStats(droppedStart, errorsStart);
+
+	if (!PortRuntime.Start(workerCount, true))
+	{
+		return result;
+	}
+
+	const ClockType::time_point start = ClockType::now();
+	const ClockType::time_point end = start + std::chrono::milliseconds(Definitions::DurationMillis);
+	while (ClockType::now() < end)
+	{
+		bool idle = true;
+
+		for (uint8_t port = 0; port < Definitions::PortCount; port++)
+		{
+			if (submitted[port] == completed[port])
+			{
+				for (uint8_t i = 0; i < sizeof(payload); i++)
+				{
+					payload[i] = (uint8_t)(submitted[port] + port + i);
+				}
+
+				if (PortRuntime.Send(port, (uint8_t)submitted[port], payload, sizeof(payload)))
+				{
+					submitted[port]++;
+					idle = false;
+				}
+			}
+		}
+
+		if (PortRuntime.Receive([&](const Definitions::RuntimeType::Frame& frame)
+			{
+				if (frame.PayloadSize != Definitions::PayloadSize
+					|| frame.Header != (uint8_t)completed[frame.Port]
+					|| frame.Payload[0] != (uint8_t)(frame.Header + frame.Port))
+				{
+					result.Corrupted++;
+				}
+				completed[frame.Port]++;
+				result.Frames++;
+			}) > 0)
+		{
+			idle = false;
+		}
+
+		if (idle)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	result.ElapsedMicros = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(ClockType::now() - start).count();
+	PortRuntime.Stop();
+
+	SumStats(result.Dropped, result.Errors);
+	result.Dropped -= droppedStart;
+	result.Errors -= errorsStart;
+
+	return result;
+}
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+/// <summary>
+/// Sends a burst to a single port without waiting, every frame must come back in order.
+/// </summary>
+void TestBurst()
+{
+	using ClockType = std::chrono::steady_clock;
+
+	if (!PortRuntime.Start(1, false))
+	{
+		OnFail();
+	}
+
+	uint8_t payload[Definitions::PayloadSize]{};
+	uint32_t submitted = 0;
+	uint32_t completed = 0;
+	uint32_t corrupted = 0;
+	const ClockType::time_point end = ClockType::now() + std::chrono::milliseconds(Definitions::BurstTimeoutMillis);
+	while (completed < Definitions::BurstSize
+		&& ClockType::now() < end)
+	{
+		if (submitted < Definitions::BurstSize)
+		{
+			payload[0] = (uint8_t)submitted;
+			if (PortRuntime.Send(0, (uint8_t)submitted, payload, sizeof(payload)))
+			{
+				submitted++;
+			}
+		}
+
+		PortRuntime.Receive([&](const Definitions::RuntimeType::Frame& frame)
+			{
+				if (frame.Port != 0
+					|| frame.Header != (uint8_t)completed
+					|| frame.Payload[0] != frame.Header)
+				{
+					corrupted++;
+				}
+				completed++;
+			});
+		std::this_thread::yield();
+	}
+	PortRuntime.Stop();
+
+	Serial.print(F("Burst\tSent "));
+	Serial.print(submitted);
+	Serial.print(F("\tReceived "));
+	Serial.println(completed);
+
+	if (completed != Definitions::BurstSize
+		|| corrupted > 0)
+	{
+		OnFail();
+	}
+}
+
+/// <summary>
+/// Sends a burst to one port, while sending to a stalled and a disconnected port on the same worker.
+/// The burst must still arrive, the stalled port's sends must back up in its own queue, and the disconnected port's be dropped.
+/// </summary>
+void TestStalledPorts()
+{
+	using ClockType = std::chrono::steady_clock;
+
+	Ports[Definitions::StalledPort].Stalled.store(true);
+	Ports[Definitions::DisconnectedPort].Connected.store(false);
+	const uint32_t droppedStart = PortRuntime.GetStats(Definitions::DisconnectedPort).TxDropped;
+
+	if (!PortRuntime.Start(1, false))
+	{
+		OnFail();
+	}
+
+	uint8_t payload[Definitions::PayloadSize]{};
+	uint32_t submitted = 0;
+	uint32_t completed = 0;
+	uint32_t stalledSubmitted = 0;
+	uint32_t disconnectedSubmitted = 0;
+	uint32_t unexpected = 0;
+	const ClockType::time_point end = ClockType::now() + std::chrono::milliseconds(Definitions::BurstTimeoutMillis);
+	while ((completed < Definitions::BurstSize
+		|| PortRuntime.GetStats(Definitions::DisconnectedPort).TxDropped - droppedStart < disconnectedSubmitted)
+		&& ClockType::now() < end)
+	{
+		if (submitted < Definitions::BurstSize)
+		{
+			payload[0] = (uint8_t)submitted;
+			if (PortRuntime.Send(0, (uint8_t)submitted, payload, sizeof(payload)))
+			{
+				submitted++;
+			}
+			if (PortRuntime.Send(Definitions::StalledPort, 0, payload, sizeof(payload)))
+			{
+				stalledSubmitted++;
+			}
+			if (PortRuntime.Send(Definitions::DisconnectedPort, 0, payload, sizeof(payload)))
+			{
+				disconnectedSubmitted++;
+			}
+		}
+
+		PortRuntime.Receive([&](const Definitions::RuntimeType::Frame& frame)
+			{
+				if (frame.Port != 0
+					|| frame.Header != (uint8_t)completed
+					|| frame.Payload[0] != frame.Header)
+				{
+					unexpected++;
+				}
+				completed++;
+			});
+		std::this_thread::yield();
+	}
+	PortRuntime.Stop();
+
+	const uint32_t dropped = PortRuntime.GetStats(Definitions::DisconnectedPort).TxDropped - droppedStart;
+
+	Serial.print(F("Stalled\tReceived "));
+	Serial.print(completed);
+	Serial.print(F("\tStalled accepted "));
+	Serial.print(stalledSubmitted);
+	Serial.print(F("\tDisconnected dropped "));
+	Serial.print(dropped);
+	Serial.print('/');
+	Serial.println(disconnectedSubmitted);
+
+	Ports[Definitions::StalledPort].Stalled.store(false);
+	Ports[Definitions::DisconnectedPort].Connected.store(true);
+
+	if (completed != Definitions::BurstSize
+		|| unexpected > 0
+		|| stalledSubmitted >= Definitions::BurstSize
+		|| disconnectedSubmitted == 0
+		|| dropped != disconnectedSubmitted)
+	{
+		OnFail();
+	}
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface Sharded Runtime Scaling Benchmark"));
+	Serial.print(F("Ports "));
+	Serial.print(Definitions::PortCount);
+	Serial.print(F("\tPayload "));
+	Serial.print(Definitions::PayloadSize);
+	Serial.print(F("\tCores "));
+	Serial.println(std::thread::hardware_concurrency());
+	Serial.println();
+
+	for (uint8_t i = 0; i < Definitions::PortCount; i++)
+	{
+		if (PortRuntime.AddPort(Ports[i], Definitions::Key, Definitions::KeySize) < 0)
+		{
+			Serial.println(F("AddPort Failed!"));
+			OnFail();
+		}
+	}
+
+	TestBurst();
+	Serial.println();
+
+	Serial.println(F("Workers\tFrames/s\tCorrupted\tDropped\tErrors"));
+	for (uint8_t i = 0; i < sizeof(Definitions::WorkerCounts); i++)
+	{
+		const BenchmarkResult result = RunWorkers(Definitions::WorkerCounts[i]);
+
+		Serial.print(Definitions::WorkerCounts[i]);
+		Serial.print('\t');
+		Serial.print((uint32_t)(((uint64_t)result.Frames * 1000000) / (result.ElapsedMicros > 0 ? result.ElapsedMicros : 1)));
+		Serial.print('\t');
+		Serial.print(result.Corrupted);
+		Serial.print('\t');
+		Serial.print(result.Dropped);
+		Serial.print('\t');
+		Serial.println(result.Errors);
+
+		if (result.Frames == 0
+			|| result.Corrupted > 0)
+		{
+			OnFail();
+		}
+	}
+	Serial.println();
+
+	TestStalledPorts();
+
+	Serial.println();
+	Serial.println(F("Benchmark complete."));
+	Serial.println();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,357 @@
+/*
+	Library Shared Memory Transport Testing Project.
+	Forks an echo process, linked to this one through a SharedMemorySerial segment.
+	Both ends run an unchanged UartInterfaceCore, and block in WaitForRx() while waiting on each other.
+	Every echo must come back intact, at memory speed and then with 1 Mbaud emulation.
+	Reports round trips per second, and the emulated wire time against the ideal.
+	Linux host only (e.g. EpoxyDuino).
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#include <UartInterface.h>
+#include <UartInterfaceCore.h>
+#include <UartInterfaceSharedMemory.h>
+
+#include <chrono>
+#include <sys/wait.h>
+
+using namespace UartInterface;
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint8_t MaxPayloadSize = 64;
+	static constexpr uint32_t Baudrate = 1000000;
+	static constexpr uint32_t RoundTrips = 20000;
+	static constexpr uint32_t EmulatedRoundTrips = 500;
+	static constexpr uint32_t WaitMicros = 1000;
+	static constexpr uint32_t OpenRetries = 1000;
+	static constexpr uint32_t RetryMicros = 10000;
+
+	static constexpr char SegmentName[] = "/uart_interface_shm_test";
+
+	// Event-driven idle, woken from WaitForRx().
+	struct UartDefinitions : TemplateUartDefinitions<Baudrate, MaxPayloadSize>
+	{
+		static constexpr bool EventDrivenIdle = true;
+	};
+	using SerialType = Transport::SharedMemorySerial<>;
+	using CoreType = UartInterfaceCore<SerialType, UartDefinitions>;
+}
+
+uint32_t NowMicros()
+{
+	return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+uint8_t FillPayload(uint8_t* payload, const uint32_t index)
+{
+	const uint8_t size = (uint8_t)(index % (Definitions::MaxPayloadSize + 1));
+	for (uint8_t i = 0; i < size; i++)
+	{
+		payload[i] = ((i + index) % 5 == 0) ? 0 : (uint8_t)(index * 31 + i);
+	}
+
+	return size;
+}
+
+/// <summary>
+/// Keeps the last message.
+/// </summary>
+struct LastMessageListener : UartListener
+{
+	uint8_t Payload[Definitions::MaxPayloadSize]{};
+	uint8_t PayloadSize = 0;
+	uint8_t Header = 0;
+	bool Pending = false;
+	uint32_t Errors = 0;
+
+	void OnUartStateChange(const bool connected) final {}
+
+	void OnUartRx(const uint8_t header) final
+	{
+		OnUartRx(header, nullptr, 0);
+	}
+
+	void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+	{
+		if (Pending)
+		{
+			Errors++;
+		}
+		Header = header;
+		PayloadSize = payloadSize;
+		memcpy(Payload, payload, payloadSize);
+		Pending = true;
+	}
+
+	void OnUartTx() final {}
+	void OnUartRxError(const RxErrorEnum error) final { Errors++; }
+	void OnUartTxError(const TxErrorEnum error) final { Errors++; }
+};
+
+/// <summary>
+/// Polls the core, and sleeps on the serial until the next deadline or the peer writes.
+/// </summary>
+void Step(Definitions::CoreType& core, Definitions::SerialType& serial)
+{
+	const uint32_t now = NowMicros();
+	const uint32_t deadline = core.Poll(now);
+	uint32_t wait = Definitions::WaitMicros;
+	if (core.IsPolling())
+	{
+		const int32_t due = (int32_t)(deadline - now);
+		wait = (due <= 0) ? 0 : (((uint32_t)due < wait) ? (uint32_t)due : wait);
+	}
+
+	if (wait > 0)
+	{
+		serial.WaitForRx(wait);
+	}
+
+	if (serial.TakeEvent())
+	{
+		core.OnSerialEvent(NowMicros());
+	}
+}
+
+bool StartCore(Definitions::CoreType& core)
+{
+	if (!core.Setup())
+	{
+		return false;
+	}
+	core.Start();
+
+	const uint32_t start = NowMicros();
+	while (!core.CanSendMessage())
+	{
+		if (NowMicros() - start > 1000000)
+		{
+			return false;
+		}
+		core.Poll(NowMicros());
+	}
+
+	return true;
+}
+
+/// <summary>
+/// The forked peer, sends back every message until the exit header.
+/// </summary>
+/// <returns>Process exit status, 0 for success.</returns>
+int RunEcho(const bool emulate)
+{
+	Definitions::SerialType serial(emulate);
+	uint32_t retries = 0;
+	while (!serial.Open(Definitions::SegmentName))
+	{
+		if (++retries > Definitions::OpenRetries)
+		{
+			return 1;
+		}
+		usleep(1000);
+	}
+
+	LastMessageListener listener{};
+	Definitions::CoreType core(serial, &listener, Definitions::Key, Definitions::KeySize);
+	if (!StartCore(core))
+	{
+		return 2;
+	}
+
+	while (true)
+	{
+		if (listener.Pending
+			&& core.CanSendMessage())
+		{
+			if (!core.SendMessage(listener.Header, listener.Payload, listener.PayloadSize))
+			{
+				return 3;
+			}
+			listener.Pending = false;
+
+			if (listener.Header == UINT8_MAX
+				&& listener.PayloadSize == 0)
+			{
+				break;
+			}
+		}
+
+		Step(core, serial);
+	}
+
+	// Drain the last echo.
+	while (core.IsTxPolling())
+	{
+		core.Poll(NowMicros());
+	}
+	serial.flush();
+
+	return (listener.Errors == 0) ? 0 : 4;
+}
+
+/// <returns>Elapsed micros.</returns>
+uint32_t RunPingPong(const bool emulate, const uint32_t roundTrips, uint32_t& wireBytes)
+{
+	Definitions::SerialType serial(emulate);
+	if (!serial.Create(Definitions::SegmentName))
+	{
+		OnFail();
+	}
+
+	const pid_t child = fork();
+	if (child < 0)
+	{
+		OnFail();
+	}
+	else if (child == 0)
+	{
+		_exit(RunEcho(emulate));
+	}
+
+	LastMessageListener listener{};
+	Definitions::CoreType core(serial, &listener, Definitions::Key, Definitions::KeySize);
+	if (!StartCore(core))
+	{
+		OnFail();
+	}
+
+	uint8_t payload[Definitions::MaxPayloadSize];
+	wireBytes = 0;
+	uint32_t start = 0;
+	for (uint32_t i = 0; i <= roundTrips; i++)
+	{
+		// The last one tells the peer to exit.
+		const uint8_t header = (i < roundTrips) ? (uint8_t)(i % UINT8_MAX) : UINT8_MAX;
+		const uint8_t size = (i < roundTrips) ? FillPayload(payload, i) : 0;
+		if (!core.SendMessage(header, payload, size))
+		{
+			OnFail();
+		}
+		if (i > 0)
+		{
+			wireBytes += 2 * (2 + MessageDefinition::GetBufferSizeFromPayload(size));
+		}
+
+		const uint32_t sentMicros = NowMicros();
+		uint32_t retryMicros = sentMicros;
+		while (!listener.Pending)
+		{
+			if (NowMicros() - sentMicros > 1000000)
+			{
+				OnFail();
+			}
+
+			// The peer's begin() discards anything sent before it.
+			if (i == 0
+				&& NowMicros() - retryMicros > Definitions::RetryMicros
+				&& core.CanSendMessage())
+			{
+				core.SendMessage(header, payload, size);
+				retryMicros = NowMicros();
+			}
+			Step(core, serial);
+		}
+		listener.Pending = false;
+
+		if (listener.Header != header
+			|| listener.PayloadSize != size
+			|| memcmp(listener.Payload, payload, size) != 0)
+		{
+			OnFail();
+		}
+
+		while (!core.CanSendMessage())
+		{
+			core.Poll(NowMicros());
+		}
+
+		// The first one waits for the peer to start.
+		if (i == 0)
+		{
+			start = NowMicros();
+		}
+	}
+	const uint32_t elapsed = NowMicros() - start;
+
+	int status = 0;
+	if (waitpid(child, &status, 0) != child
+		|| !WIFEXITED(status)
+		|| WEXITSTATUS(status) != 0
+		|| listener.Errors > 0)
+	{
+		OnFail();
+	}
+
+	return elapsed;
+}
+
+void TestMemorySpeed()
+{
+	uint32_t wireBytes;
+	const uint32_t elapsed = RunPingPong(false, Definitions::RoundTrips, wireBytes);
+
+	Serial.print(F("Memory speed\tRound trips "));
+	Serial.print(Definitions::RoundTrips);
+	Serial.print(F("\tRound trips/s "));
+	Serial.print((uint32_t)(((uint64_t)Definitions::RoundTrips * 1000000) / (elapsed > 0 ? elapsed : 1)));
+	Serial.print(F("\tus/round trip "));
+	Serial.println((float)elapsed / Definitions::RoundTrips, 2);
+}
+
+void TestEmulatedBaudrate()
+{
+	uint32_t wireBytes;
+	const uint32_t elapsed = RunPingPong(true, Definitions::EmulatedRoundTrips, wireBytes);
+
+	// 10 bits per byte.
+	const uint32_t wireMicros = (uint32_t)(((uint64_t)wireBytes * 10 * 1000000) / Definitions::Baudrate);
+
+	Serial.print(F("1 Mbaud emulated\tRound trips "));
+	Serial.print(Definitions::EmulatedRoundTrips);
+	Serial.print(F("\tElapsed us "));
+	Serial.print(elapsed);
+	Serial.print(F("\tWire us "));
+	Serial.println(wireMicros);
+
+	// Never faster than the wire.
+	if (elapsed < wireMicros)
+	{
+		OnFail();
+	}
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface Shared Memory Transport Test Start"));
+	Serial.println();
+
+	TestMemorySpeed();
+	TestEmulatedBaudrate();
+
+	Serial.println();
+	Serial.println(F("All tests passed."));
+	Serial.println();
+}
+
+void loop()
+{
+}
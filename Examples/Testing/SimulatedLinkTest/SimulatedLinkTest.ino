@@ -0,0 +1,424 @@
+/*
+	Library Simulated Link Testing Project.
+	Runs two UartInterfaceTask endpoints over a deterministic simulated link, faster than real time.
+	Also sends a raw buffer through a standalone UartOutTask, which must not write outside it.
+	Host only (e.g. EpoxyDuino), the whole stack runs from the VirtualClock through _TASK_EXTERNAL_TIME.
+	UartInterfaceTask depends on TaskScheduler (https://github.com/arkhipenko/TaskScheduler).
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#define _TASK_EXTERNAL_TIME
+#define _TASK_OO_CALLBACKS
+#include <TScheduler.hpp>
+
+#include <UartInterface.h>
+#include <UartInterfaceTask.h>
+#include <UartInterfaceCore.h>
+#include <UartInterfaceSimulation.h>
+
+using namespace UartInterface;
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint32_t Baudrate = 115200;
+	static constexpr uint32_t PropagationNanos = 2000;
+	static constexpr uint32_t StepNanos = 5000;
+	static constexpr uint32_t DurationMillis = 2000;
+	static constexpr uint32_t DrainMillis = 100;
+
+	using UartDefinitions = TemplateUartDefinitions<Baudrate>;
+	using LinkType = Simulation::SimulatedLink<64, 64>;
+	using UartInterfaceTaskType = UartInterfaceTask<LinkType::Endpoint, UartDefinitions>;
+	using UartInterfaceCoreType = UartInterfaceCore<LinkType::Endpoint, UartDefinitions>;
+	using UartOutTaskType = UartOut::UartOutTask<LinkType::Endpoint, UartDefinitions::MaxSerialStepOut, UartDefinitions::WriteTimeoutMillis>;
+
+	// Follows the sender's payload pattern.
+	using HeartbeatFrame = PreEncodedFrame<Key, KeySize, 7, 7, 8, 9, 10>;
+}
+
+Simulation::VirtualClock Clock{};
+
+uint32_t external_millis()
+{
+	return Clock.Millis();
+}
+
+uint32_t external_micros()
+{
+	return Clock.Micros();
+}
+
+struct ScenarioResult
+{
+	Simulation::ChannelStats Link{};
+	uint32_t Sent = 0;
+	uint32_t Received = 0;
+	uint32_t Corrupted = 0;
+	uint32_t RxErrors = 0;
+	uint32_t TxErrors = 0;
+};
+
+/// <summary>
+/// Counts deliveries and checks payloads against the sender's pattern.
+/// </summary>
+struct CheckListener : UartListener
+{
+	ScenarioResult& Result;
+
+	CheckListener(ScenarioResult& result)
+		: Result(result)
+	{
+	}
+
+	void OnUartStateChange(const bool connected) final {}
+
+	void OnUartRx(const uint8_t header) final
+	{
+		Result.Received++;
+	}
+
+	void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+	{
+		Result.Received++;
+		for (uint8_t i = 0; i < payloadSize; i++)
+		{
+			if (payload[i] != (uint8_t)(header + i))
+			{
+				Result.Corrupted++;
+				break;
+			}
+		}
+	}
+
+	void OnUartTx() final {}
+
+	void OnUartRxError(const RxErrorEnum error) final
+	{
+		Result.RxErrors++;
+	}
+
+	void OnUartTxError(const TxErrorEnum error) final
+	{
+		Result.TxErrors++;
+	}
+};
+
+/// <summary>
+/// Sends a pattern of messages, every other one a constant pre-encoded frame if preEncoded.
+/// </summary>
+ScenarioResult RunScenario(const Simulation::FaultConfig& faults, const uint32_t seed, const bool preEncoded = false)
+{
+	ScenarioResult result{};
+	CheckListener listener(result);
+
+	Clock.Reset();
+	TS::Scheduler scheduler{};
+	Definitions::LinkType link(Clock, Definitions::PropagationNanos, seed);
+	link.SetFaults(faults);
+
+	Definitions::UartInterfaceTaskType sender(scheduler, link.A, nullptr, Definitions::Key, Definitions::KeySize);
+	Definitions::UartInterfaceTaskType receiver(scheduler, link.B, &listener, Definitions::Key, Definitions::KeySize);
+
+	if (!sender.Setup() || !receiver.Setup())
+	{
+		return result;
+	}
+
+	sender.Start();
+	receiver.Start();
+
+	uint8_t payload[Definitions::UartDefinitions::MaxPayloadSize]{};
+	while (Clock.Millis() < (Definitions::DurationMillis + Definitions::DrainMillis))
+	{
+		if (Clock.Millis() < Definitions::DurationMillis
+			&& sender.CanSendMessage())
+		{
+			const uint8_t header = (uint8_t)result.Sent;
+			const uint8_t payloadSize = 1 + (result.Sent % (sizeof(payload) - 1));
+			for (uint8_t i = 0; i < payloadSize; i++)
+			{
+				payload[i] = header + i;
+			}
+
+			if (preEncoded
+				&& (result.Sent % 2) == 1)
+			{
+				if (sender.template SendPreEncoded<Definitions::HeartbeatFrame>())
+				{
+					result.Sent++;
+				}
+			}
+			else if (sender.SendMessage(header, payload, payloadSize))
+			{
+				result.Sent++;
+			}
+		}
+
+		scheduler.execute();
+		Clock.Advance(Definitions::StepNanos);
+	}
+
+	sender.Stop();
+	receiver.Stop();
+	result.Link = link.A.GetStats();
+
+	return result;
+}
+
+/// <summary>
+/// Same traffic as RunScenario, from a super-loop without TaskScheduler.
+/// The clock jumps straight to the next deadline, capped to a byte time while the link is busy.
+/// </summary>
+ScenarioResult RunCoreScenario(uint32_t& polls)
+{
+	ScenarioResult result{};
+	CheckListener listener(result);
+
+	Clock.Reset();
+	Definitions::LinkType link(Clock, Definitions::PropagationNanos);
+
+	Definitions::UartInterfaceCoreType sender(link.A, nullptr, Definitions::Key, Definitions::KeySize);
+	Definitions::UartInterfaceCoreType receiver(link.B, &listener, Definitions::Key, Definitions::KeySize);
+
+	if (!sender.Setup() || !receiver.Setup())
+	{
+		return result;
+	}
+
+	sender.Start();
+	receiver.Start();
+
+	static constexpr uint32_t byteNanos = (1000000000UL / Definitions::Baudrate) * 10;
+	uint8_t payload[Definitions::UartDefinitions::MaxPayloadSize]{};
+	polls = 0;
+	while (Clock.Millis() < (Definitions::DurationMillis + Definitions::DrainMillis))
+	{
+		const uint32_t now = Clock.Micros();
+
+		if (Clock.Millis() < Definitions::DurationMillis
+			&& sender.CanSendMessage())
+		{
+			const uint8_t header = (uint8_t)result.Sent;
+			const uint8_t payloadSize = 1 + (result.Sent % (sizeof(payload) - 1));
+			for (uint8_t i = 0; i < payloadSize; i++)
+			{
+				payload[i] = header + i;
+			}
+
+			if (sender.SendMessage(header, payload, payloadSize))
+			{
+				result.Sent++;
+			}
+		}
+
+		// Stands in for the RX interrupt.
+		if (link.B.available() > 0)
+		{
+			receiver.OnSerialEvent(now);
+		}
+
+		const uint32_t senderDeadline = sender.Poll(now);
+		const uint32_t receiverDeadline = receiver.Poll(now);
+		polls++;
+
+		uint32_t wait = (int32_t)(senderDeadline - receiverDeadline) < 0 ? senderDeadline - now : receiverDeadline - now;
+		if ((int32_t)wait <= 0)
+		{
+			Clock.Advance(Definitions::StepNanos);
+		}
+		else
+		{
+			const uint64_t waitNanos = (uint64_t)wait * 1000;
+			Clock.Advance((link.A.Pending() > 0 || link.B.Pending() > 0) && waitNanos > byteNanos ? byteNanos : waitNanos);
+		}
+	}
+
+	result.Link = link.A.GetStats();
+
+	return result;
+}
+
+/// <summary>
+/// Sends a raw buffer with a UartOutTask that owns its core, the far end must read it between two delimiters.
+/// </summary>
+bool TestOutTask()
+{
+	static constexpr uint8_t MessageSize = 5;
+
+	Clock.Reset();
+	TS::Scheduler scheduler{};
+	Definitions::LinkType link(Clock, Definitions::PropagationNanos);
+	link.A.begin(Definitions::Baudrate);
+	link.B.begin(Definitions::Baudrate);
+
+	// Guard bytes around the message.
+	static constexpr uint8_t Guard = 0xA5;
+	uint8_t outFrame[1 + MessageSize + 1]{ Guard, 1, 2, 3, 4, 5, Guard };
+	uint8_t* outBuffer = &outFrame[1];
+	Definitions::UartOutTaskType writer(scheduler, link.A, outBuffer, nullptr);
+	if (!writer.Setup()
+		|| !writer.Start()
+		|| !writer.CanSend()
+		|| !writer.SendMessage(MessageSize)
+		|| writer.CanSend())
+	{
+		return false;
+	}
+
+	uint8_t received[MessageSize + 2]{};
+	uint8_t receivedSize = 0;
+	while (Clock.Millis() < Definitions::DrainMillis)
+	{
+		scheduler.execute();
+		Clock.Advance(Definitions::StepNanos);
+		while (link.B.available() > 0)
+		{
+			const uint8_t value = (uint8_t)link.B.read();
+			if (receivedSize < sizeof(received))
+			{
+				received[receivedSize] = value;
+			}
+			receivedSize++;
+		}
+	}
+
+	return writer.CanSend()
+		&& outFrame[0] == Guard
+		&& outFrame[MessageSize + 1] == Guard
+		&& receivedSize == sizeof(received)
+		&& received[0] == MessageDefinition::Delimiter
+		&& memcmp(&received[1], outBuffer, MessageSize) == 0
+		&& received[MessageSize + 1] == MessageDefinition::Delimiter;
+}
+
+void PrintResult(const ScenarioResult& result)
+{
+	Serial.print(F("\tSent "));
+	Serial.print(result.Sent);
+	Serial.print(F("\tReceived "));
+	Serial.print(result.Received);
+	Serial.print(F("\tCorrupted "));
+	Serial.print(result.Corrupted);
+	Serial.print(F("\tRxErrors "));
+	Serial.print(result.RxErrors);
+	Serial.print(F("\tTxErrors "));
+	Serial.println(result.TxErrors);
+	Serial.print(F("\tWire bytes "));
+	Serial.print(result.Link.BytesOnWire);
+	Serial.print(F("\tBitFlips "));
+	Serial.print(result.Link.BitFlips);
+	Serial.print(F("\tDrops "));
+	Serial.print(result.Link.Drops);
+	Serial.print(F("\tInserts "));
+	Serial.print(result.Link.Inserts);
+	Serial.print(F("\tOverruns "));
+	Serial.println(result.Link.RxOverruns);
+}
+
+bool SameResult(const ScenarioResult& a, const ScenarioResult& b)
+{
+	return a.Sent == b.Sent
+		&& a.Received == b.Received
+		&& a.RxErrors == b.RxErrors
+		&& a.Link.BytesOnWire == b.Link.BytesOnWire
+		&& a.Link.BitFlips == b.Link.BitFlips;
+}
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface Simulated Link Test Start"));
+	Serial.println();
+
+	// Clean link: every message arrives, wire rate bounds the throughput.
+	Simulation::FaultConfig clean{};
+	const ScenarioResult cleanResult = RunScenario(clean, 1);
+	Serial.println(F("Clean link"));
+	PrintResult(cleanResult);
+	if (cleanResult.Sent == 0
+		|| cleanResult.Received != cleanResult.Sent
+		|| cleanResult.Corrupted > 0
+		|| cleanResult.RxErrors > 0
+		|| cleanResult.Link.BytesOnWire > ((Definitions::Baudrate / 10) * (Definitions::DurationMillis + Definitions::DrainMillis)) / 1000)
+	{
+		OnFail();
+	}
+
+	// Noisy link: errors are detected, never delivered.
+	Simulation::FaultConfig noisy{};
+	noisy.BitFlipPpm = 50;
+	noisy.DropPpm = 100;
+	noisy.InsertPpm = 100;
+	const ScenarioResult noisyResult = RunScenario(noisy, 1234);
+	Serial.println(F("Noisy link"));
+	PrintResult(noisyResult);
+	if (noisyResult.RxErrors == 0
+		|| noisyResult.Corrupted > 0)
+	{
+		OnFail();
+	}
+
+	// Same seed, same outcome.
+	if (!SameResult(noisyResult, RunScenario(noisy, 1234)))
+	{
+		Serial.println(F("Not deterministic."));
+		OnFail();
+	}
+
+	// Constant frames, encoded at compile-time, mixed with runtime encoded ones.
+	const ScenarioResult preEncodedResult = RunScenario(clean, 1, true);
+	Serial.println(F("Pre-encoded frames"));
+	PrintResult(preEncodedResult);
+	if (preEncodedResult.Sent == 0
+		|| preEncodedResult.Received != preEncodedResult.Sent
+		|| preEncodedResult.Corrupted > 0
+		|| preEncodedResult.RxErrors > 0)
+	{
+		OnFail();
+	}
+
+	// Scheduler-free cores, polled only when due.
+	uint32_t polls = 0;
+	const ScenarioResult coreResult = RunCoreScenario(polls);
+	Serial.print(F("Core super-loop, polls "));
+	Serial.println(polls);
+	PrintResult(coreResult);
+	if (coreResult.Sent == 0
+		|| coreResult.Received != coreResult.Sent
+		|| coreResult.Corrupted > 0
+		|| coreResult.RxErrors > 0)
+	{
+		OnFail();
+	}
+
+	Serial.println(F("Standalone UartOutTask"));
+	if (!TestOutTask())
+	{
+		OnFail();
+	}
+
+	Serial.println();
+	Serial.println(F("All tests passed."));
+	Serial.println();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,278 @@
+/*
+	Library Single-Write Framing Testing Project.
+	Sends messages and pre-encoded frames through a serial that counts its driver calls.
+	A frame that fits the serial's free space must go out in a single write, delimiters included, in a single TX step.
+	Pre-encoded frames go out in a single gathered write, when the serial takes one.
+	Through a serial TX FIFO smaller than a frame, the chunked path must put the same bytes on the wire.
+	Reports driver writes and TX steps per frame.
+	Host only (e.g. EpoxyDuino).
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#include <UartInterface.h>
+#include <UartInterfaceCore.h>
+
+using namespace UartInterface;
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint8_t MaxPayloadSize = 64;
+	static constexpr uint16_t Messages = 500;
+
+	static constexpr uint32_t CaptureSize = 64 * 1024;
+
+	using UartDefinitions = TemplateUartDefinitions<1000000, MaxPayloadSize>;
+	struct AddressedDefinitions : UartDefinitions
+	{
+		static constexpr bool Addressed = true;
+	};
+}
+
+uint8_t Captures[2][Definitions::CaptureSize];
+
+/// <summary>
+/// Counts every driver call, and keeps the bytes.
+/// </summary>
+struct CountingSerial
+{
+	uint8_t* Capture = nullptr;
+	uint32_t Size = 0;
+	uint32_t Writes = 0;
+	int FifoSize = 1024;
+
+	operator bool() { return true; }
+	void begin(const unsigned long baudrate) {}
+	int available() { return 0; }
+	int peek() { return -1; }
+	int read() { return -1; }
+	int availableForWrite() { return FifoSize; }
+	void flush() {}
+	void clearWriteError() {}
+
+	size_t write(const uint8_t value)
+	{
+		return write(&value, 1);
+	}
+
+	size_t write(const uint8_t* buffer, const size_t size)
+	{
+		Writes++;
+		const size_t accepted = (size > (size_t)FifoSize) ? (size_t)FifoSize : size;
+		if (Size + accepted <= Definitions::CaptureSize)
+		{
+			memcpy(&Capture[Size], buffer, accepted);
+			Size += accepted;
+		}
+
+		return accepted;
+	}
+};
+
+/// <summary>
+/// With a single call for several buffers, as writev() would.
+/// </summary>
+struct GatherSerial : CountingSerial
+{
+	uint16_t WriteGather(const uint8_t* const* data, const uint16_t* sizes, const uint8_t count)
+	{
+		Writes++;
+		uint16_t written = 0;
+		for (uint8_t i = 0; i < count; i++)
+		{
+			memcpy(&Capture[Size], data[i], sizes[i]);
+			Size += sizes[i];
+			written += sizes[i];
+		}
+
+		return written;
+	}
+};
+
+struct StepResult
+{
+	uint32_t Writes;
+	uint32_t Steps;
+	uint32_t Size;
+};
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+uint8_t FillPayload(uint8_t* payload, const uint16_t index)
+{
+	const uint8_t size = (uint8_t)(index % (Definitions::MaxPayloadSize + 1));
+	for (uint8_t i = 0; i < size; i++)
+	{
+		payload[i] = ((i + index) % 6 == 0) ? 0 : (uint8_t)(index * 17 + i);
+	}
+
+	return size;
+}
+
+template<bool PreEncoded>
+struct SendTag {};
+
+template<typename CoreType, typename CodecType>
+bool Send(CoreType& core, CodecType& codec, uint8_t* frame, const uint8_t header, const uint8_t* payload, const uint8_t size, SendTag<false>)
+{
+	return core.SendMessage(header, payload, size);
+}
+
+/// <summary>
+/// Encoded by a scratch codec, and sent from outside the core.
+/// </summary>
+template<typename CoreType, typename CodecType>
+bool Send(CoreType& core, CodecType& codec, uint8_t* frame, const uint8_t header, const uint8_t* payload, const uint8_t size, SendTag<true>)
+{
+	frame[(uint8_t)MessageDefinition::FieldIndexEnum::Header] = header;
+	memcpy(&frame[(uint8_t)MessageDefinition::FieldIndexEnum::Payload], payload, size);
+	const uint8_t frameSize = (uint8_t)codec.EncodeMessageAndCrcInPlace(frame, MessageDefinition::GetMessageSize(size));
+
+	return core.SendPreEncoded(frame, frameSize);
+}
+
+/// <summary>
+/// Every message, each sent and stepped until done.
+/// </summary>
+template<typename SerialType, typename UartDefinitions, bool PreEncoded = false>
+StepResult SendAll(SerialType& serial)
+{
+	UartInterfaceCore<SerialType, UartDefinitions> core(serial, nullptr, Definitions::Key, Definitions::KeySize);
+	if (!core.Setup())
+	{
+		OnFail();
+	}
+	core.Start();
+	while (!core.CanSendMessage())
+	{
+		core.Poll(0);
+	}
+
+	MessageCodec<Definitions::MaxPayloadSize> codec(Definitions::Key, Definitions::KeySize);
+	codec.Setup();
+
+	const uint32_t writesBefore = serial.Writes;
+	StepResult result{};
+	uint8_t payload[Definitions::MaxPayloadSize];
+	uint8_t frame[MessageDefinition::GetBufferSizeFromPayload(Definitions::MaxPayloadSize)];
+	for (uint16_t i = 0; i < Definitions::Messages; i++)
+	{
+		const uint8_t size = FillPayload(payload, i);
+		if (!Send(core, codec, frame, (uint8_t)i, payload, size, SendTag<PreEncoded>()))
+		{
+			OnFail();
+		}
+
+		while (core.IsTxPolling())
+		{
+			core.PollTx(0);
+			result.Steps++;
+		}
+	}
+
+	result.Writes = serial.Writes - writesBefore;
+	result.Size = serial.Size;
+
+	return result;
+}
+
+void Report(const char* name, const StepResult& result)
+{
+	Serial.print(name);
+	Serial.print(F("\tWrites/frame "));
+	Serial.print((float)result.Writes / Definitions::Messages, 2);
+	Serial.print(F("\tTX steps/frame "));
+	Serial.println((float)result.Steps / Definitions::Messages, 2);
+}
+
+template<typename UartDefinitions>
+void TestMessages(const char* name)
+{
+	CountingSerial whole{};
+	whole.Capture = Captures[0];
+	const StepResult single = SendAll<CountingSerial, UartDefinitions>(whole);
+
+	CountingSerial small{};
+	small.Capture = Captures[1];
+	small.FifoSize = 16;
+	const StepResult chunked = SendAll<CountingSerial, UartDefinitions>(small);
+
+	Report(name, single);
+	Report("  16 byte FIFO", chunked);
+
+	if (single.Writes != Definitions::Messages
+		|| single.Steps != Definitions::Messages
+		|| single.Size != chunked.Size
+		|| memcmp(Captures[0], Captures[1], single.Size) != 0)
+	{
+		OnFail();
+	}
+}
+
+void TestPreEncoded()
+{
+	GatherSerial gather{};
+	gather.Capture = Captures[0];
+	const StepResult gathered = SendAll<GatherSerial, Definitions::UartDefinitions, true>(gather);
+
+	CountingSerial plain{};
+	plain.Capture = Captures[1];
+	const StepResult separate = SendAll<CountingSerial, Definitions::UartDefinitions, true>(plain);
+
+	Report("Pre-encoded, gathered", gathered);
+	Report("Pre-encoded", separate);
+
+	// Delimiter, frame, delimiter.
+	if (gathered.Writes != Definitions::Messages
+		|| gathered.Steps != Definitions::Messages
+		|| separate.Writes != 3 * Definitions::Messages
+		|| separate.Steps != Definitions::Messages
+		|| gathered.Size != separate.Size
+		|| memcmp(Captures[0], Captures[1], gathered.Size) != 0)
+	{
+		OnFail();
+	}
+
+	// The same bytes as sent from the OutBuffer.
+	CountingSerial reference{};
+	reference.Capture = Captures[1];
+	const StepResult messages = SendAll<CountingSerial, Definitions::UartDefinitions>(reference);
+	if (messages.Size != gathered.Size
+		|| memcmp(Captures[0], Captures[1], gathered.Size) != 0)
+	{
+		OnFail();
+	}
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface Single-Write Framing Test Start"));
+	Serial.println();
+
+	TestMessages<Definitions::UartDefinitions>("Messages\t");
+	TestMessages<Definitions::AddressedDefinitions>("Addressed\t");
+	TestPreEncoded();
+
+	Serial.println();
+	Serial.println(F("All tests passed."));
+	Serial.println();
+}
+
+void loop()
+{
+}
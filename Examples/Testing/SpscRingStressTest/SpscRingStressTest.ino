@@ -0,0 +1,404 @@
+/*
+	Library SPSC Ring Stress Testing Project.
+	Hammers SpscByteRing with a reader thread at multi-Mbaud rates, with consumer hiccups.
+	Then runs a receiver that stalls its scheduler, with and without an SpscSerial fed from the "ISR".
+	Host only (e.g. EpoxyDuino), link with -pthread.
+	UartInterfaceTask depends on TaskScheduler (https://github.com/arkhipenko/TaskScheduler).
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#define _TASK_EXTERNAL_TIME
+#define _TASK_OO_CALLBACKS
+#include <TScheduler.hpp>
+
+#include <UartInterface.h>
+#include <UartInterfaceTask.h>
+#include <UartInterfaceSimulation.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace UartInterface;
+
+namespace Definitions
+{
+	static constexpr uint16_t RingSize = 1024;
+	static constexpr uint8_t BurstSize = 16;
+	static constexpr uint32_t DurationMillis = 1000;
+
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint32_t LinkBaudrate = 1000000;
+	static constexpr uint32_t StepNanos = 2000;
+	static constexpr uint32_t LinkDurationMillis = 1000;
+	static constexpr uint32_t StallPeriodMillis = 20;
+	static constexpr uint32_t StallMillis = 4;
+
+	using RingType = Transport::SpscByteRing<RingSize>;
+	using UartDefinitions = TemplateUartDefinitions<LinkBaudrate>;
+	using LinkType = Simulation::SimulatedLink<64, 64>;
+	using RingSerialType = Transport::SpscSerial<LinkType::Endpoint, RingSize>;
+}
+
+Simulation::VirtualClock Clock{};
+
+uint32_t external_millis()
+{
+	return Clock.Millis();
+}
+
+uint32_t external_micros()
+{
+	return Clock.Micros();
+}
+
+static uint8_t Pattern(const uint32_t index)
+{
+	return (uint8_t)(index ^ (index >> 8) ^ (index >> 16));
+}
+
+struct StressResult
+{
+	uint32_t Produced = 0;
+	uint32_t Consumed = 0;
+	uint32_t Overruns = 0;
+	uint32_t Mismatches = 0;
+	uint32_t ElapsedMicros = 0;
+};
+
+/// <summary>
+/// Reader thread pushes FIFO sized bursts, paced at baudrate (8N1).
+/// With baudrate 0, the reader pushes without loss as fast as the consumer keeps up.
+/// The consumer sleeps for hiccupMicros every hiccupPeriodMicros.
+/// The producer only advances the pattern by what was pushed, so the stream stays checkable through overruns.
+/// </summary>
+StressResult RunStress(const uint32_t baudrate, const uint32_t hiccupPeriodMicros, const uint32_t hiccupMicros)
+{
+	using ClockType = std::chrono::steady_clock;
+
+	static Definitions::RingType ring{};
+	ring.Clear();
+	const uint32_t overrunsStart = ring.GetOverruns();
+
+	StressResult result{};
+	std::atomic<bool> running{ true };
+	std::atomic<uint32_t> produced{ 0 };
+	std::atomic<uint32_t> offered{ 0 };
+
+	const ClockType::time_point start = ClockType::now();
+	const ClockType::time_point end = start + std::chrono::milliseconds(Definitions::DurationMillis);
+
+	std::thread producer([&]()
+		{
+			uint8_t burst[Definitions::BurstSize];
+			uint32_t index = 0;
+			uint64_t offeredBytes = 0;
+
+			while (ClockType::now() < end)
+			{
+				if (baudrate == 0)
+				{
+					// Lossless, fills the ring in place and waits while it is full.
+					uint8_t* span;
+					uint16_t spanSize = ring.WriteSpan(span);
+					if (spanSize == 0)
+					{
+						std::this_thread::yield();
+						continue;
+					}
+					else if (spanSize > sizeof(burst))
+					{
+						spanSize = sizeof(burst);
+					}
+
+					for (uint16_t i = 0; i < spanSize; i++)
+					{
+						span[i] = Pattern(index + i);
+					}
+					ring.Commit(spanSize);
+					index += spanSize;
+					offeredBytes += spanSize;
+					continue;
+				}
+
+				// Everything due by now arrives in FIFO sized bursts, then the reader sleeps.
+				const uint64_t due = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(ClockType::now() - start).count() * baudrate / (10 * 1000000000ULL);
+
+				if (offeredBytes >= due)
+				{
+					std::this_thread::sleep_for(std::chrono::microseconds(20));
+					continue;
+				}
+
+				while (offeredBytes < due)
+				{
+					for (uint8_t i = 0; i < sizeof(burst); i++)
+					{
+						burst[i] = Pattern(index + i);
+					}
+					index += ring.Push(burst, sizeof(burst));
+					offeredBytes += sizeof(burst);
+				}
+			}
+
+			produced = index;
+			offered = (uint32_t)offeredBytes;
+			running = false;
+		});
+
+	uint32_t index = 0;
+	ClockType::time_point nextHiccup = start + std::chrono::microseconds(hiccupPeriodMicros);
+	while (true)
+	{
+		const bool wasRunning = running;
+
+		const uint8_t* span;
+		const uint16_t spanSize = ring.ReadSpan(span);
+		for (uint16_t i = 0; i < spanSize; i++)
+		{
+			if (span[i] != Pattern(index + i))
+			{
+				result.Mismatches++;
+			}
+		}
+		ring.Consume(spanSize);
+		index += spanSize;
+
+		if (spanSize == 0)
+		{
+			if (!wasRunning)
+			{
+				break;
+			}
+			std::this_thread::yield();
+		}
+
+		if (hiccupMicros > 0 && ClockType::now() >= nextHiccup)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(hiccupMicros));
+			nextHiccup = ClockType::now() + std::chrono::microseconds(hiccupPeriodMicros);
+		}
+	}
+
+	producer.join();
+
+	result.ElapsedMicros = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(ClockType::now() - start).count();
+	result.Produced = offered;
+	result.Consumed = index;
+	result.Overruns = ring.GetOverruns() - overrunsStart;
+
+	if (produced != index)
+	{
+		result.Mismatches++;
+	}
+
+	return result;
+}
+
+void PrintStress(const StressResult& result)
+{
+	Serial.print(F("\tOffered "));
+	Serial.print(result.Produced);
+	Serial.print(F("\tConsumed "));
+	Serial.print(result.Consumed);
+	Serial.print(F("\tOverruns "));
+	Serial.print(result.Overruns);
+	Serial.print(F("\tMismatches "));
+	Serial.print(result.Mismatches);
+	Serial.print(F("\tMbaud "));
+	Serial.println((((uint64_t)result.Consumed * 10) / (result.ElapsedMicros > 0 ? result.ElapsedMicros : 1)));
+}
+
+bool StressValid(const StressResult& result)
+{
+	return result.Consumed > 0
+		&& result.Mismatches == 0
+		&& (result.Consumed + result.Overruns) == result.Produced;
+}
+
+struct LinkResult
+{
+	uint32_t Sent = 0;
+	uint32_t Received = 0;
+	uint32_t RxErrors = 0;
+	uint32_t LinkOverruns = 0;
+	uint32_t RingOverruns = 0;
+};
+
+struct CountListener : UartListener
+{
+	LinkResult& Result;
+
+	CountListener(LinkResult& result)
+		: Result(result)
+	{
+	}
+
+	void OnUartStateChange(const bool connected) final {}
+	void OnUartRx(const uint8_t header) final { Result.Received++; }
+	void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final { Result.Received++; }
+	void OnUartTx() final {}
+	void OnUartRxError(const RxErrorEnum error) final { Result.RxErrors++; }
+	void OnUartTxError(const TxErrorEnum error) final {}
+};
+
+/// <summary>
+/// The receiver's scheduler stalls for StallMillis every StallPeriodMillis.
+/// The "ISR" (Pump) keeps running through the stall when the receiver reads through the ring.
+/// </summary>
+template<typename ReceiverSerialType>
+LinkResult RunStalledReceiver(Definitions::LinkType& link, ReceiverSerialType& receiverSerial, Definitions::RingSerialType* ringSerial)
+{
+	LinkResult result{};
+	CountListener listener(result);
+
+	TS::Scheduler senderScheduler{};
+	TS::Scheduler receiverScheduler{};
+
+	UartInterfaceTask<Definitions::LinkType::Endpoint, Definitions::UartDefinitions> sender(senderScheduler, link.A, nullptr, Definitions::Key, Definitions::KeySize);
+	UartInterfaceTask<ReceiverSerialType, Definitions::UartDefinitions> receiver(receiverScheduler, receiverSerial, &listener, Definitions::Key, Definitions::KeySize);
+
+	if (!sender.Setup() || !receiver.Setup())
+	{
+		return result;
+	}
+
+	sender.Start();
+	receiver.Start();
+
+	uint8_t payload[Definitions::UartDefinitions::MaxPayloadSize]{};
+	while (Clock.Millis() < Definitions::LinkDurationMillis)
+	{
+		if (Clock.Millis() < (Definitions::LinkDurationMillis - 50)
+			&& sender.CanSendMessage()
+			&& sender.SendMessage((uint8_t)result.Sent, payload, sizeof(payload)))
+		{
+			result.Sent++;
+		}
+		senderScheduler.execute();
+
+		if (ringSerial != nullptr)
+		{
+			ringSerial->Pump();
+		}
+
+		if ((Clock.Millis() % Definitions::StallPeriodMillis) >= Definitions::StallMillis)
+		{
+			if (ringSerial != nullptr && ringSerial->TakeEvent())
+			{
+				receiver.OnSerialEvent();
+			}
+			receiverScheduler.execute();
+		}
+
+		Clock.Advance(Definitions::StepNanos);
+	}
+
+	result.LinkOverruns = link.A.GetStats().RxOverruns;
+	if (ringSerial != nullptr)
+	{
+		result.RingOverruns = ringSerial->GetOverruns();
+	}
+
+	return result;
+}
+
+void PrintLink(const LinkResult& result)
+{
+	Serial.print(F("\tSent "));
+	Serial.print(result.Sent);
+	Serial.print(F("\tReceived "));
+	Serial.print(result.Received);
+	Serial.print(F("\tRxErrors "));
+	Serial.print(result.RxErrors);
+	Serial.print(F("\tFifo Overruns "));
+	Serial.print(result.LinkOverruns);
+	Serial.print(F("\tRing Overruns "));
+	Serial.println(result.RingOverruns);
+}
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface SPSC Ring Stress Test Start"));
+	Serial.println();
+
+	// 4 Mbaud, consumer sleeps 1 ms every 10 ms: 400 bytes per hiccup, fits the ring.
+	// A single core host can't keep both threads running, overruns are only checked with 2+ cores.
+	Serial.println(F("Paced 4 Mbaud, short hiccups"));
+	const StressResult paced = RunStress(4000000, 10000, 1000);
+	PrintStress(paced);
+	if (!StressValid(paced)
+		|| (paced.Overruns > 0 && std::thread::hardware_concurrency() > 1))
+	{
+		OnFail();
+	}
+
+	// 4 Mbaud, consumer sleeps 10 ms: overruns must be counted, the stream stays intact.
+	Serial.println(F("Paced 4 Mbaud, long hiccups"));
+	const StressResult overrun = RunStress(4000000, 20000, 10000);
+	PrintStress(overrun);
+	if (!StressValid(overrun)
+		|| overrun.Overruns == 0)
+	{
+		OnFail();
+	}
+
+	Serial.println(F("Unpaced, lossless"));
+	const StressResult unpaced = RunStress(0, 0, 0);
+	PrintStress(unpaced);
+	if (!StressValid(unpaced)
+		|| unpaced.Overruns > 0)
+	{
+		OnFail();
+	}
+
+	// Stalled receiver, straight from the 64 byte driver FIFO.
+	Serial.println(F("Stalled receiver, driver FIFO"));
+	Clock.Reset();
+	Definitions::LinkType directLink(Clock);
+	const LinkResult direct = RunStalledReceiver(directLink, directLink.B, nullptr);
+	PrintLink(direct);
+
+	// Stalled receiver, fed through the ring.
+	Serial.println(F("Stalled receiver, SPSC ring"));
+	Clock.Reset();
+	Definitions::LinkType ringLink(Clock);
+	Definitions::RingSerialType ringSerial(ringLink.B);
+	const LinkResult ringed = RunStalledReceiver(ringLink, ringSerial, &ringSerial);
+	PrintLink(ringed);
+
+	if (direct.LinkOverruns == 0
+		|| ringed.Sent == 0
+		|| ringed.Received != ringed.Sent
+		|| ringed.RxErrors > 0
+		|| ringed.LinkOverruns > 0
+		|| ringed.RingOverruns > 0)
+	{
+		OnFail();
+	}
+
+	Serial.println();
+	Serial.println(F("All tests passed."));
+	Serial.println();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,282 @@
+/*
+	Library Stream Decoder Benchmark Project.
+	Builds a large in-memory stream of delimited frames, with corrupted, short and overlong frames mixed in,
+	 and decodes it with MessageStreamDecoder, whole and in chunks that split frames.
+	Checks that every chunking yields the same records, and reports the scan and decode throughput.
+	Host only (e.g. EpoxyDuino).
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#include <UartInterface.h>
+
+#include <chrono>
+
+using namespace UartInterface;
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint32_t StreamSize = 32 * 1024 * 1024;
+	static constexpr uint8_t PayloadSizeMax = 64;
+
+	// One in each, by frame index.
+	static constexpr uint32_t CorruptEvery = 97;
+	static constexpr uint32_t ShortEvery = 1009;
+	static constexpr uint32_t LongEvery = 10007;
+
+	static constexpr size_t ChunkSizes[]{ 1, 7, 4093, 65536 };
+
+	using DecoderType = MessageStreamDecoder<PayloadSizeMax>;
+}
+
+uint8_t Stream[Definitions::StreamSize];
+uint8_t Work[Definitions::StreamSize];
+uint32_t StreamSize = 0;
+
+Definitions::DecoderType Decoder(Definitions::Key, Definitions::KeySize);
+MessageCodec<Definitions::PayloadSizeMax> Encoder(Definitions::Key, Definitions::KeySize);
+
+struct ExpectedCounts
+{
+	uint32_t Valid = 0;
+	uint32_t Crc = 0;
+	uint32_t TooShort = 0;
+	uint32_t TooLong = 0;
+};
+
+ExpectedCounts Expected{};
+
+/// <summary>
+/// Order sensitive digest of the records, to compare decodes.
+/// </summary>
+struct RecordDigest
+{
+	uint64_t Hash = 1469598103934665603ULL;
+	uint32_t Count = 0;
+
+	void Add(const uint8_t value)
+	{
+		Hash = (Hash ^ value) * 1099511628211ULL;
+	}
+
+	void Add(const StreamRecord& record)
+	{
+		for (uint8_t i = 0; i < 8; i++)
+		{
+			Add((uint8_t)(record.Offset >> (i * 8)));
+		}
+		Add((uint8_t)record.Status);
+		Add(record.Header);
+		Add(record.PayloadSize);
+		for (uint8_t i = 0; i < record.PayloadSize; i++)
+		{
+			Add(record.Payload[i]);
+		}
+		Count++;
+	}
+};
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+/// <summary>
+/// Wire-like stream: each frame between its own start and end delimiters.
+/// </summary>
+void BuildStream()
+{
+	uint8_t message[MessageDefinition::GetBufferSizeFromPayload(Definitions::PayloadSizeMax)]{};
+	static constexpr uint16_t frameSizeMax = sizeof(message) + 2;
+
+	uint32_t index = 0;
+	while (StreamSize + (frameSizeMax * 2) < sizeof(Stream))
+	{
+		Stream[StreamSize++] = MessageDefinition::Delimiter;
+
+		if ((index % Definitions::ShortEvery) == Definitions::ShortEvery - 1)
+		{
+			Stream[StreamSize++] = 0x55;
+			Expected.TooShort++;
+		}
+		else if ((index % Definitions::LongEvery) == Definitions::LongEvery - 1)
+		{
+			memset(&Stream[StreamSize], 0xAA, frameSizeMax);
+			StreamSize += frameSizeMax;
+			Expected.TooLong++;
+		}
+		else
+		{
+			const uint8_t payloadSize = (uint8_t)(index % (Definitions::PayloadSizeMax + 1));
+			message[(uint8_t)MessageDefinition::FieldIndexEnum::Header] = (uint8_t)index;
+			for (uint8_t i = 0; i < payloadSize; i++)
+			{
+				message[(uint8_t)MessageDefinition::FieldIndexEnum::Payload + i] = (uint8_t)(index * 7 + i);
+			}
+
+			const uint16_t encodedSize = Encoder.EncodeMessageAndCrcInPlace(message, MessageDefinition::GetMessageSize(payloadSize));
+			if ((index % Definitions::CorruptEvery) == Definitions::CorruptEvery - 1)
+			{
+				// Never 0, the frame stays whole.
+				message[encodedSize / 2] = (message[encodedSize / 2] == 0xFF) ? 0x01 : (uint8_t)(message[encodedSize / 2] + 1);
+				Expected.Crc++;
+			}
+			else
+			{
+				Expected.Valid++;
+			}
+
+			memcpy(&Stream[StreamSize], message, encodedSize);
+			StreamSize += encodedSize;
+		}
+
+		Stream[StreamSize++] = MessageDefinition::Delimiter;
+		index++;
+	}
+
+	// A partial frame at the end.
+	Stream[StreamSize++] = MessageDefinition::Delimiter;
+	Stream[StreamSize++] = 0x42;
+	Stream[StreamSize++] = 0x43;
+}
+
+/// <summary>
+/// Decodes a fresh copy of the stream, in chunks of chunkSize (0 for a single chunk).
+/// </summary>
+RecordDigest Decode(const size_t chunkSize, uint32_t& elapsedMicros)
+{
+	using ClockType = std::chrono::steady_clock;
+
+	RecordDigest digest{};
+	memcpy(Work, Stream, StreamSize);
+	Decoder.Clear();
+
+	const ClockType::time_point start = ClockType::now();
+	const size_t step = (chunkSize > 0) ? chunkSize : StreamSize;
+	for (size_t offset = 0; offset < StreamSize; offset += step)
+	{
+		const size_t size = (StreamSize - offset < step) ? (StreamSize - offset) : step;
+		Decoder.Feed(&Work[offset], size, [&digest](const StreamRecord& record)
+			{
+				digest.Add(record);
+			});
+	}
+	Decoder.Finish([&digest](const StreamRecord& record)
+		{
+			digest.Add(record);
+		});
+	elapsedMicros = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(ClockType::now() - start).count();
+
+	return digest;
+}
+
+uint32_t GetMegabytesPerSecond(const uint32_t bytes, const uint32_t elapsedMicros)
+{
+	return (uint32_t)(bytes / (elapsedMicros > 0 ? elapsedMicros : 1));
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface Stream Decoder Benchmark Start"));
+	Serial.println();
+
+	if (!Decoder.Setup()
+		|| !Encoder.Setup())
+	{
+		Serial.println(F("Setup Failed!"));
+		OnFail();
+	}
+
+	BuildStream();
+	Serial.print(F("Stream "));
+	Serial.print(StreamSize);
+	Serial.println(F(" bytes"));
+
+	uint32_t elapsed = 0;
+	const RecordDigest reference = Decode(0, elapsed);
+	const StreamStats stats = Decoder.GetStats();
+
+	Serial.print(F("Valid "));
+	Serial.print(stats.Valid);
+	Serial.print(F("\tCrc "));
+	Serial.print(stats.Crc);
+	Serial.print(F("\tTooShort "));
+	Serial.print(stats.TooShort);
+	Serial.print(F("\tTooLong "));
+	Serial.print(stats.TooLong);
+	Serial.print(F("\tTruncated "));
+	Serial.println(stats.Truncated);
+
+	if (stats.Valid != Expected.Valid
+		|| stats.Crc != Expected.Crc
+		|| stats.TooShort != Expected.TooShort
+		|| stats.TooLong != Expected.TooLong
+		|| stats.Truncated != 1
+		|| stats.Bytes != StreamSize)
+	{
+		OnFail();
+	}
+
+	Serial.println();
+	Serial.println(F("Chunk\tDecode MB/s"));
+	Serial.print(F("Whole\t"));
+	Serial.println(GetMegabytesPerSecond(StreamSize, elapsed));
+
+	for (uint8_t i = 0; i < sizeof(Definitions::ChunkSizes) / sizeof(Definitions::ChunkSizes[0]); i++)
+	{
+		const RecordDigest digest = Decode(Definitions::ChunkSizes[i], elapsed);
+
+		Serial.print(Definitions::ChunkSizes[i]);
+		Serial.print('\t');
+		Serial.println(GetMegabytesPerSecond(StreamSize, elapsed));
+
+		if (digest.Hash != reference.Hash
+			|| digest.Count != reference.Count)
+		{
+			OnFail();
+		}
+	}
+
+	// Delimiter scan alone, the decoder's lower bound.
+	using ClockType = std::chrono::steady_clock;
+	const ClockType::time_point start = ClockType::now();
+	uint32_t delimiters = 0;
+	const uint8_t* scan = Stream;
+	const uint8_t* end = Stream + StreamSize;
+	while (scan < end)
+	{
+		const uint8_t* delimiter = (const uint8_t*)memchr(scan, MessageDefinition::Delimiter, (size_t)(end - scan));
+		if (delimiter == nullptr)
+		{
+			break;
+		}
+		delimiters++;
+		scan = delimiter + 1;
+	}
+	elapsed = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(ClockType::now() - start).count();
+
+	Serial.print(F("Scan\t"));
+	Serial.print(GetMegabytesPerSecond(StreamSize, elapsed));
+	Serial.print(F("\tDelimiters "));
+	Serial.println(delimiters);
+
+	Serial.println();
+	Serial.println(F("All tests passed."));
+	Serial.println();
+}
+
+void loop()
+{
+}
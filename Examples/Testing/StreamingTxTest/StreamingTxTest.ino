@@ -0,0 +1,332 @@
+/*
+	Library Streaming TX Testing Project.
+	Sends the same messages with buffered and streaming TX, plain, addressed and with FEC parity,
+	 through a small serial TX FIFO that splits every frame into many writes.
+	The wire bytes must be identical, and every message delivered.
+	Then reports the CPU time from SendMessage() to the first frame byte in the serial, for a large payload.
+	Host only (e.g. EpoxyDuino), the link runs from the VirtualClock through _TASK_EXTERNAL_TIME.
+	UartInterfaceTask depends on TaskScheduler (https://github.com/arkhipenko/TaskScheduler).
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#define _TASK_EXTERNAL_TIME
+#define _TASK_OO_CALLBACKS
+#include <TScheduler.hpp>
+
+#include <UartInterface.h>
+#include <UartInterfaceTask.h>
+#include <UartInterfaceCore.h>
+#include <UartInterfaceSimulation.h>
+
+#include <chrono>
+
+using namespace UartInterface;
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint32_t Baudrate = 1000000;
+	static constexpr uint8_t MaxPayloadSize = 200;
+	static constexpr uint32_t StepNanos = 2000;
+	static constexpr uint16_t Messages = 250;
+	static constexpr uint32_t CostRuns = 100000;
+	static constexpr uint8_t Address = 3;
+
+	template<bool addressed, uint8_t parity, bool streaming>
+	struct UartDefinitions : TemplateUartDefinitions<Baudrate, MaxPayloadSize>
+	{
+		static constexpr bool Addressed = addressed;
+		static constexpr uint8_t FecParitySize = parity;
+		static constexpr bool StreamingTx = streaming;
+	};
+
+	// Much smaller than a frame.
+	using LinkType = Simulation::SimulatedLink<256, 16>;
+
+	static constexpr uint32_t CaptureSize = 256 * 1024;
+}
+
+Simulation::VirtualClock Clock{};
+
+uint32_t external_millis()
+{
+	return Clock.Millis();
+}
+
+uint32_t external_micros()
+{
+	return Clock.Micros();
+}
+
+/// <summary>
+/// Keeps the TX wire bytes.
+/// </summary>
+struct CaptureTap : WireTap
+{
+	uint8_t* Data;
+	uint32_t Size = 0;
+	uint32_t Writes = 0;
+
+	CaptureTap(uint8_t* data)
+		: Data(data)
+	{
+	}
+
+	void OnWireBytes(const WireDirectionEnum direction, const uint32_t timestampMicros, const uint8_t* data, const uint16_t size) final
+	{
+		if (direction == WireDirectionEnum::Tx
+			&& Size + size <= Definitions::CaptureSize)
+		{
+			memcpy(&Data[Size], data, size);
+			Size += size;
+			Writes++;
+		}
+	}
+};
+
+struct CheckListener : UartListener
+{
+	uint32_t Received = 0;
+	uint32_t Errors = 0;
+
+	void OnUartStateChange(const bool connected) final {}
+
+	void OnUartRx(const uint8_t header) final
+	{
+		Received++;
+	}
+
+	void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+	{
+		Received++;
+		if (payloadSize != (header % (Definitions::MaxPayloadSize + 1)))
+		{
+			Errors++;
+		}
+	}
+
+	void OnUartTx() final {}
+	void OnUartRxError(const RxErrorEnum error) final { Errors++; }
+	void OnUartTxError(const TxErrorEnum error) final { Errors++; }
+};
+
+/// <summary>
+/// Null modem stand-in, takes writes in FIFO sized chunks and never receives.
+/// </summary>
+struct SinkSerial
+{
+	uint32_t Written = 0;
+
+	operator bool() { return true; }
+	void begin(const unsigned long baudrate) {}
+	int available() { return 0; }
+	int peek() { return -1; }
+	int read() { return -1; }
+	int availableForWrite() { return 16; }
+	size_t write(const uint8_t value) { Written++; return 1; }
+	size_t write(const uint8_t* buffer, const size_t size) { Written += size; return size; }
+	void flush() {}
+	void clearWriteError() {}
+};
+
+uint8_t Captures[2][Definitions::CaptureSize];
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+/// <summary>
+/// Payloads with runs of delimiters, so COBS blocks have every size.
+/// </summary>
+uint8_t FillPayload(uint8_t* payload, const uint16_t index, uint32_t& random)
+{
+	const uint8_t size = (uint8_t)(index % (Definitions::MaxPayloadSize + 1));
+	for (uint8_t i = 0; i < size; i++)
+	{
+		random = random * 1103515245 + 12345;
+		const uint8_t value = (uint8_t)(random >> 16);
+		payload[i] = ((value % ((index % 7) + 2)) == 0) ? 0 : value;
+	}
+
+	return size;
+}
+
+template<typename UartDefinitions>
+uint32_t Capture(uint8_t* capture)
+{
+	using InterfaceType = UartInterfaceTask<Definitions::LinkType::Endpoint, UartDefinitions>;
+
+	CaptureTap tap(capture);
+	CheckListener listener{};
+
+	Clock.Reset();
+	TS::Scheduler scheduler{};
+	Definitions::LinkType link(Clock, 1000, 1);
+
+	InterfaceType sender(scheduler, link.A, nullptr, Definitions::Key, Definitions::KeySize);
+	InterfaceType receiver(scheduler, link.B, &listener, Definitions::Key, Definitions::KeySize);
+	if (!sender.Setup() || !receiver.Setup())
+	{
+		OnFail();
+	}
+	sender.SetAddress(1);
+	receiver.SetAddress(Definitions::Address);
+	sender.SetWireTap(&tap);
+
+	sender.Start();
+	receiver.Start();
+
+	uint8_t payload[Definitions::MaxPayloadSize]{};
+	uint32_t random = 42;
+	uint16_t sent = 0;
+	while (sent < Definitions::Messages
+		|| Clock.Millis() < 20)
+	{
+		if (sent < Definitions::Messages
+			&& sender.CanSendMessage())
+		{
+			uint32_t next = random;
+			const uint8_t size = FillPayload(payload, sent, next);
+			if (UartDefinitions::Addressed ? sender.SendMessageTo(Definitions::Address, (uint8_t)sent, payload, size)
+				: sender.SendMessage((uint8_t)sent, payload, size))
+			{
+				random = next;
+				sent++;
+			}
+		}
+
+		scheduler.execute();
+		Clock.Advance(Definitions::StepNanos);
+	}
+
+	// Drain.
+	const uint32_t drainStart = Clock.Millis();
+	while (Clock.Millis() - drainStart < 10)
+	{
+		scheduler.execute();
+		Clock.Advance(Definitions::StepNanos);
+	}
+
+	if (listener.Errors > 0
+		|| listener.Received != Definitions::Messages)
+	{
+		OnFail();
+	}
+
+	return tap.Size;
+}
+
+template<bool Addressed, uint8_t Parity>
+void TestWire(const char* name)
+{
+	const uint32_t buffered = Capture<Definitions::UartDefinitions<Addressed, Parity, false>>(Captures[0]);
+	const uint32_t streaming = Capture<Definitions::UartDefinitions<Addressed, Parity, true>>(Captures[1]);
+
+	Serial.print(name);
+	Serial.print(F("\tWire bytes "));
+	Serial.print(buffered);
+	Serial.print('/');
+	Serial.println(streaming);
+
+	if (buffered != streaming
+		|| memcmp(Captures[0], Captures[1], buffered) != 0)
+	{
+		OnFail();
+	}
+}
+
+/// <summary>
+/// CPU time from SendMessage() until the first frame byte is in the serial, and for the whole frame.
+/// </summary>
+template<bool Streaming>
+void BenchmarkFirstByte()
+{
+	using CoreType = UartInterfaceCore<SinkSerial, Definitions::UartDefinitions<false, 0, Streaming>>;
+
+	SinkSerial serial{};
+	CoreType core(serial, nullptr, Definitions::Key, Definitions::KeySize);
+	if (!core.Setup())
+	{
+		OnFail();
+	}
+	core.Start();
+	while (!core.CanSendMessage())
+	{
+		core.Poll(0);
+	}
+
+	uint8_t payload[Definitions::MaxPayloadSize];
+	uint32_t random = 7;
+	FillPayload(payload, Definitions::MaxPayloadSize, random);
+
+	double firstNanos = 0;
+	double frameNanos = 0;
+	for (uint32_t run = 0; run < Definitions::CostRuns; run++)
+	{
+		const uint32_t before = serial.Written;
+		const auto start = std::chrono::steady_clock::now();
+		if (!core.SendMessage((uint8_t)run, payload, sizeof(payload)))
+		{
+			OnFail();
+		}
+
+		// Past the start delimiter.
+		while (serial.Written < before + 2)
+		{
+			core.PollTx(0);
+		}
+		const auto first = std::chrono::steady_clock::now();
+
+		while (core.IsTxPolling())
+		{
+			core.PollTx(0);
+		}
+		const auto end = std::chrono::steady_clock::now();
+
+		firstNanos += std::chrono::duration<double, std::nano>(first - start).count();
+		frameNanos += std::chrono::duration<double, std::nano>(end - start).count();
+	}
+
+	Serial.print(Streaming ? F("Streaming") : F("Buffered"));
+	Serial.print(F("\tPayload "));
+	Serial.print(Definitions::MaxPayloadSize);
+	Serial.print(F("\tFirst byte "));
+	Serial.print(firstNanos / Definitions::CostRuns, 0);
+	Serial.print(F(" ns\tWhole frame "));
+	Serial.print(frameNanos / Definitions::CostRuns, 0);
+	Serial.println(F(" ns"));
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface Streaming TX Test Start"));
+	Serial.println();
+
+	TestWire<false, 0>("Plain\t");
+	TestWire<true, 0>("Addressed");
+	TestWire<false, 8>("FEC\t");
+
+	BenchmarkFirstByte<false>();
+	BenchmarkFirstByte<true>();
+
+	Serial.println();
+	Serial.println(F("All tests passed."));
+	Serial.println();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,350 @@
+/*
+	Library MPSC Submission Queue Benchmark.
+	1 to 16 producer threads send messages to a single port, whose thread runs the UartInterfaceCore.
+	Through the lock-free MpscSubmissionQueue, each producer encoding in its own slot,
+	 against SendMessage() behind a mutex shared with the port thread.
+	The port's serial is a memory sink, so the figures are the submission and protocol CPU cost.
+	Every frame on the wire is then decoded: all must be valid, and each producer's in its send order.
+	Linux host only (e.g. EpoxyDuino), link with -pthread.
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#include <UartInterface.h>
+#include <UartInterfaceCore.h>
+#include <UartInterfaceRuntime.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+using namespace UartInterface;
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint8_t PayloadSize = 16;
+	static constexpr uint32_t Messages = 200000;
+	static constexpr uint8_t ProducerCounts[]{ 1, 2, 4, 8, 16 };
+	static constexpr uint8_t ProducersMax = 16;
+
+	static constexpr uint32_t CaptureSize = Messages * (MessageDefinition::GetBufferSizeFromPayload(PayloadSize) + 2);
+
+	using UartDefinitions = TemplateUartDefinitions<1000000, PayloadSize>;
+	using QueueType = Runtime::MpscSubmissionQueue<UartDefinitions, 64>;
+}
+
+uint8_t Capture[Definitions::CaptureSize];
+
+/// <summary>
+/// Keeps every byte written, owned by the port thread.
+/// </summary>
+class SinkSerial
+{
+public:
+	uint32_t Size = 0;
+
+public:
+	operator bool() { return true; }
+
+	void begin(const unsigned long baudrate) {}
+	void end() {}
+	void clearWriteError() {}
+
+	int available() { return 0; }
+	int peek() { return -1; }
+	int read() { return -1; }
+	int availableForWrite() { return 1024; }
+
+	size_t write(const uint8_t value)
+	{
+		return write(&value, 1);
+	}
+
+	size_t write(const uint8_t* buffer, const size_t size)
+	{
+		if (Size + size <= Definitions::CaptureSize)
+		{
+			memcpy(&Capture[Size], buffer, size);
+			Size += size;
+		}
+
+		return size;
+	}
+};
+
+using CoreType = UartInterfaceCore<SinkSerial, Definitions::UartDefinitions>;
+
+struct BenchmarkResult
+{
+	uint32_t ElapsedMicros = 0;
+	uint32_t Rejected = 0;
+};
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+/// <summary>
+/// Producer index and its message count, in the payload.
+/// </summary>
+void FillPayload(uint8_t* payload, const uint8_t producer, const uint32_t index)
+{
+	payload[0] = producer;
+	memcpy(&payload[1], &index, sizeof(index));
+	for (uint8_t i = 1 + sizeof(index); i < Definitions::PayloadSize; i++)
+	{
+		payload[i] = (uint8_t)(index + i);
+	}
+}
+
+void StartCore(CoreType& core)
+{
+	if (!core.Setup())
+	{
+		OnFail();
+	}
+	core.Start();
+	while (!core.CanSendMessage())
+	{
+		core.Poll(0);
+	}
+}
+
+BenchmarkResult RunQueue(SinkSerial& serial, const uint8_t producerCount)
+{
+	using ClockType = std::chrono::steady_clock;
+
+	CoreType core(serial, nullptr, Definitions::Key, Definitions::KeySize);
+	StartCore(core);
+
+	Definitions::QueueType queue{};
+
+	std::atomic<uint8_t> done{ 0 };
+	std::thread producers[Definitions::ProducersMax];
+
+	const ClockType::time_point start = ClockType::now();
+	for (uint8_t p = 0; p < producerCount; p++)
+	{
+		producers[p] = std::thread([&queue, &done, p, producerCount]()
+			{
+				Definitions::QueueType::Producer producer(queue, Definitions::Key, Definitions::KeySize);
+				producer.Setup();
+
+				uint8_t payload[Definitions::PayloadSize];
+				const uint32_t count = Definitions::Messages / producerCount;
+				for (uint32_t i = 0; i < count; i++)
+				{
+					FillPayload(payload, p, i);
+					while (!producer.SendMessage((uint8_t)i, payload, sizeof(payload)))
+					{
+						std::this_thread::yield();
+					}
+				}
+				done++;
+			});
+	}
+
+	// Port thread.
+	while (done.load() < producerCount
+		|| queue.IsPending())
+	{
+		if (!queue.Pump(core)
+			&& !core.IsTxPolling())
+		{
+			std::this_thread::yield();
+		}
+		core.PollTx(0);
+	}
+
+	BenchmarkResult result{};
+	result.ElapsedMicros = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(ClockType::now() - start).count();
+	result.Rejected = queue.GetRejectedCount();
+
+	for (uint8_t p = 0; p < producerCount; p++)
+	{
+		producers[p].join();
+	}
+
+	return result;
+}
+
+BenchmarkResult RunMutex(SinkSerial& serial, const uint8_t producerCount)
+{
+	using ClockType = std::chrono::steady_clock;
+
+	CoreType core(serial, nullptr, Definitions::Key, Definitions::KeySize);
+	StartCore(core);
+
+	std::mutex portMutex;
+	std::atomic<uint8_t> done{ 0 };
+	std::thread producers[Definitions::ProducersMax];
+
+	const ClockType::time_point start = ClockType::now();
+	for (uint8_t p = 0; p < producerCount; p++)
+	{
+		producers[p] = std::thread([&core, &portMutex, &done, p, producerCount]()
+			{
+				uint8_t payload[Definitions::PayloadSize];
+				const uint32_t count = Definitions::Messages / producerCount;
+				for (uint32_t i = 0; i < count; i++)
+				{
+					FillPayload(payload, p, i);
+					while (true)
+					{
+						{
+							std::lock_guard<std::mutex> lock(portMutex);
+							if (core.SendMessage((uint8_t)i, payload, sizeof(payload)))
+							{
+								break;
+							}
+						}
+						std::this_thread::yield();
+					}
+				}
+				done++;
+			});
+	}
+
+	// Port thread.
+	while (true)
+	{
+		{
+			std::lock_guard<std::mutex> lock(portMutex);
+			if (core.IsTxPolling())
+			{
+				core.PollTx(0);
+				continue;
+			}
+			else if (done.load() == producerCount)
+			{
+				break;
+			}
+		}
+		std::this_thread::yield();
+	}
+
+	BenchmarkResult result{};
+	result.ElapsedMicros = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(ClockType::now() - start).count();
+
+	for (uint8_t p = 0; p < producerCount; p++)
+	{
+		producers[p].join();
+	}
+
+	return result;
+}
+
+/// <summary>
+/// Every frame valid, and each producer's messages in order.
+/// </summary>
+bool CheckCapture(const uint32_t size, const uint8_t producerCount)
+{
+	uint32_t next[Definitions::ProducersMax]{};
+	uint32_t frames = 0;
+	bool valid = true;
+
+	MessageStreamDecoder<Definitions::PayloadSize> decoder(Definitions::Key, Definitions::KeySize);
+	if (!decoder.Setup())
+	{
+		return false;
+	}
+
+	auto check = [&](const StreamRecord& record)
+		{
+			if (record.Status != StreamStatusEnum::Valid
+				|| record.PayloadSize != Definitions::PayloadSize)
+			{
+				valid = false;
+
+				return;
+			}
+
+			uint32_t index;
+			memcpy(&index, &record.Payload[1], sizeof(index));
+			if (record.Payload[0] >= producerCount
+				|| index != next[record.Payload[0]]
+				|| record.Header != (uint8_t)index)
+			{
+				valid = false;
+
+				return;
+			}
+			next[record.Payload[0]]++;
+			frames++;
+		};
+	decoder.Feed(Capture, size, check);
+	decoder.Finish(check);
+
+	return valid
+		&& frames == (Definitions::Messages / producerCount) * producerCount;
+}
+
+void Report(const char* name, const BenchmarkResult& result, const uint8_t producerCount)
+{
+	const uint32_t messages = (Definitions::Messages / producerCount) * producerCount;
+
+	Serial.print(producerCount);
+	Serial.print('\t');
+	Serial.print(name);
+	Serial.print('\t');
+	Serial.print((uint32_t)(((uint64_t)messages * 1000000) / (result.ElapsedMicros > 0 ? result.ElapsedMicros : 1)));
+	Serial.print('\t');
+	Serial.println(result.Rejected);
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface MPSC Submission Queue Benchmark"));
+	Serial.print(F("Messages "));
+	Serial.print(Definitions::Messages);
+	Serial.print(F("\tPayload "));
+	Serial.print(Definitions::PayloadSize);
+	Serial.print(F("\tCores "));
+	Serial.println(std::thread::hardware_concurrency());
+	Serial.println();
+
+	Serial.println(F("Producers\tMode\tMessages/s\tQueue full"));
+	for (uint8_t i = 0; i < sizeof(Definitions::ProducerCounts); i++)
+	{
+		const uint8_t producerCount = Definitions::ProducerCounts[i];
+
+		SinkSerial queueSerial{};
+		const BenchmarkResult queued = RunQueue(queueSerial, producerCount);
+		if (!CheckCapture(queueSerial.Size, producerCount))
+		{
+			OnFail();
+		}
+
+		SinkSerial mutexSerial{};
+		const BenchmarkResult locked = RunMutex(mutexSerial, producerCount);
+		if (!CheckCapture(mutexSerial.Size, producerCount))
+		{
+			OnFail();
+		}
+
+		Report("MPSC queue", queued, producerCount);
+		Report("Mutex\t", locked, producerCount);
+	}
+
+	Serial.println();
+	Serial.println(F("Benchmark complete."));
+	Serial.println();
+}
+
+void loop()
+{
+}
@@ -40,6 +40,8 @@ public:
 		{
 			TestPayloadSize = 0;
 		}
+
+		return true;
 	}
 
 private:
@@ -14,7 +14,7 @@ namespace VirtualUart
 	struct ISerial
 	{
 		virtual void ReceiveBytes(const uint8_t* data, size_t size) {}
-		virtual size_t AvailableReceive() {}
+		virtual size_t AvailableReceive() { return 0; }
 	};
 
 	/// <summary>
@@ -100,10 +100,8 @@ namespace VirtualUart
 					return Receiver->AvailableReceive();
 				}
 			}
-			else
-			{
-				return 0;
-			}
+
+			return 0;
 		}
 
 		void clearWriteError()
@@ -183,6 +181,7 @@ namespace VirtualUart
 			{
 				PrintName();
 				Serial.println(F("Rejected, disabled."));
+				return 0;
 			}
 		}
 
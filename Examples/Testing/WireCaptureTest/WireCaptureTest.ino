@@ -0,0 +1,353 @@
+/*
+	Library Wire Capture Testing Project.
+	Captures both ends of a noisy simulated link, to a file on one end and a ring on the other,
+	 then replays the file through WireReplay and checks that the decode matches the live one exactly.
+	Also reports the replay decode throughput, and checks the original timing pace.
+	Linux host only (e.g. EpoxyDuino), the whole stack runs from the VirtualClock through _TASK_EXTERNAL_TIME.
+	UartInterfaceTask depends on TaskScheduler (https://github.com/arkhipenko/TaskScheduler).
+*/
+
+#define SERIAL_BAUD_RATE 115200
+
+#define _TASK_EXTERNAL_TIME
+#define _TASK_OO_CALLBACKS
+#include <TScheduler.hpp>
+
+#include <UartInterface.h>
+#include <UartInterfaceTask.h>
+#include <UartInterfaceSimulation.h>
+#include <UartInterfaceCapture.h>
+
+using namespace UartInterface;
+using namespace UartInterface::Capture;
+
+namespace Definitions
+{
+	static constexpr uint8_t Key[]{ 1, 2, 3, 4, 5, 6, 7, 8 };
+	static constexpr uint8_t KeySize = sizeof(Key);
+
+	static constexpr uint32_t StepNanos = 2000;
+	static constexpr uint32_t DurationMillis = 1000;
+	static constexpr uint32_t DrainMillis = 100;
+	static constexpr uint8_t ThroughputRuns = 20;
+
+	static constexpr const char* CapturePath = "wire_capture.bin";
+	static constexpr uint32_t CaptureSizeMax = 512 * 1024;
+	static constexpr uint16_t RingSize = 2048;
+
+	using UartDefinitions = TemplateUartDefinitions<1000000>;
+	using LinkType = Simulation::SimulatedLink<64, 64>;
+	using UartInterfaceTaskType = UartInterfaceTask<LinkType::Endpoint, UartDefinitions>;
+}
+
+Simulation::VirtualClock Clock{};
+
+uint32_t external_millis()
+{
+	return Clock.Millis();
+}
+
+uint32_t external_micros()
+{
+	return Clock.Micros();
+}
+
+/// <summary>
+/// Counts deliveries and errors, as ReplayResult does.
+/// </summary>
+struct CountListener : UartListener
+{
+	ReplayResult Result{};
+
+	void OnUartStateChange(const bool connected) final {}
+
+	void OnUartRx(const uint8_t header) final
+	{
+		Result.Messages++;
+	}
+
+	void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+	{
+		Result.Messages++;
+	}
+
+	void OnUartTx() final {}
+
+	void OnUartRxError(const RxErrorEnum error) final
+	{
+		switch (error)
+		{
+		case RxErrorEnum::Crc:
+			Result.CrcErrors++;
+			break;
+		case RxErrorEnum::TooShort:
+			Result.TooShortErrors++;
+			break;
+		case RxErrorEnum::TooLong:
+			Result.TooLongErrors++;
+			break;
+		default:
+			break;
+		}
+	}
+
+	void OnUartTxError(const TxErrorEnum error) final {}
+};
+
+/// <summary>
+/// Export() target for the ring.
+/// </summary>
+struct MemoryStream
+{
+	uint8_t Buffer[Definitions::RingSize + WireCaptureFormat::HeaderSize]{};
+	uint32_t Size = 0;
+
+	size_t write(const uint8_t* data, const size_t size)
+	{
+		memcpy(&Buffer[Size], data, size);
+		Size += size;
+
+		return size;
+	}
+};
+
+TS::Scheduler SchedulerBase{};
+Definitions::LinkType Link(Clock, 1000, 3);
+CountListener LiveListener{};
+Definitions::UartInterfaceTaskType InterfaceA(SchedulerBase, Link.A, nullptr, Definitions::Key, Definitions::KeySize);
+Definitions::UartInterfaceTaskType InterfaceB(SchedulerBase, Link.B, &LiveListener, Definitions::Key, Definitions::KeySize);
+
+WireCaptureFile CaptureB{};
+WireCaptureRing<Definitions::RingSize> CaptureA{};
+MemoryStream RingExport{};
+WireReplay<Definitions::UartDefinitions> Replay(Definitions::Key, Definitions::KeySize);
+
+uint8_t CaptureBuffer[Definitions::CaptureSizeMax]{};
+uint32_t CaptureSize = 0;
+uint32_t SentB = 0;
+
+void OnFail()
+{
+	Serial.println();
+	Serial.println(F("Test Failed!"));
+	Serial.println();
+
+	while (true);;
+}
+
+bool SameDecode(const ReplayResult& a, const ReplayResult& b)
+{
+	return a.Messages == b.Messages
+		&& a.CrcErrors == b.CrcErrors
+		&& a.TooShortErrors == b.TooShortErrors
+		&& a.TooLongErrors == b.TooLongErrors;
+}
+
+void PrintResult(const ReplayResult& result)
+{
+	Serial.print(F("Messages "));
+	Serial.print(result.Messages);
+	Serial.print(F("\tCrc "));
+	Serial.print(result.CrcErrors);
+	Serial.print(F("\tTooShort "));
+	Serial.print(result.TooShortErrors);
+	Serial.print(F("\tTooLong "));
+	Serial.print(result.TooLongErrors);
+	Serial.print(F("\tRecords "));
+	Serial.print(result.Records);
+	Serial.print(F("\tBytes "));
+	Serial.print(result.Bytes);
+	Serial.print(F("\tElapsed "));
+	Serial.print(result.ElapsedMicros);
+	Serial.println(F(" us"));
+}
+
+/// <summary>
+/// Both ends send frames of varying size over a noisy link, each captured by its own tap.
+/// </summary>
+void RunLive()
+{
+	Simulation::FaultConfig faults{};
+	faults.BitFlipPpm = 100;
+	faults.DropPpm = 200;
+	Link.SetFaults(faults);
+
+	InterfaceA.SetWireTap(&CaptureA);
+	InterfaceB.SetWireTap(&CaptureB);
+	InterfaceA.Start();
+	InterfaceB.Start();
+
+	uint8_t payload[Definitions::UartDefinitions::MaxPayloadSize]{};
+	uint32_t sentA = 0;
+	while (Clock.Millis() < (Definitions::DurationMillis + Definitions::DrainMillis))
+	{
+		if (Clock.Millis() < Definitions::DurationMillis)
+		{
+			const uint8_t payloadSize = 1 + (sentA % (sizeof(payload) - 1));
+			for (uint8_t i = 0; i < payloadSize; i++)
+			{
+				payload[i] = (uint8_t)(sentA + i);
+			}
+
+			if (InterfaceA.SendMessage((uint8_t)sentA, payload, payloadSize))
+			{
+				sentA++;
+			}
+
+			if ((Clock.Millis() % 10) == 0
+				&& InterfaceB.SendMessage((uint8_t)SentB))
+			{
+				SentB++;
+			}
+		}
+
+		SchedulerBase.execute();
+		Clock.Advance(Definitions::StepNanos);
+	}
+
+	InterfaceA.Stop();
+	InterfaceB.Stop();
+	InterfaceA.SetWireTap(nullptr);
+	InterfaceB.SetWireTap(nullptr);
+	CaptureB.Close();
+
+	Serial.print(F("Live\t\t"));
+	PrintResult(LiveListener.Result);
+}
+
+bool LoadCapture()
+{
+	FILE* file = fopen(Definitions::CapturePath, "rb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	CaptureSize = fread(CaptureBuffer, 1, sizeof(CaptureBuffer), file);
+	const bool complete = feof(file) || fgetc(file) == EOF;
+	fclose(file);
+	remove(Definitions::CapturePath);
+
+	return complete && CaptureSize > WireCaptureFormat::HeaderSize;
+}
+
+/// <summary>
+/// The ring keeps the most recent records, exported as a complete capture with monotonic timestamps.
+/// </summary>
+bool CheckRing()
+{
+	CaptureA.Export(RingExport);
+
+	WireCaptureReader reader(RingExport.Buffer, RingExport.Size);
+	WireCaptureRecord record;
+	uint32_t records = 0;
+	uint32_t last = reader.GetStartMicros();
+	bool monotonic = true;
+	while (reader.Next(record))
+	{
+		monotonic &= (int32_t)(record.TimestampMicros - last) >= 0;
+		last = record.TimestampMicros;
+		records++;
+	}
+
+	Serial.print(F("Ring\t\tRecords "));
+	Serial.print(records);
+	Serial.print(F("\tDropped "));
+	Serial.print(CaptureA.GetDroppedRecords());
+	Serial.print(F("\tLast "));
+	Serial.print(last);
+	Serial.println(F(" us"));
+
+	return reader.IsComplete()
+		&& monotonic
+		&& records > 0
+		&& CaptureA.GetDroppedRecords() > 0
+		&& RingExport.Size > (Definitions::RingSize - (WireCaptureFormat::PrefixSizeMax + WireCaptureFormat::RecordDataMax))
+		&& last <= Clock.Micros()
+		&& last >= ((Definitions::DurationMillis - 10) * 1000);
+}
+
+void setup()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	while (!Serial)
+		;
+
+	Serial.println();
+	Serial.println(F("Uart Interface Wire Capture Test Start"));
+	Serial.println();
+
+	if (!InterfaceA.Setup()
+		|| !InterfaceB.Setup()
+		|| !Replay.Setup()
+		|| !CaptureB.Open(Definitions::CapturePath))
+	{
+		Serial.println(F("Setup Failed!"));
+		OnFail();
+	}
+
+	RunLive();
+
+	if (!LoadCapture())
+	{
+		Serial.println(F("Capture load failed."));
+		OnFail();
+	}
+
+	// What B received, decoded again from the capture.
+	const ReplayResult replayRx = Replay.Run(CaptureBuffer, CaptureSize);
+	Serial.print(F("Replay RX\t"));
+	PrintResult(replayRx);
+	if (!replayRx.Complete
+		|| !SameDecode(replayRx, LiveListener.Result)
+		|| LiveListener.Result.CrcErrors == 0)
+	{
+		OnFail();
+	}
+
+	// What B sent, before the faults on the wire.
+	const ReplayResult replayTx = Replay.Run(CaptureBuffer, CaptureSize, ReplayModeEnum::AsFastAsPossible, WireDirectionEnum::Tx);
+	Serial.print(F("Replay TX\t"));
+	PrintResult(replayTx);
+	if (replayTx.Messages != SentB
+		|| replayTx.CrcErrors > 0)
+	{
+		OnFail();
+	}
+
+	if (!CheckRing())
+	{
+		OnFail();
+	}
+
+	// Decode throughput.
+	uint64_t bytes = 0;
+	uint64_t elapsed = 0;
+	for (uint8_t i = 0; i < Definitions::ThroughputRuns; i++)
+	{
+		const ReplayResult result = Replay.Run(CaptureBuffer, CaptureSize);
+		bytes += result.Bytes;
+		elapsed += result.ElapsedMicros;
+	}
+	Serial.print(F("Throughput\t"));
+	Serial.print((uint32_t)(bytes / (elapsed > 0 ? elapsed : 1)));
+	Serial.println(F(" MB/s"));
+
+	// Original timing takes the captured time, with the same decode.
+	const ReplayResult paced = Replay.Run(CaptureBuffer, CaptureSize, ReplayModeEnum::OriginalTiming);
+	Serial.print(F("Paced\t\t"));
+	PrintResult(paced);
+	if (!SameDecode(paced, replayRx)
+		|| paced.ElapsedMicros < paced.CaptureMicros)
+	{
+		OnFail();
+	}
+
+	Serial.println();
+	Serial.println(F("All tests passed."));
+	Serial.println();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,701 @@
+#ifndef _UART_INTERFACE_FRAME_BRIDGE_h
+#define _UART_INTERFACE_FRAME_BRIDGE_h
+
+#define _TASK_OO_CALLBACKS
+#include <TSchedulerDeclarations.hpp>
+
+#include "../Task/UartInterfaceTask.h"
+
+namespace UartInterface
+{
+	/// <summary>
+	/// Frame forwarding between two interfaces, e.g. a gateway's host and device UARTs.
+	/// </summary>
+	namespace Bridge
+	{
+		enum class SideEnum : uint8_t
+		{
+			A,
+			B
+		};
+
+		/// <summary>
+		/// What happens to a frame received on a side, by header.
+		/// Forward sends it out of the other side, Local delivers it to this side's listener.
+		/// </summary>
+		enum class RouteEnum : uint8_t
+		{
+			Drop = 0,
+			Forward = 1,
+			Local = 2,
+			ForwardAndLocal = Forward | Local
+		};
+
+		/// <summary>
+		/// Forwarding storage and mode.
+		/// </summary>
+		/// <typeparam name="cutThrough">Starts forwarding as soon as the header is in, before the frame is validated.</typeparam>
+		/// <typeparam name="forwardBuffers">Encoded frames per direction, in flight or waiting for the other side.</typeparam>
+		template<bool cutThrough = true,
+			uint8_t forwardBuffers = 2>
+		struct TemplateBridgeDefinitions
+		{
+			static constexpr bool CutThrough = cutThrough;
+			static constexpr uint8_t ForwardBuffers = forwardBuffers;
+		};
+
+		struct BridgeStats
+		{
+			/// <summary>
+			/// Valid frames sent on, cut-through included.
+			/// </summary>
+			uint32_t Forwarded = 0;
+
+			/// <summary>
+			/// Valid frames that went out while still arriving.
+			/// </summary>
+			uint32_t CutThrough = 0;
+
+			/// <summary>
+			/// Cut-through frames that failed validation (or were cut short) after they started going out.
+			/// Their forwarded copy is ended so that it can't pass validation either.
+			/// </summary>
+			uint32_t Aborted = 0;
+
+			/// <summary>
+			/// Frames not forwarded, for lack of a free buffer.
+			/// </summary>
+			uint32_t Overruns = 0;
+		};
+
+		/// <summary>
+		/// Two UartInterfaceTasks with the same key and definitions, forwarding each other's frames as they were received.
+		/// The receiving side still decodes and checks each frame, but the forwarded copy is neither copied out,
+		///  re-encoded, nor re-hashed: its encoded bytes go straight out of the other side.
+		/// With BridgeDefinitions::CutThrough, a frame starts going out as soon as its header is in and the other side is free,
+		///  and its end delimiter follows the validation. A frame that fails it is ended so that it fails at the far end too.
+		/// Otherwise, or while the other side is busy, frames are stored and forwarded once valid, in order.
+		/// Routes are set per side and header with SetRoute(), by default every frame is forwarded, and none delivered locally.
+		/// </summary>
+		template<typename SerialTypeA,
+			typename SerialTypeB,
+			typename UartDefinitions,
+			typename BridgeDefinitions = TemplateBridgeDefinitions<>>
+		class FrameBridge : public TS::Task
+		{
+		private:
+			using MessageDefinition = UartInterface::MessageDefinition;
+
+			static_assert(!UartDefinitions::Addressed, "Bridged frames are not addressed.");
+			static_assert(BridgeDefinitions::ForwardBuffers >= 1 && BridgeDefinitions::ForwardBuffers < UINT8_MAX, "At least one forward buffer.");
+
+			/// <summary>
+			/// Encoded frame, and an extra byte to poison an aborted one.
+			/// </summary>
+			static constexpr uint8_t FrameSize = MessageDefinition::GetBufferSizeFromPayload(UartDefinitions::MaxPayloadSize) + UartDefinitions::FecParitySize + 1;
+
+			static constexpr uint8_t HeaderIndex = (uint8_t)MessageDefinition::FieldIndexEnum::Header;
+
+			static constexpr uint8_t BufferNone = UINT8_MAX;
+
+			enum class BufferStateEnum : uint8_t
+			{
+				Free,
+				Filling,
+				Queued,
+				Sending
+			};
+
+			/// <summary>
+			/// One direction, from the frames received on a side.
+			/// </summary>
+			struct Flow
+			{
+				uint8_t Frames[BridgeDefinitions::ForwardBuffers][FrameSize];
+				uint8_t Sizes[BridgeDefinitions::ForwardBuffers];
+				BufferStateEnum States[BridgeDefinitions::ForwardBuffers];
+
+				/// <summary>
+				/// Valid frames waiting for the other side, oldest first.
+				/// </summary>
+				uint8_t Queue[BridgeDefinitions::ForwardBuffers];
+				uint8_t QueueCount;
+
+				uint8_t Filling;
+				uint8_t Sending;
+
+				BridgeStats Stats;
+
+				/// <summary>
+				/// COBS position of the frame being received: current block code, and bytes left in the block.
+				/// Decoded counts the message bytes, until the header.
+				/// </summary>
+				uint8_t Code;
+				uint8_t BlockLeft;
+				uint8_t Decoded;
+				uint8_t Header;
+
+				bool InFrame;
+				bool HeaderKnown;
+				bool Decided;
+				bool Through;
+			};
+
+			/// <summary>
+			/// A side's listener and frame sink, back to the bridge.
+			/// </summary>
+			class Port : public UartListener, public FrameSink
+			{
+			private:
+				FrameBridge& Owner;
+				const SideEnum Side;
+
+			public:
+				UartListener* Listener;
+
+			public:
+				Port(FrameBridge& owner, const SideEnum side, UartListener* listener)
+					: Owner(owner)
+					, Side(side)
+					, Listener(listener)
+				{
+				}
+
+				void OnFrameBytes(const uint8_t* data, const uint8_t size) final
+				{
+					Owner.OnFrameBytes(Side, data, size);
+				}
+
+				void OnFrameEnd(const bool valid) final
+				{
+					Owner.OnFrameEnd(Side, valid);
+				}
+
+				void OnUartStateChange(const bool connected) final
+				{
+					if (!connected)
+					{
+						Owner.OnDisconnected(Side);
+					}
+
+					if (Listener != nullptr)
+					{
+						Listener->OnUartStateChange(connected);
+					}
+				}
+
+				void OnUartRx(const uint8_t header) final
+				{
+					if (Listener != nullptr
+						&& Owner.IsLocal(Side, header))
+					{
+						Listener->OnUartRx(header);
+					}
+				}
+
+				void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+				{
+					if (Listener != nullptr
+						&& Owner.IsLocal(Side, header))
+					{
+						Listener->OnUartRx(header, payload, payloadSize);
+					}
+				}
+
+				void OnUartTx() final
+				{
+					if (!Owner.OnTargetTx(Side, true)
+						&& Listener != nullptr)
+					{
+						Listener->OnUartTx();
+					}
+				}
+
+				void OnUartRxError(const RxErrorEnum error) final
+				{
+					if (Listener != nullptr)
+					{
+						Listener->OnUartRxError(error);
+					}
+				}
+
+				void OnUartTxError(const TxErrorEnum error) final
+				{
+					if (!Owner.OnTargetTx(Side, false)
+						&& Listener != nullptr)
+					{
+						Listener->OnUartTxError(error);
+					}
+				}
+			};
+
+		private:
+			Port PortA;
+			Port PortB;
+
+			UartInterfaceTask<SerialTypeA, UartDefinitions> InterfaceA;
+			UartInterfaceTask<SerialTypeB, UartDefinitions> InterfaceB;
+
+		private:
+			/// <summary>
+			/// Indexed by the receiving side.
+			/// </summary>
+			Flow Flows[2]{};
+
+			uint8_t ForwardMask[2][32]{};
+			uint8_t LocalMask[2][32]{};
+
+		public:
+			FrameBridge(TS::Scheduler& scheduler,
+				SerialTypeA& serialA, UartListener* listenerA,
+				SerialTypeB& serialB, UartListener* listenerB,
+				const uint8_t* key,
+				const uint8_t keySize)
+				: TS::Task(UartDefinitions::PollPeriodMillis, TASK_FOREVER, &scheduler, false)
+				, PortA(*this, SideEnum::A, listenerA)
+				, PortB(*this, SideEnum::B, listenerB)
+				, InterfaceA(scheduler, serialA, &PortA, key, keySize)
+				, InterfaceB(scheduler, serialB, &PortB, key, keySize)
+			{
+				memset(ForwardMask, UINT8_MAX, sizeof(ForwardMask));
+			}
+
+			bool Setup()
+			{
+				InterfaceA.SetFrameSink(&PortA);
+				InterfaceB.SetFrameSink(&PortB);
+
+				return InterfaceA.Setup() && InterfaceB.Setup();
+			}
+
+			void Start()
+			{
+				Reset(Flows[0]);
+				Reset(Flows[1]);
+				InterfaceA.Start();
+				InterfaceB.Start();
+			}
+
+			void Stop()
+			{
+				InterfaceA.Stop();
+				InterfaceB.Stop();
+				Reset(Flows[0]);
+				Reset(Flows[1]);
+				TS::Task::disable();
+			}
+
+			/// <summary>
+			/// Side A, e.g. for local sends. Its listener must stay the bridge's.
+			/// </summary>
+			UartInterfaceTask<SerialTypeA, UartDefinitions>& GetInterfaceA()
+			{
+				return InterfaceA;
+			}
+
+			UartInterfaceTask<SerialTypeB, UartDefinitions>& GetInterfaceB()
+			{
+				return InterfaceB;
+			}
+
+			/// <summary>
+			/// Route for frames received on a side, with this header.
+			/// </summary>
+			void SetRoute(const SideEnum side, const uint8_t header, const RouteEnum route)
+			{
+				SetMask(ForwardMask[(uint8_t)side], header, ((uint8_t)route & (uint8_t)RouteEnum::Forward) != 0);
+				SetMask(LocalMask[(uint8_t)side], header, ((uint8_t)route & (uint8_t)RouteEnum::Local) != 0);
+			}
+
+			/// <summary>
+			/// Route for frames received on a side, for headers first to last, inclusive.
+			/// </summary>
+			void SetRoute(const SideEnum side, const uint8_t first, const uint8_t last, const RouteEnum route)
+			{
+				for (uint16_t header = first; header <= last; header++)
+				{
+					SetRoute(side, (uint8_t)header, route);
+				}
+			}
+
+			RouteEnum GetRoute(const SideEnum side, const uint8_t header) const
+			{
+				return (RouteEnum)((IsForwarded(side, header) ? (uint8_t)RouteEnum::Forward : 0)
+					| (IsLocal(side, header) ? (uint8_t)RouteEnum::Local : 0));
+			}
+
+			/// <summary>
+			/// Forwarding of the frames received on a side, since Start().
+			/// </summary>
+			const BridgeStats& GetStats(const SideEnum side) const
+			{
+				return Flows[(uint8_t)side].Stats;
+			}
+
+		public:
+			/// <summary>
+			/// Retries queued frames while the other side has no room, a sent frame wakes the next one.
+			/// </summary>
+			bool Callback() final
+			{
+				SendQueued(SideEnum::A);
+				SendQueued(SideEnum::B);
+
+				if (Flows[0].QueueCount == 0
+					&& Flows[1].QueueCount == 0)
+				{
+					TS::Task::disable();
+				}
+
+				return true;
+			}
+
+		private:
+			static void SetMask(uint8_t* mask, const uint8_t header, const bool set)
+			{
+				if (set)
+				{
+					mask[header >> 3] |= (uint8_t)(1 << (header & 7));
+				}
+				else
+				{
+					mask[header >> 3] &= (uint8_t)~(1 << (header & 7));
+				}
+			}
+
+			bool IsForwarded(const SideEnum side, const uint8_t header) const
+			{
+				return (ForwardMask[(uint8_t)side][header >> 3] >> (header & 7)) & 1;
+			}
+
+			bool IsLocal(const SideEnum side, const uint8_t header) const
+			{
+				return (LocalMask[(uint8_t)side][header >> 3] >> (header & 7)) & 1;
+			}
+
+			static void Reset(Flow& flow)
+			{
+				for (uint8_t i = 0; i < BridgeDefinitions::ForwardBuffers; i++)
+				{
+					flow.States[i] = BufferStateEnum::Free;
+				}
+				flow.QueueCount = 0;
+				flow.Filling = BufferNone;
+				flow.Sending = BufferNone;
+				flow.Stats = BridgeStats{};
+				flow.InFrame = false;
+				flow.Through = false;
+			}
+
+			void OnFrameBytes(const SideEnum side, const uint8_t* data, const uint8_t size)
+			{
+				Flow& flow = Flows[(uint8_t)side];
+
+				if (!flow.InFrame)
+				{
+					BeginFrame(flow);
+				}
+
+				if (flow.Filling == BufferNone)
+				{
+					return;
+				}
+
+				uint8_t& frameSize = flow.Sizes[flow.Filling];
+				if (size >= FrameSize - frameSize)
+				{
+					// Left for the RX core to end as too long.
+					return;
+				}
+
+				uint8_t* frame = flow.Frames[flow.Filling];
+				memcpy(&frame[frameSize], data, size);
+				frameSize += size;
+				Scan(flow, data, size);
+
+				if (flow.Through)
+				{
+					ExtendThrough(side, frameSize);
+				}
+				else if (!flow.Decided
+					&& flow.HeaderKnown)
+				{
+					flow.Decided = true;
+					if (!IsForwarded(side, flow.Header))
+					{
+						Drop(flow);
+					}
+					else if (BridgeDefinitions::CutThrough
+						&& flow.Sending == BufferNone
+						&& flow.QueueCount == 0
+						&& SendThrough(side, frame, frameSize, true))
+					{
+						flow.Through = true;
+						flow.Sending = flow.Filling;
+					}
+				}
+			}
+
+			void OnFrameEnd(const SideEnum side, const bool valid)
+			{
+				Flow& flow = Flows[(uint8_t)side];
+
+				if (!flow.InFrame)
+				{
+					return;
+				}
+				flow.InFrame = false;
+
+				const uint8_t index = flow.Filling;
+				if (index == BufferNone)
+				{
+					return;
+				}
+				flow.Filling = BufferNone;
+
+				if (flow.Through)
+				{
+					flow.Through = false;
+					if (valid)
+					{
+						flow.Stats.Forwarded++;
+						flow.Stats.CutThrough++;
+					}
+					else
+					{
+						Poison(flow, index);
+						flow.Stats.Aborted++;
+					}
+					CloseThrough(side, flow.Sizes[index]);
+				}
+				else if (valid
+					&& IsForwarded(side, flow.Header))
+				{
+					flow.States[index] = BufferStateEnum::Queued;
+					flow.Queue[flow.QueueCount++] = index;
+					flow.Stats.Forwarded++;
+					SendQueued(side);
+				}
+				else
+				{
+					flow.States[index] = BufferStateEnum::Free;
+				}
+			}
+
+			void BeginFrame(Flow& flow)
+			{
+				flow.InFrame = true;
+				flow.Code = 0;
+				flow.BlockLeft = 0;
+				flow.Decoded = 0;
+				flow.HeaderKnown = false;
+				flow.Decided = false;
+				flow.Through = false;
+				flow.Filling = BufferNone;
+
+				for (uint8_t i = 0; i < BridgeDefinitions::ForwardBuffers; i++)
+				{
+					if (flow.States[i] == BufferStateEnum::Free)
+					{
+						flow.States[i] = BufferStateEnum::Filling;
+						flow.Sizes[i] = 0;
+						flow.Filling = i;
+
+						return;
+					}
+				}
+
+				flow.Stats.Overruns++;
+			}
+
+			/// <summary>
+			/// Stops keeping the frame being received, it is still received and validated.
+			/// </summary>
+			static void Drop(Flow& flow)
+			{
+				if (flow.Filling != flow.Sending)
+				{
+					flow.States[flow.Filling] = BufferStateEnum::Free;
+				}
+				flow.Filling = BufferNone;
+				flow.Through = false;
+			}
+
+			/// <summary>
+			/// Follows the COBS blocks of the frame being received, and picks up its header.
+			/// Only the bytes up to the header are looked at, blocks are skipped over whole.
+			/// </summary>
+			static void Scan(Flow& flow, const uint8_t* data, const uint8_t size)
+			{
+				uint8_t index = 0;
+				while (index < size)
+				{
+					if (flow.BlockLeft == 0)
+					{
+						// Each code after the first stands for a delimiter, unless it follows a full block.
+						if (flow.Code != 0
+							&& flow.Code != UartCobsCodec::Codes::MaxCode)
+						{
+							Decode(flow, MessageDefinition::Delimiter);
+						}
+						flow.Code = data[index++];
+						flow.BlockLeft = flow.Code - UartCobsCodec::Codes::EndReplacement;
+					}
+					else
+					{
+						uint8_t chunk = size - index;
+						if (chunk > flow.BlockLeft)
+						{
+							chunk = flow.BlockLeft;
+						}
+
+						for (uint8_t i = 0; i < chunk && !flow.HeaderKnown; i++)
+						{
+							Decode(flow, data[index + i]);
+						}
+						index += chunk;
+						flow.BlockLeft -= chunk;
+					}
+				}
+			}
+
+			static void Decode(Flow& flow, const uint8_t value)
+			{
+				if (!flow.HeaderKnown)
+				{
+					if (flow.Decoded == HeaderIndex)
+					{
+						flow.Header = value;
+						flow.HeaderKnown = true;
+					}
+					flow.Decoded++;
+				}
+			}
+
+			/// <summary>
+			/// Makes the forwarded copy of a failed frame fail COBS decoding at the far end.
+			/// Cut inside a block, it already does. Otherwise, a last code claims more bytes than there are.
+			/// </summary>
+			static void Poison(Flow& flow, const uint8_t index)
+			{
+				if (flow.BlockLeft == 0
+					&& flow.Sizes[index] < FrameSize)
+				{
+					flow.Frames[index][flow.Sizes[index]++] = UartCobsCodec::Codes::MaxCode;
+				}
+			}
+
+			/// <summary>
+			/// Sends the oldest queued frame received on a side, if the other side is free.
+			/// </summary>
+			void SendQueued(const SideEnum side)
+			{
+				Flow& flow = Flows[(uint8_t)side];
+
+				if (flow.QueueCount == 0)
+				{
+					return;
+				}
+
+				const uint8_t index = flow.Queue[0];
+				if (flow.Sending == BufferNone
+					&& SendThrough(side, flow.Frames[index], flow.Sizes[index], false))
+				{
+					flow.States[index] = BufferStateEnum::Sending;
+					flow.Sending = index;
+					flow.QueueCount--;
+					for (uint8_t i = 0; i < flow.QueueCount; i++)
+					{
+						flow.Queue[i] = flow.Queue[i + 1];
+					}
+				}
+
+				if (flow.QueueCount > 0)
+				{
+					TS::Task::enableIfNot();
+				}
+			}
+
+			/// <summary>
+			/// A side is done sending, frees the forwarded frame if it was one.
+			/// </summary>
+			/// <returns>True if it was a forwarded frame.</returns>
+			bool OnTargetTx(const SideEnum target, const bool)
+			{
+				const SideEnum side = Other(target);
+				Flow& flow = Flows[(uint8_t)side];
+
+				if (flow.Sending == BufferNone)
+				{
+					return false;
+				}
+
+				if (flow.Sending == flow.Filling)
+				{
+					// Cut-through failed on the way out, the rest isn't kept.
+					flow.Stats.Aborted++;
+					flow.Filling = BufferNone;
+					flow.Through = false;
+				}
+				flow.States[flow.Sending] = BufferStateEnum::Free;
+				flow.Sending = BufferNone;
+				SendQueued(side);
+
+				return true;
+			}
+
+			void OnDisconnected(const SideEnum side)
+			{
+				// Nothing more goes out of this side.
+				Flow& flow = Flows[(uint8_t)Other(side)];
+				for (uint8_t i = 0; i < BridgeDefinitions::ForwardBuffers; i++)
+				{
+					flow.States[i] = BufferStateEnum::Free;
+				}
+				flow.Filling = BufferNone;
+				flow.Through = false;
+				flow.QueueCount = 0;
+				flow.Sending = BufferNone;
+			}
+
+			static SideEnum Other(const SideEnum side)
+			{
+				return (side == SideEnum::A) ? SideEnum::B : SideEnum::A;
+			}
+
+			/// <summary>
+			/// Out of the side opposite the receiving one.
+			/// </summary>
+			bool SendThrough(const SideEnum side, const uint8_t* frame, const uint8_t frameSize, const bool open)
+			{
+				return (side == SideEnum::A) ? InterfaceB.SendThrough(frame, frameSize, open)
+					: InterfaceA.SendThrough(frame, frameSize, open);
+			}
+
+			void ExtendThrough(const SideEnum side, const uint8_t frameSize)
+			{
+				if (side == SideEnum::A)
+				{
+					InterfaceB.ExtendThrough(frameSize);
+				}
+				else
+				{
+					InterfaceA.ExtendThrough(frameSize);
+				}
+			}
+
+			void CloseThrough(const SideEnum side, const uint8_t frameSize)
+			{
+				if (side == SideEnum::A)
+				{
+					InterfaceB.CloseThrough(frameSize);
+				}
+				else
+				{
+					InterfaceA.CloseThrough(frameSize);
+				}
+			}
+		};
+	}
+}
+#endif
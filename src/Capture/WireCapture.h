@@ -0,0 +1,468 @@
+#ifndef _UART_INTERFACE_WIRE_CAPTURE_h
+#define _UART_INTERFACE_WIRE_CAPTURE_h
+
+#include <UartInterface.h>
+
+#if defined(__linux__)
+#include <stdio.h>
+#endif
+
+namespace UartInterface
+{
+	/// <summary>
+	/// Timestamped raw wire capture, from a WireTap.
+	/// </summary>
+	namespace Capture
+	{
+		/// <summary>
+		/// Compact append-only capture format, little-endian.
+		///		Header: 'U' 'I' 'W' 'C', Version, Reserved, StartMicros[4].
+		///		Record: Prefix, DeltaMicros (unsigned LEB128, 1 to 5 bytes), Data[1..RecordDataMax].
+		///			Prefix bit 7 is the direction (1 for TX), bits 0..6 are the data size - 1.
+		///			DeltaMicros is from the previous record, or from StartMicros for the first.
+		/// </summary>
+		struct WireCaptureFormat
+		{
+			static constexpr uint32_t Magic = 0x43574955;
+			static constexpr uint8_t Version = 1;
+			static constexpr uint8_t HeaderSize = 10;
+
+			static constexpr uint8_t RecordDataMax = 128;
+			static constexpr uint8_t DeltaSizeMax = 5;
+			static constexpr uint8_t PrefixSizeMax = 1 + DeltaSizeMax;
+
+			static constexpr uint8_t DirectionFlag = 0x80;
+			static constexpr uint8_t SizeMask = 0x7F;
+
+			static void WriteHeader(uint8_t* header, const uint32_t startMicros)
+			{
+				WriteUInt32(&header[0], Magic);
+				header[4] = Version;
+				header[5] = 0;
+				WriteUInt32(&header[6], startMicros);
+			}
+
+			static bool ReadHeader(const uint8_t* header, const uint32_t size, uint32_t& startMicros)
+			{
+				if (size < HeaderSize
+					|| ReadUInt32(&header[0]) != Magic
+					|| header[4] != Version)
+				{
+					return false;
+				}
+
+				startMicros = ReadUInt32(&header[6]);
+
+				return true;
+			}
+
+			/// <returns>Prefix size, written to prefix[PrefixSizeMax].</returns>
+			static uint8_t WritePrefix(uint8_t* prefix, const WireDirectionEnum direction, uint32_t deltaMicros, const uint8_t dataSize)
+			{
+				prefix[0] = (uint8_t)((direction == WireDirectionEnum::Tx ? DirectionFlag : 0) | ((dataSize - 1) & SizeMask));
+
+				uint8_t size = 1;
+				do
+				{
+					prefix[size] = (uint8_t)(deltaMicros & 0x7F);
+					deltaMicros >>= 7;
+					if (deltaMicros > 0)
+					{
+						prefix[size] |= 0x80;
+					}
+					size++;
+				} while (deltaMicros > 0);
+
+				return size;
+			}
+
+			static void WriteUInt32(uint8_t* data, const uint32_t value)
+			{
+				data[0] = (uint8_t)value;
+				data[1] = (uint8_t)(value >> 8);
+				data[2] = (uint8_t)(value >> 16);
+				data[3] = (uint8_t)(value >> 24);
+			}
+
+			static uint32_t ReadUInt32(const uint8_t* data)
+			{
+				return (uint32_t)data[0]
+					| ((uint32_t)data[1] << 8)
+					| ((uint32_t)data[2] << 16)
+					| ((uint32_t)data[3] << 24);
+			}
+		};
+
+		struct WireCaptureRecord
+		{
+			const uint8_t* Data;
+			uint32_t TimestampMicros;
+			WireDirectionEnum Direction;
+			uint8_t Size;
+		};
+
+		/// <summary>
+		/// Sequential record reader over a contiguous capture.
+		/// A truncated last record ends the capture.
+		/// </summary>
+		class WireCaptureReader
+		{
+		private:
+			const uint8_t* Capture;
+			const uint32_t CaptureSize;
+
+			uint32_t Offset = 0;
+			uint32_t TimestampMicros = 0;
+			uint32_t StartMicros = 0;
+			bool Valid;
+
+		public:
+			WireCaptureReader(const uint8_t* capture, const uint32_t captureSize)
+				: Capture(capture)
+				, CaptureSize(captureSize)
+				, Valid(capture != nullptr
+					&& WireCaptureFormat::ReadHeader(capture, captureSize, StartMicros))
+			{
+				Rewind();
+			}
+
+			bool IsValid() const
+			{
+				return Valid;
+			}
+
+			uint32_t GetStartMicros() const
+			{
+				return StartMicros;
+			}
+
+			/// <summary>
+			/// True when all records were read, without a truncated tail.
+			/// </summary>
+			bool IsComplete() const
+			{
+				return Valid && Offset == CaptureSize;
+			}
+
+			void Rewind()
+			{
+				Offset = WireCaptureFormat::HeaderSize;
+				TimestampMicros = StartMicros;
+			}
+
+			bool Next(WireCaptureRecord& record)
+			{
+				if (!Valid
+					|| Offset >= CaptureSize)
+				{
+					return false;
+				}
+
+				uint32_t offset = Offset;
+				const uint8_t prefix = Capture[offset++];
+
+				uint32_t delta = 0;
+				for (uint8_t shift = 0; ; shift += 7)
+				{
+					if (offset >= CaptureSize
+						|| shift >= (WireCaptureFormat::DeltaSizeMax * 7))
+					{
+						return false;
+					}
+
+					const uint8_t value = Capture[offset++];
+					delta |= (uint32_t)(value & 0x7F) << shift;
+					if ((value & 0x80) == 0)
+					{
+						break;
+					}
+				}
+
+				const uint8_t size = (uint8_t)((prefix & WireCaptureFormat::SizeMask) + 1);
+				if (CaptureSize - offset < size)
+				{
+					return false;
+				}
+
+				TimestampMicros += delta;
+				record.Data = &Capture[offset];
+				record.TimestampMicros = TimestampMicros;
+				record.Direction = (prefix & WireCaptureFormat::DirectionFlag) ? WireDirectionEnum::Tx : WireDirectionEnum::Rx;
+				record.Size = size;
+				Offset = offset + size;
+
+				return true;
+			}
+		};
+
+		/// <summary>
+		/// Record encoding state: tap bytes are split into records and timestamped against the previous one.
+		/// </summary>
+		class WireCaptureEncoder
+		{
+		private:
+			uint32_t LastMicros = 0;
+			bool Started = false;
+
+		public:
+			void Clear()
+			{
+				Started = false;
+			}
+
+			bool IsStarted() const
+			{
+				return Started;
+			}
+
+			/// <summary>
+			/// Starts the capture at the first record's timestamp.
+			/// </summary>
+			/// <returns>True if this record starts the capture.</returns>
+			bool Start(const uint32_t timestampMicros)
+			{
+				if (Started)
+				{
+					return false;
+				}
+
+				Started = true;
+				LastMicros = timestampMicros;
+
+				return true;
+			}
+
+			uint32_t GetStartMicros() const
+			{
+				return LastMicros;
+			}
+
+			uint8_t WritePrefix(uint8_t* prefix, const WireDirectionEnum direction, const uint32_t timestampMicros, const uint8_t dataSize)
+			{
+				const uint32_t delta = timestampMicros - LastMicros;
+				LastMicros = timestampMicros;
+
+				return WireCaptureFormat::WritePrefix(prefix, direction, delta, dataSize);
+			}
+		};
+
+		/// <summary>
+		/// In-memory flight recorder, for MCUs.
+		/// When full, the oldest records are dropped to make room, so the ring holds the most recent traffic.
+		/// Export() writes a regular capture to any stream with write(const uint8_t*, size_t), e.g. a Serial.
+		/// </summary>
+		/// <typeparam name="Capacity">Ring size in bytes, records included.</typeparam>
+		template<uint16_t Capacity>
+		class WireCaptureRing : public WireTap
+		{
+		private:
+			static_assert(Capacity > (WireCaptureFormat::PrefixSizeMax + WireCaptureFormat::RecordDataMax), "Capacity too small for a full record.");
+
+		private:
+			WireCaptureEncoder Encoder{};
+
+			uint8_t Buffer[Capacity]{};
+			uint16_t Tail = 0;
+			uint16_t Count = 0;
+
+			// Timestamp the oldest kept record's delta is relative to.
+			uint32_t StartMicros = 0;
+			uint32_t DroppedRecords = 0;
+
+		public:
+			void Clear()
+			{
+				Encoder.Clear();
+				Tail = 0;
+				Count = 0;
+				DroppedRecords = 0;
+			}
+
+			uint16_t GetSize() const
+			{
+				return Count;
+			}
+
+			/// <summary>
+			/// Oldest records overwritten, since Clear().
+			/// </summary>
+			uint32_t GetDroppedRecords() const
+			{
+				return DroppedRecords;
+			}
+
+			/// <summary>
+			/// Writes the header and the kept records.
+			/// </summary>
+			/// <returns>Bytes written.</returns>
+			template<typename StreamType>
+			uint32_t Export(StreamType& stream) const
+			{
+				uint8_t header[WireCaptureFormat::HeaderSize];
+				WireCaptureFormat::WriteHeader(header, Encoder.IsStarted() ? StartMicros : 0);
+
+				uint32_t written = stream.write(header, sizeof(header));
+
+				const uint16_t first = (Count < (Capacity - Tail)) ? Count : (Capacity - Tail);
+				if (first > 0)
+				{
+					written += stream.write(&Buffer[Tail], first);
+				}
+				if (Count > first)
+				{
+					written += stream.write(Buffer, Count - first);
+				}
+
+				return written;
+			}
+
+			void OnWireBytes(const WireDirectionEnum direction, const uint32_t timestampMicros, const uint8_t* data, const uint16_t size) final
+			{
+				if (Encoder.Start(timestampMicros))
+				{
+					StartMicros = timestampMicros;
+				}
+
+				uint16_t index = 0;
+				while (index < size)
+				{
+					const uint8_t recordSize = (size - index > WireCaptureFormat::RecordDataMax) ? WireCaptureFormat::RecordDataMax : (uint8_t)(size - index);
+
+					uint8_t prefix[WireCaptureFormat::PrefixSizeMax];
+					const uint8_t prefixSize = Encoder.WritePrefix(prefix, direction, timestampMicros, recordSize);
+
+					while ((uint16_t)(Capacity - Count) < (uint16_t)(prefixSize + recordSize))
+					{
+						DropOldest();
+					}
+
+					Push(prefix, prefixSize);
+					Push(&data[index], recordSize);
+					index += recordSize;
+				}
+			}
+
+		private:
+			uint8_t Peek(const uint16_t offset) const
+			{
+				return Buffer[(uint16_t)((Tail + offset) % Capacity)];
+			}
+
+			void Push(const uint8_t* data, const uint16_t size)
+			{
+				uint16_t head = (uint16_t)((Tail + Count) % Capacity);
+				for (uint16_t i = 0; i < size; i++)
+				{
+					Buffer[head] = data[i];
+					head = (head + 1 < Capacity) ? (head + 1) : 0;
+				}
+				Count += size;
+			}
+
+			void DropOldest()
+			{
+				uint16_t offset = 1;
+				uint32_t delta = 0;
+				for (uint8_t shift = 0; offset < Count; shift += 7)
+				{
+					const uint8_t value = Peek(offset++);
+					delta |= (uint32_t)(value & 0x7F) << shift;
+					if ((value & 0x80) == 0)
+					{
+						break;
+					}
+				}
+
+				const uint16_t recordSize = offset + (Peek(0) & WireCaptureFormat::SizeMask) + 1;
+
+				// The next record's delta stays relative to the dropped one.
+				StartMicros += delta;
+				Tail = (uint16_t)((Tail + recordSize) % Capacity);
+				Count -= recordSize;
+				DroppedRecords++;
+			}
+		};
+
+#if defined(__linux__)
+		/// <summary>
+		/// Appends a capture to a file, for hosts.
+		/// The header is written with the first record.
+		/// </summary>
+		class WireCaptureFile : public WireTap
+		{
+		private:
+			WireCaptureEncoder Encoder{};
+
+			FILE* File = nullptr;
+			uint32_t Records = 0;
+
+		public:
+			~WireCaptureFile()
+			{
+				Close();
+			}
+
+			bool Open(const char* path)
+			{
+				Close();
+				Encoder.Clear();
+				Records = 0;
+				File = fopen(path, "wb");
+
+				return File != nullptr;
+			}
+
+			void Close()
+			{
+				if (File != nullptr)
+				{
+					fclose(File);
+					File = nullptr;
+				}
+			}
+
+			void Flush()
+			{
+				if (File != nullptr)
+				{
+					fflush(File);
+				}
+			}
+
+			uint32_t GetRecordCount() const
+			{
+				return Records;
+			}
+
+			void OnWireBytes(const WireDirectionEnum direction, const uint32_t timestampMicros, const uint8_t* data, const uint16_t size) final
+			{
+				if (File == nullptr)
+				{
+					return;
+				}
+
+				if (Encoder.Start(timestampMicros))
+				{
+					uint8_t header[WireCaptureFormat::HeaderSize];
+					WireCaptureFormat::WriteHeader(header, timestampMicros);
+					fwrite(header, 1, sizeof(header), File);
+				}
+
+				uint16_t index = 0;
+				while (index < size)
+				{
+					const uint8_t recordSize = (size - index > WireCaptureFormat::RecordDataMax) ? WireCaptureFormat::RecordDataMax : (uint8_t)(size - index);
+
+					uint8_t prefix[WireCaptureFormat::PrefixSizeMax];
+					const uint8_t prefixSize = Encoder.WritePrefix(prefix, direction, timestampMicros, recordSize);
+					fwrite(prefix, 1, prefixSize, File);
+					fwrite(&data[index], 1, recordSize, File);
+					index += recordSize;
+					Records++;
+				}
+			}
+		};
+#endif
+	}
+}
+#endif
@@ -0,0 +1,234 @@
+#ifndef _UART_INTERFACE_WIRE_REPLAY_h
+#define _UART_INTERFACE_WIRE_REPLAY_h
+
+#if defined(__linux__)
+#include <chrono>
+#include <thread>
+
+#include "WireCapture.h"
+#include "../Core/UartInterfaceCore.h"
+
+namespace UartInterface
+{
+	namespace Capture
+	{
+		enum class ReplayModeEnum : uint8_t
+		{
+			/// <summary>
+			/// Records are fed at their captured wall time.
+			/// </summary>
+			OriginalTiming,
+
+			/// <summary>
+			/// Records are fed back to back, for decode throughput.
+			/// </summary>
+			AsFastAsPossible
+		};
+
+		struct ReplayResult
+		{
+			uint32_t Records = 0;
+			uint32_t Bytes = 0;
+			uint32_t Messages = 0;
+			uint32_t CrcErrors = 0;
+			uint32_t TooShortErrors = 0;
+			uint32_t TooLongErrors = 0;
+			uint32_t CaptureMicros = 0;
+			uint32_t ElapsedMicros = 0;
+			bool Complete = false;
+		};
+
+		/// <summary>
+		/// Host replay of a capture through the real RX state machine and MessageCodec.
+		/// The core runs on the captured timestamps in both modes, so read timeouts and results do not depend on the pace.
+		/// Decoded messages and errors go to the optional listener.
+		/// </summary>
+		template<typename UartDefinitions = UartInterface::TemplateUartDefinitions<>>
+		class WireReplay : private UartListener
+		{
+		private:
+			/// <summary>
+			/// RX-only serial over the current record, with the span API.
+			/// </summary>
+			class ReplaySerial
+			{
+			private:
+				const uint8_t* Data = nullptr;
+				uint16_t Size = 0;
+
+			public:
+				void Feed(const uint8_t* data, const uint16_t size)
+				{
+					Data = data;
+					Size = size;
+				}
+
+				operator bool() { return true; }
+
+				void begin(const unsigned long) { Size = 0; }
+				void end() {}
+				void clearWriteError() {}
+
+				int available() { return Size; }
+				int availableForWrite() { return 0; }
+
+				int read()
+				{
+					if (Size == 0)
+					{
+						return -1;
+					}
+
+					Size--;
+
+					return *Data++;
+				}
+
+				uint16_t ReadSpan(const uint8_t*& data)
+				{
+					data = Data;
+
+					return Size;
+				}
+
+				void Consume(const uint16_t size)
+				{
+					Data += size;
+					Size -= size;
+				}
+
+				size_t write(const uint8_t value) { return 0; }
+				size_t write(const uint8_t* buffer, const size_t size) { return 0; }
+			};
+
+		private:
+			ReplaySerial SerialInstance{};
+			UartInterfaceCore<ReplaySerial, UartDefinitions> Core;
+
+			UartListener* Listener = nullptr;
+			ReplayResult Result{};
+
+		public:
+			WireReplay(const uint8_t* key, const uint8_t keySize)
+				: Core(SerialInstance, this, key, keySize)
+			{
+			}
+
+			bool Setup()
+			{
+				return Core.Setup();
+			}
+
+			/// <summary>
+			/// Replays the records of one direction, e.g. Rx for what the captured node received.
+			/// </summary>
+			ReplayResult Run(const uint8_t* capture, const uint32_t captureSize,
+				const ReplayModeEnum mode = ReplayModeEnum::AsFastAsPossible,
+				const WireDirectionEnum direction = WireDirectionEnum::Rx,
+				UartListener* listener = nullptr)
+			{
+				using ClockType = std::chrono::steady_clock;
+
+				Result = ReplayResult{};
+				Listener = listener;
+
+				WireCaptureReader reader(capture, captureSize);
+				if (!reader.IsValid())
+				{
+					return Result;
+				}
+
+				uint32_t now = reader.GetStartMicros();
+				Core.Start();
+				Core.PollRx(now);
+
+				const ClockType::time_point start = ClockType::now();
+				WireCaptureRecord record;
+				while (reader.Next(record))
+				{
+					if (record.Direction != direction)
+					{
+						continue;
+					}
+
+					now = record.TimestampMicros;
+					if (mode == ReplayModeEnum::OriginalTiming)
+					{
+						std::this_thread::sleep_until(start + std::chrono::microseconds(now - reader.GetStartMicros()));
+					}
+
+					// Idle poll first, for the read timeouts of the gap before this record.
+					Core.PollRx(now);
+
+					SerialInstance.Feed(record.Data, record.Size);
+					while (SerialInstance.available() > 0)
+					{
+						Core.PollRx(now);
+					}
+					Core.PollRx(now);
+
+					Result.Records++;
+					Result.Bytes += record.Size;
+				}
+
+				Result.ElapsedMicros = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(ClockType::now() - start).count();
+				Result.CaptureMicros = now - reader.GetStartMicros();
+				Result.Complete = reader.IsComplete();
+				Core.Stop();
+				Listener = nullptr;
+
+				return Result;
+			}
+
+		private:
+			void OnUartStateChange(const bool) final {}
+
+			void OnUartRx(const uint8_t header) final
+			{
+				Result.Messages++;
+				if (Listener != nullptr)
+				{
+					Listener->OnUartRx(header);
+				}
+			}
+
+			void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+			{
+				Result.Messages++;
+				if (Listener != nullptr)
+				{
+					Listener->OnUartRx(header, payload, payloadSize);
+				}
+			}
+
+			void OnUartTx() final {}
+
+			void OnUartRxError(const RxErrorEnum error) final
+			{
+				switch (error)
+				{
+				case RxErrorEnum::Crc:
+					Result.CrcErrors++;
+					break;
+				case RxErrorEnum::TooShort:
+					Result.TooShortErrors++;
+					break;
+				case RxErrorEnum::TooLong:
+					Result.TooLongErrors++;
+					break;
+				default:
+					break;
+				}
+
+				if (Listener != nullptr)
+				{
+					Listener->OnUartRxError(error);
+				}
+			}
+
+			void OnUartTxError(const TxErrorEnum) final {}
+		};
+	}
+}
+#endif
+#endif
@@ -0,0 +1,334 @@
+#ifndef _UART_INTERFACE_COALESCING_h
+#define _UART_INTERFACE_COALESCING_h
+
+#define _TASK_OO_CALLBACKS
+#include <TSchedulerDeclarations.hpp>
+
+#include "../Task/UartInterfaceTask.h"
+
+namespace UartInterface
+{
+	/// <summary>
+	/// Last-value-wins transmission of state messages.
+	/// </summary>
+	namespace Coalescing
+	{
+		/// <summary>
+		/// Coalescing storage.
+		/// </summary>
+		/// <typeparam name="pendingSlots">State messages that can wait for the serial at once, one per distinct header.</typeparam>
+		template<uint8_t pendingSlots = 4>
+		struct TemplateCoalescingDefinitions
+		{
+			static constexpr uint8_t PendingSlots = pendingSlots;
+		};
+
+		/// <summary>
+		/// UartInterfaceTask with last-value-wins sends, for headers marked with SetCoalescing().
+		/// A coalescing message that can't be sent now waits in a pending slot, and goes out as soon as the serial is free.
+		/// A newer message with the same header replaces the waiting one's payload in place, keeping its place in line.
+		/// Pending messages only ever hold the newest value, and there's at most one per header.
+		/// Other headers are sent as with UartInterfaceTask, failing while the serial is busy.
+		/// </summary>
+		template<typename SerialType,
+			typename UartDefinitions,
+			typename CoalescingDefinitions = TemplateCoalescingDefinitions<>>
+		class CoalescingUartInterface : public TS::Task, public UartListener
+		{
+		private:
+			static_assert(CoalescingDefinitions::PendingSlots > 0, "At least one pending slot.");
+
+			struct PendingMessage
+			{
+				uint8_t Payload[UartDefinitions::MaxPayloadSize];
+				uint8_t PayloadSize;
+				uint8_t Header;
+			};
+
+		private:
+			UartInterfaceTask<SerialType, UartDefinitions> Interface;
+
+			UartListener* Listener;
+
+		private:
+			/// <summary>
+			/// Oldest first.
+			/// </summary>
+			PendingMessage Pending[CoalescingDefinitions::PendingSlots]{};
+
+			uint8_t CoalescingMask[32]{};
+
+			uint32_t CoalescedCount = 0;
+			uint32_t DeferredCount = 0;
+			uint8_t PendingCount = 0;
+
+		public:
+			CoalescingUartInterface(TS::Scheduler& scheduler, SerialType& serialInstance, UartListener* listener,
+				const uint8_t* key,
+				const uint8_t keySize)
+				: TS::Task(UartDefinitions::PollPeriodMillis, TASK_FOREVER, &scheduler, false)
+				, Interface(scheduler, serialInstance, this, key, keySize)
+				, Listener(listener)
+			{
+			}
+
+			bool Setup()
+			{
+				return Interface.Setup();
+			}
+
+			void Start()
+			{
+				PendingCount = 0;
+				CoalescedCount = 0;
+				DeferredCount = 0;
+				Interface.Start();
+			}
+
+			void Stop()
+			{
+				Interface.Stop();
+				PendingCount = 0;
+				TS::Task::disable();
+			}
+
+			UartInterfaceTask<SerialType, UartDefinitions>& GetInterface()
+			{
+				return Interface;
+			}
+
+			/// <summary>
+			/// Marks a header as state: only its newest value matters.
+			/// </summary>
+			void SetCoalescing(const uint8_t header, const bool coalescing)
+			{
+				if (coalescing)
+				{
+					CoalescingMask[header >> 3] |= (uint8_t)(1 << (header & 7));
+				}
+				else
+				{
+					CoalescingMask[header >> 3] &= (uint8_t)~(1 << (header & 7));
+				}
+			}
+
+			bool IsCoalescing(const uint8_t header) const
+			{
+				return (CoalescingMask[header >> 3] >> (header & 7)) & 1;
+			}
+
+			/// <summary>
+			/// State messages waiting for the serial.
+			/// </summary>
+			uint8_t GetPendingCount() const
+			{
+				return PendingCount;
+			}
+
+			/// <summary>
+			/// Waiting messages replaced by a newer value, since Start().
+			/// </summary>
+			uint32_t GetCoalescedCount() const
+			{
+				return CoalescedCount;
+			}
+
+			/// <summary>
+			/// State messages that had to wait for the serial, since Start().
+			/// </summary>
+			uint32_t GetDeferredCount() const
+			{
+				return DeferredCount;
+			}
+
+			bool CanSendMessage() const
+			{
+				return Interface.CanSendMessage();
+			}
+
+			bool SendMessage(const uint8_t header)
+			{
+				if (IsCoalescing(header))
+				{
+					return Coalesce(header, nullptr, 0);
+				}
+
+				return Interface.SendMessage(header);
+			}
+
+			bool SendMessage(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize)
+			{
+				if (IsCoalescing(header))
+				{
+					return payload != nullptr
+						&& Coalesce(header, payload, payloadSize);
+				}
+
+				return Interface.SendMessage(header, payload, payloadSize);
+			}
+
+			template<typename PayloadType>
+			bool SendMessage(const uint8_t header, const PayloadType& payload)
+			{
+				static_assert(PayloadTypeCheck<PayloadType>::Valid, "Payload type must be a trivially copyable value, not a pointer.");
+
+				if (IsCoalescing(header))
+				{
+					return Coalesce(header, (const uint8_t*)&payload, sizeof(PayloadType));
+				}
+
+				return Interface.SendMessage(header, payload);
+			}
+
+		public:
+			/// <summary>
+			/// Retries while the serial has no room, a sent message wakes the next one in OnUartTx().
+			/// </summary>
+			bool Callback() final
+			{
+				SendPending();
+
+				if (PendingCount == 0)
+				{
+					TS::Task::disable();
+				}
+
+				return true;
+			}
+
+		public:
+			void OnUartStateChange(const bool connected) final
+			{
+				if (!connected)
+				{
+					PendingCount = 0;
+				}
+
+				if (Listener != nullptr)
+				{
+					Listener->OnUartStateChange(connected);
+				}
+			}
+
+			void OnUartRx(const uint8_t header) final
+			{
+				if (Listener != nullptr)
+				{
+					Listener->OnUartRx(header);
+				}
+			}
+
+			void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+			{
+				if (Listener != nullptr)
+				{
+					Listener->OnUartRx(header, payload, payloadSize);
+				}
+			}
+
+			void OnUartTx() final
+			{
+				SendPending();
+				if (Listener != nullptr)
+				{
+					Listener->OnUartTx();
+				}
+			}
+
+			void OnUartRxError(const RxErrorEnum error) final
+			{
+				if (Listener != nullptr)
+				{
+					Listener->OnUartRxError(error);
+				}
+			}
+
+			void OnUartTxError(const TxErrorEnum error) final
+			{
+				SendPending();
+				if (Listener != nullptr)
+				{
+					Listener->OnUartTxError(error);
+				}
+			}
+
+		private:
+			bool Coalesce(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize)
+			{
+				if (payloadSize > UartDefinitions::MaxPayloadSize)
+				{
+					return false;
+				}
+
+				for (uint8_t i = 0; i < PendingCount; i++)
+				{
+					if (Pending[i].Header == header)
+					{
+						Store(Pending[i], payload, payloadSize);
+						CoalescedCount++;
+
+						return true;
+					}
+				}
+
+				if (PendingCount == 0)
+				{
+					if (payload == nullptr)
+					{
+						if (Interface.SendMessage(header))
+						{
+							return true;
+						}
+					}
+					else if (Interface.SendMessage(header, payload, payloadSize))
+					{
+						return true;
+					}
+				}
+
+				if (PendingCount >= CoalescingDefinitions::PendingSlots
+					|| !Interface.IsSerialConnected())
+				{
+					return false;
+				}
+
+				Pending[PendingCount].Header = header;
+				Store(Pending[PendingCount], payload, payloadSize);
+				PendingCount++;
+				DeferredCount++;
+				TS::Task::enableIfNot();
+
+				return true;
+			}
+
+			static void Store(PendingMessage& message, const uint8_t* payload, const uint8_t payloadSize)
+			{
+				if (payloadSize > 0)
+				{
+					memcpy(message.Payload, payload, payloadSize);
+				}
+				message.PayloadSize = payloadSize;
+			}
+
+			/// <summary>
+			/// Sends the oldest pending message, if the serial is free.
+			/// </summary>
+			void SendPending()
+			{
+				if (PendingCount == 0
+					|| !Interface.CanSendMessage()
+					|| !Interface.SendMessage(Pending[0].Header, Pending[0].Payload, Pending[0].PayloadSize))
+				{
+					return;
+				}
+
+				PendingCount--;
+				for (uint8_t i = 0; i < PendingCount; i++)
+				{
+					Pending[i] = Pending[i + 1];
+				}
+			}
+		};
+	}
+}
+#endif
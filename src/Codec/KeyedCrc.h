@@ -17,6 +17,9 @@ namespace UartInterface
 		/// </summary>
 		static constexpr uint8_t CrcSize = 2;
 
+	private:
+		static constexpr uint16_t FletcherModulus = 255;
+
 	private:
 		Fletcher16 Hasher{};
 
@@ -24,6 +27,32 @@ namespace UartInterface
 		const uint8_t* Key;
 		const uint8_t KeySize;
 
+		// Fletcher16 sums after the key, for the fixed size path.
+		uint8_t KeySum1 = 0;
+		uint8_t KeySum2 = 0;
+
+	public:
+		/// <summary>
+		/// Compile-time GetCrc, for a constant key and data.
+		/// Same mod 255 sums as Fletcher16.
+		/// </summary>
+		static constexpr uint16_t GetStaticCrc(const uint8_t* key, const uint8_t keySize, const uint8_t* data, const uint8_t dataSize)
+		{
+			return GetStaticFletcher(data, dataSize, GetStaticFletcher(key, keySize, 0));
+		}
+
+	private:
+		/// <summary>
+		/// Continues Fletcher16 sums, packed as (sum2 << 8) | sum1.
+		/// </summary>
+		static constexpr uint16_t GetStaticFletcher(const uint8_t* data, const uint8_t size, const uint16_t sums)
+		{
+			return (size == 0) ? sums
+				: GetStaticFletcher(data + 1, size - 1,
+					(uint16_t)(((((sums >> 8) + (((sums & UINT8_MAX) + data[0]) % FletcherModulus)) % FletcherModulus) << 8)
+						| (((sums & UINT8_MAX) + data[0]) % FletcherModulus)));
+		}
+
 	public:
 		KeyedCrc(const uint8_t* key, const uint8_t keySize)
 			: Key(key)
@@ -31,9 +60,20 @@ namespace UartInterface
 		{
 		}
 
-		bool Setup() const
+		bool Setup()
 		{
-			return Key != nullptr && KeySize > 0;
+			if (Key != nullptr && KeySize > 0)
+			{
+				Hasher.begin();
+				Hasher.add(Key, (uint16_t)KeySize);
+				const uint16_t keyCrc = Hasher.getFletcher();
+				KeySum1 = (uint8_t)keyCrc;
+				KeySum2 = (uint8_t)(keyCrc >> 8);
+
+				return true;
+			}
+
+			return false;
 		}
 
 		uint16_t GetCrc(const uint8_t* data, const uint16_t dataSize)
@@ -44,6 +84,46 @@ namespace UartInterface
 
 			return Hasher.getFletcher();
 		}
+
+		/// <summary>
+		/// GetCrc with a leading byte outside the data, e.g. the frame's address.
+		/// </summary>
+		uint16_t GetCrc(const uint8_t prefix, const uint8_t* data, const uint16_t dataSize)
+		{
+			Hasher.begin();
+			Hasher.add(Key, (uint16_t)KeySize);
+			Hasher.add(prefix);
+			Hasher.add(data, dataSize);
+
+			return Hasher.getFletcher();
+		}
+
+		/// <summary>
+		/// Compile-time sized GetCrc, continues from the key sums cached in Setup().
+		/// AVR keeps Fletcher16's own reduction, to stay bit exact with GetCrc().
+		/// </summary>
+		template<uint8_t DataSize>
+		uint16_t GetCrc(const uint8_t* data)
+		{
+#if defined(ARDUINO_ARCH_AVR) || defined(ARDUINO_ARCH_MEGAAVR)
+			Hasher.begin(KeySum1, KeySum2);
+			Hasher.add(data, (uint16_t)DataSize);
+
+			return Hasher.getFletcher();
+#else
+			// Sums fit in 32 bits for up to UINT8_MAX bytes, reduced once at the end.
+			uint32_t sum1 = KeySum1;
+			uint32_t sum2 = KeySum2;
+
+			for (uint8_t i = 0; i < DataSize; i++)
+			{
+				sum1 += data[i];
+				sum2 += sum1;
+			}
+
+			return (uint16_t)(((sum2 % FletcherModulus) << 8) | (sum1 % FletcherModulus));
+#endif
+		}
 	};
 }
 #endif
\ No newline at end of file
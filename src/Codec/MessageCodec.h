@@ -3,22 +3,32 @@
 
 #include "UartCobsCodec.h"
 #include "KeyedCrc.h"
+#include "ReedSolomon.h"
 #include "../Model/UartInterface.h"
 
 namespace UartInterface
 {
-	template<uint8_t PayloadSizeMax = MessageDefinition::PayloadSizeMax>
+	/// <summary>
+	/// Message CRC and COBS framing.
+	/// With ParitySize > 0, Reed-Solomon parity is appended to the CRC'd message before COBS,
+	///  and up to ParitySize / 2 byte errors are corrected on decode, before the CRC check.
+	/// </summary>
+	template<uint8_t PayloadSizeMax = MessageDefinition::PayloadSizeMax,
+		uint8_t ParitySize = 0>
 	class MessageCodec
 	{
 	private:
 		using MessageDefinition = UartInterface::MessageDefinition;
 
+		static_assert((uint16_t)PayloadSizeMax + MessageDefinition::MessageSizeMin + ParitySize <= MessageDefinition::MessageSizeMax, "Payload and parity too large for a frame.");
+
 	public:
-		static constexpr uint16_t BufferSize = MessageDefinition::GetBufferSizeFromPayload(PayloadSizeMax);
+		static constexpr uint16_t BufferSize = MessageDefinition::GetBufferSizeFromPayload(PayloadSizeMax) + ParitySize;
 
 	private:
 		uint8_t Copy[BufferSize]{};
 		KeyedCrc Crc;
+		ReedSolomon<ParitySize> Fec;
 
 	public:
 		MessageCodec(const uint8_t* key, const uint8_t keySize)
@@ -28,7 +38,12 @@ namespace UartInterface
 
 		bool Setup()
 		{
-			return Crc.Setup();
+			return Crc.Setup() && Fec.Setup();
+		}
+
+		const FecStats& GetFecStats() const
+		{
+			return Fec.GetStats();
 		}
 
 		uint16_t EncodeMessageAndCrcInPlace(uint8_t* message, const uint16_t messageSize)
@@ -39,27 +54,55 @@ namespace UartInterface
 			}
 
 			const uint16_t dataSize = messageSize - (uint8_t)MessageDefinition::FieldIndexEnum::Header;
-			const uint16_t crc = Crc.GetCrc(&message[(uint8_t)MessageDefinition::FieldIndexEnum::Header], dataSize);
 
-			if (dataSize > 0)
+			return EncodeWithCrc(message, messageSize, Crc.GetCrc(&message[(uint8_t)MessageDefinition::FieldIndexEnum::Header], dataSize));
+		}
+
+		/// <summary>
+		/// EncodeMessageAndCrcInPlace for an addressed frame, the address is bound into the CRC.
+		/// </summary>
+		uint16_t EncodeMessageAndCrcInPlace(uint8_t* message, const uint16_t messageSize, const uint8_t address)
+		{
+			if (messageSize < uint8_t(MessageDefinition::FieldIndexEnum::Header))
 			{
-				memcpy(&Copy[uint8_t(MessageDefinition::FieldIndexEnum::Header)],
-					&message[uint8_t(MessageDefinition::FieldIndexEnum::Header)],
-					dataSize);
+				return 0;
 			}
-			Copy[(uint8_t)MessageDefinition::FieldIndexEnum::Crc0] = (uint8_t)crc;
-			Copy[(uint8_t)MessageDefinition::FieldIndexEnum::Crc1] = (uint8_t)((crc >> 8) & UINT8_MAX);
 
-			const uint16_t outSize = UartCobsCodec::GetBufferSize(messageSize);
+			const uint16_t dataSize = messageSize - (uint8_t)MessageDefinition::FieldIndexEnum::Header;
+
+			return EncodeWithCrc(message, messageSize, Crc.GetCrc(address, &message[(uint8_t)MessageDefinition::FieldIndexEnum::Header], dataSize));
+		}
 
-			if (UartCobsCodec::Encode(Copy, message, messageSize) == outSize)
+		/// <summary>
+		/// Sets the CRC (and parity) of a message in place, without COBS, for a streaming encoder.
+		/// The message must have room for ParitySize more bytes.
+		/// </summary>
+		/// <returns>Message size with parity, 0 if invalid.</returns>
+		uint16_t PrepareMessageInPlace(uint8_t* message, const uint16_t messageSize)
+		{
+			if (messageSize < uint8_t(MessageDefinition::FieldIndexEnum::Header))
 			{
-				return outSize;
+				return 0;
 			}
-			else
+
+			const uint16_t dataSize = messageSize - (uint8_t)MessageDefinition::FieldIndexEnum::Header;
+
+			return PrepareWithCrc(message, messageSize, Crc.GetCrc(&message[(uint8_t)MessageDefinition::FieldIndexEnum::Header], dataSize));
+		}
+
+		/// <summary>
+		/// PrepareMessageInPlace for an addressed frame, the address is bound into the CRC.
+		/// </summary>
+		uint16_t PrepareMessageInPlace(uint8_t* message, const uint16_t messageSize, const uint8_t address)
+		{
+			if (messageSize < uint8_t(MessageDefinition::FieldIndexEnum::Header))
 			{
 				return 0;
 			}
+
+			const uint16_t dataSize = messageSize - (uint8_t)MessageDefinition::FieldIndexEnum::Header;
+
+			return PrepareWithCrc(message, messageSize, Crc.GetCrc(address, &message[(uint8_t)MessageDefinition::FieldIndexEnum::Header], dataSize));
 		}
 
 		bool MessageValid(uint8_t* message, const uint16_t messageSize)
@@ -70,27 +113,227 @@ namespace UartInterface
 			}
 
 			const uint16_t dataSize = messageSize - (uint8_t)MessageDefinition::FieldIndexEnum::Header;
-			const uint16_t crc = Crc.GetCrc(&message[(uint8_t)MessageDefinition::FieldIndexEnum::Header], dataSize);
+
+			return GetMessageCrc(message) == Crc.GetCrc(&message[(uint8_t)MessageDefinition::FieldIndexEnum::Header], dataSize);
+		}
+
+		bool MessageValid(uint8_t* message, const uint16_t messageSize, const uint8_t address)
+		{
+			if (messageSize < (uint8_t)MessageDefinition::FieldIndexEnum::Header)
+			{
+				return 0;
+			}
+
+			const uint16_t dataSize = messageSize - (uint8_t)MessageDefinition::FieldIndexEnum::Header;
+
+			return GetMessageCrc(message) == Crc.GetCrc(address, &message[(uint8_t)MessageDefinition::FieldIndexEnum::Header], dataSize);
+		}
+
+		/// <summary>
+		/// Compile-time sized EncodeMessageAndCrcInPlace.
+		/// </summary>
+		/// <returns>Encoded buffer size.</returns>
+		template<uint8_t PayloadSize>
+		uint8_t EncodeMessageAndCrcInPlace(uint8_t* message)
+		{
+			static_assert(PayloadSize <= PayloadSizeMax, "Payload too large for codec.");
+
+			static constexpr uint8_t messageSize = MessageDefinition::GetMessageSize(PayloadSize);
+			static constexpr uint8_t dataSize = messageSize - (uint8_t)MessageDefinition::FieldIndexEnum::Header;
+
+			if (ParitySize > 0)
+			{
+				return EncodeMessageAndCrcInPlace(message, messageSize);
+			}
+
+			const uint16_t crc = Crc.template GetCrc<dataSize>(&message[(uint8_t)MessageDefinition::FieldIndexEnum::Header]);
+
+			memcpy(&Copy[uint8_t(MessageDefinition::FieldIndexEnum::Header)],
+				&message[uint8_t(MessageDefinition::FieldIndexEnum::Header)],
+				dataSize);
+			Copy[(uint8_t)MessageDefinition::FieldIndexEnum::Crc0] = (uint8_t)crc;
+			Copy[(uint8_t)MessageDefinition::FieldIndexEnum::Crc1] = (uint8_t)((crc >> 8) & UINT8_MAX);
+
+			return UartCobsCodec::EncodeFixed<messageSize>(Copy, message);
+		}
+
+		/// <summary>
+		/// Compile-time sized MessageValid.
+		/// </summary>
+		template<uint8_t PayloadSize>
+		bool MessageValid(const uint8_t* message)
+		{
+			static constexpr uint8_t dataSize = MessageDefinition::GetMessageSize(PayloadSize) - (uint8_t)MessageDefinition::FieldIndexEnum::Header;
+
+			const uint16_t crc = Crc.template GetCrc<dataSize>(&message[(uint8_t)MessageDefinition::FieldIndexEnum::Header]);
 			const uint16_t matchCrc = (uint16_t)message[(uint8_t)MessageDefinition::FieldIndexEnum::Crc0]
 				| (((uint16_t)message[(uint8_t)MessageDefinition::FieldIndexEnum::Crc1]) << 8);
 
 			return matchCrc == crc;
 		}
 
+		/// <summary>
+		/// Compile-time sized DecodeMessageInPlaceIfValid.
+		/// The buffer must hold MessageDefinition::GetBufferSizeFromPayload(PayloadSize) + ParitySize bytes.
+		/// </summary>
+		template<uint8_t PayloadSize>
+		bool DecodeMessageInPlaceIfValid(uint8_t* buffer)
+		{
+			static_assert(PayloadSize <= PayloadSizeMax, "Payload too large for codec.");
+
+			static constexpr uint8_t messageSize = MessageDefinition::GetMessageSize(PayloadSize);
+
+			if (ParitySize > 0)
+			{
+				return DecodeMessageInPlaceIfValid(buffer, UartCobsCodec::GetBufferSize(messageSize + ParitySize));
+			}
+
+			return UartCobsCodec::DecodeFixed<messageSize>(buffer, buffer) == messageSize
+				&& MessageValid<PayloadSize>(buffer);
+		}
+
 		bool DecodeMessageInPlaceIfValid(uint8_t* buffer, const uint16_t bufferSize)
 		{
-			const uint16_t messageSize = UartCobsCodec::GetDataSize(bufferSize);
+			const uint16_t messageSize = DecodeAndCorrectInPlace(buffer, bufferSize);
+
+			return messageSize > 0
+				&& MessageValid(buffer, messageSize);
+		}
+
+		/// <summary>
+		/// DecodeMessageInPlaceIfValid for an addressed frame, the buffer holds the encoded message without the address.
+		/// </summary>
+		bool DecodeMessageInPlaceIfValid(uint8_t* buffer, const uint16_t bufferSize, const uint8_t address)
+		{
+			const uint16_t messageSize = DecodeAndCorrectInPlace(buffer, bufferSize);
 
-			if (messageSize >= MessageDefinition::MessageSizeMin
-				&& UartCobsCodec::DecodeInPlace(buffer, bufferSize) == messageSize)
+			return messageSize > 0
+				&& MessageValid(buffer, messageSize, address);
+		}
+
+	private:
+		/// <summary>
+		/// COBS decodes, and corrects byte errors with the parity.
+		/// </summary>
+		/// <returns>Message size, 0 if invalid.</returns>
+		uint16_t DecodeAndCorrectInPlace(uint8_t* buffer, const uint16_t bufferSize)
+		{
+			const uint16_t codedSize = UartCobsCodec::GetDataSize(bufferSize);
+
+			if (codedSize < (uint16_t)MessageDefinition::MessageSizeMin + ParitySize)
+			{
+				return 0;
+			}
+
+			if (ParitySize == 0)
+			{
+				return (UartCobsCodec::DecodeInPlace(buffer, bufferSize) == codedSize) * codedSize;
+			}
+
+			// Misplaced delimiters are byte errors too.
+			UartCobsCodec::DecodeLenient(buffer, buffer, bufferSize);
+
+			return Fec.Decode(buffer, codedSize) * (codedSize - ParitySize);
+		}
+
+		static uint16_t GetMessageCrc(const uint8_t* message)
+		{
+			return (uint16_t)message[(uint8_t)MessageDefinition::FieldIndexEnum::Crc0]
+				| (((uint16_t)message[(uint8_t)MessageDefinition::FieldIndexEnum::Crc1]) << 8);
+		}
+
+		uint16_t PrepareWithCrc(uint8_t* message, const uint16_t messageSize, const uint16_t crc)
+		{
+			const uint16_t codedSize = messageSize + ParitySize;
+
+			if (codedSize > UartCobsCodec::DataSizeMax)
+			{
+				return 0;
+			}
+
+			message[(uint8_t)MessageDefinition::FieldIndexEnum::Crc0] = (uint8_t)crc;
+			message[(uint8_t)MessageDefinition::FieldIndexEnum::Crc1] = (uint8_t)((crc >> 8) & UINT8_MAX);
+
+			Fec.Encode(message, messageSize, &message[messageSize]);
+
+			return codedSize;
+		}
+
+		uint16_t EncodeWithCrc(uint8_t* message, const uint16_t messageSize, const uint16_t crc)
+		{
+			const uint16_t dataSize = messageSize - (uint8_t)MessageDefinition::FieldIndexEnum::Header;
+
+			if (dataSize > 0)
 			{
-				return MessageValid(buffer, messageSize);
+				memcpy(&Copy[uint8_t(MessageDefinition::FieldIndexEnum::Header)],
+					&message[uint8_t(MessageDefinition::FieldIndexEnum::Header)],
+					dataSize);
+			}
+			Copy[(uint8_t)MessageDefinition::FieldIndexEnum::Crc0] = (uint8_t)crc;
+			Copy[(uint8_t)MessageDefinition::FieldIndexEnum::Crc1] = (uint8_t)((crc >> 8) & UINT8_MAX);
+
+			const uint16_t codedSize = messageSize + ParitySize;
+			const uint16_t outSize = UartCobsCodec::GetBufferSize(codedSize);
+
+			Fec.Encode(Copy, messageSize, &Copy[messageSize]);
+
+			if (UartCobsCodec::Encode(Copy, message, codedSize) == outSize)
+			{
+				return outSize;
 			}
 			else
 			{
-				return false;
+				return 0;
 			}
 		}
 	};
+
+	/// <summary>
+	/// Message codec for a single, compile-time payload size.
+	/// Loop bounds and buffer sizes are constants, so the compiler can unroll and fold the size checks.
+	/// </summary>
+	template<uint8_t PayloadSize>
+	class FixedMessageCodec
+	{
+	private:
+		using MessageDefinition = UartInterface::MessageDefinition;
+
+	public:
+		static constexpr uint8_t MessageSize = MessageDefinition::GetMessageSize(PayloadSize);
+		static constexpr uint8_t BufferSize = MessageDefinition::GetBufferSizeFromPayload(PayloadSize);
+
+	private:
+		MessageCodec<PayloadSize> Codec;
+
+	public:
+		FixedMessageCodec(const uint8_t* key, const uint8_t keySize)
+			: Codec(key, keySize)
+		{
+		}
+
+		bool Setup()
+		{
+			return Codec.Setup();
+		}
+
+		/// <summary>
+		/// Encodes header and payload in place, the message must have room for BufferSize bytes.
+		/// </summary>
+		/// <returns>BufferSize.</returns>
+		uint8_t EncodeMessageAndCrcInPlace(uint8_t* message)
+		{
+			return Codec.template EncodeMessageAndCrcInPlace<PayloadSize>(message);
+		}
+
+		bool MessageValid(const uint8_t* message)
+		{
+			return Codec.template MessageValid<PayloadSize>(message);
+		}
+
+		bool DecodeMessageInPlaceIfValid(uint8_t* buffer)
+		{
+			return Codec.template DecodeMessageInPlaceIfValid<PayloadSize>(buffer);
+		}
+	};
 }
 #endif
\ No newline at end of file
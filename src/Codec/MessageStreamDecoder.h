@@ -0,0 +1,301 @@
+#ifndef _UART_INTERFACE_MESSAGE_STREAM_DECODER_h
+#define _UART_INTERFACE_MESSAGE_STREAM_DECODER_h
+
+#include <string.h>
+
+#include "MessageCodec.h"
+
+namespace UartInterface
+{
+	enum class StreamStatusEnum : uint8_t
+	{
+		Valid,
+		Crc,
+		TooShort,
+		TooLong,
+		Truncated
+	};
+
+	/// <summary>
+	/// A frame found in the stream.
+	/// Payload points into the caller's chunk (decoded in place), or into the decoder for a frame split across chunks.
+	/// It is only valid until the next Next()/Feed() call.
+	/// </summary>
+	struct StreamRecord
+	{
+		uint64_t Offset;
+		const uint8_t* Payload;
+		uint8_t PayloadSize;
+		uint8_t Header;
+		StreamStatusEnum Status;
+	};
+
+	struct StreamStats
+	{
+		uint64_t Bytes = 0;
+		uint32_t Valid = 0;
+		uint32_t Crc = 0;
+		uint32_t TooShort = 0;
+		uint32_t TooLong = 0;
+		uint32_t Truncated = 0;
+	};
+
+	/// <summary>
+	/// Bulk decoder for large streams of 0x00 delimited frames, e.g. captures and logs.
+	/// Delimiters are found with memchr (vectorized by the C library on hosts), and each frame is decoded and validated in place.
+	/// Chunks may split frames anywhere: the partial tail is carried over to the next chunk.
+	/// Empty frames (back to back delimiters) are skipped, as on the wire.
+	/// </summary>
+	/// <typeparam name="PayloadSizeMax">Longer frames are reported TooLong.</typeparam>
+	template<uint8_t PayloadSizeMax = MessageDefinition::PayloadSizeMax>
+	class MessageStreamDecoder
+	{
+	private:
+		using MessageDefinition = UartInterface::MessageDefinition;
+
+		static constexpr uint16_t FrameSizeMax = MessageDefinition::GetBufferSizeFromPayload(PayloadSizeMax);
+
+	private:
+		MessageCodec<PayloadSizeMax> Codec;
+
+		StreamStats Stats{};
+
+		uint8_t* Chunk = nullptr;
+		size_t ChunkSize = 0;
+		size_t ChunkIndex = 0;
+		uint64_t ChunkOffset = 0;
+
+		// Partial frame carried over from the previous chunk.
+		uint8_t Carry[FrameSizeMax]{};
+		uint64_t CarryOffset = 0;
+		uint16_t CarrySize = 0;
+		bool CarryTooLong = false;
+
+	public:
+		MessageStreamDecoder(const uint8_t* key, const uint8_t keySize)
+			: Codec(key, keySize)
+		{
+		}
+
+		bool Setup()
+		{
+			return Codec.Setup();
+		}
+
+		/// <summary>
+		/// Restarts at stream offset 0, dropping any carried partial frame.
+		/// </summary>
+		void Clear()
+		{
+			Stats = StreamStats{};
+			Chunk = nullptr;
+			ChunkSize = 0;
+			ChunkIndex = 0;
+			ChunkOffset = 0;
+			CarrySize = 0;
+			CarryTooLong = false;
+		}
+
+		const StreamStats& GetStats() const
+		{
+			return Stats;
+		}
+
+		/// <summary>
+		/// Sets the next chunk of the stream, for Next(), once the previous one is exhausted.
+		/// The chunk is modified by in place decoding.
+		/// </summary>
+		void SetChunk(uint8_t* chunk, const size_t chunkSize)
+		{
+			ChunkOffset += ChunkSize;
+			Chunk = chunk;
+			ChunkSize = chunkSize;
+			ChunkIndex = 0;
+			Stats.Bytes += chunkSize;
+		}
+
+		/// <summary>
+		/// Next complete frame in the current chunk.
+		/// </summary>
+		/// <returns>False when the chunk is exhausted, its partial tail is carried over.</returns>
+		bool Next(StreamRecord& record)
+		{
+			while (ChunkIndex < ChunkSize)
+			{
+				uint8_t* start = &Chunk[ChunkIndex];
+				const size_t remaining = ChunkSize - ChunkIndex;
+				uint8_t* delimiter = (uint8_t*)memchr(start, MessageDefinition::Delimiter, remaining);
+
+				if (delimiter == nullptr)
+				{
+					AppendCarry(start, remaining);
+					ChunkIndex = ChunkSize;
+
+					return false;
+				}
+
+				const size_t size = (size_t)(delimiter - start);
+				const uint64_t offset = ChunkOffset + ChunkIndex;
+				ChunkIndex += size + 1;
+
+				if (CarrySize > 0 || CarryTooLong)
+				{
+					// Completes the frame started in a previous chunk.
+					AppendCarry(start, size);
+					const bool tooLong = CarryTooLong;
+					const uint16_t carrySize = CarrySize;
+					CarrySize = 0;
+					CarryTooLong = false;
+					if (tooLong)
+					{
+						return Report(record, CarryOffset, StreamStatusEnum::TooLong);
+					}
+
+					return DecodeFrame(record, Carry, carrySize, CarryOffset);
+				}
+				else if (size > 0)
+				{
+					if (size > FrameSizeMax)
+					{
+						return Report(record, offset, StreamStatusEnum::TooLong);
+					}
+
+					return DecodeFrame(record, start, (uint16_t)size, offset);
+				}
+			}
+
+			return false;
+		}
+
+		/// <summary>
+		/// Ends the stream, a carried partial frame is reported Truncated.
+		/// </summary>
+		bool Finish(StreamRecord& record)
+		{
+			ChunkOffset += ChunkSize;
+			ChunkIndex = 0;
+			ChunkSize = 0;
+
+			if (CarrySize > 0 || CarryTooLong)
+			{
+				CarrySize = 0;
+				CarryTooLong = false;
+
+				return Report(record, CarryOffset, StreamStatusEnum::Truncated);
+			}
+
+			return false;
+		}
+
+		/// <summary>
+		/// Decodes a whole chunk, handler(const StreamRecord&) is called for each frame.
+		/// </summary>
+		/// <returns>Frames reported.</returns>
+		template<typename HandlerType>
+		uint32_t Feed(uint8_t* chunk, const size_t chunkSize, HandlerType&& handler)
+		{
+			SetChunk(chunk, chunkSize);
+
+			StreamRecord record;
+			uint32_t count = 0;
+			while (Next(record))
+			{
+				handler(record);
+				count++;
+			}
+
+			return count;
+		}
+
+		template<typename HandlerType>
+		uint32_t Finish(HandlerType&& handler)
+		{
+			StreamRecord record;
+			if (Finish(record))
+			{
+				handler(record);
+
+				return 1;
+			}
+
+			return 0;
+		}
+
+	private:
+		void AppendCarry(const uint8_t* data, const size_t size)
+		{
+			if (CarrySize == 0 && !CarryTooLong)
+			{
+				CarryOffset = ChunkOffset + ChunkIndex;
+			}
+
+			if (CarryTooLong
+				|| size > (size_t)(FrameSizeMax - CarrySize))
+			{
+				CarryTooLong = true;
+				CarrySize = 0;
+			}
+			else
+			{
+				memcpy(&Carry[CarrySize], data, size);
+				CarrySize += (uint16_t)size;
+			}
+		}
+
+		bool DecodeFrame(StreamRecord& record, uint8_t* frame, const uint16_t size, const uint64_t offset)
+		{
+			if (size < MessageDefinition::MessageSizeMin)
+			{
+				return Report(record, offset, StreamStatusEnum::TooShort);
+			}
+
+			if (!Codec.DecodeMessageInPlaceIfValid(frame, size))
+			{
+				return Report(record, offset, StreamStatusEnum::Crc);
+			}
+
+			const uint8_t messageSize = (uint8_t)UartCobsCodec::GetDataSize(size);
+			record.Header = frame[(uint8_t)MessageDefinition::FieldIndexEnum::Header];
+			record.Payload = &frame[(uint8_t)MessageDefinition::FieldIndexEnum::Payload];
+			record.PayloadSize = MessageDefinition::GetPayloadSize(messageSize);
+
+			return Report(record, offset, StreamStatusEnum::Valid);
+		}
+
+		bool Report(StreamRecord& record, const uint64_t offset, const StreamStatusEnum status)
+		{
+			record.Offset = offset;
+			record.Status = status;
+
+			switch (status)
+			{
+			case StreamStatusEnum::Valid:
+				Stats.Valid++;
+				break;
+			case StreamStatusEnum::Crc:
+				Stats.Crc++;
+				break;
+			case StreamStatusEnum::TooShort:
+				Stats.TooShort++;
+				break;
+			case StreamStatusEnum::TooLong:
+				Stats.TooLong++;
+				break;
+			case StreamStatusEnum::Truncated:
+			default:
+				Stats.Truncated++;
+				break;
+			}
+
+			if (status != StreamStatusEnum::Valid)
+			{
+				record.Header = 0;
+				record.Payload = nullptr;
+				record.PayloadSize = 0;
+			}
+
+			return true;
+		}
+	};
+}
+#endif
@@ -0,0 +1,88 @@
+#ifndef _UART_INTERFACE_PRE_ENCODED_FRAME_h
+#define _UART_INTERFACE_PRE_ENCODED_FRAME_h
+
+#include "UartCobsCodec.h"
+#include "KeyedCrc.h"
+#include "../Model/UartInterface.h"
+
+namespace UartInterface
+{
+	namespace PreEncoded
+	{
+		template<uint8_t... Indexes>
+		struct IndexSequence {};
+
+		template<uint8_t Count, uint8_t... Indexes>
+		struct MakeIndexSequence : MakeIndexSequence<Count - 1, Count - 1, Indexes...> {};
+
+		template<uint8_t... Indexes>
+		struct MakeIndexSequence<0, Indexes...>
+		{
+			using Type = IndexSequence<Indexes...>;
+		};
+
+		/// <summary>
+		/// COBS encoded Message, built at compile-time.
+		/// </summary>
+		template<typename MessageType, typename Sequence>
+		struct EncodedBuffer;
+
+		template<typename MessageType, uint8_t... Indexes>
+		struct EncodedBuffer<MessageType, IndexSequence<Indexes...>>
+		{
+			static constexpr uint8_t Data[sizeof...(Indexes)]{ UartCobsCodec::GetStaticEncoded(MessageType::Data, sizeof(MessageType::Data), Indexes)... };
+		};
+
+		template<typename MessageType, uint8_t... Indexes>
+		constexpr uint8_t EncodedBuffer<MessageType, IndexSequence<Indexes...>>::Data[sizeof...(Indexes)];
+
+		/// <summary>
+		/// Header and payload, as covered by the CRC.
+		/// </summary>
+		template<uint8_t Header, uint8_t... Payload>
+		struct MessageContent
+		{
+			static constexpr uint8_t Data[1 + sizeof...(Payload)]{ Header, Payload... };
+		};
+
+		template<uint8_t Header, uint8_t... Payload>
+		constexpr uint8_t MessageContent<Header, Payload...>::Data[1 + sizeof...(Payload)];
+
+		template<const uint8_t* Key, uint8_t KeySize, uint8_t Header, uint8_t... Payload>
+		struct MessageWithCrc
+		{
+			static constexpr uint16_t Crc = KeyedCrc::GetStaticCrc(Key, KeySize,
+				MessageContent<Header, Payload...>::Data, sizeof(MessageContent<Header, Payload...>::Data));
+
+			static constexpr uint8_t Data[MessageDefinition::MessageSizeMin + sizeof...(Payload)]{ (uint8_t)Crc, (uint8_t)(Crc >> 8), Header, Payload... };
+		};
+
+		template<const uint8_t* Key, uint8_t KeySize, uint8_t Header, uint8_t... Payload>
+		constexpr uint8_t MessageWithCrc<Key, KeySize, Header, Payload...>::Data[MessageDefinition::MessageSizeMin + sizeof...(Payload)];
+	}
+
+	/// <summary>
+	/// Constant message, CRC'd and COBS encoded at compile-time into rodata (RAM on AVR).
+	/// Same bytes as MessageCodec::EncodeMessageAndCrcInPlace() with the same key, ready for SendPreEncoded().
+	/// The key must be a constant array with linkage, e.g. a namespace scope static constexpr.
+	/// Not for Addressed definitions, the address is bound into the CRC at send time.
+	/// </summary>
+	template<const uint8_t* Key, uint8_t KeySize, uint8_t Header, uint8_t... Payload>
+	struct PreEncodedFrame
+	{
+		static_assert(sizeof...(Payload) <= MessageDefinition::PayloadSizeMax, "Payload too large.");
+
+		using MessageType = PreEncoded::MessageWithCrc<Key, KeySize, Header, Payload...>;
+
+		static constexpr uint8_t PayloadSize = sizeof...(Payload);
+		static constexpr uint8_t BufferSize = MessageDefinition::GetBufferSizeFromPayload(PayloadSize);
+
+		using BufferType = PreEncoded::EncodedBuffer<MessageType, typename PreEncoded::MakeIndexSequence<BufferSize>::Type>;
+
+		static constexpr const uint8_t* GetBuffer()
+		{
+			return BufferType::Data;
+		}
+	};
+}
+#endif
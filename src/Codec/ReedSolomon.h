@@ -0,0 +1,377 @@
+#ifndef _UART_INTERFACE_REED_SOLOMON_h
+#define _UART_INTERFACE_REED_SOLOMON_h
+
+#include <stdint.h>
+#include <string.h>
+
+namespace UartInterface
+{
+	/// <summary>
+	/// GF(2^8) arithmetic, primitive polynomial x^8 + x^4 + x^3 + x^2 + 1 (0x11D), generator 2.
+	/// Log and exp tables (768 bytes) are built once in Setup(), and shared by every codec.
+	/// </summary>
+	template<typename Dummy = void>
+	class TemplateGaloisField
+	{
+	private:
+		static constexpr uint16_t Primitive = 0x11D;
+
+		static uint8_t Exp[512];
+		static uint8_t Log[256];
+		static bool Ready;
+
+	public:
+		static void Setup()
+		{
+			if (Ready)
+			{
+				return;
+			}
+
+			uint16_t value = 1;
+			for (uint16_t i = 0; i < 255; i++)
+			{
+				Exp[i] = (uint8_t)value;
+				Log[value] = (uint8_t)i;
+				value <<= 1;
+				if (value & 0x100)
+				{
+					value ^= Primitive;
+				}
+			}
+
+			// Doubled, so products index without a modulo.
+			for (uint16_t i = 255; i < 512; i++)
+			{
+				Exp[i] = Exp[i - 255];
+			}
+			Log[0] = 0;
+			Ready = true;
+		}
+
+		static uint8_t Multiply(const uint8_t a, const uint8_t b)
+		{
+			return (a == 0 || b == 0) ? 0 : Exp[Log[a] + Log[b]];
+		}
+
+		/// <summary>
+		/// b must not be 0.
+		/// </summary>
+		static uint8_t Divide(const uint8_t a, const uint8_t b)
+		{
+			return (a == 0) ? 0 : Exp[Log[a] + 255 - Log[b]];
+		}
+
+		/// <summary>
+		/// Generator to the power, power in 0-254.
+		/// </summary>
+		static uint8_t Power(const uint8_t power)
+		{
+			return Exp[power];
+		}
+
+		static uint8_t Inverse(const uint8_t a)
+		{
+			return Exp[255 - Log[a]];
+		}
+	};
+
+	template<typename Dummy>
+	uint8_t TemplateGaloisField<Dummy>::Exp[512]{};
+
+	template<typename Dummy>
+	uint8_t TemplateGaloisField<Dummy>::Log[256]{};
+
+	template<typename Dummy>
+	bool TemplateGaloisField<Dummy>::Ready = false;
+
+	using GaloisField = TemplateGaloisField<>;
+
+	struct FecStats
+	{
+		/// <summary>
+		/// Frames with byte errors, all corrected.
+		/// </summary>
+		uint32_t CorrectedFrames = 0;
+		uint32_t CorrectedBytes = 0;
+
+		/// <summary>
+		/// Frames with more byte errors than the code can correct (when detected).
+		/// </summary>
+		uint32_t Uncorrectable = 0;
+	};
+
+	/// <summary>
+	/// Systematic, shortened Reed-Solomon code over GF(2^8), table-driven.
+	/// ParitySize bytes are appended to up to 255 - ParitySize data bytes,
+	///  and up to ParitySize / 2 byte errors anywhere in the codeword are corrected.
+	/// Decoding: syndromes, Berlekamp-Massey, Chien search and Forney, in place.
+	/// More errors than that are mostly detected, or miscorrected: an integrity check must follow.
+	/// </summary>
+	template<uint8_t ParitySize>
+	class ReedSolomon
+	{
+	public:
+		static constexpr uint8_t CorrectableErrors = ParitySize / 2;
+
+	private:
+		static_assert(ParitySize >= 2 && ParitySize <= 32 && (ParitySize % 2) == 0, "Even parity size, 2 to 32.");
+
+		using Field = GaloisField;
+
+	private:
+		/// <summary>
+		/// Generator polynomial (x - 2^0)...(x - 2^(ParitySize-1)), highest degree first, leading 1 implied.
+		/// </summary>
+		uint8_t Generator[ParitySize]{};
+
+		FecStats Stats{};
+
+	public:
+		bool Setup()
+		{
+			Field::Setup();
+
+			// Lowest degree first while building, starting from 1.
+			uint8_t poly[ParitySize + 1]{};
+			poly[0] = 1;
+			for (uint8_t i = 0; i < ParitySize; i++)
+			{
+				const uint8_t root = Field::Power(i);
+				for (uint8_t j = i + 1; j > 0; j--)
+				{
+					poly[j] = poly[j - 1] ^ Field::Multiply(poly[j], root);
+				}
+				poly[0] = Field::Multiply(poly[0], root);
+			}
+
+			for (uint8_t i = 0; i < ParitySize; i++)
+			{
+				Generator[i] = poly[ParitySize - 1 - i];
+			}
+
+			return true;
+		}
+
+		const FecStats& GetStats() const
+		{
+			return Stats;
+		}
+
+		void ClearStats()
+		{
+			Stats = FecStats{};
+		}
+
+		/// <summary>
+		/// Computes the parity of data, into parity[ParitySize].
+		/// </summary>
+		void Encode(const uint8_t* data, const uint8_t dataSize, uint8_t* parity) const
+		{
+			memset(parity, 0, ParitySize);
+			for (uint8_t i = 0; i < dataSize; i++)
+			{
+				const uint8_t feedback = data[i] ^ parity[0];
+				for (uint8_t j = 0; j < ParitySize - 1; j++)
+				{
+					parity[j] = parity[j + 1] ^ Field::Multiply(Generator[j], feedback);
+				}
+				parity[ParitySize - 1] = Field::Multiply(Generator[ParitySize - 1], feedback);
+			}
+		}
+
+		/// <summary>
+		/// Corrects a codeword (data followed by its parity) in place.
+		/// </summary>
+		/// <returns>False if uncorrectable.</returns>
+		bool Decode(uint8_t* codeword, const uint8_t codewordSize)
+		{
+			if (codewordSize <= ParitySize)
+			{
+				return false;
+			}
+
+			// Syndromes, codeword evaluated at each generator root.
+			uint8_t syndromes[ParitySize];
+			bool clean = true;
+			for (uint8_t i = 0; i < ParitySize; i++)
+			{
+				const uint8_t root = Field::Power(i);
+				uint8_t value = 0;
+				for (uint8_t j = 0; j < codewordSize; j++)
+				{
+					value = Field::Multiply(value, root) ^ codeword[j];
+				}
+				syndromes[i] = value;
+				clean &= (value == 0);
+			}
+
+			if (clean)
+			{
+				return true;
+			}
+
+			// Berlekamp-Massey error locator, lowest degree first.
+			uint8_t locator[ParitySize + 1]{};
+			uint8_t previous[ParitySize + 1]{};
+			uint8_t scratch[ParitySize + 1];
+			locator[0] = 1;
+			previous[0] = 1;
+			uint8_t errorCount = 0;
+			uint8_t shift = 1;
+			uint8_t previousDiscrepancy = 1;
+			for (uint8_t n = 0; n < ParitySize; n++)
+			{
+				uint8_t discrepancy = syndromes[n];
+				for (uint8_t i = 1; i <= errorCount; i++)
+				{
+					discrepancy ^= Field::Multiply(locator[i], syndromes[n - i]);
+				}
+
+				if (discrepancy == 0)
+				{
+					shift++;
+					continue;
+				}
+
+				const uint8_t scale = Field::Divide(discrepancy, previousDiscrepancy);
+				if (2 * errorCount <= n)
+				{
+					memcpy(scratch, locator, sizeof(scratch));
+					AddScaledShifted(locator, previous, scale, shift);
+					errorCount = n + 1 - errorCount;
+					memcpy(previous, scratch, sizeof(previous));
+					previousDiscrepancy = discrepancy;
+					shift = 1;
+				}
+				else
+				{
+					AddScaledShifted(locator, previous, scale, shift);
+					shift++;
+				}
+			}
+
+			if (errorCount > CorrectableErrors)
+			{
+				Stats.Uncorrectable++;
+
+				return false;
+			}
+
+			// Error evaluator, syndromes times locator, mod x^ParitySize.
+			uint8_t evaluator[ParitySize]{};
+			for (uint8_t i = 0; i < ParitySize; i++)
+			{
+				for (uint8_t j = 0; j <= i && j <= errorCount; j++)
+				{
+					evaluator[i] ^= Field::Multiply(locator[j], syndromes[i - j]);
+				}
+			}
+
+			// Chien search over the (shortened) codeword, with Forney's magnitudes.
+			uint8_t found = 0;
+			for (uint8_t index = 0; index < codewordSize; index++)
+			{
+				const uint8_t degree = codewordSize - 1 - index;
+				const uint8_t inverse = Field::Power((uint8_t)((255 - degree) % 255));
+
+				if (Evaluate(locator, errorCount + 1, inverse) != 0)
+				{
+					continue;
+				}
+
+				// Formal derivative, only odd terms remain.
+				uint8_t derivative = 0;
+				uint8_t inversePower = 1;
+				for (uint8_t i = 1; i <= errorCount; i += 2)
+				{
+					derivative ^= Field::Multiply(locator[i], inversePower);
+					inversePower = Field::Multiply(inversePower, Field::Multiply(inverse, inverse));
+				}
+
+				if (derivative == 0)
+				{
+					break;
+				}
+
+				const uint8_t magnitude = Field::Multiply(Field::Power(degree),
+					Field::Divide(Evaluate(evaluator, ParitySize, inverse), derivative));
+				codeword[index] ^= magnitude;
+				found++;
+			}
+
+			if (found != errorCount)
+			{
+				// Roots outside the shortened codeword, too many errors.
+				Stats.Uncorrectable++;
+
+				return false;
+			}
+
+			Stats.CorrectedFrames++;
+			Stats.CorrectedBytes += found;
+
+			return true;
+		}
+
+	private:
+		/// <summary>
+		/// poly += scale * x^shift * other, lowest degree first.
+		/// </summary>
+		static void AddScaledShifted(uint8_t* poly, const uint8_t* other, const uint8_t scale, const uint8_t shift)
+		{
+			for (uint8_t i = 0; i + shift <= ParitySize; i++)
+			{
+				poly[i + shift] ^= Field::Multiply(scale, other[i]);
+			}
+		}
+
+		/// <summary>
+		/// Polynomial value at x, lowest degree first.
+		/// </summary>
+		static uint8_t Evaluate(const uint8_t* poly, const uint8_t size, const uint8_t x)
+		{
+			uint8_t value = 0;
+			for (uint8_t i = size; i > 0; i--)
+			{
+				value = Field::Multiply(value, x) ^ poly[i - 1];
+			}
+
+			return value;
+		}
+	};
+
+	/// <summary>
+	/// No FEC, nothing is appended or corrected.
+	/// </summary>
+	template<>
+	class ReedSolomon<0>
+	{
+	public:
+		static constexpr uint8_t CorrectableErrors = 0;
+
+	private:
+		FecStats Stats{};
+
+	public:
+		bool Setup()
+		{
+			return true;
+		}
+
+		const FecStats& GetStats() const
+		{
+			return Stats;
+		}
+
+		void ClearStats() {}
+
+		void Encode(const uint8_t*, const uint8_t, uint8_t*) const {}
+
+		bool Decode(uint8_t*, const uint8_t)
+		{
+			return true;
+		}
+	};
+}
+#endif
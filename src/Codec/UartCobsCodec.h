@@ -2,6 +2,7 @@
 #define _UART_COBS_CODEC_h
 
 #include <stdint.h>
+#include <string.h>
 
 namespace UartCobsCodec
 {
@@ -25,6 +26,26 @@ namespace UartCobsCodec
 		return uint8_t(bufferSize <= (DataSizeMax + 1)) * (bufferSize - 1);
 	}
 
+	/// <summary>
+	/// Non-delimiter bytes from index on, plus 1: the COBS code for a block starting at index.
+	/// </summary>
+	static constexpr uint8_t GetStaticCode(const uint8_t* data, const uint8_t size, const uint8_t index)
+	{
+		return (index >= size || data[index] == Codes::Delimiter) ? Codes::EndReplacement
+			: (uint8_t)(1 + GetStaticCode(data, size, index + 1));
+	}
+
+	/// <summary>
+	/// Compile-time Encode, one encoded byte at a time.
+	/// As with EncodeFixed, size never reaches Codes::MaxCode.
+	/// </summary>
+	/// <param name="index">Encoded byte index, 0 to size.</param>
+	static constexpr uint8_t GetStaticEncoded(const uint8_t* data, const uint8_t size, const uint8_t index)
+	{
+		return (index == 0 || data[index - 1] == Codes::Delimiter) ? GetStaticCode(data, size, index)
+			: data[index - 1];
+	}
+
 	static uint8_t Encode(const uint8_t* buffer, uint8_t* encodedBuffer, const uint8_t size)
 	{
 		uint8_t read_index = 0;
@@ -82,7 +103,7 @@ namespace UartCobsCodec
 			const uint8_t chunk = code - Codes::EndReplacement;
 			if (chunk <= size - read_index)
 			{
-				memcpy(&decodedBuffer[write_index], &buffer[read_index], chunk);
+				memmove(&decodedBuffer[write_index], &buffer[read_index], chunk);
 				write_index += chunk;
 				read_index += chunk;
 			}
@@ -100,6 +121,99 @@ namespace UartCobsCodec
 	{
 		return Decode(buffer, buffer, size);
 	}
+
+	/// <summary>
+	/// Compile-time sized Encode.
+	/// Size never reaches Codes::MaxCode, so each data byte lands 1 byte ahead.
+	/// </summary>
+	template<uint8_t Size>
+	static uint8_t EncodeFixed(const uint8_t* buffer, uint8_t* encodedBuffer)
+	{
+		static_assert(Size > 0 && Size <= DataSizeMax, "Invalid COBS data size.");
+
+		uint8_t code_index = 0;
+		uint8_t code = Codes::EndReplacement;
+
+		for (uint8_t i = 0; i < Size; i++)
+		{
+			if (buffer[i] == Codes::Delimiter)
+			{
+				encodedBuffer[code_index] = code;
+				code = Codes::EndReplacement;
+				code_index = i + 1;
+			}
+			else
+			{
+				encodedBuffer[i + 1] = buffer[i];
+				code++;
+			}
+		}
+
+		encodedBuffer[code_index] = code;
+
+		return Size + 1;
+	}
+
+	/// <summary>
+	/// Compile-time sized Decode, from Size + 1 encoded bytes.
+	/// Safe in place, each decoded byte lands 1 byte behind.
+	/// </summary>
+	/// <returns>Size if valid, 0 otherwise.</returns>
+	template<uint8_t Size>
+	static uint8_t DecodeFixed(const uint8_t* encodedBuffer, uint8_t* decodedBuffer)
+	{
+		static_assert(Size > 0 && Size <= DataSizeMax, "Invalid COBS data size.");
+
+		uint16_t code_index = encodedBuffer[0];
+
+		for (uint8_t i = 1; i <= Size; i++)
+		{
+			const uint8_t value = encodedBuffer[i];
+			if (i == code_index)
+			{
+				decodedBuffer[i - 1] = Codes::Delimiter;
+				code_index = i + value;
+			}
+			else
+			{
+				decodedBuffer[i - 1] = value;
+			}
+		}
+
+		return (code_index == (uint16_t)Size + 1) * Size;
+	}
+
+	/// <summary>
+	/// DecodeFixed with a runtime size, that never fails.
+	/// A corrupted code only misplaces delimiters in the output, as byte errors for a forward error correction to repair.
+	/// Safe in place, each decoded byte lands 1 byte behind.
+	/// </summary>
+	/// <returns>Decoded size, size - 1.</returns>
+	static uint8_t DecodeLenient(const uint8_t* encodedBuffer, uint8_t* decodedBuffer, const uint8_t size)
+	{
+		if (size == 0)
+		{
+			return 0;
+		}
+
+		uint16_t code_index = encodedBuffer[0];
+
+		for (uint8_t i = 1; i < size; i++)
+		{
+			const uint8_t value = encodedBuffer[i];
+			if (i == code_index)
+			{
+				decodedBuffer[i - 1] = Codes::Delimiter;
+				code_index = i + value;
+			}
+			else
+			{
+				decodedBuffer[i - 1] = value;
+			}
+		}
+
+		return size - 1;
+	}
 };
 
 #endif
\ No newline at end of file
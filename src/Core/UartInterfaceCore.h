@@ -0,0 +1,1112 @@
+#ifndef _UART_INTERFACE_CORE_h
+#define _UART_INTERFACE_CORE_h
+
+#include <UartInterface.h>
+#include "UartOutCore.h"
+
+namespace UartInterface
+{
+	/// <summary>
+	/// Scheduler-agnostic protocol core: RX state machine, message encoding and the TX core.
+	/// The integrator calls PollRx()/PollTx() (or Poll()) with the current time,
+	///  and schedules the next call at the returned deadline, or on the next event.
+	/// With UartDefinitions::Addressed, frames for other nodes are skipped to the next delimiter as they stream in.
+	/// RX frames accumulate in a pool of UartDefinitions::RxPoolSize buffers, the listener may keep one with LeaseRx().
+	/// With UartDefinitions::RxBatchSize, the frames completed in one RX pass stay in the pool, and are delivered together at its end.
+	/// With UartDefinitions::EventDrivenIdle, IsRxPolling() turns false while the line is idle, until an event wakes it.
+	/// A FrameSink sees each frame's encoded bytes as they accumulate, and SendThrough() forwards them as they are.
+	/// </summary>
+	template<typename SerialType,
+		typename UartDefinitions = UartInterface::TemplateUartDefinitions<>>
+		class UartInterfaceCore
+	{
+	private:
+		using MessageDefinition = UartInterface::MessageDefinition;
+
+	private:
+		enum class StateEnum
+		{
+			Disabled,
+			WaitingForSerial,
+			PassiveWaitPoll,
+			ActiveWaitPoll,
+			Accumulating,
+			DeliveringMessage
+		};
+
+	public:
+		using UartOutCoreType = UartOut::UartOutCore<SerialType, UartDefinitions::MaxSerialStepOut, UartDefinitions::WriteTimeoutMillis>;
+
+		static constexpr uint8_t RxLeaseNone = UINT8_MAX;
+
+	private:
+		static constexpr size_t BufferSize = MessageDefinition::GetBufferSizeFromPayload(UartDefinitions::MaxPayloadSize) + UartDefinitions::FecParitySize;
+		static constexpr uint8_t AddressSize = UartDefinitions::Addressed ? MessageDefinition::AddressSize : 0;
+		static constexpr uint32_t PollPeriodMicros = UartDefinitions::PollPeriodMillis * 1000;
+		static constexpr uint32_t ReadTimeoutMicros = UartDefinitions::ReadTimeoutMillis * 1000;
+		static constexpr uint32_t IdleSafetyMicros = UartDefinitions::IdleSafetyMillis * 1000;
+
+		static_assert(UartDefinitions::RxPoolSize >= 1 && UartDefinitions::RxPoolSize <= 8, "1 to 8 RX pool buffers.");
+		static_assert(UartDefinitions::RxBatchSize <= UartDefinitions::RxPoolSize, "RX batch larger than the RX pool.");
+
+		UartOutCoreType UartWriter;
+
+		MessageCodec<(uint8_t)UartDefinitions::MaxPayloadSize, UartDefinitions::FecParitySize> Codec;
+
+	private:
+		SerialType& SerialInstance;
+		Transport::SpanReader<SerialType, UartDefinitions::MaxSerialStepIn> Reader;
+		UartListener* Listener;
+		WireTap* Tap = nullptr;
+		FrameSink* Sink = nullptr;
+
+	private:
+		/// <summary>
+		/// Out message, framed by a byte on each side for the delimiters, so the TX core can write it whole.
+		/// </summary>
+		UartOut::PaddedOutBuffer<BufferSize + AddressSize> OutFrame{};
+		uint8_t Pool[UartDefinitions::RxPoolSize][BufferSize]{};
+
+		/// <summary>
+		/// Frames completed in this RX pass, in Pool[0] to Pool[BatchCount - 1].
+		/// </summary>
+		RxFrame Batch[(UartDefinitions::RxBatchSize > 0) ? UartDefinitions::RxBatchSize : 1]{};
+		uint8_t BatchCount = 0;
+
+		/// <summary>
+		/// Pool buffer being accumulated, nullptr while every buffer is leased.
+		/// </summary>
+		uint8_t* InBuffer = Pool[0];
+
+		uint32_t PollStart = 0;
+		uint32_t LastIn = 0;
+		uint32_t Baudrate = UartDefinitions::Baudrate;
+		uint16_t InSize = 0;
+
+	private:
+		uint32_t SkippedCount = 0;
+		uint32_t RxByteCount = 0;
+		uint32_t PoolDropCount = 0;
+		uint32_t RxPollCount = 0;
+		uint8_t InIndex = 0;
+		uint8_t LeasedMask = 0;
+		bool Delivering = false;
+		uint8_t Address = MessageDefinition::AddressPromiscuous;
+		uint8_t InAddress = MessageDefinition::AddressBroadcast;
+		bool FrameStart = true;
+		bool SkipFrame = false;
+
+		/// <summary>
+		/// The frame being skipped was too long, rather than for another node.
+		/// </summary>
+		bool Oversized = false;
+
+		/// <summary>
+		/// The FrameSink has bytes of the current frame, and is owed its OnFrameEnd().
+		/// </summary>
+		bool SinkFrame = false;
+
+		/// <summary>
+		/// Event-driven idle, with no safety net: nothing to poll until woken.
+		/// </summary>
+		bool Sleeping = false;
+
+	private:
+		StateEnum State = StateEnum::Disabled;
+
+	public:
+		UartInterfaceCore(SerialType& serialInstance, UartListener* listener,
+			const uint8_t* key,
+			const uint8_t keySize)
+			: UartWriter(serialInstance, OutFrame, listener)
+			, Codec(key, keySize)
+			, SerialInstance(serialInstance)
+			, Reader(serialInstance)
+			, Listener(listener)
+		{
+		}
+
+		bool Setup()
+		{
+			return Codec.Setup() && UartWriter.Setup();
+		}
+
+		UartOutCoreType& GetWriter()
+		{
+			return UartWriter;
+		}
+
+		/// <summary>
+		/// This node's address, for Addressed definitions.
+		/// MessageDefinition::AddressPromiscuous accepts every frame.
+		/// </summary>
+		void SetAddress(const uint8_t address)
+		{
+			Address = address;
+		}
+
+		uint8_t GetAddress() const
+		{
+			return Address;
+		}
+
+		/// <summary>
+		/// Frames skipped for other nodes, since Start().
+		/// </summary>
+		uint32_t GetSkippedCount() const
+		{
+			return SkippedCount;
+		}
+
+		/// <summary>
+		/// Keeps the frame being delivered, only from within OnUartRx().
+		/// Its header and payload stay valid until ReleaseRx(), while the next frames accumulate in another pool buffer.
+		/// </summary>
+		/// <returns>Lease for ReleaseRx(), RxLeaseNone if refused (see UartDefinitions::RxPoolDropNewest).</returns>
+		uint8_t LeaseRx()
+		{
+			if (!Delivering
+				|| ((LeasedMask >> InIndex) & 1)
+				|| (!UartDefinitions::RxPoolDropNewest && GetRxPoolFree() <= 1))
+			{
+				return RxLeaseNone;
+			}
+
+			LeasedMask |= (uint8_t)(1 << InIndex);
+
+			return InIndex;
+		}
+
+		/// <summary>
+		/// Returns a leased buffer to the pool.
+		/// </summary>
+		void ReleaseRx(const uint8_t lease)
+		{
+			if (lease < UartDefinitions::RxPoolSize)
+			{
+				LeasedMask &= (uint8_t)~(1 << lease);
+
+				// Between frames, the next one gets the freed buffer.
+				if (InBuffer == nullptr
+					&& InSize == 0)
+				{
+					AcquireBuffer();
+				}
+			}
+		}
+
+		/// <summary>
+		/// Pool buffers not leased, including the one accumulating.
+		/// </summary>
+		uint8_t GetRxPoolFree() const
+		{
+			uint8_t free = 0;
+			for (uint8_t i = 0; i < UartDefinitions::RxPoolSize; i++)
+			{
+				free += ((LeasedMask >> i) & 1) ^ 1;
+			}
+
+			return free;
+		}
+
+		/// <summary>
+		/// Frames dropped while every pool buffer was leased, since Start().
+		/// </summary>
+		uint32_t GetRxPoolDropCount() const
+		{
+			return PoolDropCount;
+		}
+
+		/// <summary>
+		/// Frames and bytes corrected by the FEC, for UartDefinitions::FecParitySize > 0.
+		/// </summary>
+		const FecStats& GetFecStats() const
+		{
+			return Codec.GetFecStats();
+		}
+
+		/// <summary>
+		/// Bytes taken from the serial by the RX state machine, since Start().
+		/// </summary>
+		uint32_t GetRxByteCount() const
+		{
+			return RxByteCount;
+		}
+
+		/// <summary>
+		/// RX state machine steps, since Start(). Idle wakeups show as steps while no bytes come in.
+		/// </summary>
+		uint32_t GetRxPollCount() const
+		{
+			return RxPollCount;
+		}
+
+		/// <summary>
+		/// Bytes handed to the serial by the TX core, since Start().
+		/// </summary>
+		uint32_t GetTxByteCount() const
+		{
+			return UartWriter.GetByteCount();
+		}
+
+		/// <summary>
+		/// Half-duplex line driver, toggled around each transmission with UartDefinitions::TurnaroundMicros.
+		/// </summary>
+		void SetLineDriver(LineDriver* driver)
+		{
+			UartWriter.SetLineDriver(driver, UartDefinitions::TurnaroundMicros, GetByteMicros(Baudrate));
+		}
+
+		/// <summary>
+		/// Raw wire capture of both directions, nullptr to disable.
+		/// RX bytes are reported as they are consumed by the RX state machine.
+		/// </summary>
+		void SetWireTap(WireTap* tap)
+		{
+			Tap = tap;
+			UartWriter.SetWireTap(tap);
+		}
+
+		/// <summary>
+		/// Encoded RX frames as they accumulate, nullptr to disable.
+		/// </summary>
+		void SetFrameSink(FrameSink* sink)
+		{
+			EndSinkFrame(false);
+			Sink = sink;
+		}
+
+		/// <summary>
+		/// Re-begins the serial at another rate, dropping any partial RX frame.
+		/// Only call while the TX core is idle. Start() returns to UartDefinitions::Baudrate.
+		/// </summary>
+		void SetBaudrate(const uint32_t baudrate)
+		{
+			Baudrate = baudrate;
+			Reader.Clear();
+			EndSinkFrame(false);
+			InSize = 0;
+			FrameStart = true;
+			SkipFrame = false;
+			Oversized = false;
+			switch (State)
+			{
+			case StateEnum::Accumulating:
+			case StateEnum::DeliveringMessage:
+				State = StateEnum::PassiveWaitPoll;
+				break;
+			default:
+				break;
+			}
+			Sleeping = false;
+			UartWriter.SetByteMicros(GetByteMicros(Baudrate));
+			SerialInstance.begin(Baudrate);
+		}
+
+		uint32_t GetBaudrate() const
+		{
+			return Baudrate;
+		}
+
+		void Start()
+		{
+			UartWriter.Clear();
+			Reader.Clear();
+			EndSinkFrame(false);
+			InSize = 0;
+			FrameStart = true;
+			SkipFrame = false;
+			Oversized = false;
+			SkippedCount = 0;
+			RxByteCount = 0;
+			PoolDropCount = 0;
+			RxPollCount = 0;
+			Sleeping = false;
+			LeasedMask = 0;
+			BatchCount = 0;
+			InIndex = 0;
+			InBuffer = Pool[0];
+			Baudrate = UartDefinitions::Baudrate;
+			UartWriter.SetByteMicros(GetByteMicros(Baudrate));
+			State = StateEnum::WaitingForSerial;
+			SerialInstance.begin(Baudrate);
+		}
+
+		void Stop()
+		{
+			switch (State)
+			{
+			case StateEnum::WaitingForSerial:
+			case StateEnum::Disabled:
+				UartWriter.Clear();
+				if (Listener != nullptr)
+				{
+					Listener->OnUartStateChange(false);
+				}
+			default:
+				break;
+			}
+
+			State = StateEnum::Disabled;
+		}
+
+		bool CanSendMessage() const
+		{
+			switch (State)
+			{
+			case StateEnum::Disabled:
+			case StateEnum::WaitingForSerial:
+				return false;
+			default:
+				break;
+			}
+
+			return UartWriter.CanSend();
+		}
+
+		bool IsSerialConnected()
+		{
+			return SerialInstance;
+		}
+
+		/// <summary>
+		/// The TX core must be polled after a successful send.
+		/// Addressed definitions send to MessageDefinition::AddressBroadcast.
+		/// </summary>
+		bool SendMessage(const uint8_t header)
+		{
+			return SendMessageTo(MessageDefinition::AddressBroadcast, header);
+		}
+
+		bool SendMessage(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize)
+		{
+			return SendMessageTo(MessageDefinition::AddressBroadcast, header, payload, payloadSize);
+		}
+
+		/// <summary>
+		/// Sends to a single node, for Addressed definitions.
+		/// Other definitions only send to MessageDefinition::AddressBroadcast.
+		/// </summary>
+		bool SendMessageTo(const uint8_t address, const uint8_t header)
+		{
+			if (!CanSendMessage()
+				|| !IsSendAddress(address))
+			{
+				return false;
+			}
+
+			GetOutBuffer()[(uint8_t)MessageDefinition::FieldIndexEnum::Header] = header;
+
+			return SendEncoded(address, MessageDefinition::GetMessageSize(0));
+		}
+
+		bool SendMessageTo(const uint8_t address, const uint8_t header, const uint8_t* payload, const uint8_t payloadSize)
+		{
+			if (!CanSendMessage()
+				|| !IsSendAddress(address)
+				|| payloadSize > UartDefinitions::MaxPayloadSize
+				|| payload == nullptr)
+			{
+				return false;
+			}
+
+			uint8_t* outBuffer = GetOutBuffer();
+			outBuffer[(uint8_t)MessageDefinition::FieldIndexEnum::Header] = header;
+			memcpy(&outBuffer[(uint8_t)MessageDefinition::FieldIndexEnum::Payload], payload, payloadSize);
+
+			return SendEncoded(address, MessageDefinition::GetMessageSize(payloadSize));
+		}
+
+		/// <summary>
+		/// Sends a fixed size payload, encoded with compile-time sizes.
+		/// </summary>
+		template<typename PayloadType>
+		bool SendMessage(const uint8_t header, const PayloadType& payload)
+		{
+			static_assert(PayloadTypeCheck<PayloadType>::Valid, "Payload type must be a trivially copyable value, not a pointer.");
+			static_assert(sizeof(PayloadType) <= UartDefinitions::MaxPayloadSize, "Payload type too large.");
+
+			if (!CanSendMessage())
+			{
+				return false;
+			}
+
+			uint8_t* outBuffer = GetOutBuffer();
+			outBuffer[(uint8_t)MessageDefinition::FieldIndexEnum::Header] = header;
+			memcpy(&outBuffer[(uint8_t)MessageDefinition::FieldIndexEnum::Payload], &payload, sizeof(PayloadType));
+
+			if (AddressSize > 0
+				|| UartDefinitions::StreamingTx)
+			{
+				return SendEncoded(MessageDefinition::AddressBroadcast, MessageDefinition::GetMessageSize(sizeof(PayloadType)));
+			}
+
+			const uint8_t outSize = Codec.template EncodeMessageAndCrcInPlace<sizeof(PayloadType)>(outBuffer);
+
+			return UartWriter.SendMessage(outSize);
+		}
+
+		/// <summary>
+		/// Sends a frame encoded ahead of time, straight from its buffer, with no encoding or copy.
+		/// It must have been encoded with this interface's key, and stay unchanged until sent.
+		/// </summary>
+		/// <param name="frame">COBS encoded message, without delimiters.</param>
+		bool SendPreEncoded(const uint8_t* frame, const uint8_t frameSize)
+		{
+			static_assert(AddressSize == 0, "Pre-encoded frames are not addressed.");
+			static_assert(UartDefinitions::FecParitySize == 0, "Pre-encoded frames carry no FEC parity.");
+
+			return CanSendMessage()
+				&& frameSize <= BufferSize
+				&& UartWriter.SendEncoded(frame, frameSize);
+		}
+
+		/// <summary>
+		/// Sends a compile-time PreEncodedFrame.
+		/// </summary>
+		template<typename FrameType>
+		bool SendPreEncoded()
+		{
+			static_assert(FrameType::PayloadSize <= UartDefinitions::MaxPayloadSize, "Pre-encoded payload too large.");
+
+			return SendPreEncoded(FrameType::GetBuffer(), FrameType::BufferSize);
+		}
+
+		/// <summary>
+		/// Forwards a frame from another interface with the same key and definitions, as it was received.
+		/// An open frame is still arriving: ExtendThrough() as its bytes come in, and CloseThrough() after the last.
+		/// The frame must stay unchanged until sent.
+		/// </summary>
+		/// <param name="frame">COBS encoded message, without delimiters.</param>
+		bool SendThrough(const uint8_t* frame, const uint8_t frameSize, const bool open)
+		{
+			static_assert(AddressSize == 0, "Forwarded frames are not addressed.");
+
+			return CanSendMessage()
+				&& frameSize <= BufferSize
+				&& UartWriter.SendThrough(frame, frameSize, open);
+		}
+
+		void ExtendThrough(const uint8_t frameSize)
+		{
+			UartWriter.ExtendThrough(frameSize);
+		}
+
+		void CloseThrough(const uint8_t frameSize)
+		{
+			UartWriter.CloseThrough(frameSize);
+		}
+
+		/// <summary>
+		/// Serial RX event.
+		/// </summary>
+		/// <returns>True if the RX core should be polled now.</returns>
+		bool OnSerialEvent(const uint32_t nowMicros)
+		{
+			Sleeping = false;
+
+			switch (State)
+			{
+			case StateEnum::PassiveWaitPoll:
+				State = StateEnum::ActiveWaitPoll;
+				PollStart = nowMicros;
+				return true;
+			case StateEnum::WaitingForSerial:
+				return true;
+			case StateEnum::ActiveWaitPoll:
+			case StateEnum::Accumulating:
+				// Waiting on a timeout deadline, not polling.
+				return UartDefinitions::EventDrivenIdle;
+			default:
+				return false;
+			}
+		}
+
+		/// <summary>
+		/// Serial connection change notification (e.g. USB CDC line state), for event-driven idle.
+		/// </summary>
+		/// <returns>True if the RX core should be polled now.</returns>
+		bool OnConnectionChange()
+		{
+			Sleeping = false;
+
+			return State != StateEnum::Disabled;
+		}
+
+		/// <summary>
+		/// Wakes an event-driven idle RX, e.g. after a send.
+		/// </summary>
+		/// <returns>True if it was sleeping, and should be polled now.</returns>
+		bool WakeRx()
+		{
+			const bool sleeping = Sleeping;
+			Sleeping = false;
+
+			return sleeping && State != StateEnum::Disabled;
+		}
+
+		/// <summary>
+		/// False when the RX core is stopped, or idle until an event.
+		/// </summary>
+		bool IsRxPolling() const
+		{
+			return State != StateEnum::Disabled
+				&& !Sleeping;
+		}
+
+		/// <summary>
+		/// False when there is nothing to send.
+		/// </summary>
+		bool IsTxPolling() const
+		{
+			return UartWriter.IsPolling();
+		}
+
+		bool IsPolling() const
+		{
+			return IsRxPolling() || IsTxPolling();
+		}
+
+		/// <summary>
+		/// Runs one step of the TX state machine.
+		/// </summary>
+		/// <returns>Next wake deadline, in micros. Only meaningful while IsTxPolling().</returns>
+		uint32_t PollTx(const uint32_t nowMicros)
+		{
+			return UartWriter.Poll(nowMicros);
+		}
+
+		/// <summary>
+		/// Runs one step of both state machines.
+		/// </summary>
+		/// <returns>Earliest wake deadline, in micros. Only meaningful while IsPolling().</returns>
+		uint32_t Poll(const uint32_t nowMicros)
+		{
+			const uint32_t rxDeadline = PollRx(nowMicros);
+
+			if (UartWriter.IsPolling())
+			{
+				const uint32_t txDeadline = UartWriter.Poll(nowMicros);
+				if (!IsRxPolling()
+					|| (int32_t)(txDeadline - rxDeadline) < 0)
+				{
+					return txDeadline;
+				}
+			}
+
+			return rxDeadline;
+		}
+
+		/// <summary>
+		/// Runs one step of the RX state machine.
+		/// </summary>
+		/// <returns>Next wake deadline, in micros. Only meaningful while IsRxPolling().</returns>
+		uint32_t PollRx(const uint32_t nowMicros)
+		{
+			RxPollCount++;
+
+			switch (State)
+			{
+			case StateEnum::WaitingForSerial:
+				if (SerialInstance)
+				{
+					if (UartWriter.Start())
+					{
+						State = StateEnum::ActiveWaitPoll;
+						PollStart = nowMicros;
+						if (Listener != nullptr)
+						{
+							Listener->OnUartStateChange(true);
+						}
+
+						return nowMicros;
+					}
+				}
+				return GetIdleDeadline(nowMicros);
+			case StateEnum::PassiveWaitPoll:
+				if (!SerialInstance)
+				{
+					OnDisconnected();
+				}
+				else if (Reader.Available())
+				{
+					State = StateEnum::ActiveWaitPoll;
+					PollStart = nowMicros;
+				}
+				else
+				{
+					return GetIdleDeadline(nowMicros);
+				}
+				break;
+			case StateEnum::ActiveWaitPoll:
+				if (!SerialInstance)
+				{
+					OnDisconnected();
+				}
+				else if (Reader.Available())
+				{
+					PollStart = nowMicros;
+					State = StateEnum::Accumulating;
+				}
+				else if (nowMicros - PollStart > ReadTimeoutMicros)
+				{
+					State = StateEnum::PassiveWaitPoll;
+				}
+				else if (UartDefinitions::EventDrivenIdle)
+				{
+					return PollStart + ReadTimeoutMicros + 1;
+				}
+				break;
+			case StateEnum::Accumulating:
+				if (!SerialInstance)
+				{
+					OnDisconnected();
+				}
+				else if (Accumulate(nowMicros))
+				{
+					LastIn = nowMicros;
+					if (BatchCount > 0)
+					{
+						DeliverBatch();
+					}
+				}
+				else if (nowMicros - LastIn > ReadTimeoutMicros)
+				{
+					EndSinkFrame(false);
+					InSize = 0;
+					FrameStart = true;
+					SkipFrame = false;
+					Oversized = false;
+					PollStart = nowMicros;
+					State = StateEnum::ActiveWaitPoll;
+				}
+				else if (UartDefinitions::EventDrivenIdle)
+				{
+					if (InSize == 0
+						&& !SkipFrame)
+					{
+						// Between frames, nothing to time out.
+						State = StateEnum::PassiveWaitPoll;
+
+						return GetIdleDeadline(nowMicros);
+					}
+
+					return LastIn + ReadTimeoutMicros + 1;
+				}
+				break;
+			case StateEnum::DeliveringMessage:
+				DeliverMessage();
+				InSize = 0;
+				State = StateEnum::Accumulating;
+				break;
+			case StateEnum::Disabled:
+			default:
+				break;
+			}
+
+			return nowMicros;
+		}
+
+	private:
+		/// <summary>
+		/// Next poll while waiting for the serial, or for a frame to start.
+		/// Event-driven idle sleeps until woken, or until the safety net.
+		/// </summary>
+		uint32_t GetIdleDeadline(const uint32_t nowMicros)
+		{
+			if (!UartDefinitions::EventDrivenIdle)
+			{
+				return nowMicros + PollPeriodMicros;
+			}
+
+			Sleeping = (IdleSafetyMicros == 0);
+
+			return nowMicros + IdleSafetyMicros;
+		}
+
+		/// <summary>
+		/// Only the CRC (and parity) is set ahead, the TX core COBS encodes as it writes.
+		/// </summary>
+		bool SendStreaming(const uint8_t address, const uint8_t messageSize)
+		{
+			uint8_t* outBuffer = GetOutBuffer();
+			const uint8_t codedSize = (AddressSize > 0) ? Codec.PrepareMessageInPlace(outBuffer, messageSize, address)
+				: Codec.PrepareMessageInPlace(outBuffer, messageSize);
+			if (codedSize == 0)
+			{
+				return false;
+			}
+
+			if (AddressSize > 0)
+			{
+				memmove(&outBuffer[AddressSize], outBuffer, codedSize);
+				outBuffer[0] = address;
+			}
+
+			return UartWriter.SendStreaming(AddressSize, codedSize);
+		}
+
+		/// <summary>
+		/// Out message, after the byte kept for the start delimiter.
+		/// </summary>
+		uint8_t* GetOutBuffer()
+		{
+			return OutFrame.GetMessage();
+		}
+
+		/// <summary>
+		/// 8N1 byte time, rounded up.
+		/// </summary>
+		static uint32_t GetByteMicros(const uint32_t baudrate)
+		{
+			return (10 * 1000000UL + baudrate - 1) / baudrate;
+		}
+
+		bool SendEncoded(const uint8_t address, const uint8_t messageSize)
+		{
+			if (UartDefinitions::StreamingTx)
+			{
+				return SendStreaming(address, messageSize);
+			}
+
+			uint8_t* outBuffer = GetOutBuffer();
+			if (AddressSize == 0)
+			{
+				return UartWriter.SendMessage(Codec.EncodeMessageAndCrcInPlace(outBuffer, messageSize));
+			}
+
+			const uint8_t outSize = Codec.EncodeMessageAndCrcInPlace(outBuffer, messageSize, address);
+			if (outSize == 0)
+			{
+				return false;
+			}
+
+			// The address goes unencoded, ahead of the COBS data.
+			memmove(&outBuffer[AddressSize], outBuffer, outSize);
+			outBuffer[0] = address;
+
+			return UartWriter.SendMessage(outSize + AddressSize);
+		}
+
+		bool IsSendAddress(const uint8_t address) const
+		{
+			return (AddressSize > 0) ? (address != MessageDefinition::Delimiter)
+				: (address == MessageDefinition::AddressBroadcast);
+		}
+
+		bool AcceptAddress(const uint8_t address) const
+		{
+			return Address == MessageDefinition::AddressPromiscuous
+				|| address == Address
+				|| address == MessageDefinition::AddressBroadcast;
+		}
+
+		void OnDisconnected()
+		{
+			EndSinkFrame(false);
+			State = StateEnum::WaitingForSerial;
+			if (Listener != nullptr)
+			{
+				Listener->OnUartStateChange(false);
+			}
+		}
+
+		/// <summary>
+		/// Accumulates up to MaxSerialStepIn bytes from the serial spans, until a delimiter is found.
+		/// In Addressed mode, a frame for another node is only scanned for its end delimiter.
+		/// </summary>
+		/// <returns>True if any bytes were consumed.</returns>
+		bool Accumulate(const uint32_t nowMicros)
+		{
+			uint8_t budget = UartDefinitions::MaxSerialStepIn;
+			bool consumedAny = false;
+
+			while (budget > 0
+				&& State == StateEnum::Accumulating)
+			{
+				const uint8_t* span;
+				uint16_t spanSize = Reader.ReadSpan(span);
+				if (spanSize == 0)
+				{
+					break;
+				}
+				else if (spanSize > budget)
+				{
+					spanSize = budget;
+				}
+
+				const uint8_t* delimiter = (const uint8_t*)memchr(span, MessageDefinition::Delimiter, spanSize);
+				const uint8_t* data = span;
+				uint16_t dataSize = (delimiter != nullptr) ? uint16_t(delimiter - span) : spanSize;
+				uint16_t consumed = dataSize;
+
+				if (AddressSize > 0
+					&& FrameStart
+					&& dataSize > 0)
+				{
+					// First byte after a delimiter is the destination.
+					FrameStart = false;
+					InAddress = data[0];
+					SkipFrame = !AcceptAddress(InAddress);
+					data += AddressSize;
+					dataSize -= AddressSize;
+				}
+
+				if (!SkipFrame
+					&& InSize + dataSize > BufferSize)
+				{
+					// The rest of the frame is dropped, up to its delimiter.
+					EndSinkFrame(false);
+					InSize = 0;
+					SkipFrame = true;
+					Oversized = true;
+					if (Listener != nullptr)
+					{
+						Listener->OnUartRxError(RxErrorEnum::TooLong);
+					}
+				}
+
+				if (!SkipFrame)
+				{
+					if (InBuffer == nullptr
+						&& InSize == 0)
+					{
+						// A buffer may have been released since the last frame.
+						AcquireBuffer();
+					}
+
+					if (InBuffer != nullptr)
+					{
+						memcpy(&InBuffer[InSize], data, dataSize);
+					}
+					InSize += dataSize;
+
+					if (Sink != nullptr
+						&& dataSize > 0)
+					{
+						SinkFrame = true;
+						Sink->OnFrameBytes(data, (uint8_t)dataSize);
+					}
+				}
+
+				if (delimiter != nullptr)
+				{
+					consumed++;
+					if (SkipFrame)
+					{
+						if (!Oversized)
+						{
+							SkippedCount++;
+						}
+					}
+					else if (InSize >= MessageDefinition::MessageSizeMin)
+					{
+						if (InBuffer == nullptr)
+						{
+							EndSinkFrame(false);
+							InSize = 0;
+							PoolDropCount++;
+							if (Listener != nullptr)
+							{
+								Listener->OnUartRxError(RxErrorEnum::PoolExhausted);
+							}
+						}
+						else if (UartDefinitions::RxBatchSize > 0)
+						{
+							BatchFrame();
+						}
+						else
+						{
+							State = StateEnum::DeliveringMessage;
+						}
+					}
+					else
+					{
+						EndSinkFrame(false);
+						if (InSize > 0 && Listener != nullptr)
+						{
+							Listener->OnUartRxError(RxErrorEnum::TooShort);
+						}
+						InSize = 0;
+					}
+					FrameStart = true;
+					SkipFrame = false;
+					Oversized = false;
+					if (InBuffer == nullptr)
+					{
+						AcquireBuffer();
+					}
+				}
+
+				ConsumeIn(span, consumed, nowMicros);
+				budget -= consumed;
+				consumedAny = true;
+			}
+
+			return consumedAny;
+		}
+
+		void ConsumeIn(const uint8_t* span, const uint16_t size, const uint32_t nowMicros)
+		{
+			if (Tap != nullptr)
+			{
+				Tap->OnWireBytes(WireDirectionEnum::Rx, nowMicros, span, size);
+			}
+			Reader.Consume(size);
+			RxByteCount += size;
+		}
+
+		/// <summary>
+		/// Next frame goes to the first buffer not leased, if any.
+		/// </summary>
+		void AcquireBuffer()
+		{
+			InBuffer = nullptr;
+			for (uint8_t i = 0; i < UartDefinitions::RxPoolSize; i++)
+			{
+				if (((LeasedMask >> i) & 1) == 0)
+				{
+					InIndex = i;
+					InBuffer = Pool[i];
+					break;
+				}
+			}
+		}
+
+		void DeliverMessage()
+		{
+			Delivering = true;
+			DeliverFrame();
+			Delivering = false;
+
+			if ((LeasedMask >> InIndex) & 1)
+			{
+				AcquireBuffer();
+			}
+		}
+
+		/// <summary>
+		/// Ends the FrameSink's frame, if it got any of it.
+		/// </summary>
+		void EndSinkFrame(const bool valid)
+		{
+			if (SinkFrame)
+			{
+				SinkFrame = false;
+				Sink->OnFrameEnd(valid);
+			}
+		}
+
+		/// <summary>
+		/// Decodes and checks the accumulated frame in place, and settles its forwarding.
+		/// </summary>
+		bool ValidateFrame()
+		{
+			const bool valid = (AddressSize > 0) ? Codec.DecodeMessageInPlaceIfValid(InBuffer, InSize, InAddress)
+				: Codec.DecodeMessageInPlaceIfValid(InBuffer, InSize);
+
+			// Forwarding is settled before the local delivery.
+			EndSinkFrame(valid);
+
+			return valid;
+		}
+
+		uint8_t GetInPayloadSize() const
+		{
+			return MessageDefinition::GetPayloadSize(InSize - 1 - UartDefinitions::FecParitySize);
+		}
+
+		/// <summary>
+		/// Adds a completed frame to the batch, and accumulates the next one in the following pool buffer.
+		/// A full batch ends the pass.
+		/// </summary>
+		void BatchFrame()
+		{
+			if (ValidateFrame())
+			{
+				RxFrame& frame = Batch[BatchCount++];
+				frame.Header = InBuffer[(uint8_t)MessageDefinition::FieldIndexEnum::Header];
+				frame.Payload = &InBuffer[(uint8_t)MessageDefinition::FieldIndexEnum::Payload];
+				frame.PayloadSize = GetInPayloadSize();
+
+				if (BatchCount < UartDefinitions::RxBatchSize)
+				{
+					InIndex = BatchCount;
+					InBuffer = Pool[InIndex];
+				}
+				else
+				{
+					State = StateEnum::DeliveringMessage;
+				}
+			}
+			else if (Listener != nullptr)
+			{
+				Listener->OnUartRxError(RxErrorEnum::Crc);
+			}
+			InSize = 0;
+		}
+
+		/// <summary>
+		/// Hands over the pass's frames, and moves a partial frame back to the first pool buffer.
+		/// </summary>
+		void DeliverBatch()
+		{
+			if (Listener != nullptr)
+			{
+				Listener->OnUartRxBatch(Batch, BatchCount);
+			}
+			BatchCount = 0;
+
+			if (InIndex != 0)
+			{
+				if (InSize > 0)
+				{
+					memcpy(Pool[0], InBuffer, InSize);
+				}
+				InIndex = 0;
+				InBuffer = Pool[0];
+			}
+
+			if (State == StateEnum::DeliveringMessage)
+			{
+				State = StateEnum::Accumulating;
+			}
+		}
+
+		void DeliverFrame()
+		{
+			if (InSize >= MessageDefinition::MessageSizeMin)
+			{
+				if (ValidateFrame())
+				{
+					if (Listener != nullptr)
+					{
+						const uint8_t payloadSize = GetInPayloadSize();
+						if (payloadSize > 0)
+						{
+							Listener->OnUartRx(InBuffer[(uint8_t)MessageDefinition::FieldIndexEnum::Header],
+								&InBuffer[(uint8_t)MessageDefinition::FieldIndexEnum::Payload], payloadSize);
+						}
+						else
+						{
+							Listener->OnUartRx(InBuffer[(uint8_t)MessageDefinition::FieldIndexEnum::Header]);
+						}
+					}
+				}
+				else if (Listener != nullptr)
+				{
+					Listener->OnUartRxError(RxErrorEnum::Crc);
+				}
+			}
+			else
+			{
+				EndSinkFrame(false);
+				if (InSize > 0 && Listener != nullptr)
+				{
+					Listener->OnUartRxError(RxErrorEnum::TooShort);
+				}
+			}
+		}
+	};
+}
+#endif
@@ -0,0 +1,742 @@
+#ifndef _UART_OUT_CORE_h
+#define _UART_OUT_CORE_h
+
+#include <UartInterface.h>
+
+namespace UartInterface
+{
+	namespace UartOut
+	{
+		/// <summary>
+		/// Out message buffer with a spare byte on each side, for the delimiters.
+		/// </summary>
+		/// <typeparam name="MessageCapacity">Largest message.</typeparam>
+		template<size_t MessageCapacity>
+		struct PaddedOutBuffer
+		{
+			uint8_t Frame[1 + MessageCapacity + 1];
+
+			uint8_t* GetMessage()
+			{
+				return &Frame[1];
+			}
+		};
+
+		/// <summary>
+		/// Scheduler-agnostic stream writer from an external fixed buffer.
+		/// Delimits each buffer transmission with the MessageDefinition delimiter.
+		/// A frame that fits the serial's free space goes out whole, delimiters included, in a single write and a single Poll().
+		/// Delimiters are staged around the message in place only when the core was given a PaddedOutBuffer, otherwise they are gathered.
+		/// Otherwise it goes out in chunks of up to MaxSerialStepOut bytes, as space frees up.
+		/// Poll() runs the state machine and returns the next wake deadline.
+		/// With a LineDriver (half-duplex), the driver is enabled a turnaround before the start delimiter,
+		///  and released a turnaround after the serial has drained the end delimiter.
+		/// SendStreaming() COBS encodes a raw message on the fly, straight into the serial's free space.
+		/// SendThrough() forwards an encoded frame that is still arriving, its end delimiter waits for CloseThrough().
+		/// </summary>
+		/// <typeparam name="SerialType"></typeparam>
+		/// <typeparam name="MaxSerialStepOut"></typeparam>
+		template<typename SerialType,
+			uint8_t MaxSerialStepOut,
+			uint32_t WriteTimeoutMillis>
+		class UartOutCore
+		{
+		private:
+			enum class StateEnum : uint8_t
+			{
+				NotSending,
+				Queued,
+				EnablingDriver,
+				SendingStartDelimiter,
+				SendingData,
+				SendingEndDelimiter,
+				Draining,
+				ReleasingDriver
+			};
+
+			StateEnum SendState = StateEnum::NotSending;
+
+		private:
+			using MessageDefinition = UartInterface::MessageDefinition;
+
+			static constexpr uint32_t WriteTimeoutMicros = WriteTimeoutMillis * 1000;
+
+		private:
+			SerialType& SerialInstance;
+			Transport::SpanWriter<SerialType> Writer;
+			uint8_t* OutBuffer;
+			const uint8_t* OutData = nullptr;
+			UartListener* Listener;
+
+			/// <summary>
+			/// Largest message for a PaddedOutBuffer.
+			/// </summary>
+			const uint16_t OutCapacity;
+
+			/// <summary>
+			/// The OutBuffer has a spare byte before it and after OutCapacity, for the delimiters.
+			/// </summary>
+			const bool Padded;
+			LineDriver* Driver = nullptr;
+			WireTap* Tap = nullptr;
+
+		private:
+			uint32_t TurnaroundMicros = 0;
+			uint32_t ByteMicros = 0;
+			uint32_t DrainStart = 0;
+			uint32_t ByteCount = 0;
+			uint16_t IdleFree = 0;
+
+		private:
+			uint32_t OutStart = 0;
+			uint8_t OutSize = 0;
+			uint8_t OutIndex = 0;
+
+		private:
+			/// <summary>
+			/// Streaming COBS state: raw bytes sent as is, bytes left in the current block,
+			///  and whether the block ends on a delimiter (or the data).
+			/// </summary>
+			uint8_t RawSize = 0;
+			uint8_t BlockRemaining = 0;
+			bool Streaming = false;
+			bool BlockOpen = false;
+			bool BlockDelimited = false;
+
+			/// <summary>
+			/// Cut-through frame still open, OutSize grows as it arrives.
+			/// </summary>
+			bool Through = false;
+
+		public:
+			/// <param name="outBuffer">Message buffer, of any size.</param>
+			UartOutCore(SerialType& serialInstance, uint8_t* outBuffer, UartListener* listener)
+				: SerialInstance(serialInstance)
+				, Writer(serialInstance)
+				, OutBuffer(outBuffer)
+				, Listener(listener)
+				, OutCapacity(UINT8_MAX)
+				, Padded(false)
+			{
+			}
+
+			/// <param name="outBuffer">Message buffer, with room for the delimiters around it.</param>
+			template<size_t MessageCapacity>
+			UartOutCore(SerialType& serialInstance, PaddedOutBuffer<MessageCapacity>& outBuffer, UartListener* listener)
+				: SerialInstance(serialInstance)
+				, Writer(serialInstance)
+				, OutBuffer(outBuffer.GetMessage())
+				, Listener(listener)
+				, OutCapacity(MessageCapacity)
+				, Padded(true)
+			{
+			}
+
+			bool Setup() const
+			{
+				return OutBuffer != nullptr;
+			}
+
+			/// <summary>
+			/// Half-duplex operation, nullptr for full-duplex.
+			/// </summary>
+			/// <param name="byteMicros">Time on the wire of a single byte.</param>
+			void SetLineDriver(LineDriver* driver, const uint32_t turnaroundMicros, const uint32_t byteMicros)
+			{
+				ReleaseDriver();
+				SendState = StateEnum::NotSending;
+				Driver = driver;
+				TurnaroundMicros = turnaroundMicros;
+				ByteMicros = byteMicros;
+			}
+
+			/// <summary>
+			/// Raw TX byte capture, nullptr to disable.
+			/// </summary>
+			void SetWireTap(WireTap* tap)
+			{
+				Tap = tap;
+			}
+
+			/// <summary>
+			/// Line driver drain timing, after a baud rate change.
+			/// </summary>
+			void SetByteMicros(const uint32_t byteMicros)
+			{
+				ByteMicros = byteMicros;
+			}
+
+			void Clear()
+			{
+				ReleaseDriver();
+				OutSize = 0;
+				SendState = StateEnum::NotSending;
+				OutIndex = 0;
+				Through = false;
+				SerialInstance.clearWriteError();
+			}
+
+			bool Start()
+			{
+				if (OutBuffer != nullptr)
+				{
+					Clear();
+					ByteCount = 0;
+
+					return true;
+				}
+				else
+				{
+					return false;
+				}
+			}
+
+			bool CanSend() const
+			{
+				return SendState == StateEnum::NotSending
+					&& Writer.AvailableForWrite() >= MessageDefinition::MessageSizeMin;
+			}
+
+			/// <summary>
+			/// Queues the OutBuffer for transmission, the write timeout starts on the next Poll().
+			/// </summary>
+			bool SendMessage(const uint8_t messageSize)
+			{
+				if (!CanSend()
+					|| messageSize < MessageDefinition::MessageSizeMin
+					|| messageSize > OutCapacity)
+				{
+					return false;
+				}
+
+				OutData = OutBuffer;
+				OutSize = messageSize;
+				OutIndex = 0;
+				Streaming = false;
+				Through = false;
+				SendState = StateEnum::Queued;
+
+				return true;
+			}
+
+			/// <summary>
+			/// Queues the OutBuffer for transmission, COBS encoding it as it goes out.
+			/// Nothing is encoded ahead: each block's code is found when the block starts,
+			///  and its bytes are written straight from the OutBuffer.
+			/// </summary>
+			/// <param name="rawSize">Leading bytes sent unencoded, e.g. an address.</param>
+			/// <param name="dataSize">Raw message bytes, after the unencoded ones.</param>
+			bool SendStreaming(const uint8_t rawSize, const uint8_t dataSize)
+			{
+				if (!CanSend()
+					|| dataSize < MessageDefinition::MessageSizeMin
+					|| dataSize > UartCobsCodec::DataSizeMax)
+				{
+					return false;
+				}
+
+				OutData = OutBuffer;
+				OutSize = rawSize + dataSize;
+				OutIndex = 0;
+				RawSize = rawSize;
+				BlockRemaining = 0;
+				BlockOpen = false;
+				BlockDelimited = true;
+				Streaming = true;
+				Through = false;
+				SendState = StateEnum::Queued;
+
+				return true;
+			}
+
+			/// <summary>
+			/// Queues an already encoded message from outside the OutBuffer, e.g. a constant frame.
+			/// The data must stay unchanged until sent.
+			/// </summary>
+			bool SendEncoded(const uint8_t* data, const uint8_t dataSize)
+			{
+				if (!CanSend()
+					|| data == nullptr
+					|| dataSize < MessageDefinition::MessageSizeMin)
+				{
+					return false;
+				}
+
+				OutData = data;
+				OutSize = dataSize;
+				OutIndex = 0;
+				Streaming = false;
+				Through = false;
+				SendState = StateEnum::Queued;
+
+				return true;
+			}
+
+			/// <summary>
+			/// Queues an encoded frame from outside the OutBuffer, possibly while it is still arriving (cut-through).
+			/// An open frame goes out as far as ExtendThrough() has grown it, and only ends after CloseThrough().
+			/// The data must stay unchanged until sent.
+			/// </summary>
+			/// <param name="open">True if more bytes are yet to come.</param>
+			bool SendThrough(const uint8_t* data, const uint8_t dataSize, const bool open)
+			{
+				if (!CanSend()
+					|| data == nullptr
+					|| (!open && dataSize < MessageDefinition::MessageSizeMin))
+				{
+					return false;
+				}
+
+				OutData = data;
+				OutSize = dataSize;
+				OutIndex = 0;
+				Streaming = false;
+				Through = open;
+				SendState = StateEnum::Queued;
+
+				return true;
+			}
+
+			/// <summary>
+			/// More of the open frame has arrived, dataSize in total.
+			/// </summary>
+			void ExtendThrough(const uint8_t dataSize)
+			{
+				if (Through)
+				{
+					OutSize = dataSize;
+				}
+			}
+
+			/// <summary>
+			/// The open frame is complete at dataSize, the end delimiter follows its last byte.
+			/// </summary>
+			void CloseThrough(const uint8_t dataSize)
+			{
+				if (Through)
+				{
+					OutSize = dataSize;
+					Through = false;
+				}
+			}
+
+			/// <summary>
+			/// Bytes handed to the serial, delimiters included, since Start().
+			/// </summary>
+			uint32_t GetByteCount() const
+			{
+				return ByteCount;
+			}
+
+			/// <summary>
+			/// False when there is nothing to do until the next SendMessage().
+			/// </summary>
+			bool IsPolling() const
+			{
+				return SendState != StateEnum::NotSending;
+			}
+
+			/// <summary>
+			/// True while the line driver is enabled.
+			/// </summary>
+			bool IsDriving() const
+			{
+				return Driver != nullptr
+					&& SendState != StateEnum::NotSending
+					&& SendState != StateEnum::Queued;
+			}
+
+			/// <summary>
+			/// Runs one step of the TX state machine.
+			/// </summary>
+			/// <returns>Next wake deadline, in micros. Only meaningful while IsPolling().</returns>
+			uint32_t Poll(const uint32_t nowMicros)
+			{
+				if (!SerialInstance)
+				{
+					Clear();
+
+					return nowMicros;
+				}
+
+				if (SendState == StateEnum::Queued)
+				{
+					OutStart = nowMicros;
+					if (Driver != nullptr)
+					{
+						IdleFree = Writer.AvailableForWrite();
+						Driver->OnLineDriverEnable(true);
+						SendState = StateEnum::EnablingDriver;
+					}
+					else
+					{
+						SendState = StateEnum::SendingStartDelimiter;
+					}
+				}
+
+				const bool timedOut = (nowMicros - OutStart) >= WriteTimeoutMicros;
+
+				switch (SendState)
+				{
+				case StateEnum::EnablingDriver:
+					if ((nowMicros - OutStart) < TurnaroundMicros)
+					{
+						return OutStart + TurnaroundMicros;
+					}
+					SendState = StateEnum::SendingStartDelimiter;
+					break;
+				case StateEnum::SendingStartDelimiter:
+					if (timedOut)
+					{
+						OnTxError(UartInterface::TxErrorEnum::StartTimeout);
+					}
+					else if (!WriteFrame(nowMicros)
+						&& Writer.AvailableForWrite() > MessageDefinition::MessageSizeMin)
+					{
+						WriteDelimiter(nowMicros);
+						SendState = StateEnum::SendingData;
+					}
+					break;
+				case StateEnum::SendingData:
+					if (Streaming ? IsStreaming() : (OutIndex < OutSize))
+					{
+						if (timedOut)
+						{
+							OnTxError(UartInterface::TxErrorEnum::DataTimeout);
+							break;
+						}
+						else
+						{
+							if (Streaming)
+							{
+								PushStreaming(nowMicros);
+							}
+							else
+							{
+								OutIndex += PushOut(nowMicros);
+							}
+
+							if (Streaming ? !IsStreaming() : (OutIndex >= OutSize && !Through))
+							{
+								SendState = StateEnum::SendingEndDelimiter;
+								break;
+							}
+						}
+					}
+					else if (Through)
+					{
+						// Cut-through, waiting on the frame's next bytes.
+						if (timedOut)
+						{
+							OnTxError(UartInterface::TxErrorEnum::DataTimeout);
+						}
+						else
+						{
+							return nowMicros + ByteMicros;
+						}
+					}
+					else
+					{
+						SendState = StateEnum::SendingEndDelimiter;
+					}
+					break;
+				case StateEnum::SendingEndDelimiter:
+					if (timedOut)
+					{
+						OnTxError(UartInterface::TxErrorEnum::EndTimeout);
+					}
+					else if (Writer.AvailableForWrite() > 0)
+					{
+						WriteDelimiter(nowMicros);
+						if (Driver != nullptr)
+						{
+							SendState = StateEnum::Draining;
+						}
+						else
+						{
+							OnTxDone();
+						}
+					}
+					break;
+				case StateEnum::Draining:
+					if (timedOut)
+					{
+						OnTxError(UartInterface::TxErrorEnum::EndTimeout);
+					}
+					else
+					{
+						const uint16_t free = Writer.AvailableForWrite();
+						if (free >= IdleFree)
+						{
+							// The last byte is still in the shift register.
+							DrainStart = nowMicros;
+							SendState = StateEnum::ReleasingDriver;
+
+							return DrainStart + ByteMicros + TurnaroundMicros;
+						}
+						else
+						{
+							return nowMicros + (uint32_t)(IdleFree - free) * ByteMicros;
+						}
+					}
+					break;
+				case StateEnum::ReleasingDriver:
+					if ((nowMicros - DrainStart) < (ByteMicros + TurnaroundMicros))
+					{
+						return DrainStart + ByteMicros + TurnaroundMicros;
+					}
+					OnTxDone();
+					break;
+				case StateEnum::NotSending:
+				default:
+					break;
+				}
+
+				return nowMicros;
+			}
+
+		private:
+			void ReleaseDriver()
+			{
+				if (IsDriving())
+				{
+					Driver->OnLineDriverEnable(false);
+				}
+			}
+
+			void OnTxDone()
+			{
+				ReleaseDriver();
+				SendState = StateEnum::NotSending;
+				if (Listener != nullptr)
+				{
+					Listener->OnUartTx();
+				}
+			}
+
+			void OnTxError(const UartInterface::TxErrorEnum error)
+			{
+				ReleaseDriver();
+				SendState = StateEnum::NotSending;
+				if (Listener != nullptr)
+				{
+					Listener->OnUartTxError(error);
+				}
+			}
+
+			void WriteDelimiter(const uint32_t nowMicros)
+			{
+				if (Writer.Write((uint8_t)(MessageDefinition::Delimiter)))
+				{
+					ByteCount++;
+					if (Tap != nullptr)
+					{
+						const uint8_t delimiter = MessageDefinition::Delimiter;
+						Tap->OnWireBytes(WireDirectionEnum::Tx, nowMicros, &delimiter, 1);
+					}
+				}
+			}
+
+			/// <summary>
+			/// Writes the whole frame, delimiters included, if it fits the serial's free space.
+			/// A padded OutBuffer's delimiters are set around the message, for a single contiguous write.
+			/// Any other frame is gathered between two delimiters.
+			/// If the serial takes only part of it, the chunked path carries on from there.
+			/// </summary>
+			/// <returns>True if any of the frame went out.</returns>
+			bool WriteFrame(const uint32_t nowMicros)
+			{
+				static constexpr uint8_t Delimiter = MessageDefinition::Delimiter;
+
+				const uint16_t frameSize = (uint16_t)OutSize + 2;
+				if (Streaming
+					|| Through
+					|| Writer.AvailableForWrite() < frameSize)
+				{
+					return false;
+				}
+
+				uint16_t written;
+				if (Padded
+					&& OutData == OutBuffer)
+				{
+					uint8_t* frame = &OutBuffer[-1];
+					frame[0] = Delimiter;
+					frame[frameSize - 1] = Delimiter;
+					written = Writer.Write(frame, frameSize);
+					if (written > 0
+						&& Tap != nullptr)
+					{
+						Tap->OnWireBytes(WireDirectionEnum::Tx, nowMicros, frame, written);
+					}
+				}
+				else
+				{
+					const uint8_t* data[3]{ &Delimiter, OutData, &Delimiter };
+					const uint16_t sizes[3]{ 1, OutSize, 1 };
+					written = Writer.WriteGather(data, sizes, 3);
+					if (Tap != nullptr)
+					{
+						uint16_t left = written;
+						for (uint8_t i = 0; i < 3 && left > 0; i++)
+						{
+							const uint16_t size = (left < sizes[i]) ? left : sizes[i];
+							Tap->OnWireBytes(WireDirectionEnum::Tx, nowMicros, data[i], size);
+							left -= size;
+						}
+					}
+				}
+				ByteCount += written;
+
+				if (written == 0)
+				{
+					return false;
+				}
+				else if (written >= frameSize)
+				{
+					if (Driver != nullptr)
+					{
+						SendState = StateEnum::Draining;
+					}
+					else
+					{
+						OnTxDone();
+					}
+				}
+				else if (written > OutSize)
+				{
+					SendState = StateEnum::SendingEndDelimiter;
+				}
+				else
+				{
+					OutIndex = (uint8_t)(written - 1);
+					SendState = StateEnum::SendingData;
+				}
+
+				return true;
+			}
+
+			uint8_t PushOut(const uint32_t nowMicros)
+			{
+				uint8_t size = OutSize - OutIndex;
+
+				if (size > MaxSerialStepOut)
+				{
+					size = MaxSerialStepOut;
+				}
+
+				const uint16_t available = Writer.AvailableForWrite();
+				if (size > available)
+				{
+					size = available;
+				}
+
+				const uint16_t written = Writer.Write(&OutData[OutIndex], size);
+				ByteCount += written;
+				if (written > 0
+					&& Tap != nullptr)
+				{
+					Tap->OnWireBytes(WireDirectionEnum::Tx, nowMicros, &OutData[OutIndex], written);
+				}
+
+				return (uint8_t)written;
+			}
+
+			/// <summary>
+			/// False once the last block is out.
+			/// </summary>
+			bool IsStreaming() const
+			{
+				return BlockOpen || BlockDelimited;
+			}
+
+			/// <summary>
+			/// Writes up to MaxSerialStepOut encoded bytes: unencoded ones first, then each block's code and its bytes.
+			/// A block's bytes hold no delimiter, so they go out as they are.
+			/// </summary>
+			void PushStreaming(const uint32_t nowMicros)
+			{
+				uint16_t budget = Writer.AvailableForWrite();
+				if (budget > MaxSerialStepOut)
+				{
+					budget = MaxSerialStepOut;
+				}
+
+				while (budget > 0
+					&& IsStreaming())
+				{
+					if (OutIndex < RawSize)
+					{
+						uint8_t size = RawSize - OutIndex;
+						if (size > budget)
+						{
+							size = (uint8_t)budget;
+						}
+
+						const uint16_t written = Write(&OutData[OutIndex], size, nowMicros);
+						OutIndex += (uint8_t)written;
+						if (written < size)
+						{
+							break;
+						}
+						budget -= written;
+					}
+					else if (!BlockOpen)
+					{
+						const uint8_t* delimiter = (const uint8_t*)memchr(&OutData[OutIndex], MessageDefinition::Delimiter, OutSize - OutIndex);
+						const uint8_t blockSize = (delimiter != nullptr) ? (uint8_t)(delimiter - &OutData[OutIndex]) : (uint8_t)(OutSize - OutIndex);
+						const uint8_t code = blockSize + UartCobsCodec::Codes::EndReplacement;
+
+						if (Write(&code, 1, nowMicros) == 0)
+						{
+							break;
+						}
+						budget--;
+						BlockRemaining = blockSize;
+						BlockDelimited = delimiter != nullptr;
+						BlockOpen = true;
+					}
+					else
+					{
+						uint8_t size = BlockRemaining;
+						if (size > budget)
+						{
+							size = (uint8_t)budget;
+						}
+
+						const uint16_t written = (size > 0) ? Write(&OutData[OutIndex], size, nowMicros) : 0;
+						OutIndex += (uint8_t)written;
+						BlockRemaining -= (uint8_t)written;
+						budget -= written;
+
+						if (BlockRemaining > 0)
+						{
+							break;
+						}
+
+						// The delimiter is carried by the next block's code.
+						BlockOpen = false;
+						if (BlockDelimited)
+						{
+							OutIndex++;
+						}
+					}
+				}
+			}
+
+			uint16_t Write(const uint8_t* data, const uint8_t size, const uint32_t nowMicros)
+			{
+				const uint16_t written = Writer.Write(data, size);
+				ByteCount += written;
+				if (written > 0
+					&& Tap != nullptr)
+				{
+					Tap->OnWireBytes(WireDirectionEnum::Tx, nowMicros, data, written);
+				}
+
+				return written;
+			}
+		};
+	}
+}
+#endif
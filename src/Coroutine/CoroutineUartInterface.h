@@ -0,0 +1,586 @@
+#ifndef _UART_INTERFACE_COROUTINE_h
+#define _UART_INTERFACE_COROUTINE_h
+
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#include <stddef.h>
+
+#define _TASK_OO_CALLBACKS
+#include <TSchedulerDeclarations.hpp>
+
+#include "../Task/UartInterfaceTask.h"
+
+namespace UartInterface
+{
+	/// <summary>
+	/// C++20 coroutine layer for host builds.
+	/// Awaitable Send()/Receive() on top of the UartInterfaceTask state machines, without heap use.
+	/// </summary>
+	namespace Coroutine
+	{
+		/// <summary>
+		/// Fixed pool of coroutine frames.
+		/// </summary>
+		template<size_t FrameSize, uint8_t FrameCount>
+		class CoroutineFramePool
+		{
+		private:
+			alignas(max_align_t) uint8_t Frames[FrameCount][FrameSize]{};
+			bool Used[FrameCount]{};
+
+		public:
+			void* Allocate(const size_t size)
+			{
+				if (size <= FrameSize)
+				{
+					for (uint8_t i = 0; i < FrameCount; i++)
+					{
+						if (!Used[i])
+						{
+							Used[i] = true;
+
+							return Frames[i];
+						}
+					}
+				}
+
+				return nullptr;
+			}
+
+			void Free(void* frame)
+			{
+				for (uint8_t i = 0; i < FrameCount; i++)
+				{
+					if (frame == Frames[i])
+					{
+						Used[i] = false;
+						break;
+					}
+				}
+			}
+
+			uint8_t GetFreeCount() const
+			{
+				uint8_t count = 0;
+				for (uint8_t i = 0; i < FrameCount; i++)
+				{
+					count += !Used[i];
+				}
+
+				return count;
+			}
+		};
+
+		/// <summary>
+		/// Resumes a waiting coroutine.
+		/// One ending on an exception stops at its final suspend point: its frame goes back to the pool, and the exception on to the caller.
+		/// </summary>
+		inline void Resume(const std::coroutine_handle<> handle)
+		{
+#if defined(__cpp_exceptions)
+			try
+			{
+				handle.resume();
+			}
+			catch (...)
+			{
+				if (handle.done())
+				{
+					handle.destroy();
+				}
+				throw;
+			}
+#else
+			handle.resume();
+#endif
+		}
+
+		/// <summary>
+		/// Eagerly started, self-destroying coroutine, with frames from a fixed pool.
+		/// Invalid if the pool was exhausted, the coroutine body then never runs.
+		/// An exception leaving the body is rethrown to whoever ran it last: its caller, or the interface's Callback() that resumed it.
+		/// </summary>
+		template<size_t FrameSize, uint8_t FrameCount>
+		class BasicUartCoroutine
+		{
+		public:
+			using FramePoolType = CoroutineFramePool<FrameSize, FrameCount>;
+
+			struct promise_type
+			{
+				inline static FramePoolType Pool{};
+
+				static void* operator new(const size_t size) noexcept
+				{
+					return Pool.Allocate(size);
+				}
+
+				static void operator delete(void* frame) noexcept
+				{
+					Pool.Free(frame);
+				}
+
+				static BasicUartCoroutine get_return_object_on_allocation_failure()
+				{
+					return BasicUartCoroutine(false);
+				}
+
+				BasicUartCoroutine get_return_object()
+				{
+					return BasicUartCoroutine(true);
+				}
+
+				std::suspend_never initial_suspend() noexcept { return {}; }
+				std::suspend_never final_suspend() noexcept { return {}; }
+				void return_void() {}
+				void unhandled_exception()
+				{
+#if defined(__cpp_exceptions)
+					throw;
+#endif
+				}
+			};
+
+		private:
+			bool Started;
+
+			BasicUartCoroutine(const bool started)
+				: Started(started)
+			{
+			}
+
+		public:
+			bool Valid() const
+			{
+				return Started;
+			}
+
+			static uint8_t GetFreeFrames()
+			{
+				return promise_type::Pool.GetFreeCount();
+			}
+		};
+
+		using UartCoroutine = BasicUartCoroutine<1024, 8>;
+
+		enum class SendResultEnum : uint8_t
+		{
+			Sent,
+			Busy,
+			Timeout,
+			TxError,
+			Disconnected
+		};
+
+		template<uint8_t MaxPayloadSize>
+		struct ReceivedMessage
+		{
+			bool Valid;
+			uint8_t Header;
+			uint8_t PayloadSize;
+			uint8_t Payload[MaxPayloadSize];
+		};
+
+		/// <summary>
+		/// UartInterfaceTask with awaitable Send() and Receive().
+		/// TX: one frame in flight, up to MaxSendWaiters queued, each completes on OnUartTx/OnUartTxError or its timeout.
+		/// RX: up to MaxReceiveWaiters, matched by header. Unclaimed messages and all other events go to the listener.
+		/// </summary>
+		template<typename SerialType,
+			typename UartDefinitions = UartInterface::TemplateUartDefinitions<>,
+			uint8_t MaxSendWaiters = 4,
+			uint8_t MaxReceiveWaiters = 4>
+		class CoroutineUartInterface : public TS::Task, public UartListener
+		{
+		public:
+			using ReceivedMessageType = ReceivedMessage<UartDefinitions::MaxPayloadSize>;
+
+			struct SendAwaiter
+			{
+				CoroutineUartInterface& Owner;
+				const uint8_t* Payload;
+				uint32_t TimeoutMillis;
+				uint32_t Deadline = 0;
+				std::coroutine_handle<> Handle{};
+				uint8_t Header;
+				uint8_t PayloadSize;
+				SendResultEnum Result = SendResultEnum::Busy;
+
+				bool await_ready() const noexcept
+				{
+					return false;
+				}
+
+				bool await_suspend(std::coroutine_handle<> handle)
+				{
+					Handle = handle;
+
+					return Owner.SuspendSend(this);
+				}
+
+				SendResultEnum await_resume() const noexcept
+				{
+					return Result;
+				}
+			};
+
+			struct ReceiveAwaiter
+			{
+				CoroutineUartInterface& Owner;
+				uint32_t TimeoutMillis;
+				uint32_t Deadline = 0;
+				std::coroutine_handle<> Handle{};
+				ReceivedMessageType Message{};
+
+				bool await_ready() const noexcept
+				{
+					return false;
+				}
+
+				bool await_suspend(std::coroutine_handle<> handle)
+				{
+					Handle = handle;
+
+					return Owner.SuspendReceive(this);
+				}
+
+				ReceivedMessageType await_resume() const noexcept
+				{
+					return Message;
+				}
+			};
+
+		private:
+			UartInterfaceTask<SerialType, UartDefinitions> Interface;
+
+			UartListener* Listener;
+
+			SendAwaiter* ActiveSend = nullptr;
+			SendAwaiter* SendWaiters[MaxSendWaiters]{};
+			ReceiveAwaiter* ReceiveWaiters[MaxReceiveWaiters]{};
+			uint8_t SendWaiterCount = 0;
+
+		public:
+			CoroutineUartInterface(TS::Scheduler& scheduler, SerialType& serialInstance, UartListener* listener,
+				const uint8_t* key,
+				const uint8_t keySize)
+				: TS::Task(UartDefinitions::PollPeriodMillis, TASK_FOREVER, &scheduler, false)
+				, Interface(scheduler, serialInstance, this, key, keySize)
+				, Listener(listener)
+			{
+			}
+
+			bool Setup()
+			{
+				return Interface.Setup();
+			}
+
+			void Start()
+			{
+				Interface.Start();
+			}
+
+			void Stop()
+			{
+				Interface.Stop();
+				FailAll();
+			}
+
+			UartInterfaceTask<SerialType, UartDefinitions>& GetInterface()
+			{
+				return Interface;
+			}
+
+			/// <summary>
+			/// co_await resumes once the frame is fully written, failed, or timed out waiting for the link.
+			/// The payload must stay valid until then.
+			/// </summary>
+			SendAwaiter Send(const uint8_t header, const uint8_t* payload = nullptr, const uint8_t payloadSize = 0,
+				const uint32_t timeoutMillis = UartDefinitions::WriteTimeoutMillis)
+			{
+				return SendAwaiter{ *this, payload, timeoutMillis, 0, {}, header, payloadSize };
+			}
+
+			/// <summary>
+			/// co_await resumes with the next message with this header, or invalid on timeout.
+			/// </summary>
+			/// <param name="timeoutMillis">0 waits forever.</param>
+			ReceiveAwaiter Receive(const uint8_t header, const uint32_t timeoutMillis = 0)
+			{
+				ReceiveAwaiter awaiter{ *this, timeoutMillis };
+				awaiter.Message.Header = header;
+
+				return awaiter;
+			}
+
+		public:
+			bool Callback() final
+			{
+				DispatchSend();
+
+				const uint32_t now = TaskClock::Millis();
+
+				for (uint8_t i = 0; i < SendWaiterCount; i++)
+				{
+					if ((int32_t)(now - SendWaiters[i]->Deadline) >= 0)
+					{
+						SendAwaiter* waiter = SendWaiters[i];
+						RemoveSendWaiter(i);
+						waiter->Result = SendResultEnum::Timeout;
+						Resume(waiter->Handle);
+
+						return true;
+					}
+				}
+
+				for (uint8_t i = 0; i < MaxReceiveWaiters; i++)
+				{
+					if (ReceiveWaiters[i] != nullptr
+						&& ReceiveWaiters[i]->TimeoutMillis > 0
+						&& (int32_t)(now - ReceiveWaiters[i]->Deadline) >= 0)
+					{
+						ReceiveAwaiter* waiter = ReceiveWaiters[i];
+						ReceiveWaiters[i] = nullptr;
+						waiter->Message.Valid = false;
+						Resume(waiter->Handle);
+
+						return true;
+					}
+				}
+
+				if (!HasTimedWaiters())
+				{
+					TS::Task::disable();
+				}
+
+				return true;
+			}
+
+		public:
+			void OnUartStateChange(const bool connected) final
+			{
+				if (!connected)
+				{
+					FailAll();
+				}
+
+				if (Listener != nullptr)
+				{
+					Listener->OnUartStateChange(connected);
+				}
+			}
+
+			void OnUartRx(const uint8_t header) final
+			{
+				if (!ResumeReceive(header, nullptr, 0)
+					&& Listener != nullptr)
+				{
+					Listener->OnUartRx(header);
+				}
+			}
+
+			void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+			{
+				if (!ResumeReceive(header, payload, payloadSize)
+					&& Listener != nullptr)
+				{
+					Listener->OnUartRx(header, payload, payloadSize);
+				}
+			}
+
+			void OnUartTx() final
+			{
+				if (!CompleteSend(SendResultEnum::Sent)
+					&& Listener != nullptr)
+				{
+					Listener->OnUartTx();
+				}
+			}
+
+			void OnUartRxError(const RxErrorEnum error) final
+			{
+				if (Listener != nullptr)
+				{
+					Listener->OnUartRxError(error);
+				}
+			}
+
+			void OnUartTxError(const TxErrorEnum error) final
+			{
+				if (!CompleteSend(SendResultEnum::TxError)
+					&& Listener != nullptr)
+				{
+					Listener->OnUartTxError(error);
+				}
+			}
+
+		private:
+			bool SuspendSend(SendAwaiter* awaiter)
+			{
+				if (ActiveSend == nullptr
+					&& SendWaiterCount == 0
+					&& StartSend(awaiter))
+				{
+					return true;
+				}
+				else if (SendWaiterCount < MaxSendWaiters)
+				{
+					awaiter->Deadline = TaskClock::Millis() + awaiter->TimeoutMillis;
+					SendWaiters[SendWaiterCount++] = awaiter;
+					TS::Task::enableIfNot();
+
+					return true;
+				}
+
+				awaiter->Result = SendResultEnum::Busy;
+
+				return false;
+			}
+
+			bool SuspendReceive(ReceiveAwaiter* awaiter)
+			{
+				for (uint8_t i = 0; i < MaxReceiveWaiters; i++)
+				{
+					if (ReceiveWaiters[i] == nullptr)
+					{
+						ReceiveWaiters[i] = awaiter;
+						if (awaiter->TimeoutMillis > 0)
+						{
+							awaiter->Deadline = TaskClock::Millis() + awaiter->TimeoutMillis;
+							TS::Task::enableIfNot();
+						}
+
+						return true;
+					}
+				}
+
+				awaiter->Message.Valid = false;
+
+				return false;
+			}
+
+			bool StartSend(SendAwaiter* awaiter)
+			{
+				const bool started = (awaiter->PayloadSize > 0)
+					? Interface.SendMessage(awaiter->Header, awaiter->Payload, awaiter->PayloadSize)
+					: Interface.SendMessage(awaiter->Header);
+
+				if (started)
+				{
+					ActiveSend = awaiter;
+				}
+
+				return started;
+			}
+
+			void DispatchSend()
+			{
+				if (ActiveSend == nullptr
+					&& SendWaiterCount > 0
+					&& StartSend(SendWaiters[0]))
+				{
+					RemoveSendWaiter(0);
+				}
+			}
+
+			bool CompleteSend(const SendResultEnum result)
+			{
+				if (ActiveSend != nullptr)
+				{
+					SendAwaiter* awaiter = ActiveSend;
+					ActiveSend = nullptr;
+					awaiter->Result = result;
+					if (SendWaiterCount > 0)
+					{
+						TS::Task::enableIfNot();
+					}
+					Resume(awaiter->Handle);
+
+					return true;
+				}
+
+				return false;
+			}
+
+			bool ResumeReceive(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize)
+			{
+				for (uint8_t i = 0; i < MaxReceiveWaiters; i++)
+				{
+					if (ReceiveWaiters[i] != nullptr
+						&& ReceiveWaiters[i]->Message.Header == header)
+					{
+						ReceiveAwaiter* awaiter = ReceiveWaiters[i];
+						ReceiveWaiters[i] = nullptr;
+						awaiter->Message.Valid = true;
+						awaiter->Message.PayloadSize = payloadSize;
+						if (payloadSize > 0)
+						{
+							memcpy(awaiter->Message.Payload, payload, payloadSize);
+						}
+						Resume(awaiter->Handle);
+
+						return true;
+					}
+				}
+
+				return false;
+			}
+
+			void RemoveSendWaiter(const uint8_t index)
+			{
+				for (uint8_t i = index + 1; i < SendWaiterCount; i++)
+				{
+					SendWaiters[i - 1] = SendWaiters[i];
+				}
+				SendWaiterCount--;
+			}
+
+			bool HasTimedWaiters() const
+			{
+				if (SendWaiterCount > 0)
+				{
+					return true;
+				}
+
+				for (uint8_t i = 0; i < MaxReceiveWaiters; i++)
+				{
+					if (ReceiveWaiters[i] != nullptr
+						&& ReceiveWaiters[i]->TimeoutMillis > 0)
+					{
+						return true;
+					}
+				}
+
+				return false;
+			}
+
+			/// <summary>
+			/// Fails the sends pending on disconnection. Sends queued by the resumed coroutines wait for their timeout.
+			/// Receivers keep waiting for the link to come back.
+			/// </summary>
+			void FailAll()
+			{
+				uint8_t pending = SendWaiterCount + (ActiveSend != nullptr);
+
+				while (pending-- > 0
+					&& (ActiveSend != nullptr || SendWaiterCount > 0))
+				{
+					SendAwaiter* awaiter = ActiveSend;
+					if (awaiter != nullptr)
+					{
+						ActiveSend = nullptr;
+					}
+					else
+					{
+						awaiter = SendWaiters[0];
+						RemoveSendWaiter(0);
+					}
+					awaiter->Result = SendResultEnum::Disconnected;
+					Resume(awaiter->Handle);
+				}
+			}
+		};
+	}
+}
+#endif
+#endif
@@ -0,0 +1,497 @@
+#ifndef _UART_INTERFACE_CREDITED_h
+#define _UART_INTERFACE_CREDITED_h
+
+#define _TASK_OO_CALLBACKS
+#include <TSchedulerDeclarations.hpp>
+
+#include "../Task/UartInterfaceTask.h"
+
+namespace UartInterface
+{
+	/// <summary>
+	/// Credit-based receiver flow control, so a fast sender never overruns a slow receiver's RX FIFO.
+	/// </summary>
+	namespace FlowControl
+	{
+		/// <summary>
+		/// Flow control window and timing.
+		/// </summary>
+		/// <typeparam name="header">Reserved message header for credit frames, never delivered to the listener, nor sent by the application.</typeparam>
+		/// <typeparam name="rxWindow">RX bytes the peer may have outstanding towards this end.
+		///  Keep a credit frame's worth of headroom (CreditFrameSize) below the driver RX FIFO depth.</typeparam>
+		/// <typeparam name="creditThreshold">Consumed bytes that trigger a credit frame, 0 for the largest that never stalls the peer.</typeparam>
+		/// <typeparam name="refreshMillis">Consumed bytes below the threshold are credited after this long.</typeparam>
+		/// <typeparam name="stallMillis">Without credit for this long, the sender requests it.</typeparam>
+		template<uint8_t header = UINT8_MAX - 1,
+			uint16_t rxWindow = 48,
+			uint16_t creditThreshold = 0,
+			uint32_t refreshMillis = 2,
+			uint32_t stallMillis = 20>
+		struct TemplateFlowControlDefinitions
+		{
+			static constexpr uint8_t Header = header;
+			static constexpr uint16_t RxWindow = rxWindow;
+			static constexpr uint16_t CreditThreshold = creditThreshold;
+			static constexpr uint32_t RefreshMillis = refreshMillis;
+			static constexpr uint32_t StallMillis = stallMillis;
+		};
+
+		/// <summary>
+		/// UartInterfaceTask that only sends what the peer has room for.
+		/// Each end counts the bytes it has sent and the bytes it has taken from its serial,
+		///  and advertises a limit of consumed + RxWindow, in the sender's count.
+		/// Credit frames carry both this end's limit (as a receiver) and its sent count (as a sender):
+		///  once a frame arrives, every byte sent before it has been consumed or lost, so the receiver resyncs its count to the sender's.
+		/// Lost bytes or credit frames only delay credit, until the next credit frame or a stalled sender's request.
+		/// Credit frames are sent for consumed application frames only, so both ends never keep crediting each other's credit frames.
+		/// SendMessage() fails while the frame does not fit in the credit, as when the serial is busy.
+		/// Point-to-point only, both ends must use flow control.
+		/// </summary>
+		template<typename SerialType,
+			typename UartDefinitions,
+			typename FlowControlDefinitions = TemplateFlowControlDefinitions<>>
+		class CreditedUartInterface : public TS::Task, public UartListener
+		{
+		public:
+			/// <summary>
+			/// Bytes on the wire for a message, delimiters and FEC parity included.
+			/// </summary>
+			static constexpr uint16_t GetFrameSize(const uint8_t payloadSize)
+			{
+				return (uint16_t)MessageDefinition::GetBufferSizeFromPayload(payloadSize) + UartDefinitions::FecParitySize + 2;
+			}
+
+			static constexpr uint8_t CreditPayloadSize = 5;
+			static constexpr uint16_t CreditFrameSize = GetFrameSize(CreditPayloadSize);
+
+		private:
+			static constexpr uint16_t FrameSizeMax = GetFrameSize(UartDefinitions::MaxPayloadSize);
+
+			/// <summary>
+			/// With at most Threshold bytes left uncredited, the peer always has credit for its largest frame.
+			/// </summary>
+			static constexpr uint16_t Threshold = (FlowControlDefinitions::CreditThreshold > 0) ? FlowControlDefinitions::CreditThreshold
+				: ((FlowControlDefinitions::RxWindow > FrameSizeMax) ? (FlowControlDefinitions::RxWindow - FrameSizeMax) : 1);
+
+			static_assert(!UartDefinitions::Addressed, "Flow control is point-to-point.");
+			static_assert(UartDefinitions::MaxPayloadSize >= CreditPayloadSize, "Credit frames need a 5 byte payload.");
+			static_assert(FlowControlDefinitions::RxWindow >= FrameSizeMax, "RX window must fit the largest frame.");
+			static_assert(FlowControlDefinitions::RxWindow <= INT16_MAX, "RX window must fit the 16 bit counts.");
+			static_assert(Threshold <= FlowControlDefinitions::RxWindow, "Credit threshold must be within the RX window.");
+
+			enum class FlagsEnum : uint8_t
+			{
+				/// <summary>
+				/// Limit is in the peer's sent count.
+				/// </summary>
+				Synced = 1,
+
+				/// <summary>
+				/// The sender is out of credit, a credit frame is requested.
+				/// </summary>
+				Request = 2
+			};
+
+			enum class FieldIndexEnum : uint8_t
+			{
+				Flags = 0,
+				Limit = 1,
+				Sent = 3
+			};
+
+		private:
+			UartInterfaceTask<SerialType, UartDefinitions> Interface;
+
+			UartListener* Listener;
+
+		private:
+			uint32_t LastCredit = 0;
+			uint32_t LastCreditSent = 0;
+			uint32_t LastRequest = 0;
+			uint32_t StallCount = 0;
+			uint32_t CreditFrameCount = 0;
+
+			uint16_t TxLimit = 0;
+			uint16_t RxOffset = 0;
+			uint16_t ConsumedMark = 0;
+			uint16_t Uncredited = 0;
+
+			bool Connected = false;
+			bool CreditValid = false;
+			bool RxSynced = false;
+			bool Starved = false;
+			bool CreditPending = false;
+			bool RequestPending = false;
+			bool ControlInFlight = false;
+
+		public:
+			CreditedUartInterface(TS::Scheduler& scheduler, SerialType& serialInstance, UartListener* listener,
+				const uint8_t* key,
+				const uint8_t keySize)
+				: TS::Task(UartDefinitions::PollPeriodMillis, TASK_FOREVER, &scheduler, false)
+				, Interface(scheduler, serialInstance, this, key, keySize)
+				, Listener(listener)
+			{
+			}
+
+			bool Setup()
+			{
+				return Interface.Setup();
+			}
+
+			void Start()
+			{
+				Reset();
+				StallCount = 0;
+				CreditFrameCount = 0;
+				Interface.Start();
+			}
+
+			void Stop()
+			{
+				Interface.Stop();
+				Reset();
+				TS::Task::disable();
+			}
+
+			UartInterfaceTask<SerialType, UartDefinitions>& GetInterface()
+			{
+				return Interface;
+			}
+
+			/// <summary>
+			/// Bytes the peer can still absorb, 0 until its first credit.
+			/// </summary>
+			uint16_t GetCredit()
+			{
+				if (!CreditValid)
+				{
+					return 0;
+				}
+
+				const int16_t credit = (int16_t)(TxLimit - GetSent());
+
+				return (credit > 0) ? (uint16_t)credit : 0;
+			}
+
+			/// <summary>
+			/// Sends refused for lack of credit, since Start().
+			/// </summary>
+			uint32_t GetStallCount() const
+			{
+				return StallCount;
+			}
+
+			/// <summary>
+			/// Credit frames sent, since Start().
+			/// </summary>
+			uint32_t GetCreditFrameCount() const
+			{
+				return CreditFrameCount;
+			}
+
+			/// <summary>
+			/// True if a message of payloadSize can be sent now.
+			/// </summary>
+			bool CanSendMessage(const uint8_t payloadSize = 0)
+			{
+				return !ControlInFlight
+					&& !CreditPending
+					&& !RequestPending
+					&& Interface.CanSendMessage()
+					&& HasCredit(GetFrameSize(payloadSize));
+			}
+
+			/// <summary>
+			/// The reserved FlowControlDefinitions::Header is refused.
+			/// </summary>
+			bool SendMessage(const uint8_t header)
+			{
+				return header != FlowControlDefinitions::Header
+					&& CheckSend(0)
+					&& Interface.SendMessage(header);
+			}
+
+			bool SendMessage(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize)
+			{
+				return header != FlowControlDefinitions::Header
+					&& CheckSend(payloadSize)
+					&& Interface.SendMessage(header, payload, payloadSize);
+			}
+
+			template<typename PayloadType>
+			bool SendMessage(const uint8_t header, const PayloadType& payload)
+			{
+				static_assert(PayloadTypeCheck<PayloadType>::Valid, "Payload type must be a trivially copyable value, not a pointer.");
+
+				return header != FlowControlDefinitions::Header
+					&& CheckSend(sizeof(PayloadType))
+					&& Interface.SendMessage(header, payload);
+			}
+
+		public:
+			bool Callback() final
+			{
+				const uint32_t now = TaskClock::Millis();
+
+				if (RxSynced
+					&& Uncredited > 0
+					&& now - LastCreditSent >= FlowControlDefinitions::RefreshMillis)
+				{
+					CreditPending = true;
+				}
+
+				if ((!CreditValid || Starved)
+					&& now - LastCredit >= FlowControlDefinitions::StallMillis
+					&& now - LastRequest >= FlowControlDefinitions::StallMillis)
+				{
+					RequestPending = true;
+					LastRequest = now;
+				}
+
+				SendPending(now);
+
+				if (!Connected)
+				{
+					TS::Task::disable();
+				}
+
+				return true;
+			}
+
+		public:
+			void OnUartStateChange(const bool connected) final
+			{
+				Reset();
+				if (connected)
+				{
+					const uint32_t now = TaskClock::Millis();
+					Connected = true;
+					LastCredit = now;
+					LastCreditSent = now;
+					LastRequest = now;
+					RequestPending = true;
+					TS::Task::enableIfNot();
+				}
+
+				if (Listener != nullptr)
+				{
+					Listener->OnUartStateChange(connected);
+				}
+			}
+
+			void OnUartRx(const uint8_t header) final
+			{
+				OnFrameConsumed();
+				if (header != FlowControlDefinitions::Header
+					&& Listener != nullptr)
+				{
+					Listener->OnUartRx(header);
+				}
+			}
+
+			void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+			{
+				if (header == FlowControlDefinitions::Header)
+				{
+					if (payloadSize == CreditPayloadSize)
+					{
+						OnCredit(payload);
+					}
+					ConsumedMark = GetConsumed();
+					SendPending(TaskClock::Millis());
+				}
+				else
+				{
+					OnFrameConsumed();
+					if (Listener != nullptr)
+					{
+						Listener->OnUartRx(header, payload, payloadSize);
+					}
+				}
+			}
+
+			void OnUartTx() final
+			{
+				if (ControlInFlight)
+				{
+					ControlInFlight = false;
+					SendPending(TaskClock::Millis());
+				}
+				else if (Listener != nullptr)
+				{
+					Listener->OnUartTx();
+				}
+			}
+
+			void OnUartRxError(const RxErrorEnum error) final
+			{
+				OnFrameConsumed();
+				if (Listener != nullptr)
+				{
+					Listener->OnUartRxError(error);
+				}
+			}
+
+			void OnUartTxError(const TxErrorEnum error) final
+			{
+				if (ControlInFlight)
+				{
+					// The next credit frame carries the same, newer, counts.
+					ControlInFlight = false;
+				}
+				else if (Listener != nullptr)
+				{
+					Listener->OnUartTxError(error);
+				}
+			}
+
+		private:
+			void Reset()
+			{
+				Connected = false;
+				CreditValid = false;
+				RxSynced = false;
+				Starved = false;
+				CreditPending = false;
+				RequestPending = false;
+				ControlInFlight = false;
+				Uncredited = 0;
+			}
+
+			uint16_t GetSent()
+			{
+				return (uint16_t)Interface.GetCore().GetTxByteCount();
+			}
+
+			/// <summary>
+			/// Bytes taken from the serial, in the peer's sent count once synced.
+			/// </summary>
+			uint16_t GetConsumed()
+			{
+				return (uint16_t)(Interface.GetCore().GetRxByteCount() + RxOffset);
+			}
+
+			bool HasCredit(const uint16_t frameSize)
+			{
+				return CreditValid
+					&& (int16_t)(TxLimit - (uint16_t)(GetSent() + frameSize)) >= 0;
+			}
+
+			bool CheckSend(const uint8_t payloadSize)
+			{
+				if (ControlInFlight
+					|| CreditPending
+					|| RequestPending
+					|| !Interface.CanSendMessage())
+				{
+					return false;
+				}
+
+				if (!HasCredit(GetFrameSize(payloadSize)))
+				{
+					if (!Starved)
+					{
+						Starved = true;
+						StallCount++;
+					}
+
+					return false;
+				}
+
+				Starved = false;
+
+				return true;
+			}
+
+			/// <summary>
+			/// An application frame (or a corrupted one) has been taken from the serial, its bytes can be credited.
+			/// </summary>
+			void OnFrameConsumed()
+			{
+				const uint16_t consumed = GetConsumed();
+				Uncredited += (uint16_t)(consumed - ConsumedMark);
+				ConsumedMark = consumed;
+
+				if (RxSynced
+					&& Uncredited >= Threshold)
+				{
+					CreditPending = true;
+					SendPending(TaskClock::Millis());
+				}
+			}
+
+			void OnCredit(const uint8_t* payload)
+			{
+				const uint8_t flags = payload[(uint8_t)FieldIndexEnum::Flags];
+
+				// Every byte the peer sent up to the end of this frame has been consumed, or lost.
+				RxOffset = (uint16_t)(ReadUInt16(&payload[(uint8_t)FieldIndexEnum::Sent]) - (uint16_t)Interface.GetCore().GetRxByteCount());
+				if (!RxSynced)
+				{
+					RxSynced = true;
+					CreditPending = true;
+				}
+
+				if (flags & (uint8_t)FlagsEnum::Synced)
+				{
+					TxLimit = ReadUInt16(&payload[(uint8_t)FieldIndexEnum::Limit]);
+					CreditValid = true;
+					LastCredit = TaskClock::Millis();
+				}
+
+				if (flags & (uint8_t)FlagsEnum::Request)
+				{
+					CreditPending = true;
+				}
+			}
+
+			void SendPending(const uint32_t now)
+			{
+				if (ControlInFlight
+					|| (!CreditPending && !RequestPending)
+					|| !Interface.CanSendMessage())
+				{
+					return;
+				}
+
+				// Only requests may go beyond the credit, into the peer's headroom.
+				if (!RequestPending
+					&& CreditValid
+					&& !HasCredit(CreditFrameSize))
+				{
+					return;
+				}
+
+				const uint16_t consumed = GetConsumed();
+				uint8_t credit[CreditPayloadSize];
+				credit[(uint8_t)FieldIndexEnum::Flags] = (RxSynced ? (uint8_t)FlagsEnum::Synced : 0)
+					| (RequestPending ? (uint8_t)FlagsEnum::Request : 0);
+				WriteUInt16(&credit[(uint8_t)FieldIndexEnum::Limit], (uint16_t)(consumed + FlowControlDefinitions::RxWindow));
+				WriteUInt16(&credit[(uint8_t)FieldIndexEnum::Sent], (uint16_t)(GetSent() + CreditFrameSize));
+
+				if (Interface.SendMessage(FlowControlDefinitions::Header, credit, sizeof(credit)))
+				{
+					ControlInFlight = true;
+					CreditPending = false;
+					RequestPending = false;
+					LastCreditSent = now;
+					CreditFrameCount++;
+					Uncredited = 0;
+				}
+			}
+
+			static uint16_t ReadUInt16(const uint8_t* data)
+			{
+				return (uint16_t)(data[0] | ((uint16_t)data[1] << 8));
+			}
+
+			static void WriteUInt16(uint8_t* data, const uint16_t value)
+			{
+				data[0] = (uint8_t)value;
+				data[1] = (uint8_t)(value >> 8);
+			}
+		};
+	}
+}
+#endif
@@ -6,14 +6,85 @@
 
 namespace UartInterface
 {
-	template<uint32_t baudrate = 115200,
-		uint32_t maxPayloadSize = 64,
-		uint8_t maxSerialStepOut = 32,
-		uint8_t maxSerialStepIn = 32,
-		uint32_t writeTimeoutMillis = 50,
-		uint32_t readTimeoutMillis = 50,
-		uint32_t pollPeriodMillis = 1>
-	struct TemplateUartDefinitions
+	/// <summary>
+	/// Default settings.
+	/// Derive and override by name, e.g. struct MyDefs : UartInterface::UartDefaults { static constexpr uint8_t RxBatchSize = 8; };
+	/// </summary>
+	struct UartDefaults
+	{
+		static constexpr uint32_t Baudrate = 115200;
+		static constexpr uint32_t MaxPayloadSize = 64;
+		static constexpr uint8_t MaxSerialStepOut = 32;
+		static constexpr uint8_t MaxSerialStepIn = 32;
+
+		static constexpr uint32_t WriteTimeoutMillis = 50;
+		static constexpr uint32_t ReadTimeoutMillis = 50;
+		static constexpr uint32_t PollPeriodMillis = 1;
+
+		/// <summary>
+		/// Multi-drop framing, each frame starts with its destination address.
+		/// </summary>
+		static constexpr bool Addressed = false;
+
+		/// <summary>
+		/// Half-duplex line driver settle time, before the first and after the last byte.
+		/// </summary>
+		static constexpr uint32_t TurnaroundMicros = 0;
+
+		/// <summary>
+		/// RX frame buffers, one accumulates while the listener keeps (leases) the others.
+		/// </summary>
+		static constexpr uint8_t RxPoolSize = 1;
+
+		/// <summary>
+		/// Pool exhaustion policy.
+		/// False: the last free buffer is never leased, the listener must copy instead.
+		/// True: every lease is granted, and incoming frames are dropped (RxErrorEnum::PoolExhausted) until a buffer is released.
+		/// </summary>
+		static constexpr bool RxPoolDropNewest = false;
+
+		/// <summary>
+		/// Reed-Solomon parity bytes appended to each frame, 0 for none.
+		/// Up to half as many byte errors per frame are corrected, before the CRC check. Both ends must match.
+		/// </summary>
+		static constexpr uint8_t FecParitySize = 0;
+
+		/// <summary>
+		/// RX stops polling once the line is idle, and only runs again on OnSerialEvent(), a send, or OnConnectionChange().
+		/// Every serial RX must then reach OnSerialEvent(). False polls every PollPeriodMillis while idle.
+		/// </summary>
+		static constexpr bool EventDrivenIdle = false;
+
+		/// <summary>
+		/// Event-driven idle safety net, an idle poll every so often in case an event was missed. 0 for none.
+		/// </summary>
+		static constexpr uint32_t IdleSafetyMillis = 0;
+
+		/// <summary>
+		/// TX sends the raw message, COBS encoded on the fly into the serial's free space.
+		/// Transmission starts right after the CRC, instead of after the whole frame is encoded.
+		/// </summary>
+		static constexpr bool StreamingTx = false;
+
+		/// <summary>
+		/// RX frames completed in one pass are handed over together with OnUartRxBatch(), up to this many. 0 for OnUartRx() on each frame.
+		/// The batch is kept in the RX pool, RxPoolSize must be at least as large, and LeaseRx() is not available.
+		/// </summary>
+		static constexpr uint8_t RxBatchSize = 0;
+	};
+
+	/// <summary>
+	/// UartDefaults with the basic settings given in place.
+	/// Derive from it to override the others by name.
+	/// </summary>
+	template<uint32_t baudrate = UartDefaults::Baudrate,
+		uint32_t maxPayloadSize = UartDefaults::MaxPayloadSize,
+		uint8_t maxSerialStepOut = UartDefaults::MaxSerialStepOut,
+		uint8_t maxSerialStepIn = UartDefaults::MaxSerialStepIn,
+		uint32_t writeTimeoutMillis = UartDefaults::WriteTimeoutMillis,
+		uint32_t readTimeoutMillis = UartDefaults::ReadTimeoutMillis,
+		uint32_t pollPeriodMillis = UartDefaults::PollPeriodMillis>
+	struct TemplateUartDefinitions : UartDefaults
 	{
 		static constexpr uint32_t Baudrate = baudrate;
 		static constexpr uint32_t MaxPayloadSize = maxPayloadSize;
@@ -36,6 +107,15 @@ namespace UartInterface
 		};
 
 		static constexpr uint8_t Delimiter = UartCobsCodec::Codes::Delimiter;
+
+		/// <summary>
+		/// Optional destination address, sent unencoded right after the start delimiter and bound into the CRC.
+		/// Any value but the Delimiter, AddressBroadcast reaches every node.
+		/// A node with AddressPromiscuous accepts every frame.
+		/// </summary>
+		static constexpr uint8_t AddressSize = 1;
+		static constexpr uint8_t AddressBroadcast = UINT8_MAX;
+		static constexpr uint8_t AddressPromiscuous = Delimiter;
 		static constexpr uint8_t CrcSize = KeyedCrc::CrcSize;
 		static constexpr uint8_t MessageSizeMin = (uint8_t)FieldIndexEnum::Payload;
 		static constexpr uint8_t MessageSizeMax = UartCobsCodec::DataSizeMax;
@@ -62,6 +142,22 @@ namespace UartInterface
 		}
 	};
 
+	/// <summary>
+	/// Fixed size payload types are sent as their bytes: trivially copyable values, not pointers.
+	/// Local trait, <type_traits> is missing on AVR.
+	/// </summary>
+	template<typename PayloadType>
+	struct PayloadTypeCheck
+	{
+		static constexpr bool Valid = __is_trivially_copyable(PayloadType);
+	};
+
+	template<typename PayloadType>
+	struct PayloadTypeCheck<PayloadType*>
+	{
+		static constexpr bool Valid = false;
+	};
+
 	enum class TxErrorEnum : uint8_t
 	{
 		StartTimeout,
@@ -75,7 +171,18 @@ namespace UartInterface
 		Crc,
 		TooShort,
 		TooLong,
-		EndTimeout
+		EndTimeout,
+		PoolExhausted
+	};
+
+	/// <summary>
+	/// Received message, its payload only valid during the callback.
+	/// </summary>
+	struct RxFrame
+	{
+		const uint8_t* Payload;
+		uint8_t PayloadSize;
+		uint8_t Header;
 	};
 
 	struct UartListener
@@ -85,10 +192,63 @@ namespace UartInterface
 		virtual void OnUartRx(const uint8_t header) = 0;
 		virtual void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) = 0;
 
+		/// <summary>
+		/// Valid frames completed in one RX pass, in order, with UartDefinitions::RxBatchSize > 0.
+		/// Defaults to an OnUartRx() for each.
+		/// </summary>
+		virtual void OnUartRxBatch(const RxFrame* frames, const uint8_t count)
+		{
+			for (uint8_t i = 0; i < count; i++)
+			{
+				if (frames[i].PayloadSize > 0)
+				{
+					OnUartRx(frames[i].Header, frames[i].Payload, frames[i].PayloadSize);
+				}
+				else
+				{
+					OnUartRx(frames[i].Header);
+				}
+			}
+		}
+
 		virtual void OnUartTx() = 0;
 
 		virtual void OnUartRxError(const RxErrorEnum error) = 0;
 		virtual void OnUartTxError(const TxErrorEnum error) = 0;
 	};
+
+	enum class WireDirectionEnum : uint8_t
+	{
+		Rx,
+		Tx
+	};
+
+	/// <summary>
+	/// Raw wire byte tap, for capture. Called with the bytes as they are taken from or handed to the serial.
+	/// </summary>
+	struct WireTap
+	{
+		virtual void OnWireBytes(const WireDirectionEnum direction, const uint32_t timestampMicros, const uint8_t* data, const uint16_t size) = 0;
+	};
+
+	/// <summary>
+	/// Encoded RX frames, handed over as they accumulate, e.g. to forward them as they are.
+	/// Bytes come without delimiters, and every frame that got any ends with a single OnFrameEnd().
+	/// </summary>
+	struct FrameSink
+	{
+		virtual void OnFrameBytes(const uint8_t* data, const uint8_t size) = 0;
+
+		/// <param name="valid">True if the frame decoded and passed the CRC, false if it failed or was cut short.</param>
+		virtual void OnFrameEnd(const bool valid) = 0;
+	};
+
+	/// <summary>
+	/// Half-duplex (RS-485) transceiver direction control.
+	/// </summary>
+	struct LineDriver
+	{
+		virtual void OnLineDriverEnable(const bool enabled) = 0;
+	};
 }
 #endif
\ No newline at end of file
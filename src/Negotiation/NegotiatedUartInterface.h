@@ -0,0 +1,789 @@
+#ifndef _UART_INTERFACE_NEGOTIATED_h
+#define _UART_INTERFACE_NEGOTIATED_h
+
+#define _TASK_OO_CALLBACKS
+#include <TSchedulerDeclarations.hpp>
+
+#include "../Task/UartInterfaceTask.h"
+
+namespace UartInterface
+{
+	/// <summary>
+	/// In-band baud rate negotiation, from UartDefinitions::Baudrate up to the fastest reliable candidate.
+	/// </summary>
+	namespace Negotiation
+	{
+		/// <summary>
+		/// Compile-time candidate rates, ascending.
+		/// The first is the base rate, where every link starts and falls back to.
+		/// </summary>
+		template<uint32_t... Rates>
+		struct TemplateBaudRates
+		{
+			static constexpr uint8_t Count = sizeof...(Rates);
+			static constexpr uint32_t Values[sizeof...(Rates)]{ Rates... };
+
+			static_assert(Count > 0 && Count <= 8, "1 to 8 candidate rates.");
+
+			static constexpr uint32_t Get(const uint8_t index)
+			{
+				return Values[index];
+			}
+
+			static constexpr uint32_t GetBase()
+			{
+				return Values[0];
+			}
+
+			static constexpr uint8_t GetAllMask()
+			{
+				return (uint8_t)((1U << Count) - 1);
+			}
+
+			static constexpr bool IsAscending(const uint8_t index = 1)
+			{
+				return index >= Count || (Values[index - 1] < Values[index] && IsAscending(index + 1));
+			}
+		};
+
+		template<uint32_t... Rates>
+		constexpr uint32_t TemplateBaudRates<Rates...>::Values[sizeof...(Rates)];
+
+		/// <summary>
+		/// Negotiation timing and thresholds.
+		/// </summary>
+		/// <typeparam name="header">Reserved message header for negotiation frames, never delivered to the listener, nor sent by the application.</typeparam>
+		/// <typeparam name="probeCount">Test frames each way, all must arrive intact to accept a rate.</typeparam>
+		/// <typeparam name="switchGuardMillis">Settle time around a rate switch, on top of the last frame's drain.</typeparam>
+		/// <typeparam name="verifyTimeoutMillis">Time to exchange all test frames at a new rate.</typeparam>
+		/// <typeparam name="keepAliveMillis">Idle period before a keep-alive, above the base rate.</typeparam>
+		/// <typeparam name="errorBurst">RX errors within errorWindowMillis that drop the link back to the base rate.</typeparam>
+		/// <typeparam name="retryMillis">Offer retransmission period.</typeparam>
+		/// <typeparam name="maxAttempts">Failed attempts before a candidate is excluded, until the next disconnect.</typeparam>
+		template<uint8_t header = UINT8_MAX,
+			uint8_t probeCount = 8,
+			uint32_t switchGuardMillis = 5,
+			uint32_t verifyTimeoutMillis = 100,
+			uint32_t keepAliveMillis = 50,
+			uint8_t errorBurst = 4,
+			uint32_t errorWindowMillis = 100,
+			uint32_t retryMillis = 50,
+			uint8_t maxAttempts = 2>
+		struct TemplateNegotiationDefinitions
+		{
+			static constexpr uint8_t Header = header;
+			static constexpr uint8_t ProbeCount = probeCount;
+			static constexpr uint32_t SwitchGuardMillis = switchGuardMillis;
+			static constexpr uint32_t VerifyTimeoutMillis = verifyTimeoutMillis;
+			static constexpr uint32_t KeepAliveMillis = keepAliveMillis;
+			static constexpr uint8_t ErrorBurst = errorBurst;
+			static constexpr uint32_t ErrorWindowMillis = errorWindowMillis;
+			static constexpr uint32_t RetryMillis = retryMillis;
+			static constexpr uint8_t MaxAttempts = maxAttempts;
+
+			/// <summary>
+			/// Silence above the base rate that drops the link back to it.
+			/// </summary>
+			static constexpr uint32_t LivenessTimeoutMillis = keepAliveMillis * 3;
+
+			/// <summary>
+			/// Unanswered offers before settling at the base rate, until the peer offers.
+			/// </summary>
+			static constexpr uint8_t MaxOfferRetries = 8;
+		};
+
+		/// <summary>
+		/// UartInterfaceTask that negotiates the fastest reliable baud rate with its peer, after each connection.
+		/// Both ends exchange their supported candidates and acknowledge each other's (Offer),
+		///  switch to the fastest common one after a guard time, and exchange test frames (Probe, Verified).
+		/// A rate that fails verification is retried up to MaxAttempts, then excluded and the next one down is tried.
+		/// Above the base rate, an RX error burst or a silent link drops back to the base rate and renegotiates.
+		/// The application can only send while not negotiating. Point-to-point only, both ends must negotiate.
+		/// </summary>
+		template<typename SerialType,
+			typename UartDefinitions,
+			typename BaudRates,
+			typename NegotiationDefinitions = TemplateNegotiationDefinitions<>>
+		class NegotiatedUartInterface : public TS::Task, public UartListener
+		{
+		private:
+			static_assert(!UartDefinitions::Addressed, "Baud rate negotiation is point-to-point.");
+			static_assert(BaudRates::GetBase() == UartDefinitions::Baudrate, "The first candidate must be UartDefinitions::Baudrate.");
+			static_assert(BaudRates::IsAscending(), "Candidate rates must be ascending.");
+			static_assert(UartDefinitions::MaxPayloadSize >= 4, "Negotiation frames need a 4 byte payload.");
+
+			enum class OpcodeEnum : uint8_t
+			{
+				Offer,
+				Probe,
+				Verified,
+				Ping
+			};
+
+			enum class StateEnum : uint8_t
+			{
+				Disconnected,
+				Offering,
+				Switching,
+				Verifying,
+				Settled
+			};
+
+			struct OfferPayload
+			{
+				uint8_t Opcode;
+				uint8_t Mask;
+				uint8_t Acknowledged;
+			};
+
+			struct IndexPayload
+			{
+				uint8_t Opcode;
+				uint8_t Index;
+			};
+
+			static constexpr uint8_t ProbeSize = (UartDefinitions::MaxPayloadSize < MessageDefinition::PayloadSizeMax) ?
+				UartDefinitions::MaxPayloadSize : MessageDefinition::PayloadSizeMax;
+
+			static constexpr uint8_t ProbeHeaderSize = 3;
+
+			/// <summary>
+			/// Longest negotiation frame on the wire, for the switch drain time.
+			/// </summary>
+			static constexpr uint32_t ControlFrameBits = (MessageDefinition::GetBufferSizeFromPayload(sizeof(OfferPayload)) + UartDefinitions::FecParitySize + 2) * 10;
+
+		private:
+			UartInterfaceTask<SerialType, UartDefinitions> Interface;
+
+			UartListener* Listener;
+
+			uint8_t ProbeBuffer[ProbeSize]{};
+
+		private:
+			uint32_t StateStart = 0;
+			uint32_t LastRx = 0;
+			uint32_t LastTx = 0;
+			uint32_t ErrorWindowStart = 0;
+			uint32_t SwitchCount = 0;
+			uint32_t FallbackCount = 0;
+
+			uint8_t Failures[BaudRates::Count]{};
+			uint8_t Supported = BaudRates::GetAllMask();
+			uint8_t OfferedMask = 0;
+			uint8_t PeerMask = 0;
+			uint8_t Current = 0;
+			uint8_t Target = 0;
+			uint8_t OfferRetries = 0;
+			uint8_t ErrorCount = 0;
+			uint8_t ProbesSent = 0;
+			uint8_t ProbesReceived = 0;
+
+			StateEnum State = StateEnum::Disconnected;
+			OpcodeEnum InFlightOpcode = OpcodeEnum::Offer;
+
+			bool ControlInFlight = false;
+			bool FallbackPending = false;
+			bool InFlightAcknowledged = false;
+			bool PeerKnown = false;
+			bool PeerAcknowledged = false;
+			bool Acknowledged = false;
+			bool OfferPending = false;
+			bool VerifiedPending = false;
+			bool VerifiedSent = false;
+			bool PeerVerified = false;
+			bool PingPending = false;
+
+		public:
+			NegotiatedUartInterface(TS::Scheduler& scheduler, SerialType& serialInstance, UartListener* listener,
+				const uint8_t* key,
+				const uint8_t keySize)
+				: TS::Task(UartDefinitions::PollPeriodMillis, TASK_FOREVER, &scheduler, false)
+				, Interface(scheduler, serialInstance, this, key, keySize)
+				, Listener(listener)
+			{
+			}
+
+			bool Setup()
+			{
+				return Interface.Setup();
+			}
+
+			void Start()
+			{
+				Reset();
+				SwitchCount = 0;
+				FallbackCount = 0;
+				Interface.Start();
+			}
+
+			void Stop()
+			{
+				Interface.Stop();
+				Reset();
+				TS::Task::disable();
+			}
+
+			UartInterfaceTask<SerialType, UartDefinitions>& GetInterface()
+			{
+				return Interface;
+			}
+
+			/// <summary>
+			/// Candidates this end supports, bit i for BaudRates::Get(i). The base rate is always supported.
+			/// Applies from the next negotiation.
+			/// </summary>
+			void SetSupportedRates(const uint8_t mask)
+			{
+				Supported = (uint8_t)((mask & BaudRates::GetAllMask()) | 1);
+			}
+
+			uint32_t GetBaudrate() const
+			{
+				return Interface.GetBaudrate();
+			}
+
+			bool IsNegotiating() const
+			{
+				return State != StateEnum::Settled;
+			}
+
+			/// <summary>
+			/// Rates accepted after verification, since Start().
+			/// </summary>
+			uint32_t GetSwitchCount() const
+			{
+				return SwitchCount;
+			}
+
+			/// <summary>
+			/// Drops back to the base rate, on failed verification, error bursts or silence.
+			/// </summary>
+			uint32_t GetFallbackCount() const
+			{
+				return FallbackCount;
+			}
+
+			bool CanSendMessage() const
+			{
+				return State == StateEnum::Settled
+					&& !ControlInFlight
+					&& Interface.CanSendMessage();
+			}
+
+			/// <summary>
+			/// The reserved NegotiationDefinitions::Header is refused.
+			/// </summary>
+			bool SendMessage(const uint8_t header)
+			{
+				return header != NegotiationDefinitions::Header
+					&& CanSendMessage()
+					&& Interface.SendMessage(header);
+			}
+
+			bool SendMessage(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize)
+			{
+				return header != NegotiationDefinitions::Header
+					&& CanSendMessage()
+					&& Interface.SendMessage(header, payload, payloadSize);
+			}
+
+			template<typename PayloadType>
+			bool SendMessage(const uint8_t header, const PayloadType& payload)
+			{
+				static_assert(PayloadTypeCheck<PayloadType>::Valid, "Payload type must be a trivially copyable value, not a pointer.");
+
+				return header != NegotiationDefinitions::Header
+					&& CanSendMessage()
+					&& Interface.SendMessage(header, payload);
+			}
+
+		public:
+			bool Callback() final
+			{
+				const uint32_t now = TaskClock::Millis();
+
+				switch (State)
+				{
+				case StateEnum::Offering:
+					if (now - StateStart >= NegotiationDefinitions::RetryMillis)
+					{
+						if (OfferRetries < NegotiationDefinitions::MaxOfferRetries)
+						{
+							OfferRetries++;
+							OfferPending = true;
+							StateStart = now;
+						}
+						else
+						{
+							// Peer is not answering, it will offer once it connects.
+							State = StateEnum::Settled;
+						}
+					}
+					break;
+				case StateEnum::Switching:
+					if (now - StateStart >= GetSwitchDelayMillis()
+						&& !ControlInFlight
+						&& !Interface.GetCore().IsTxPolling())
+					{
+						Interface.SetBaudrate(BaudRates::Get(Target));
+						State = StateEnum::Verifying;
+						StateStart = now;
+						ProbesSent = 0;
+						ProbesReceived = 0;
+						VerifiedPending = false;
+						VerifiedSent = false;
+						PeerVerified = false;
+					}
+					break;
+				case StateEnum::Verifying:
+					if (now - StateStart >= NegotiationDefinitions::VerifyTimeoutMillis)
+					{
+						FallbackPending = true;
+					}
+					break;
+				case StateEnum::Settled:
+					if (Current > 0)
+					{
+						if (now - LastRx >= NegotiationDefinitions::LivenessTimeoutMillis)
+						{
+							FallbackPending = true;
+						}
+						else if (now - LastTx >= NegotiationDefinitions::KeepAliveMillis)
+						{
+							PingPending = true;
+						}
+					}
+					break;
+				case StateEnum::Disconnected:
+				default:
+					break;
+				}
+
+				// The serial is only restarted between frames.
+				if (FallbackPending
+					&& !ControlInFlight
+					&& !Interface.GetCore().IsTxPolling())
+				{
+					Fallback(now);
+				}
+
+				SendPending(now);
+
+				if (State == StateEnum::Disconnected
+					|| (State == StateEnum::Settled && Current == 0))
+				{
+					TS::Task::disable();
+				}
+
+				return true;
+			}
+
+		public:
+			void OnUartStateChange(const bool connected) final
+			{
+				if (connected)
+				{
+					const uint32_t now = TaskClock::Millis();
+					LastRx = now;
+					LastTx = now;
+					StartOffering(now);
+				}
+				else
+				{
+					if (Current > 0)
+					{
+						Interface.SetBaudrate(BaudRates::GetBase());
+					}
+					Reset();
+				}
+
+				if (Listener != nullptr)
+				{
+					Listener->OnUartStateChange(connected);
+				}
+			}
+
+			void OnUartRx(const uint8_t header) final
+			{
+				LastRx = TaskClock::Millis();
+				if (header != NegotiationDefinitions::Header
+					&& Listener != nullptr)
+				{
+					Listener->OnUartRx(header);
+				}
+			}
+
+			void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+			{
+				const uint32_t now = TaskClock::Millis();
+				LastRx = now;
+				if (header == NegotiationDefinitions::Header)
+				{
+					OnControl(now, payload, payloadSize);
+				}
+				else if (Listener != nullptr)
+				{
+					Listener->OnUartRx(header, payload, payloadSize);
+				}
+			}
+
+			void OnUartTx() final
+			{
+				const uint32_t now = TaskClock::Millis();
+				LastTx = now;
+				if (ControlInFlight)
+				{
+					ControlInFlight = false;
+					OnControlSent(now);
+					SendPending(now);
+				}
+				else if (Listener != nullptr)
+				{
+					Listener->OnUartTx();
+				}
+			}
+
+			void OnUartRxError(const RxErrorEnum error) final
+			{
+				if (State == StateEnum::Settled
+					&& Current > 0)
+				{
+					const uint32_t now = TaskClock::Millis();
+					if (ErrorCount == 0
+						|| now - ErrorWindowStart > NegotiationDefinitions::ErrorWindowMillis)
+					{
+						ErrorWindowStart = now;
+						ErrorCount = 0;
+					}
+
+					if (++ErrorCount >= NegotiationDefinitions::ErrorBurst)
+					{
+						FallbackPending = true;
+					}
+				}
+
+				if (Listener != nullptr)
+				{
+					Listener->OnUartRxError(error);
+				}
+			}
+
+			void OnUartTxError(const TxErrorEnum error) final
+			{
+				if (ControlInFlight)
+				{
+					// Pending flags are only cleared once sent, the frame is retried.
+					ControlInFlight = false;
+				}
+				else if (Listener != nullptr)
+				{
+					Listener->OnUartTxError(error);
+				}
+			}
+
+		private:
+			void Reset()
+			{
+				State = StateEnum::Disconnected;
+				Current = 0;
+				Target = 0;
+				ControlInFlight = false;
+				FallbackPending = false;
+				OfferPending = false;
+				VerifiedPending = false;
+				PingPending = false;
+				ErrorCount = 0;
+				for (uint8_t i = 0; i < BaudRates::Count; i++)
+				{
+					Failures[i] = 0;
+				}
+			}
+
+			uint8_t GetAvailableMask() const
+			{
+				uint8_t mask = 1;
+				for (uint8_t i = 1; i < BaudRates::Count; i++)
+				{
+					if (Failures[i] < NegotiationDefinitions::MaxAttempts)
+					{
+						mask |= (uint8_t)(1 << i);
+					}
+				}
+
+				return mask & Supported;
+			}
+
+			/// <summary>
+			/// The last offer must drain at the current rate before the serial is restarted.
+			/// </summary>
+			uint32_t GetSwitchDelayMillis() const
+			{
+				return NegotiationDefinitions::SwitchGuardMillis
+					+ ((ControlFrameBits * 1000) + BaudRates::Get(Current) - 1) / BaudRates::Get(Current);
+			}
+
+			void StartOffering(const uint32_t now)
+			{
+				State = StateEnum::Offering;
+				StateStart = now;
+				OfferRetries = 0;
+				PeerKnown = false;
+				PeerAcknowledged = false;
+				Acknowledged = false;
+				OfferPending = true;
+				VerifiedPending = false;
+				PingPending = false;
+				TS::Task::enableIfNot();
+			}
+
+			void Fallback(const uint32_t now)
+			{
+				const uint8_t failed = (State == StateEnum::Verifying) ? Target : Current;
+				if (failed > 0
+					&& Failures[failed] < UINT8_MAX)
+				{
+					Failures[failed]++;
+				}
+				FallbackCount++;
+
+				FallbackPending = false;
+				Current = 0;
+				Target = 0;
+				ErrorCount = 0;
+				Interface.SetBaudrate(BaudRates::GetBase());
+				StartOffering(now);
+			}
+
+			void OnControl(const uint32_t now, const uint8_t* payload, const uint8_t payloadSize)
+			{
+				switch ((OpcodeEnum)payload[0])
+				{
+				case OpcodeEnum::Offer:
+					if (payloadSize >= sizeof(OfferPayload))
+					{
+						OnOffer(now, payload[1], payload[2] != 0);
+					}
+					break;
+				case OpcodeEnum::Probe:
+					if (State == StateEnum::Verifying
+						&& payloadSize == ProbeSize
+						&& payload[1] == Target
+						&& payload[2] == ProbesReceived
+						&& ProbeValid(payload))
+					{
+						if (++ProbesReceived >= NegotiationDefinitions::ProbeCount)
+						{
+							VerifiedPending = true;
+							SendPending(now);
+						}
+					}
+					break;
+				case OpcodeEnum::Verified:
+					if (State == StateEnum::Verifying
+						&& payloadSize >= sizeof(IndexPayload)
+						&& payload[1] == Target)
+					{
+						PeerVerified = true;
+						CheckVerified(now);
+					}
+					break;
+				case OpcodeEnum::Ping:
+				default:
+					break;
+				}
+			}
+
+			void OnOffer(const uint32_t now, const uint8_t mask, const bool acknowledged)
+			{
+				// Offers are only exchanged at the base rate.
+				if (Current > 0
+					|| (State == StateEnum::Switching && acknowledged))
+				{
+					return;
+				}
+
+				if (State != StateEnum::Offering)
+				{
+					StartOffering(now);
+				}
+
+				PeerMask = mask;
+				PeerKnown = true;
+				PeerAcknowledged = acknowledged;
+				if (!acknowledged)
+				{
+					// The peer (re)started, it has yet to see this end's offer.
+					Acknowledged = false;
+				}
+
+				if (!Acknowledged)
+				{
+					OfferPending = true;
+					SendPending(now);
+				}
+
+				CheckSwitch(now);
+			}
+
+			/// <summary>
+			/// Both ends have each other's candidates once both have sent and received an acknowledged offer.
+			/// </summary>
+			void CheckSwitch(const uint32_t now)
+			{
+				if (State != StateEnum::Offering
+					|| !PeerKnown
+					|| !PeerAcknowledged
+					|| !Acknowledged)
+				{
+					return;
+				}
+
+				const uint8_t common = OfferedMask & PeerMask;
+				Target = 0;
+				for (uint8_t i = 1; i < BaudRates::Count; i++)
+				{
+					if ((common >> i) & 1)
+					{
+						Target = i;
+					}
+				}
+
+				if (Target > 0)
+				{
+					State = StateEnum::Switching;
+				}
+				else
+				{
+					State = StateEnum::Settled;
+				}
+				StateStart = now;
+				OfferPending = false;
+			}
+
+			void CheckVerified(const uint32_t now)
+			{
+				if (ProbesReceived >= NegotiationDefinitions::ProbeCount
+					&& VerifiedSent
+					&& PeerVerified)
+				{
+					Current = Target;
+					State = StateEnum::Settled;
+					StateStart = now;
+					LastRx = now;
+					ErrorCount = 0;
+					SwitchCount++;
+				}
+			}
+
+			void OnControlSent(const uint32_t now)
+			{
+				switch (InFlightOpcode)
+				{
+				case OpcodeEnum::Offer:
+					Acknowledged = InFlightAcknowledged;
+					OfferPending = PeerKnown && !Acknowledged;
+					CheckSwitch(now);
+					break;
+				case OpcodeEnum::Probe:
+					ProbesSent++;
+					break;
+				case OpcodeEnum::Verified:
+					VerifiedPending = false;
+					VerifiedSent = true;
+					CheckVerified(now);
+					break;
+				case OpcodeEnum::Ping:
+				default:
+					PingPending = false;
+					break;
+				}
+			}
+
+			void SendPending(const uint32_t now)
+			{
+				if (ControlInFlight
+					|| !Interface.CanSendMessage())
+				{
+					return;
+				}
+
+				switch (State)
+				{
+				case StateEnum::Offering:
+					if (OfferPending)
+					{
+						OfferedMask = GetAvailableMask();
+						InFlightAcknowledged = PeerKnown;
+						const OfferPayload offer{ (uint8_t)OpcodeEnum::Offer, OfferedMask, (uint8_t)InFlightAcknowledged };
+						SendControl(OpcodeEnum::Offer, (const uint8_t*)&offer, sizeof(offer));
+					}
+					break;
+				case StateEnum::Verifying:
+					if (VerifiedPending)
+					{
+						const IndexPayload verified{ (uint8_t)OpcodeEnum::Verified, Target };
+						SendControl(OpcodeEnum::Verified, (const uint8_t*)&verified, sizeof(verified));
+					}
+					else if (ProbesSent < NegotiationDefinitions::ProbeCount
+						&& now - StateStart >= NegotiationDefinitions::SwitchGuardMillis)
+					{
+						FillProbe(ProbesSent);
+						SendControl(OpcodeEnum::Probe, ProbeBuffer, ProbeSize);
+					}
+					break;
+				case StateEnum::Settled:
+					if (PingPending)
+					{
+						const uint8_t ping = (uint8_t)OpcodeEnum::Ping;
+						SendControl(OpcodeEnum::Ping, &ping, sizeof(ping));
+					}
+					break;
+				default:
+					break;
+				}
+			}
+
+			void SendControl(const OpcodeEnum opcode, const uint8_t* payload, const uint8_t payloadSize)
+			{
+				if (Interface.SendMessage(NegotiationDefinitions::Header, payload, payloadSize))
+				{
+					ControlInFlight = true;
+					InFlightOpcode = opcode;
+				}
+			}
+
+			/// <summary>
+			/// Full size test frame, with delimiter and run-length heavy patterns for COBS.
+			/// </summary>
+			static uint8_t GetProbeByte(const uint8_t sequence, const uint8_t index)
+			{
+				return ((index + sequence) & 0x07) == 0 ? 0 : (uint8_t)((index * 73) ^ (sequence * 29));
+			}
+
+			void FillProbe(const uint8_t sequence)
+			{
+				ProbeBuffer[0] = (uint8_t)OpcodeEnum::Probe;
+				ProbeBuffer[1] = Target;
+				ProbeBuffer[2] = sequence;
+				for (uint8_t i = ProbeHeaderSize; i < ProbeSize; i++)
+				{
+					ProbeBuffer[i] = GetProbeByte(sequence, i);
+				}
+			}
+
+			static bool ProbeValid(const uint8_t* payload)
+			{
+				for (uint8_t i = ProbeHeaderSize; i < ProbeSize; i++)
+				{
+					if (payload[i] != GetProbeByte(payload[2], i))
+					{
+						return false;
+					}
+				}
+
+				return true;
+			}
+		};
+	}
+}
+#endif
@@ -0,0 +1,369 @@
+#ifndef _UART_INTERFACE_PERIODIC_PUBLISHER_h
+#define _UART_INTERFACE_PERIODIC_PUBLISHER_h
+
+#define _TASK_OO_CALLBACKS
+#include <TSchedulerDeclarations.hpp>
+
+#include <UartInterface.h>
+#include "../Task/TaskClock.h"
+
+namespace UartInterface
+{
+	/// <summary>
+	/// Fixed rate message publishing, scheduled into the link's capacity.
+	/// </summary>
+	namespace Publish
+	{
+		/// <summary>
+		/// Fills a registered message's payload, right before it is sent.
+		/// </summary>
+		struct PublishSource
+		{
+			/// <returns>Payload size, up to the registered payload size.</returns>
+			virtual uint8_t OnPublish(const uint8_t header, uint8_t* payload) = 0;
+		};
+
+		struct PublishStats
+		{
+			uint32_t Sent = 0;
+
+			/// <summary>
+			/// Sent after their deadline, or skipped.
+			/// </summary>
+			uint32_t DeadlineMisses = 0;
+
+			/// <summary>
+			/// Periods with no message, the previous one was still waiting.
+			/// </summary>
+			uint32_t Skipped = 0;
+
+			/// <summary>
+			/// Sends refused while the interface could send (e.g. no credit for this size), retried a poll period later.
+			/// </summary>
+			uint32_t Refused = 0;
+
+			/// <summary>
+			/// Send time after the scheduled release.
+			/// </summary>
+			uint32_t JitterLastMicros = 0;
+			uint32_t JitterMaxMicros = 0;
+		};
+
+		/// <summary>
+		/// Publisher capacity.
+		/// </summary>
+		/// <typeparam name="maxEntries">Registered messages.</typeparam>
+		/// <typeparam name="utilizationPercent">Link time the registered messages may take, the rest is left to other traffic.</typeparam>
+		template<uint8_t maxEntries = 8,
+			uint8_t utilizationPercent = 80>
+		struct TemplatePublishDefinitions
+		{
+			static constexpr uint8_t MaxEntries = maxEntries;
+			static constexpr uint8_t UtilizationPercent = utilizationPercent;
+		};
+
+		/// <summary>
+		/// Publishes registered messages at fixed periods, through an interface (UartInterfaceTask, or any of its wrappers).
+		/// Due messages are sent earliest deadline first, whenever the interface can send, and filled just in time by their PublishSource.
+		/// Registration only accepts schedules the link can carry at UartDefinitions::Baudrate:
+		///  each message's frame time over its deadline, plus the largest frame that may be in flight ahead of the most urgent one,
+		///  must fit in UtilizationPercent of the link.
+		/// </summary>
+		/// <typeparam name="InterfaceType">Provides CanSendMessage() and SendMessage(header, payload, payloadSize).</typeparam>
+		template<typename InterfaceType,
+			typename UartDefinitions,
+			typename PublishDefinitions = TemplatePublishDefinitions<>>
+		class PeriodicPublisher : public TS::Task
+		{
+		public:
+			/// <summary>
+			/// Time on the wire of a frame, delimiters (address and FEC parity) included.
+			/// </summary>
+			static constexpr uint32_t GetFrameMicros(const uint8_t payloadSize)
+			{
+				return ((uint32_t)MessageDefinition::GetBufferSizeFromPayload(payloadSize) + UartDefinitions::FecParitySize + 2 + (UartDefinitions::Addressed ? MessageDefinition::AddressSize : 0))
+					* ByteMicros;
+			}
+
+		private:
+			static constexpr uint32_t ByteMicros = (10 * 1000000UL + UartDefinitions::Baudrate - 1) / UartDefinitions::Baudrate;
+			static constexpr uint32_t BudgetPermille = (uint32_t)PublishDefinitions::UtilizationPercent * 10;
+			static constexpr uint32_t RetryMillis = (UartDefinitions::PollPeriodMillis > 0) ? UartDefinitions::PollPeriodMillis : 1;
+
+			static_assert(PublishDefinitions::MaxEntries > 0, "At least one entry.");
+			static_assert(PublishDefinitions::UtilizationPercent > 0 && PublishDefinitions::UtilizationPercent <= 100, "Utilization is a percentage.");
+
+			struct Entry
+			{
+				PublishStats Stats;
+				PublishSource* Source;
+				uint32_t PeriodMicros;
+				uint32_t DeadlineMicros;
+				uint32_t Release;
+				uint8_t Header;
+				uint8_t PayloadSize;
+			};
+
+		private:
+			InterfaceType& Interface;
+
+			Entry Entries[PublishDefinitions::MaxEntries]{};
+			uint8_t EntryCount = 0;
+
+			bool Running = false;
+
+		public:
+			PeriodicPublisher(TS::Scheduler& scheduler, InterfaceType& interface)
+				: TS::Task(TASK_IMMEDIATE, TASK_FOREVER, &scheduler, false)
+				, Interface(interface)
+			{
+			}
+
+			/// <summary>
+			/// Every registered message is released now, and then every period.
+			/// </summary>
+			void Start()
+			{
+				const uint32_t now = GetTickMicros();
+				for (uint8_t i = 0; i < EntryCount; i++)
+				{
+					Entries[i].Release = now;
+					Entries[i].Stats = PublishStats{};
+				}
+				Running = true;
+				TS::Task::enableDelayed(0);
+			}
+
+			void Stop()
+			{
+				Running = false;
+				TS::Task::disable();
+			}
+
+			/// <summary>
+			/// Registers a message, released now if running.
+			/// </summary>
+			/// <param name="payloadSize">Largest payload the source fills.</param>
+			/// <param name="deadlineMillis">Latest send after each release, 0 for the period.</param>
+			/// <returns>False if the header is already registered, there's no room, or the link can't carry the schedule.</returns>
+			bool Register(const uint8_t header, const uint8_t payloadSize, const uint32_t periodMillis, PublishSource* source,
+				const uint32_t deadlineMillis = 0)
+			{
+				if (source == nullptr
+					|| periodMillis == 0
+					|| deadlineMillis > periodMillis
+					|| payloadSize > UartDefinitions::MaxPayloadSize
+					|| EntryCount >= PublishDefinitions::MaxEntries
+					|| Find(header) != nullptr)
+				{
+					return false;
+				}
+
+				Entry& entry = Entries[EntryCount];
+				entry.Stats = PublishStats{};
+				entry.Source = source;
+				entry.PeriodMicros = periodMillis * 1000;
+				entry.DeadlineMicros = ((deadlineMillis > 0) ? deadlineMillis : periodMillis) * 1000;
+				entry.Release = GetTickMicros();
+				entry.Header = header;
+				entry.PayloadSize = payloadSize;
+
+				if (GetLoadPermille(EntryCount + 1) > BudgetPermille)
+				{
+					return false;
+				}
+				EntryCount++;
+
+				if (Running)
+				{
+					TS::Task::enableDelayed(0);
+				}
+
+				return true;
+			}
+
+			void Unregister(const uint8_t header)
+			{
+				for (uint8_t i = 0; i < EntryCount; i++)
+				{
+					if (Entries[i].Header == header)
+					{
+						EntryCount--;
+						for (uint8_t j = i; j < EntryCount; j++)
+						{
+							Entries[j] = Entries[j + 1];
+						}
+
+						return;
+					}
+				}
+			}
+
+			/// <returns>nullptr if the header is not registered.</returns>
+			const PublishStats* GetStats(const uint8_t header) const
+			{
+				for (uint8_t i = 0; i < EntryCount; i++)
+				{
+					if (Entries[i].Header == header)
+					{
+						return &Entries[i].Stats;
+					}
+				}
+
+				return nullptr;
+			}
+
+			/// <summary>
+			/// Link time reserved by the registered messages, blocking included, in permille.
+			/// </summary>
+			uint32_t GetLoadPermille() const
+			{
+				return GetLoadPermille(EntryCount);
+			}
+
+			bool Callback() final
+			{
+				if (EntryCount == 0)
+				{
+					TS::Task::disable();
+
+					return true;
+				}
+
+				const uint32_t now = TaskClock::Micros();
+				Entry* next = nullptr;
+				for (uint8_t i = 0; i < EntryCount; i++)
+				{
+					Entry& entry = Entries[i];
+					if ((int32_t)(now - entry.Release) >= 0
+						&& (next == nullptr
+							|| (int32_t)((entry.Release + entry.DeadlineMicros) - (next->Release + next->DeadlineMicros)) < 0))
+					{
+						next = &entry;
+					}
+				}
+
+				if (next != nullptr)
+				{
+					if (Interface.CanSendMessage())
+					{
+						if (!Publish(*next, now))
+						{
+							// Still due, but spinning won't get it through.
+							TS::Task::delay(RetryMillis);
+
+							return true;
+						}
+					}
+					else
+					{
+						// Due, wait for the interface.
+						TS::Task::delay(0);
+
+						return true;
+					}
+				}
+
+				uint32_t wake = Entries[0].Release;
+				for (uint8_t i = 1; i < EntryCount; i++)
+				{
+					if ((int32_t)(Entries[i].Release - wake) < 0)
+					{
+						wake = Entries[i].Release;
+					}
+				}
+				TS::Task::delay(TaskClock::GetDelayMillis(now, wake));
+
+				return true;
+			}
+
+		private:
+			/// <returns>False if the interface refused the message.</returns>
+			bool Publish(Entry& entry, const uint32_t now)
+			{
+				uint8_t payload[UartDefinitions::MaxPayloadSize > 0 ? UartDefinitions::MaxPayloadSize : 1];
+				uint8_t payloadSize = entry.Source->OnPublish(entry.Header, payload);
+				if (payloadSize > entry.PayloadSize)
+				{
+					payloadSize = entry.PayloadSize;
+				}
+
+				if (!Interface.SendMessage(entry.Header, payload, payloadSize))
+				{
+					entry.Stats.Refused++;
+
+					return false;
+				}
+
+				const uint32_t jitter = now - entry.Release;
+				entry.Stats.Sent++;
+				entry.Stats.JitterLastMicros = jitter;
+				if (jitter > entry.Stats.JitterMaxMicros)
+				{
+					entry.Stats.JitterMaxMicros = jitter;
+				}
+				if (jitter > entry.DeadlineMicros)
+				{
+					entry.Stats.DeadlineMisses++;
+				}
+
+				// Keeps the phase, releases already gone by are skipped.
+				entry.Release += entry.PeriodMicros;
+				while ((int32_t)(now - entry.Release) >= (int32_t)entry.PeriodMicros)
+				{
+					entry.Release += entry.PeriodMicros;
+					entry.Stats.Skipped++;
+					entry.Stats.DeadlineMisses++;
+				}
+
+				return true;
+			}
+
+			/// <summary>
+			/// Releases fall on the scheduler's millisecond ticks, so a delayed task wakes right on them.
+			/// </summary>
+			static uint32_t GetTickMicros()
+			{
+				return TaskClock::Millis() * 1000;
+			}
+
+			Entry* Find(const uint8_t header)
+			{
+				for (uint8_t i = 0; i < EntryCount; i++)
+				{
+					if (Entries[i].Header == header)
+					{
+						return &Entries[i];
+					}
+				}
+
+				return nullptr;
+			}
+
+			/// <summary>
+			/// Density of the first count entries, plus a largest frame blocking the tightest deadline.
+			/// </summary>
+			uint32_t GetLoadPermille(const uint8_t count) const
+			{
+				uint32_t load = 0;
+				uint32_t deadlineMin = UINT32_MAX;
+				for (uint8_t i = 0; i < count; i++)
+				{
+					load += ((GetFrameMicros(Entries[i].PayloadSize) * 1000) + Entries[i].DeadlineMicros - 1) / Entries[i].DeadlineMicros;
+					if (Entries[i].DeadlineMicros < deadlineMin)
+					{
+						deadlineMin = Entries[i].DeadlineMicros;
+					}
+				}
+
+				if (count > 0)
+				{
+					load += ((GetFrameMicros(UartDefinitions::MaxPayloadSize) * 1000) + deadlineMin - 1) / deadlineMin;
+				}
+
+				return load;
+			}
+		};
+	}
+}
+#endif
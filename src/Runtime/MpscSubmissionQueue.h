@@ -0,0 +1,226 @@
+#ifndef _UART_INTERFACE_MPSC_SUBMISSION_QUEUE_h
+#define _UART_INTERFACE_MPSC_SUBMISSION_QUEUE_h
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+#include "../Transport/SpscRing.h"
+#include "../Codec/MessageCodec.h"
+
+namespace UartInterface
+{
+	namespace Runtime
+	{
+		/// <summary>
+		/// Lock-free multi-producer/single-consumer submission queue, in front of one port's TX.
+		/// Each producer thread sends through its own Producer, which claims a slot, encodes the frame into it with its own codec,
+		///  and publishes it with a single atomic store. Producers never wait on each other's encoding, or on the port.
+		/// The port's thread calls Pump(port), which sends published slots in claim order as pre-encoded frames, straight from the slot.
+		/// A slot is only reused once its frame is fully sent.
+		/// A full queue rejects the message, counted in GetRejectedCount().
+		/// </summary>
+		/// <typeparam name="Capacity">Slot count, power of 2.</typeparam>
+		template<typename UartDefinitions, uint16_t Capacity = 64>
+		class MpscSubmissionQueue
+		{
+		private:
+			static_assert(Capacity > 1 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2.");
+			static_assert(!UartDefinitions::Addressed, "Submitted frames are not addressed.");
+			static_assert(UartDefinitions::FecParitySize == 0, "Submitted frames carry no FEC parity.");
+
+			static constexpr uint32_t Mask = Capacity - 1;
+
+			using CodecType = MessageCodec<(uint8_t)UartDefinitions::MaxPayloadSize>;
+
+			/// <summary>
+			/// Sequence == position: free for the producer claiming it.
+			/// Sequence == position + 1: published, for the consumer.
+			/// </summary>
+			struct alignas(UART_INTERFACE_CACHE_LINE_SIZE) Slot
+			{
+				std::atomic<uint32_t> Sequence{ 0 };
+				uint8_t Size = 0;
+				uint8_t Frame[CodecType::BufferSize]{};
+			};
+
+		public:
+			/// <summary>
+			/// One per producer thread, with its own codec.
+			/// </summary>
+			class Producer
+			{
+			private:
+				MpscSubmissionQueue& Queue;
+				CodecType Codec;
+
+			public:
+				Producer(MpscSubmissionQueue& queue, const uint8_t* key, const uint8_t keySize)
+					: Queue(queue)
+					, Codec(key, keySize)
+				{
+				}
+
+				bool Setup()
+				{
+					return Codec.Setup();
+				}
+
+				bool SendMessage(const uint8_t header)
+				{
+					return SendMessage(header, nullptr, 0);
+				}
+
+				/// <returns>False if the queue is full, or the payload too large.</returns>
+				bool SendMessage(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize)
+				{
+					if (payloadSize > UartDefinitions::MaxPayloadSize)
+					{
+						return false;
+					}
+
+					uint32_t position;
+					Slot* slot = Queue.Claim(position);
+					if (slot == nullptr)
+					{
+						return false;
+					}
+
+					slot->Frame[(uint8_t)MessageDefinition::FieldIndexEnum::Header] = header;
+					if (payloadSize > 0)
+					{
+						memcpy(&slot->Frame[(uint8_t)MessageDefinition::FieldIndexEnum::Payload], payload, payloadSize);
+					}
+					slot->Size = (uint8_t)Codec.EncodeMessageAndCrcInPlace(slot->Frame, MessageDefinition::GetMessageSize(payloadSize));
+					slot->Sequence.store(position + 1, std::memory_order_release);
+
+					return true;
+				}
+			};
+
+		private:
+			// Producers.
+			alignas(UART_INTERFACE_CACHE_LINE_SIZE) std::atomic<uint32_t> EnqueuePosition{ 0 };
+			std::atomic<uint32_t> Rejected{ 0 };
+
+			// Consumer owned.
+			alignas(UART_INTERFACE_CACHE_LINE_SIZE) uint32_t DequeuePosition = 0;
+			uint32_t Sent = 0;
+			bool InFlight = false;
+
+			Slot Slots[Capacity];
+
+		public:
+			MpscSubmissionQueue()
+			{
+				for (uint32_t i = 0; i < Capacity; i++)
+				{
+					Slots[i].Sequence.store(i, std::memory_order_relaxed);
+				}
+			}
+
+			uint32_t GetRejectedCount() const
+			{
+				return Rejected.load(std::memory_order_relaxed);
+			}
+
+		public:
+			// Consumer side.
+
+			/// <summary>
+			/// Releases the last frame once the port is done with it, and hands it the next one.
+			/// Call from the port's thread, with UartInterfaceTask or UartInterfaceCore.
+			/// </summary>
+			/// <returns>True if a frame was handed to the port.</returns>
+			template<typename PortType>
+			bool Pump(PortType& port)
+			{
+				if (!port.CanSendMessage())
+				{
+					return false;
+				}
+
+				if (InFlight)
+				{
+					InFlight = false;
+					Release();
+				}
+
+				Slot* slot = Front();
+				while (slot != nullptr)
+				{
+					if (slot->Size > 0
+						&& port.SendPreEncoded(slot->Frame, slot->Size))
+					{
+						InFlight = true;
+						Sent++;
+
+						return true;
+					}
+
+					// Not sendable, dropped.
+					Release();
+					slot = Front();
+				}
+
+				return false;
+			}
+
+			/// <summary>
+			/// Published frames waiting for the port, the one in flight included.
+			/// </summary>
+			bool IsPending() const
+			{
+				return InFlight || Front() != nullptr;
+			}
+
+			uint32_t GetSentCount() const
+			{
+				return Sent;
+			}
+
+		private:
+			Slot* Claim(uint32_t& position)
+			{
+				position = EnqueuePosition.load(std::memory_order_relaxed);
+				while (true)
+				{
+					Slot* slot = &Slots[position & Mask];
+					const int32_t lag = (int32_t)(slot->Sequence.load(std::memory_order_acquire) - position);
+					if (lag == 0)
+					{
+						if (EnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+						{
+							return slot;
+						}
+					}
+					else if (lag < 0)
+					{
+						// Full, the consumer still has the slot from the last lap.
+						Rejected.fetch_add(1, std::memory_order_relaxed);
+
+						return nullptr;
+					}
+					else
+					{
+						position = EnqueuePosition.load(std::memory_order_relaxed);
+					}
+				}
+			}
+
+			Slot* Front() const
+			{
+				Slot* slot = const_cast<Slot*>(&Slots[DequeuePosition & Mask]);
+
+				return (slot->Sequence.load(std::memory_order_acquire) == DequeuePosition + 1) ? slot : nullptr;
+			}
+
+			void Release()
+			{
+				Slots[DequeuePosition & Mask].Sequence.store(DequeuePosition + Capacity, std::memory_order_release);
+				DequeuePosition++;
+			}
+		};
+	}
+}
+#endif
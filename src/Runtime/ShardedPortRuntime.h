@@ -0,0 +1,468 @@
+#ifndef _UART_INTERFACE_SHARDED_PORT_RUNTIME_h
+#define _UART_INTERFACE_SHARDED_PORT_RUNTIME_h
+
+#if defined(__linux__)
+#include <stdint.h>
+#include <string.h>
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+
+#include "../Core/UartInterfaceCore.h"
+#include "SpscQueue.h"
+
+namespace UartInterface
+{
+	/// <summary>
+	/// Multi-core host runtime for many ports.
+	/// </summary>
+	namespace Runtime
+	{
+		/// <summary>
+		/// Runs the UartInterfaceCore of each port on one of N worker threads (shards).
+		/// Each shard owns its ports exclusively, so the per-byte path has no locks or shared state.
+		/// Decoded frames reach the application through each shard's bounded SPSC queue, sends through each port's own.
+		/// A single application thread calls Send()/Receive(), workers run between Start() and Stop().
+		/// A frame that doesn't fit the RX queue is dropped and counted.
+		/// A send waits in its port's TX queue until the port is free, so a busy port never holds back the others and Send() only fails once that queue is full.
+		/// Sends to a port whose serial is disconnected are dropped and counted.
+		/// </summary>
+		/// <typeparam name="MaxPorts">Port capacity.</typeparam>
+		/// <typeparam name="MaxWorkers">Shard capacity.</typeparam>
+		/// <typeparam name="QueueSize">RX queue depth per shard, power of 2.</typeparam>
+		/// <typeparam name="PortQueueSize">TX queue depth per port, power of 2.</typeparam>
+		template<typename SerialType,
+			typename UartDefinitions = UartInterface::TemplateUartDefinitions<>,
+			uint8_t MaxPorts = 128,
+			uint8_t MaxWorkers = 16,
+			uint16_t QueueSize = 256,
+			uint16_t PortQueueSize = 8>
+		class ShardedPortRuntime
+		{
+		public:
+			struct Frame
+			{
+				uint8_t Port;
+				uint8_t Header;
+				uint8_t PayloadSize;
+				uint8_t Payload[UartDefinitions::MaxPayloadSize];
+			};
+
+			struct PortStats
+			{
+				uint32_t Received;
+				uint32_t RxDropped;
+				uint32_t RxErrors;
+				uint32_t Sent;
+				uint32_t TxDropped;
+				uint32_t TxErrors;
+			};
+
+		private:
+			using CoreType = UartInterfaceCore<SerialType, UartDefinitions>;
+			using FrameQueue = SpscQueue<Frame, QueueSize>;
+			using PortQueue = SpscQueue<Frame, PortQueueSize>;
+
+			/// <summary>
+			/// Worker side counters, read from the application thread.
+			/// </summary>
+			struct AtomicPortStats
+			{
+				std::atomic<uint32_t> Received{ 0 };
+				std::atomic<uint32_t> RxDropped{ 0 };
+				std::atomic<uint32_t> RxErrors{ 0 };
+				std::atomic<uint32_t> Sent{ 0 };
+				std::atomic<uint32_t> TxDropped{ 0 };
+				std::atomic<uint32_t> TxErrors{ 0 };
+
+				static void Increment(std::atomic<uint32_t>& counter)
+				{
+					counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+				}
+			};
+
+			struct Shard
+			{
+				FrameQueue RxQueue{};
+				std::thread Thread{};
+				uint8_t Ports[MaxPorts]{};
+				uint8_t PortCount = 0;
+			};
+
+			struct Port : UartListener
+			{
+				SerialType& SerialInstance;
+				CoreType Core;
+				PortQueue TxQueue{};
+				FrameQueue* RxQueue = nullptr;
+				AtomicPortStats Stats{};
+				uint8_t Id;
+
+				Port(SerialType& serialInstance, const uint8_t id, const uint8_t* key, const uint8_t keySize)
+					: SerialInstance(serialInstance)
+					, Core(serialInstance, this, key, keySize)
+					, Id(id)
+				{
+				}
+
+				void OnUartStateChange(const bool) final {}
+
+				void OnUartRx(const uint8_t header) final
+				{
+					OnUartRx(header, nullptr, 0);
+				}
+
+				void OnUartRx(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize) final
+				{
+					Frame* frame = RxQueue->Claim();
+					if (frame == nullptr)
+					{
+						AtomicPortStats::Increment(Stats.RxDropped);
+						return;
+					}
+
+					frame->Port = Id;
+					frame->Header = header;
+					frame->PayloadSize = payloadSize;
+					if (payloadSize > 0)
+					{
+						memcpy(frame->Payload, payload, payloadSize);
+					}
+					RxQueue->Publish();
+					AtomicPortStats::Increment(Stats.Received);
+				}
+
+				void OnUartTx() final
+				{
+					AtomicPortStats::Increment(Stats.Sent);
+				}
+
+				void OnUartRxError(const RxErrorEnum) final
+				{
+					AtomicPortStats::Increment(Stats.RxErrors);
+				}
+
+				void OnUartTxError(const TxErrorEnum) final
+				{
+					AtomicPortStats::Increment(Stats.TxErrors);
+				}
+
+				bool TrySend(const Frame& frame)
+				{
+					if (frame.PayloadSize > 0)
+					{
+						return Core.SendMessage(frame.Header, frame.Payload, frame.PayloadSize);
+					}
+					else
+					{
+						return Core.SendMessage(frame.Header);
+					}
+				}
+
+				/// <summary>
+				/// Hands queued frames to the core until it is busy.
+				/// </summary>
+				void Flush()
+				{
+					for (const Frame* frame = TxQueue.Front(); frame != nullptr; frame = TxQueue.Front())
+					{
+						if (!Core.IsSerialConnected())
+						{
+							AtomicPortStats::Increment(Stats.TxDropped);
+						}
+						else if (!TrySend(*frame))
+						{
+							// Backpressure: the frame stays in front until the port is free.
+							break;
+						}
+						TxQueue.Pop();
+					}
+				}
+			};
+
+		private:
+			static constexpr uint32_t PollPeriodMicros = UartDefinitions::PollPeriodMillis * 1000;
+
+			alignas(Port) uint8_t PortStorage[MaxPorts][sizeof(Port)];
+			Shard Shards[MaxWorkers]{};
+
+			std::chrono::steady_clock::time_point Epoch{};
+			std::atomic<bool> Running{ false };
+
+			uint8_t PortCount = 0;
+			uint8_t WorkerCount = 0;
+
+		public:
+			ShardedPortRuntime() = default;
+
+			~ShardedPortRuntime()
+			{
+				Stop();
+
+				for (uint8_t i = 0; i < PortCount; i++)
+				{
+					GetPort(i).~Port();
+				}
+			}
+
+			/// <summary>
+			/// Registers a port, before Start().
+			/// </summary>
+			/// <returns>Port id, or -1 on failure.</returns>
+			int16_t AddPort(SerialType& serialInstance, const uint8_t* key, const uint8_t keySize)
+			{
+				if (Running.load() || PortCount >= MaxPorts)
+				{
+					return -1;
+				}
+
+				Port* port = new (PortStorage[PortCount]) Port(serialInstance, PortCount, key, keySize);
+				if (!port->Core.Setup())
+				{
+					port->~Port();
+
+					return -1;
+				}
+
+				return PortCount++;
+			}
+
+			uint8_t GetPortCount() const
+			{
+				return PortCount;
+			}
+
+			uint8_t GetWorkerCount() const
+			{
+				return WorkerCount;
+			}
+
+			/// <summary>
+			/// Assigns ports to workers round-robin, starts the ports and the worker threads.
+			/// </summary>
+			/// <param name="workerCount">Number of worker threads, capped to MaxWorkers and the port count.</param>
+			/// <param name="pinWorkers">Pin each worker to its own core.</param>
+			bool Start(uint8_t workerCount, const bool pinWorkers = false)
+			{
+				if (Running.load() || PortCount == 0 || workerCount == 0)
+				{
+					return false;
+				}
+
+				if (workerCount > MaxWorkers)
+				{
+					workerCount = MaxWorkers;
+				}
+				if (workerCount > PortCount)
+				{
+					workerCount = PortCount;
+				}
+				WorkerCount = workerCount;
+
+				for (uint8_t s = 0; s < WorkerCount; s++)
+				{
+					Shards[s].PortCount = 0;
+					while (Shards[s].RxQueue.Front() != nullptr)
+					{
+						Shards[s].RxQueue.Pop();
+					}
+				}
+
+				for (uint8_t i = 0; i < PortCount; i++)
+				{
+					Shard& shard = Shards[i % WorkerCount];
+					Port& port = GetPort(i);
+
+					shard.Ports[shard.PortCount++] = i;
+					while (port.TxQueue.Front() != nullptr)
+					{
+						port.TxQueue.Pop();
+					}
+					port.RxQueue = &shard.RxQueue;
+					port.Core.Start();
+				}
+
+				Epoch = std::chrono::steady_clock::now();
+				Running.store(true);
+
+				const unsigned cores = std::thread::hardware_concurrency();
+				for (uint8_t s = 0; s < WorkerCount; s++)
+				{
+					Shards[s].Thread = std::thread(&ShardedPortRuntime::Work, this, s);
+
+					if (pinWorkers && cores > 0)
+					{
+						cpu_set_t set;
+						CPU_ZERO(&set);
+						CPU_SET(s % cores, &set);
+						pthread_setaffinity_np(Shards[s].Thread.native_handle(), sizeof(set), &set);
+					}
+				}
+
+				return true;
+			}
+
+			void Stop()
+			{
+				if (!Running.exchange(false))
+				{
+					return;
+				}
+
+				for (uint8_t s = 0; s < WorkerCount; s++)
+				{
+					if (Shards[s].Thread.joinable())
+					{
+						Shards[s].Thread.join();
+					}
+				}
+
+				for (uint8_t i = 0; i < PortCount; i++)
+				{
+					GetPort(i).Core.Stop();
+				}
+			}
+
+			/// <summary>
+			/// Queues a message for the port's worker.
+			/// </summary>
+			/// <returns>False if the port's TX queue is full or the runtime is stopped.</returns>
+			bool Send(const uint8_t port, const uint8_t header, const uint8_t* payload, const uint8_t payloadSize)
+			{
+				if (!Running.load(std::memory_order_relaxed)
+					|| port >= PortCount
+					|| payloadSize > UartDefinitions::MaxPayloadSize
+					|| (payloadSize > 0 && payload == nullptr))
+				{
+					return false;
+				}
+
+				PortQueue& queue = GetPort(port).TxQueue;
+				Frame* frame = queue.Claim();
+				if (frame == nullptr)
+				{
+					return false;
+				}
+
+				frame->Port = port;
+				frame->Header = header;
+				frame->PayloadSize = payloadSize;
+				if (payloadSize > 0)
+				{
+					memcpy(frame->Payload, payload, payloadSize);
+				}
+				queue.Publish();
+
+				return true;
+			}
+
+			/// <summary>
+			/// Hands every queued frame to handler(const Frame&), at most maxFrames.
+			/// </summary>
+			/// <returns>Number of frames handled.</returns>
+			template<typename HandlerType>
+			uint32_t Receive(HandlerType&& handler, const uint32_t maxFrames = UINT32_MAX)
+			{
+				uint32_t count = 0;
+				bool any = true;
+
+				while (any && count < maxFrames)
+				{
+					any = false;
+					for (uint8_t s = 0; s < WorkerCount && count < maxFrames; s++)
+					{
+						const Frame* frame = Shards[s].RxQueue.Front();
+						if (frame != nullptr)
+						{
+							handler(*frame);
+							Shards[s].RxQueue.Pop();
+							count++;
+							any = true;
+						}
+					}
+				}
+
+				return count;
+			}
+
+			PortStats GetStats(const uint8_t port)
+			{
+				PortStats stats{};
+				if (port < PortCount)
+				{
+					const AtomicPortStats& source = GetPort(port).Stats;
+					stats.Received = source.Received.load(std::memory_order_relaxed);
+					stats.RxDropped = source.RxDropped.load(std::memory_order_relaxed);
+					stats.RxErrors = source.RxErrors.load(std::memory_order_relaxed);
+					stats.Sent = source.Sent.load(std::memory_order_relaxed);
+					stats.TxDropped = source.TxDropped.load(std::memory_order_relaxed);
+					stats.TxErrors = source.TxErrors.load(std::memory_order_relaxed);
+				}
+
+				return stats;
+			}
+
+		private:
+			Port& GetPort(const uint8_t index)
+			{
+				return *reinterpret_cast<Port*>(PortStorage[index]);
+			}
+
+			uint32_t Micros() const
+			{
+				return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - Epoch).count();
+			}
+
+			/// <summary>
+			/// Worker loop: takes submissions, polls its ports and sleeps until the earliest deadline.
+			/// </summary>
+			void Work(const uint8_t shardIndex)
+			{
+				Shard& shard = Shards[shardIndex];
+
+				while (Running.load(std::memory_order_relaxed))
+				{
+					uint32_t now = Micros();
+
+					int32_t wait = PollPeriodMicros;
+					for (uint8_t i = 0; i < shard.PortCount; i++)
+					{
+						Port& port = GetPort(shard.Ports[i]);
+
+						port.Flush();
+
+						// The worker is the port's serial event source.
+						if (port.SerialInstance.available() > 0)
+						{
+							port.Core.OnSerialEvent(now);
+						}
+
+						if (port.Core.IsPolling())
+						{
+							const int32_t portWait = (int32_t)(port.Core.Poll(now) - now);
+							if (portWait < wait)
+							{
+								wait = portWait;
+							}
+						}
+					}
+
+					if (wait > 0)
+					{
+						std::this_thread::sleep_for(std::chrono::microseconds(wait));
+					}
+					else
+					{
+						// Free when the worker has its core, lets the application in when it doesn't.
+						std::this_thread::yield();
+					}
+				}
+			}
+		};
+	}
+}
+#endif
+#endif
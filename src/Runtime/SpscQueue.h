@@ -0,0 +1,105 @@
+#ifndef _UART_INTERFACE_SPSC_QUEUE_h
+#define _UART_INTERFACE_SPSC_QUEUE_h
+
+#include <stdint.h>
+#include <atomic>
+
+#include "../Transport/SpscRing.h"
+
+namespace UartInterface
+{
+	namespace Runtime
+	{
+		/// <summary>
+		/// Bounded wait-free single-producer/single-consumer queue of fixed size records.
+		/// Records are filled and read in place: Claim()/Publish() on the producer, Front()/Pop() on the consumer.
+		/// </summary>
+		/// <typeparam name="Capacity">Power of 2.</typeparam>
+		template<typename T, uint16_t Capacity>
+		class SpscQueue
+		{
+		private:
+			static_assert(Capacity > 1 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2.");
+
+			static constexpr uint32_t Mask = Capacity - 1;
+
+		private:
+			// Producer owned.
+			alignas(UART_INTERFACE_CACHE_LINE_SIZE) std::atomic<uint32_t> Head{ 0 };
+
+			// Consumer owned.
+			alignas(UART_INTERFACE_CACHE_LINE_SIZE) std::atomic<uint32_t> Tail{ 0 };
+
+			alignas(UART_INTERFACE_CACHE_LINE_SIZE) T Records[Capacity]{};
+
+		public:
+			// Producer side.
+
+			/// <summary>
+			/// Record to fill in place, followed by Publish().
+			/// </summary>
+			/// <returns>The next free record, or nullptr when full.</returns>
+			T* Claim()
+			{
+				const uint32_t head = Head.load(std::memory_order_relaxed);
+				if (head - Tail.load(std::memory_order_acquire) >= Capacity)
+				{
+					return nullptr;
+				}
+
+				return &Records[head & Mask];
+			}
+
+			/// <summary>
+			/// Makes the last claimed record visible to the consumer.
+			/// </summary>
+			void Publish()
+			{
+				Head.store(Head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+			}
+
+			bool Push(const T& record)
+			{
+				T* slot = Claim();
+				if (slot == nullptr)
+				{
+					return false;
+				}
+
+				*slot = record;
+				Publish();
+
+				return true;
+			}
+
+		public:
+			// Consumer side.
+
+			/// <summary>
+			/// Record to read in place, followed by Pop().
+			/// </summary>
+			/// <returns>The oldest record, or nullptr when empty.</returns>
+			T* Front()
+			{
+				const uint32_t tail = Tail.load(std::memory_order_relaxed);
+				if (Head.load(std::memory_order_acquire) == tail)
+				{
+					return nullptr;
+				}
+
+				return &Records[tail & Mask];
+			}
+
+			void Pop()
+			{
+				Tail.store(Tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+			}
+
+			uint16_t Size() const
+			{
+				return (uint16_t)(Head.load(std::memory_order_acquire) - Tail.load(std::memory_order_acquire));
+			}
+		};
+	}
+}
+#endif
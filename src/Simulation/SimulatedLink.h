@@ -0,0 +1,514 @@
+#ifndef _UART_INTERFACE_SIMULATED_LINK_h
+#define _UART_INTERFACE_SIMULATED_LINK_h
+
+#include <stdint.h>
+#include <string.h>
+
+#include "VirtualClock.h"
+
+namespace UartInterface
+{
+	namespace Simulation
+	{
+		/// <summary>
+		/// Per-direction fault injection, in parts per million.
+		/// </summary>
+		struct FaultConfig
+		{
+			/// <summary>
+			/// Probability of each bit being flipped on the wire.
+			/// </summary>
+			uint32_t BitFlipPpm = 0;
+
+			/// <summary>
+			/// Probability of each byte being lost on the wire.
+			/// </summary>
+			uint32_t DropPpm = 0;
+
+			/// <summary>
+			/// Probability of a spurious byte arriving after each byte.
+			/// </summary>
+			uint32_t InsertPpm = 0;
+
+			/// <summary>
+			/// Rate-dependent faults: the cable is clean up to this baud rate, faults only apply above it.
+			/// 0 applies the faults at any rate.
+			/// </summary>
+			uint32_t CleanBaudrate = 0;
+		};
+
+		struct ChannelStats
+		{
+			uint32_t BytesWritten = 0;
+			uint32_t BytesRejected = 0;
+			uint32_t BytesOnWire = 0;
+			uint32_t BytesDelivered = 0;
+			uint32_t RxOverruns = 0;
+			uint32_t BitFlips = 0;
+			uint32_t Drops = 0;
+			uint32_t Inserts = 0;
+			uint32_t Garbled = 0;
+			uint32_t InFlightOverflows = 0;
+		};
+
+		/// <summary>
+		/// Fixed size byte ring, with contiguous span access.
+		/// </summary>
+		template<uint16_t Capacity>
+		class ByteFifo
+		{
+		private:
+			uint8_t Buffer[Capacity]{};
+			uint16_t Head = 0;
+			uint16_t Count = 0;
+
+		public:
+			void Clear()
+			{
+				Head = 0;
+				Count = 0;
+			}
+
+			uint16_t Size() const
+			{
+				return Count;
+			}
+
+			uint16_t Free() const
+			{
+				return Capacity - Count;
+			}
+
+			bool Push(const uint8_t value)
+			{
+				if (Count < Capacity)
+				{
+					Buffer[(Head + Count) % Capacity] = value;
+					Count++;
+
+					return true;
+				}
+
+				return false;
+			}
+
+			uint8_t Peek() const
+			{
+				return Buffer[Head];
+			}
+
+			uint8_t Pop()
+			{
+				const uint8_t value = Buffer[Head];
+				Consume(1);
+
+				return value;
+			}
+
+			uint16_t ReadSpan(const uint8_t*& data) const
+			{
+				data = &Buffer[Head];
+
+				return (Head + Count > Capacity) ? (Capacity - Head) : Count;
+			}
+
+			void Consume(const uint16_t size)
+			{
+				const uint16_t consumed = size < Count ? size : Count;
+				Head = (Head + consumed) % Capacity;
+				Count -= consumed;
+			}
+
+			uint16_t WriteSpan(uint8_t*& data)
+			{
+				const uint16_t tail = (Head + Count) % Capacity;
+				data = &Buffer[tail];
+
+				if (Count == Capacity)
+				{
+					return 0;
+				}
+				else if (tail >= Head)
+				{
+					return Capacity - tail;
+				}
+				else
+				{
+					return Head - tail;
+				}
+			}
+
+			void Commit(const uint16_t size)
+			{
+				Count += size < Free() ? size : Free();
+			}
+		};
+
+		/// <summary>
+		/// Deterministic simulated UART link between two endpoints, for host testing.
+		/// Each endpoint is a SerialType, with both the Arduino and span APIs.
+		/// Bytes leave the TX FIFO at wire rate (8N1, from the sender's baud rate),
+		///  arrive after the propagation delay and are lost on RX FIFO overrun.
+		/// Endpoints with mismatched baud rates receive garbled bytes.
+		/// Time only moves with the VirtualClock, state is updated lazily on every serial call.
+		/// </summary>
+		/// <typeparam name="RxFifoSize">Driver RX FIFO depth.</typeparam>
+		/// <typeparam name="TxFifoSize">Driver TX FIFO depth.</typeparam>
+		/// <typeparam name="InFlightSize">Maximum bytes in propagation, per direction.</typeparam>
+		template<uint16_t RxFifoSize = 64,
+			uint16_t TxFifoSize = 64,
+			uint16_t InFlightSize = 256>
+		class SimulatedLink
+		{
+		private:
+			static constexpr uint8_t BitsPerByte = 10;
+			static constexpr uint64_t NanosPerSecond = 1000000000;
+
+			struct InFlightByte
+			{
+				uint64_t ArrivalNanos;
+				uint8_t Value;
+			};
+
+		public:
+			class Endpoint
+			{
+				friend class SimulatedLink;
+
+			private:
+				SimulatedLink& Link;
+				Endpoint* Peer = nullptr;
+
+				ByteFifo<RxFifoSize> RxFifo{};
+				ByteFifo<TxFifoSize> TxFifo{};
+
+				InFlightByte InFlight[InFlightSize]{};
+				uint16_t InFlightHead = 0;
+				uint16_t InFlightCount = 0;
+
+				uint64_t WireFreeNanos = 0;
+				uint64_t ByteNanos = 0;
+				uint32_t Baudrate = 0;
+				bool Enabled = false;
+
+			public:
+				FaultConfig Faults{};
+				ChannelStats Stats{};
+
+			public:
+				Endpoint(SimulatedLink& link)
+					: Link(link)
+				{
+				}
+
+				const ChannelStats& GetStats() const
+				{
+					return Stats;
+				}
+
+				uint32_t GetBaudrate() const
+				{
+					return Baudrate;
+				}
+
+				/// <summary>
+				/// Bytes still waiting in the TX FIFO or on the wire.
+				/// </summary>
+				uint16_t Pending()
+				{
+					Link.Update();
+
+					return TxFifo.Size() + InFlightCount;
+				}
+
+			public:
+				operator bool()
+				{
+					return Enabled && Link.Connected;
+				}
+
+				void begin(const unsigned long baudrate)
+				{
+					// Bytes already due are delivered at the old rate.
+					Link.Update();
+					Baudrate = baudrate;
+					ByteNanos = (baudrate > 0) ? ((NanosPerSecond * BitsPerByte) / baudrate) : 0;
+					RxFifo.Clear();
+					TxFifo.Clear();
+					InFlightCount = 0;
+					WireFreeNanos = Link.Clock.Nanos();
+					Enabled = true;
+				}
+
+				void end()
+				{
+					Enabled = false;
+				}
+
+				int available()
+				{
+					Link.Update();
+
+					return RxFifo.Size();
+				}
+
+				int availableForWrite()
+				{
+					Link.Update();
+
+					return Enabled ? TxFifo.Free() : 0;
+				}
+
+				int peek()
+				{
+					Link.Update();
+
+					return (RxFifo.Size() > 0) ? RxFifo.Peek() : -1;
+				}
+
+				int read()
+				{
+					Link.Update();
+
+					return (RxFifo.Size() > 0) ? RxFifo.Pop() : -1;
+				}
+
+				size_t write(const uint8_t value)
+				{
+					return write(&value, 1);
+				}
+
+				size_t write(const uint8_t* buffer, const size_t size)
+				{
+					Link.Update();
+
+					if (!Enabled || !Link.Connected)
+					{
+						Stats.BytesRejected += size;
+
+						return 0;
+					}
+
+					StartWire();
+
+					size_t written = 0;
+					while (written < size
+						&& TxFifo.Push(buffer[written]))
+					{
+						written++;
+					}
+					Stats.BytesWritten += written;
+					Stats.BytesRejected += size - written;
+
+					return written;
+				}
+
+				void flush()
+				{
+				}
+
+				void clearWriteError()
+				{
+				}
+
+				uint16_t ReadSpan(const uint8_t*& data)
+				{
+					Link.Update();
+
+					return RxFifo.ReadSpan(data);
+				}
+
+				void Consume(const uint16_t size)
+				{
+					RxFifo.Consume(size);
+				}
+
+				uint16_t WriteSpan(uint8_t*& data)
+				{
+					Link.Update();
+
+					if (!Enabled || !Link.Connected)
+					{
+						data = nullptr;
+
+						return 0;
+					}
+
+					return TxFifo.WriteSpan(data);
+				}
+
+				void Commit(const uint16_t size)
+				{
+					StartWire();
+					TxFifo.Commit(size);
+					Stats.BytesWritten += size;
+				}
+
+			private:
+				/// <summary>
+				/// An idle wire starts transmitting from now, not from when it went idle.
+				/// </summary>
+				void StartWire()
+				{
+					if (TxFifo.Size() == 0
+						&& WireFreeNanos < Link.Clock.Nanos())
+					{
+						WireFreeNanos = Link.Clock.Nanos();
+					}
+				}
+
+				void Update(const uint64_t now)
+				{
+					// Serialize bytes onto the wire.
+					while (TxFifo.Size() > 0
+						&& ByteNanos > 0
+						&& (WireFreeNanos + ByteNanos) <= now)
+					{
+						WireFreeNanos += ByteNanos;
+						Stats.BytesOnWire++;
+						Emit(TxFifo.Pop(), WireFreeNanos + Link.PropagationNanos);
+					}
+
+					// Deliver bytes at the end of the wire.
+					while (InFlightCount > 0
+						&& InFlight[InFlightHead].ArrivalNanos <= now)
+					{
+						Peer->Receive(InFlight[InFlightHead].Value, Baudrate, Stats);
+						InFlightHead = (InFlightHead + 1) % InFlightSize;
+						InFlightCount--;
+					}
+				}
+
+				void Emit(uint8_t value, const uint64_t arrival)
+				{
+					if (Faults.CleanBaudrate > 0
+						&& Baudrate <= Faults.CleanBaudrate)
+					{
+						PushInFlight(value, arrival);
+
+						return;
+					}
+
+					if (Link.Random.Chance(Faults.DropPpm))
+					{
+						Stats.Drops++;
+
+						return;
+					}
+
+					for (uint8_t bit = 0; bit < 8; bit++)
+					{
+						if (Link.Random.Chance(Faults.BitFlipPpm))
+						{
+							value ^= (uint8_t)(1 << bit);
+							Stats.BitFlips++;
+						}
+					}
+
+					PushInFlight(value, arrival);
+
+					if (Link.Random.Chance(Faults.InsertPpm))
+					{
+						Stats.Inserts++;
+						PushInFlight((uint8_t)Link.Random.Next(), arrival);
+					}
+				}
+
+				void PushInFlight(const uint8_t value, const uint64_t arrival)
+				{
+					if (InFlightCount < InFlightSize)
+					{
+						InFlightByte& slot = InFlight[(InFlightHead + InFlightCount) % InFlightSize];
+						slot.ArrivalNanos = arrival;
+						slot.Value = value;
+						InFlightCount++;
+					}
+					else
+					{
+						Stats.InFlightOverflows++;
+					}
+				}
+
+				void Receive(uint8_t value, const uint32_t senderBaudrate, ChannelStats& senderStats)
+				{
+					if (!Enabled)
+					{
+						return;
+					}
+
+					if (senderBaudrate != Baudrate)
+					{
+						value = (uint8_t)Link.Random.Next();
+						senderStats.Garbled++;
+					}
+
+					if (RxFifo.Push(value))
+					{
+						senderStats.BytesDelivered++;
+					}
+					else
+					{
+						senderStats.RxOverruns++;
+					}
+				}
+			};
+
+		private:
+			VirtualClock& Clock;
+			SimulationRandom Random;
+			uint64_t PropagationNanos;
+			uint64_t LastUpdateNanos = UINT64_MAX;
+			bool Connected = true;
+
+		public:
+			Endpoint A;
+			Endpoint B;
+
+		public:
+			SimulatedLink(VirtualClock& clock,
+				const uint32_t propagationDelayNanos = 0,
+				const uint32_t seed = 1)
+				: Clock(clock)
+				, Random(seed)
+				, PropagationNanos(propagationDelayNanos)
+				, A(*this)
+				, B(*this)
+			{
+				A.Peer = &B;
+				B.Peer = &A;
+			}
+
+			void SetFaults(const FaultConfig& faults)
+			{
+				A.Faults = faults;
+				B.Faults = faults;
+			}
+
+			void Connect()
+			{
+				Connected = true;
+			}
+
+			void Disconnect()
+			{
+				Connected = false;
+			}
+
+			/// <summary>
+			/// Moves both directions up to the current virtual time.
+			/// </summary>
+			void Update()
+			{
+				const uint64_t now = Clock.Nanos();
+
+				if (now != LastUpdateNanos)
+				{
+					LastUpdateNanos = now;
+					A.Update(now);
+					B.Update(now);
+				}
+			}
+		};
+	}
+}
+#endif
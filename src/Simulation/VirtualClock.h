@@ -0,0 +1,89 @@
+#ifndef _UART_INTERFACE_VIRTUAL_CLOCK_h
+#define _UART_INTERFACE_VIRTUAL_CLOCK_h
+
+#include <stdint.h>
+
+namespace UartInterface
+{
+	namespace Simulation
+	{
+		/// <summary>
+		/// Manually advanced clock, with nanosecond resolution.
+		/// Time only moves on Advance(), so simulations are deterministic and can run faster than real time.
+		/// </summary>
+		class VirtualClock
+		{
+		private:
+			uint64_t NowNanos = 0;
+
+		public:
+			void Reset()
+			{
+				NowNanos = 0;
+			}
+
+			void Advance(const uint64_t nanos)
+			{
+				NowNanos += nanos;
+			}
+
+			void AdvanceMicros(const uint32_t micros)
+			{
+				NowNanos += (uint64_t)micros * 1000;
+			}
+
+			uint64_t Nanos() const
+			{
+				return NowNanos;
+			}
+
+			uint32_t Micros() const
+			{
+				return (uint32_t)(NowNanos / 1000);
+			}
+
+			uint32_t Millis() const
+			{
+				return (uint32_t)(NowNanos / 1000000);
+			}
+		};
+
+		/// <summary>
+		/// Deterministic xorshift32 pseudo-random source.
+		/// </summary>
+		class SimulationRandom
+		{
+		private:
+			uint32_t State;
+
+		public:
+			SimulationRandom(const uint32_t seed = 1)
+				: State(seed != 0 ? seed : 1)
+			{
+			}
+
+			void Seed(const uint32_t seed)
+			{
+				State = seed != 0 ? seed : 1;
+			}
+
+			uint32_t Next()
+			{
+				State ^= State << 13;
+				State ^= State >> 17;
+				State ^= State << 5;
+
+				return State;
+			}
+
+			/// <summary>
+			/// Random event with probability in parts per million.
+			/// </summary>
+			bool Chance(const uint32_t ppm)
+			{
+				return ppm > 0 && (Next() % 1000000) < ppm;
+			}
+		};
+	}
+}
+#endif
@@ -0,0 +1,45 @@
+#ifndef _UART_INTERFACE_TASK_CLOCK_h
+#define _UART_INTERFACE_TASK_CLOCK_h
+
+#include <stdint.h>
+
+namespace UartInterface
+{
+	/// <summary>
+	/// Time source for the tasks, shared with TaskScheduler.
+	/// With _TASK_EXTERNAL_TIME defined, both use external_millis()/external_micros(),
+	///  so the whole stack can run from a virtual clock.
+	/// </summary>
+	namespace TaskClock
+	{
+		inline uint32_t Millis()
+		{
+#if defined(_TASK_EXTERNAL_TIME)
+			return external_millis();
+#else
+			return millis();
+#endif
+		}
+
+		inline uint32_t Micros()
+		{
+#if defined(_TASK_EXTERNAL_TIME)
+			return external_micros();
+#else
+			return micros();
+#endif
+		}
+
+		/// <summary>
+		/// Task delay until a core's wake deadline, rounded up to the scheduler's millisecond.
+		/// </summary>
+		/// <returns>Delay in milliseconds, 0 (TASK_IMMEDIATE) if already due.</returns>
+		inline uint32_t GetDelayMillis(const uint32_t nowMicros, const uint32_t deadlineMicros)
+		{
+			const int32_t delta = (int32_t)(deadlineMicros - nowMicros);
+
+			return (delta > 0) ? (((uint32_t)delta + 999) / 1000) : 0;
+		}
+	}
+}
+#endif
@@ -5,315 +5,272 @@
 #include <TSchedulerDeclarations.hpp>
 
 #include <UartInterface.h>
+#include "TaskClock.h"
 #include "UartOutTask.h"
+#include "../Core/UartInterfaceCore.h"
 
 namespace UartInterface
 {
+	/// <summary>
+	/// TS::Task runner for UartInterfaceCore.
+	/// RX runs in this task, TX in its own UartOutTask.
+	/// With UartDefinitions::EventDrivenIdle, both disable themselves while the link is quiet.
+	/// </summary>
 	template<typename SerialType,
 		typename UartDefinitions = UartInterface::TemplateUartDefinitions<>>
 		class UartInterfaceTask : public TS::Task
 	{
-	private:
-		using MessageDefinition = UartInterface::MessageDefinition;
-
-	private:
-		enum class StateEnum
-		{
-			Disabled,
-			WaitingForSerial,
-			PassiveWaitPoll,
-			ActiveWaitPoll,
-			Accumulating,
-			DeliveringMessage
-		};
+	public:
+		using CoreType = UartInterfaceCore<SerialType, UartDefinitions>;
 
 	private:
-		static constexpr size_t BufferSize = MessageDefinition::GetBufferSizeFromPayload(UartDefinitions::MaxPayloadSize);
+		CoreType Core;
 
 		UartOut::UartOutTask<SerialType, UartDefinitions::MaxSerialStepOut, UartDefinitions::WriteTimeoutMillis> UartWriter;
 
-		MessageCodec<BufferSize> Codec;
-
-	private:
-		SerialType& SerialInstance;
-		UartListener* Listener;
-
-	private:
-
-		uint8_t OutBuffer[BufferSize]{};
-		uint8_t InBuffer[BufferSize]{};
-
-		uint32_t PollStart = 0;
-		uint32_t LastIn = 0;
-		uint16_t InSize = 0;
-
-	private:
-		StateEnum State = StateEnum::Disabled;
-
 	public:
 		UartInterfaceTask(TS::Scheduler& scheduler, SerialType& serialInstance, UartListener* listener,
 			const uint8_t* key,
 			const uint8_t keySize)
 			: TS::Task(TASK_IMMEDIATE, TASK_FOREVER, &scheduler, false)
-			, UartWriter(scheduler, serialInstance, OutBuffer, listener)
-			, Codec(key, keySize)
-			, SerialInstance(serialInstance)
-			, Listener(listener)
+			, Core(serialInstance, listener, key, keySize)
+			, UartWriter(scheduler, Core.GetWriter())
 		{
 		}
 
 		bool Setup()
 		{
-			return Codec.Setup() && UartWriter.Setup();
+			return Core.Setup();
 		}
 
 		void Start()
 		{
-			UartWriter.Clear();
-			State = StateEnum::WaitingForSerial;
-			SerialInstance.begin(UartDefinitions::Baudrate);
+			UartWriter.disable();
+			Core.Start();
 
 			TS::Task::enableDelayed(0);
 		}
 
 		void Stop()
 		{
-			switch (State)
-			{
-			case StateEnum::WaitingForSerial:
-			case StateEnum::Disabled:
-				UartWriter.Clear();
-				if (Listener != nullptr)
-				{
-					Listener->OnUartStateChange(false);
-				}
-			default:
-				break;
-			}
-
-			State = StateEnum::Disabled;
+			Core.Stop();
+			UartWriter.disable();
 			TS::Task::disable();
 		}
 
-		bool CanSendMessage() const
+		CoreType& GetCore()
+		{
+			return Core;
+		}
+
+		/// <summary>
+		/// This node's address, for Addressed definitions.
+		/// </summary>
+		void SetAddress(const uint8_t address)
 		{
-			switch (State)
+			Core.SetAddress(address);
+		}
+
+		/// <summary>
+		/// Half-duplex line driver, nullptr for full-duplex.
+		/// </summary>
+		void SetLineDriver(LineDriver* driver)
+		{
+			Core.SetLineDriver(driver);
+		}
+
+		/// <summary>
+		/// Raw wire capture of both directions, nullptr to disable.
+		/// </summary>
+		void SetWireTap(WireTap* tap)
+		{
+			Core.SetWireTap(tap);
+		}
+
+		/// <summary>
+		/// Encoded RX frames as they accumulate, nullptr to disable.
+		/// </summary>
+		void SetFrameSink(FrameSink* sink)
+		{
+			Core.SetFrameSink(sink);
+		}
+
+		/// <summary>
+		/// Re-begins the serial at another rate, only while nothing is being sent.
+		/// </summary>
+		void SetBaudrate(const uint32_t baudrate)
+		{
+			Core.SetBaudrate(baudrate);
+			if (Core.IsRxPolling())
 			{
-			case StateEnum::Disabled:
-			case StateEnum::WaitingForSerial:
-				return false;
-			default:
-				break;
+				TS::Task::enableDelayed(TASK_IMMEDIATE);
 			}
+		}
 
-			return UartWriter.CanSend();
+		uint32_t GetBaudrate() const
+		{
+			return Core.GetBaudrate();
+		}
+
+		/// <summary>
+		/// Keeps the frame being delivered, only from within OnUartRx().
+		/// </summary>
+		/// <returns>Lease for ReleaseRx(), CoreType::RxLeaseNone if refused.</returns>
+		uint8_t LeaseRx()
+		{
+			return Core.LeaseRx();
+		}
+
+		void ReleaseRx(const uint8_t lease)
+		{
+			Core.ReleaseRx(lease);
+		}
+
+		uint8_t GetRxPoolFree() const
+		{
+			return Core.GetRxPoolFree();
+		}
+
+		uint32_t GetRxPoolDropCount() const
+		{
+			return Core.GetRxPoolDropCount();
+		}
+
+		const FecStats& GetFecStats() const
+		{
+			return Core.GetFecStats();
+		}
+
+		bool CanSendMessage() const
+		{
+			return Core.CanSendMessage();
 		}
 
 		bool IsSerialConnected()
 		{
-			return SerialInstance;
+			return Core.IsSerialConnected();
 		}
 
 		bool SendMessage(const uint8_t header)
 		{
-			OutBuffer[(uint8_t)MessageDefinition::FieldIndexEnum::Header] = header;
+			return OnSent(Core.SendMessage(header));
+		}
+
+		bool SendMessage(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize)
+		{
+			return OnSent(Core.SendMessage(header, payload, payloadSize));
+		}
 
-			const uint8_t outSize = Codec.EncodeMessageAndCrcInPlace(OutBuffer, MessageDefinition::GetMessageSize(0));
+		bool SendMessageTo(const uint8_t address, const uint8_t header)
+		{
+			return OnSent(Core.SendMessageTo(address, header));
+		}
 
-			return UartWriter.SendMessage(outSize);
+		bool SendMessageTo(const uint8_t address, const uint8_t header, const uint8_t* payload, const uint8_t payloadSize)
+		{
+			return OnSent(Core.SendMessageTo(address, header, payload, payloadSize));
 		}
 
-		bool SendMessage(const uint8_t header, const uint8_t* payload, const uint8_t payloadSize)
+		/// <summary>
+		/// Sends a fixed size payload, encoded with compile-time sizes.
+		/// </summary>
+		template<typename PayloadType>
+		bool SendMessage(const uint8_t header, const PayloadType& payload)
 		{
-			if (!CanSendMessage()
-				|| payloadSize > UartDefinitions::MaxPayloadSize
-				|| payload == nullptr)
-			{
-				return false;
-			}
+			static_assert(PayloadTypeCheck<PayloadType>::Valid, "Payload type must be a trivially copyable value, not a pointer.");
+
+			return OnSent(Core.SendMessage(header, payload));
+		}
+
+		bool SendPreEncoded(const uint8_t* frame, const uint8_t frameSize)
+		{
+			return OnSent(Core.SendPreEncoded(frame, frameSize));
+		}
+
+		/// <summary>
+		/// Sends a compile-time PreEncodedFrame, with no runtime encoding.
+		/// </summary>
+		template<typename FrameType>
+		bool SendPreEncoded()
+		{
+			return OnSent(Core.template SendPreEncoded<FrameType>());
+		}
 
-			OutBuffer[(uint8_t)MessageDefinition::FieldIndexEnum::Header] = header;
-			memcpy(&OutBuffer[(uint8_t)MessageDefinition::FieldIndexEnum::Payload], payload, payloadSize);
+		/// <summary>
+		/// Forwards an encoded frame as it is, possibly still arriving, see UartInterfaceCore::SendThrough().
+		/// </summary>
+		bool SendThrough(const uint8_t* frame, const uint8_t frameSize, const bool open)
+		{
+			return OnSent(Core.SendThrough(frame, frameSize, open));
+		}
 
-			const uint8_t outSize = Codec.EncodeMessageAndCrcInPlace(OutBuffer, MessageDefinition::GetMessageSize(payloadSize));
+		void ExtendThrough(const uint8_t frameSize)
+		{
+			Core.ExtendThrough(frameSize);
+			UartWriter.Wake();
+		}
 
-			return UartWriter.SendMessage(outSize);
+		void CloseThrough(const uint8_t frameSize)
+		{
+			Core.CloseThrough(frameSize);
+			UartWriter.Wake();
 		}
 
 		void OnSerialEvent()
 		{
-			switch (State)
+			if (Core.OnSerialEvent(TaskClock::Micros()))
 			{
-			case StateEnum::PassiveWaitPoll:
-				State = StateEnum::ActiveWaitPoll;
-				PollStart = millis();
-				TS::Task::delay(TASK_IMMEDIATE);
-				break;
-			case StateEnum::WaitingForSerial:
 				TS::Task::enableDelayed(TASK_IMMEDIATE);
-				break;
-			default:
-				break;
 			}
 		}
 
+		/// <summary>
+		/// Serial connection change hook, wakes an event-driven idle RX.
+		/// </summary>
+		void OnConnectionChange()
+		{
+			if (Core.OnConnectionChange())
+			{
+				TS::Task::enableDelayed(TASK_IMMEDIATE);
+			}
+		}
+
+		uint32_t GetRxPollCount() const
+		{
+			return Core.GetRxPollCount();
+		}
+
 		bool Callback() final
 		{
-			switch (State)
+			const uint32_t now = TaskClock::Micros();
+			const uint32_t deadline = Core.PollRx(now);
+
+			if (Core.IsRxPolling())
+			{
+				TS::Task::delay(TaskClock::GetDelayMillis(now, deadline));
+			}
+			else
 			{
-			case StateEnum::WaitingForSerial:
-				TS::Task::delay(UartDefinitions::PollPeriodMillis);
-				if (SerialInstance)
-				{
-					if (UartWriter.Start())
-					{
-						State = StateEnum::ActiveWaitPoll;
-						TS::Task::delay(TASK_IMMEDIATE);
-						if (Listener != nullptr)
-						{
-							Listener->OnUartStateChange(true);
-						}
-					}
-				}
-				break;
-			case StateEnum::PassiveWaitPoll:
-				if (!SerialInstance)
-				{
-					TS::Task::delay(TASK_IMMEDIATE);
-					State = StateEnum::WaitingForSerial;
-					if (Listener != nullptr)
-					{
-						Listener->OnUartStateChange(false);
-					}
-				}
-				else if (SerialInstance.available())
-				{
-					TS::Task::delay(TASK_IMMEDIATE);
-					State = StateEnum::ActiveWaitPoll;
-					PollStart = millis();
-				}
-				else
-				{
-					TS::Task::delay(UartDefinitions::PollPeriodMillis);
-				}
-				break;
-			case StateEnum::ActiveWaitPoll:
-				TS::Task::delay(TASK_IMMEDIATE);
-				if (!SerialInstance)
-				{
-					State = StateEnum::WaitingForSerial;
-					if (Listener != nullptr)
-					{
-						Listener->OnUartStateChange(false);
-					}
-				}
-				else if (SerialInstance.available())
-				{
-					PollStart = millis();
-					State = StateEnum::Accumulating;
-				}
-				else if (millis() - PollStart > UartDefinitions::ReadTimeoutMillis)
-				{
-					State = StateEnum::PassiveWaitPoll;
-				}
-				break;
-			case StateEnum::Accumulating:
-				TS::Task::delay(TASK_IMMEDIATE);
-				if (!SerialInstance)
-				{
-					State = StateEnum::WaitingForSerial;
-					if (Listener != nullptr)
-					{
-						Listener->OnUartStateChange(false);
-					}
-					break;
-				}
-				else if (SerialInstance.available())
-				{
-					LastIn = millis();
-					if (SerialInstance.peek() == MessageDefinition::Delimiter)
-					{
-						SerialInstance.read();
-						if (InSize >= MessageDefinition::MessageSizeMin)
-						{
-							State = StateEnum::DeliveringMessage;
-						}
-						else
-						{
-							if (InSize > 0 && Listener != nullptr)
-							{
-								Listener->OnUartRxError(RxErrorEnum::TooShort);
-							}
-							InSize = 0;
-						}
-					}
-					else
-					{
-						InBuffer[InSize++] = SerialInstance.read();
-						if (InSize > MessageDefinition::GetBufferSizeFromPayload(UartDefinitions::MaxPayloadSize))
-						{
-							InSize = 0;
-							State = StateEnum::ActiveWaitPoll;
-							PollStart = millis();
-							if (Listener != nullptr)
-							{
-								Listener->OnUartRxError(RxErrorEnum::TooLong);
-							}
-						}
-					}
-				}
-				else if (millis() - LastIn > UartDefinitions::ReadTimeoutMillis)
-				{
-					InSize = 0;
-					PollStart = millis();
-					State = StateEnum::ActiveWaitPoll;
-				}
-				break;
-			case StateEnum::DeliveringMessage:
-				TS::Task::delay(TASK_IMMEDIATE);
-				DeliverMessage();
-				InSize = 0;
-				State = StateEnum::Accumulating;
-				break;
-			case StateEnum::Disabled:
-			default:
 				TS::Task::disable();
-				break;
 			}
 
 			return true;
 		}
 
 	private:
-		void DeliverMessage()
+		bool OnSent(const bool sent)
 		{
-			if (InSize >= MessageDefinition::MessageSizeMin)
+			if (sent)
 			{
-				if (Codec.DecodeMessageInPlaceIfValid(InBuffer, InSize))
-				{
-					if (Listener != nullptr)
-					{
-						if (MessageDefinition::GetPayloadSize(InSize - 1) > 0)
-						{
-							Listener->OnUartRx(InBuffer[(uint8_t)MessageDefinition::FieldIndexEnum::Header],
-								&InBuffer[(uint8_t)MessageDefinition::FieldIndexEnum::Payload], MessageDefinition::GetPayloadSize(InSize - 1));
-						}
-						else
-						{
-							Listener->OnUartRx(InBuffer[(uint8_t)MessageDefinition::FieldIndexEnum::Header]);
-						}
-					}
-				}
-				else if (Listener != nullptr)
+				UartWriter.Wake();
+				if (Core.WakeRx())
 				{
-					Listener->OnUartRxError(RxErrorEnum::Crc);
+					TS::Task::enableDelayed(TASK_IMMEDIATE);
 				}
 			}
-			else if (InSize > 0 && Listener != nullptr)
-			{
-				Listener->OnUartRxError(RxErrorEnum::TooShort);
-			}
+
+			return sent;
 		}
 	};
 }
-#endif
\ No newline at end of file
+#endif
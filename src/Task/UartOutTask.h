@@ -4,15 +4,21 @@
 #define _TASK_OO_CALLBACKS
 #include <TSchedulerDeclarations.hpp>
 
+#include <new>
+
 #include <UartInterface.h>
+#include "TaskClock.h"
+#include "../Core/UartOutCore.h"
 
 namespace UartInterface
 {
 	namespace UartOut
 	{
 		/// <summary>
-		/// Async stream writer from an external fixed buffer.
+		/// Async stream writer from an external fixed buffer, a TS::Task runner for UartOutCore.
 		/// Delimits each buffer transmission with the MessageDefinition delimiter.
+		/// Owns its core, or runs one owned elsewhere (e.g. by UartInterfaceCore).
+		/// Disables itself when there is nothing to send, Wake() on each new message.
 		/// </summary>
 		/// <typeparam name="SerialType"></typeparam>
 		/// <typeparam name="MaxSerialStepOut"></typeparam>
@@ -21,217 +27,102 @@ namespace UartInterface
 			uint32_t WriteTimeoutMillis>
 		class UartOutTask : public TS::Task
 		{
-		private:
-			enum class StateEnum : uint8_t
-			{
-				NotSending,
-				SendingStartDelimiter,
-				SendingData,
-				SendingEndDelimiter
-			};
-
-			StateEnum SendState = StateEnum::NotSending;
-
-		private:
-			using MessageDefinition = UartInterface::MessageDefinition;
-
-		private:
-			SerialType& SerialInstance;
-			uint8_t* OutBuffer;
-			UartListener* Listener;
+		public:
+			using CoreType = UartOutCore<SerialType, MaxSerialStepOut, WriteTimeoutMillis>;
 
 		private:
-			uint32_t OutStart = 0;
-			uint8_t OutSize = 0;
-			uint8_t OutIndex = 0;
+			alignas(CoreType) uint8_t CoreStorage[sizeof(CoreType)];
+			CoreType& Core;
+			const bool OwnsCore;
 
 		public:
+			/// <param name="outBuffer">Message buffer, see UartOutCore.</param>
 			UartOutTask(TS::Scheduler& scheduler, SerialType& serialInstance, uint8_t* outBuffer, UartListener* listener)
 				: Task(TASK_IMMEDIATE, TASK_FOREVER, &scheduler, false)
-				, SerialInstance(serialInstance)
-				, OutBuffer(outBuffer)
-				, Listener(listener)
+				, Core(*new (CoreStorage) CoreType(serialInstance, outBuffer, listener))
+				, OwnsCore(true)
+			{
+			}
+
+			UartOutTask(TS::Scheduler& scheduler, CoreType& core)
+				: Task(TASK_IMMEDIATE, TASK_FOREVER, &scheduler, false)
+				, Core(core)
+				, OwnsCore(false)
+			{
+			}
+
+			~UartOutTask()
+			{
+				if (OwnsCore)
+				{
+					Core.~CoreType();
+				}
+			}
+
+			CoreType& GetCore()
 			{
+				return Core;
 			}
 
 			bool Setup() const
 			{
-				return OutBuffer != nullptr;
+				return Core.Setup();
 			}
 
 			void Clear()
 			{
-				OutSize = 0;
-				SendState = StateEnum::NotSending;
-				OutIndex = 0;
-				SerialInstance.clearWriteError();
+				Core.Clear();
 			}
 
 			bool Start()
 			{
-				if (OutBuffer != nullptr)
-				{
-					Clear();
-					TS::Task::disable();
+				TS::Task::disable();
 
-					return true;
-				}
-				else
-				{
-					return false;
-				}
+				return Core.Start();
 			}
 
 			bool CanSend() const
 			{
-				return SendState == StateEnum::NotSending
-#if defined(ARDUINO_ARCH_STM32F4)
-					&& (USART_TX_BUF_SIZE - SerialInstance.pending()) >= MessageDefinition::MessageSizeMin
-#else
-					&& SerialInstance.availableForWrite() >= MessageDefinition::MessageSizeMin
-#endif
-					;
+				return Core.CanSend();
 			}
 
+			/// <summary>
+			/// Sends the first messageSize bytes of the OutBuffer.
+			/// </summary>
 			bool SendMessage(const uint8_t messageSize)
 			{
-				if (!CanSend()
-					|| messageSize < MessageDefinition::MessageSizeMin)
+				if (Core.SendMessage(messageSize))
 				{
-					return false;
-				}
+					Wake();
 
-				OutSize = messageSize;
-				OutIndex = 0;
-				SendState = StateEnum::SendingStartDelimiter;
+					return true;
+				}
 
-				OutStart = millis();
+				return false;
+			}
 
+			void Wake()
+			{
 				TS::Task::enableDelayed(TASK_IMMEDIATE);
-
-				return true;
 			}
 
 			bool Callback() final
 			{
-				if (!SerialInstance)
-				{
-					Clear();
-					TS::Task::disable();
+				const uint32_t now = TaskClock::Micros();
+				const uint32_t deadline = Core.Poll(now);
 
-					return true;
+				if (Core.IsPolling())
+				{
+					TS::Task::delay(TaskClock::GetDelayMillis(now, deadline));
 				}
-
-				const bool timedOut = (millis() - OutStart) >= WriteTimeoutMillis;
-
-				switch (SendState)
+				else
 				{
-				case StateEnum::SendingStartDelimiter:
-					if (!SerialInstance || timedOut)
-					{
-						SendState = StateEnum::NotSending;
-						if (timedOut && Listener != nullptr)
-						{
-							Listener->OnUartTxError(UartInterface::TxErrorEnum::StartTimeout);
-						}
-					}
-#if defined(ARDUINO_ARCH_STM32F4)
-					else if ((USART_TX_BUF_SIZE - SerialInstance.pending()) > MessageDefinition::MessageSizeMin)
-#else
-					else if (SerialInstance.availableForWrite() > MessageDefinition::MessageSizeMin)
-#endif
-					{
-						SerialInstance.write((uint8_t)(MessageDefinition::Delimiter));
-						SendState = StateEnum::SendingData;
-					}
-					break;
-				case StateEnum::SendingData:
-					if (OutIndex < OutSize)
-					{
-						if (!SerialInstance || timedOut)
-						{
-							SendState = StateEnum::NotSending;
-							if (timedOut && Listener != nullptr)
-							{
-								Listener->OnUartTxError(UartInterface::TxErrorEnum::DataTimeout);
-							}
-							break;
-						}
-						else
-						{
-							OutIndex += PushOut();
-							if (OutIndex >= OutSize)
-							{
-								SendState = StateEnum::SendingEndDelimiter;
-								break;
-							}
-						}
-					}
-					else
-					{
-						SendState = StateEnum::SendingEndDelimiter;
-					}
-					break;
-				case StateEnum::SendingEndDelimiter:
-					if (!SerialInstance || timedOut)
-					{
-						SendState = StateEnum::NotSending;
-						if (timedOut && Listener != nullptr)
-						{
-							Listener->OnUartTxError(UartInterface::TxErrorEnum::EndTimeout);
-						}
-					}
-					else if (SerialInstance
-#if defined(ARDUINO_ARCH_STM32F4)
-						&& (USART_TX_BUF_SIZE - SerialInstance.pending())
-#else
-						&& SerialInstance.availableForWrite()
-#endif
-						)
-					{
-						SerialInstance.write((uint8_t)(MessageDefinition::Delimiter));
-						SendState = StateEnum::NotSending;
-						if (Listener != nullptr)
-						{
-							Listener->OnUartTx();
-						}
-					}
-					break;
-				case StateEnum::NotSending:
-				default:
 					TS::Task::disable();
-					break;
 				}
 
 				return true;
 			}
-
-		private:
-			uint8_t PushOut()
-			{
-				uint8_t size = OutSize - OutIndex;
-
-				if (size > MaxSerialStepOut)
-				{
-					size = MaxSerialStepOut;
-				}
-
-#if defined(ARDUINO_ARCH_STM32F4)
-				const uint16_t available = USART_TX_BUF_SIZE - SerialInstance.pending();
-#else
-				const uint16_t available = SerialInstance.availableForWrite();
-#endif
-				if (size > available)
-				{
-					size = available;
-				}
-
-				SerialInstance.write(&OutBuffer[OutIndex], size);
-
-
-				return size;
-			}
 		};
 	}
 }
-#endif
\ No newline at end of file
+#endif
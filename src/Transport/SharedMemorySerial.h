@@ -0,0 +1,537 @@
+#ifndef _UART_INTERFACE_SHARED_MEMORY_SERIAL_h
+#define _UART_INTERFACE_SHARED_MEMORY_SERIAL_h
+
+#if defined(__linux__)
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <new>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "SpscRing.h"
+
+namespace UartInterface
+{
+	namespace Transport
+	{
+		static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2, "Shared memory rings need address-free atomics.");
+
+		/// <summary>
+		/// One direction of a shared memory link.
+		/// The wire fields are only used with baud rate emulation, and only written by the producer.
+		/// </summary>
+		template<uint16_t Capacity>
+		struct SharedMemoryChannel
+		{
+			SpscByteRing<Capacity> Ring{};
+
+			/// <summary>
+			/// When the last byte written is fully received, in CLOCK_MONOTONIC nanos.
+			/// </summary>
+			alignas(UART_INTERFACE_CACHE_LINE_SIZE) std::atomic<uint64_t> WireFreeNanos{ 0 };
+
+			/// <summary>
+			/// 8N1 byte time at the producer's baud rate, 0 when not emulated.
+			/// </summary>
+			std::atomic<uint32_t> ByteNanos{ 0 };
+
+			/// <summary>
+			/// Futex word, bumped on every write.
+			/// </summary>
+			alignas(UART_INTERFACE_CACHE_LINE_SIZE) std::atomic<uint32_t> Sequence{ 0 };
+			std::atomic<uint32_t> Waiting{ 0 };
+		};
+
+		/// <summary>
+		/// Shared memory segment layout, the creator's side is A.
+		/// </summary>
+		template<uint16_t Capacity>
+		struct SharedMemorySegment
+		{
+			static constexpr uint32_t Magic = 0x554D5348; // "UMSH"
+
+			std::atomic<uint32_t> Ready{ 0 };
+			uint32_t RingCapacity = Capacity;
+
+			SharedMemoryChannel<Capacity> AtoB{};
+			SharedMemoryChannel<Capacity> BtoA{};
+		};
+
+		/// <summary>
+		/// SerialType over a POSIX shared memory segment, for processes on the same host (e.g. co-simulation).
+		/// One process Create()s the segment, the other Open()s it by name.
+		/// Each direction is a lock-free SPSC byte ring, written and read in spans, with no syscalls on the data path.
+		/// A consumer with nothing to do may block in WaitForRx(), the producer then wakes it with a futex.
+		/// With baud rate emulation, each side's begin() rate paces its bytes:
+		///  they only become available to the peer as they would arrive on a wire,
+		///  and the writer gets no more than TxFifoSize bytes ahead of the wire.
+		/// </summary>
+		/// <typeparam name="Capacity">Ring size per direction, power of 2.</typeparam>
+		/// <typeparam name="TxFifoSize">Emulated TX FIFO depth.</typeparam>
+		template<uint16_t Capacity = 4096, uint16_t TxFifoSize = 64>
+		class SharedMemorySerial
+		{
+		public:
+			using SegmentType = SharedMemorySegment<Capacity>;
+			using ChannelType = SharedMemoryChannel<Capacity>;
+
+			static constexpr uint8_t NameSizeMax = 64;
+
+		private:
+			SegmentType* Segment = nullptr;
+			ChannelType* Tx = nullptr;
+			ChannelType* Rx = nullptr;
+
+			char Name[NameSizeMax]{};
+			bool Owner = false;
+
+			const bool EmulateBaudrate;
+
+			/// <summary>
+			/// Consumer side, bytes read or cleared and the last arrival reported by TakeEvent().
+			/// </summary>
+			uint32_t RxTaken = 0;
+			uint32_t RxSignaled = 0;
+
+		public:
+			SharedMemorySerial(const bool emulateBaudrate = false)
+				: EmulateBaudrate(emulateBaudrate)
+			{
+			}
+
+			~SharedMemorySerial()
+			{
+				Close();
+			}
+
+			/// <summary>
+			/// Creates the segment as side A, replacing any stale one with the same name.
+			/// </summary>
+			/// <param name="name">POSIX shared memory name, e.g. "/uart0".</param>
+			bool Create(const char* name)
+			{
+				Close();
+				if (!SetName(name))
+				{
+					return false;
+				}
+
+				shm_unlink(Name);
+				const int fd = shm_open(Name, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+				if (fd < 0)
+				{
+					return false;
+				}
+
+				void* address = MAP_FAILED;
+				if (ftruncate(fd, sizeof(SegmentType)) == 0)
+				{
+					address = mmap(nullptr, sizeof(SegmentType), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				}
+				close(fd);
+
+				if (address == MAP_FAILED)
+				{
+					shm_unlink(Name);
+
+					return false;
+				}
+
+				Segment = new (address) SegmentType();
+				Tx = &Segment->AtoB;
+				Rx = &Segment->BtoA;
+				Owner = true;
+				Segment->Ready.store(SegmentType::Magic, std::memory_order_release);
+
+				return true;
+			}
+
+			/// <summary>
+			/// Opens an existing segment as side B.
+			/// </summary>
+			/// <returns>False if the segment doesn't exist or isn't ready yet, or has a different Capacity.</returns>
+			bool Open(const char* name)
+			{
+				Close();
+				if (!SetName(name))
+				{
+					return false;
+				}
+
+				const int fd = shm_open(Name, O_RDWR, 0);
+				if (fd < 0)
+				{
+					return false;
+				}
+
+				struct stat info;
+				void* address = MAP_FAILED;
+				if (fstat(fd, &info) == 0
+					&& info.st_size == (off_t)sizeof(SegmentType))
+				{
+					address = mmap(nullptr, sizeof(SegmentType), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				}
+				close(fd);
+
+				if (address == MAP_FAILED)
+				{
+					return false;
+				}
+
+				SegmentType* segment = (SegmentType*)address;
+				if (segment->Ready.load(std::memory_order_acquire) != SegmentType::Magic
+					|| segment->RingCapacity != Capacity)
+				{
+					munmap(address, sizeof(SegmentType));
+
+					return false;
+				}
+
+				Segment = segment;
+				Tx = &Segment->BtoA;
+				Rx = &Segment->AtoB;
+
+				return true;
+			}
+
+			/// <summary>
+			/// Unmaps the segment, and unlinks it if this side created it.
+			/// </summary>
+			void Close()
+			{
+				if (Segment != nullptr)
+				{
+					munmap(Segment, sizeof(SegmentType));
+					if (Owner)
+					{
+						shm_unlink(Name);
+					}
+				}
+
+				Segment = nullptr;
+				Tx = nullptr;
+				Rx = nullptr;
+				Owner = false;
+				RxTaken = 0;
+				RxSignaled = 0;
+			}
+
+			/// <summary>
+			/// Blocks until RX bytes are available, or the timeout.
+			/// Bytes still on the emulated wire are waited for until they arrive.
+			/// </summary>
+			/// <returns>True if bytes are available.</returns>
+			bool WaitForRx(const uint32_t timeoutMicros)
+			{
+				if (Segment == nullptr)
+				{
+					return false;
+				}
+
+				const uint64_t deadline = NowNanos() + (uint64_t)timeoutMicros * 1000;
+				while (available() == 0)
+				{
+					const uint64_t now = NowNanos();
+					if (now >= deadline)
+					{
+						return false;
+					}
+
+					uint64_t waitNanos = deadline - now;
+					const uint32_t byteNanos = Rx->ByteNanos.load(std::memory_order_relaxed);
+					if (byteNanos > 0
+						&& Rx->Ring.Size() > 0)
+					{
+						// Until the first byte on the wire arrives.
+						const uint64_t wireFree = Rx->WireFreeNanos.load(std::memory_order_acquire);
+						const uint64_t first = wireFree - (uint64_t)(Rx->Ring.Size() - 1) * byteNanos;
+						if (first > now && first - now < waitNanos)
+						{
+							waitNanos = first - now;
+						}
+						else if (first <= now)
+						{
+							continue;
+						}
+					}
+
+					Rx->Waiting.store(1, std::memory_order_seq_cst);
+					const uint32_t sequence = Rx->Sequence.load(std::memory_order_seq_cst);
+					if (Rx->Ring.Size() == 0
+						|| byteNanos > 0)
+					{
+						FutexWait(Rx->Sequence, sequence, waitNanos);
+					}
+					Rx->Waiting.store(0, std::memory_order_relaxed);
+				}
+
+				return true;
+			}
+
+			/// <summary>
+			/// True once after new RX bytes have arrived, for the protocol context to forward as a serial event.
+			/// </summary>
+			bool TakeEvent()
+			{
+				const uint32_t arrived = RxTaken + available();
+				const bool signaled = arrived != RxSignaled;
+				RxSignaled = arrived;
+
+				return signaled;
+			}
+
+		public:
+			// SerialType.
+
+			operator bool()
+			{
+				return Segment != nullptr;
+			}
+
+			/// <summary>
+			/// Discards pending RX, and sets the emulated TX baud rate.
+			/// </summary>
+			void begin(const unsigned long baudrate)
+			{
+				if (Segment == nullptr)
+				{
+					return;
+				}
+
+				Tx->ByteNanos.store((EmulateBaudrate && baudrate > 0) ? (uint32_t)(10000000000ULL / baudrate) : 0, std::memory_order_relaxed);
+
+				RxTaken += Rx->Ring.Size();
+				Rx->Ring.Clear();
+				RxSignaled = RxTaken;
+			}
+
+			void end()
+			{
+			}
+
+			int available()
+			{
+				if (Segment == nullptr)
+				{
+					return 0;
+				}
+
+				return Arrived(Rx->Ring.Size());
+			}
+
+			int peek()
+			{
+				const uint8_t* data;
+
+				return ReadSpan(data) > 0 ? data[0] : -1;
+			}
+
+			int read()
+			{
+				const uint8_t* data;
+				if (ReadSpan(data) > 0)
+				{
+					const uint8_t value = data[0];
+					Consume(1);
+
+					return value;
+				}
+
+				return -1;
+			}
+
+			uint16_t ReadSpan(const uint8_t*& data)
+			{
+				if (Segment == nullptr)
+				{
+					return 0;
+				}
+
+				const uint16_t size = Rx->Ring.ReadSpan(data);
+				const uint16_t arrived = Arrived(Rx->Ring.Size());
+
+				return size < arrived ? size : arrived;
+			}
+
+			void Consume(const uint16_t size)
+			{
+				Rx->Ring.Consume(size);
+				RxTaken += size;
+			}
+
+			int availableForWrite()
+			{
+				if (Segment == nullptr)
+				{
+					return 0;
+				}
+
+				const uint16_t free = Tx->Ring.Free();
+				const uint32_t byteNanos = Tx->ByteNanos.load(std::memory_order_relaxed);
+				if (byteNanos == 0)
+				{
+					return free;
+				}
+
+				const uint64_t wireFree = Tx->WireFreeNanos.load(std::memory_order_relaxed);
+				const uint64_t now = NowNanos();
+				const uint64_t onWire = (wireFree > now) ? ((wireFree - now + byteNanos - 1) / byteNanos) : 0;
+				const uint16_t fifoFree = (onWire < TxFifoSize) ? (uint16_t)(TxFifoSize - onWire) : 0;
+
+				return fifoFree < free ? fifoFree : free;
+			}
+
+			uint16_t WriteSpan(uint8_t*& data)
+			{
+				if (Segment == nullptr)
+				{
+					return 0;
+				}
+
+				const uint16_t size = Tx->Ring.WriteSpan(data);
+				const uint16_t available = (uint16_t)availableForWrite();
+
+				return size < available ? size : available;
+			}
+
+			void Commit(const uint16_t size)
+			{
+				if (size > 0)
+				{
+					PutOnWire(size);
+					Tx->Ring.Commit(size);
+					Notify();
+				}
+			}
+
+			size_t write(const uint8_t value)
+			{
+				return write(&value, 1);
+			}
+
+			size_t write(const uint8_t* buffer, const size_t size)
+			{
+				if (Segment == nullptr)
+				{
+					return 0;
+				}
+
+				const uint16_t available = (uint16_t)availableForWrite();
+				const uint16_t count = (size < available) ? (uint16_t)size : available;
+				if (count > 0)
+				{
+					PutOnWire(count);
+					Tx->Ring.Push(buffer, count);
+					Notify();
+				}
+
+				return count;
+			}
+
+			/// <summary>
+			/// Waits for the emulated wire to go idle.
+			/// </summary>
+			void flush()
+			{
+				while (Segment != nullptr
+					&& Tx->ByteNanos.load(std::memory_order_relaxed) > 0
+					&& Tx->WireFreeNanos.load(std::memory_order_relaxed) > NowNanos())
+				{
+					sched_yield();
+				}
+			}
+
+			void clearWriteError()
+			{
+			}
+
+		private:
+			bool SetName(const char* name)
+			{
+				if (name == nullptr
+					|| strlen(name) >= NameSizeMax)
+				{
+					return false;
+				}
+				strcpy(Name, name);
+
+				return true;
+			}
+
+			/// <summary>
+			/// Pending RX bytes that are off the emulated wire.
+			/// The producer moves the wire before publishing the bytes, so it's never behind them.
+			/// </summary>
+			uint16_t Arrived(const uint16_t pending) const
+			{
+				const uint32_t byteNanos = Rx->ByteNanos.load(std::memory_order_relaxed);
+				if (byteNanos == 0
+					|| pending == 0)
+				{
+					return pending;
+				}
+
+				const uint64_t wireFree = Rx->WireFreeNanos.load(std::memory_order_acquire);
+				const uint64_t now = NowNanos();
+				if (wireFree <= now)
+				{
+					return pending;
+				}
+
+				const uint64_t onWire = (wireFree - now + byteNanos - 1) / byteNanos;
+
+				return (onWire < pending) ? (uint16_t)(pending - onWire) : 0;
+			}
+
+			void PutOnWire(const uint16_t size)
+			{
+				const uint32_t byteNanos = Tx->ByteNanos.load(std::memory_order_relaxed);
+				if (byteNanos > 0)
+				{
+					const uint64_t now = NowNanos();
+					const uint64_t wireFree = Tx->WireFreeNanos.load(std::memory_order_relaxed);
+					Tx->WireFreeNanos.store(((wireFree > now) ? wireFree : now) + (uint64_t)size * byteNanos, std::memory_order_release);
+				}
+			}
+
+			/// <summary>
+			/// Wakes the peer, only if it is blocked in WaitForRx().
+			/// </summary>
+			void Notify()
+			{
+				Tx->Sequence.fetch_add(1, std::memory_order_seq_cst);
+				if (Tx->Waiting.load(std::memory_order_seq_cst) != 0)
+				{
+					syscall(SYS_futex, (uint32_t*)&Tx->Sequence, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+				}
+			}
+
+			static void FutexWait(std::atomic<uint32_t>& word, const uint32_t value, const uint64_t timeoutNanos)
+			{
+				struct timespec timeout;
+				timeout.tv_sec = (time_t)(timeoutNanos / 1000000000ULL);
+				timeout.tv_nsec = (long)(timeoutNanos % 1000000000ULL);
+
+				syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAIT, value, &timeout, nullptr, 0);
+			}
+
+			static uint64_t NowNanos()
+			{
+				struct timespec now;
+				clock_gettime(CLOCK_MONOTONIC, &now);
+
+				return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+			}
+		};
+	}
+}
+#endif
+#endif
@@ -0,0 +1,319 @@
+#ifndef _UART_INTERFACE_SPAN_TRANSPORT_h
+#define _UART_INTERFACE_SPAN_TRANSPORT_h
+
+#include <stdint.h>
+#include <string.h>
+
+namespace UartInterface
+{
+	/// <summary>
+	/// Contiguous buffer access to the serial driver.
+	/// A SerialType may optionally expose its ring buffers directly:
+	///		RX: uint16_t ReadSpan(const uint8_t*& data), void Consume(const uint16_t size)
+	///		TX: uint16_t WriteSpan(uint8_t*& data), void Commit(const uint16_t size)
+	/// Spans are contiguous, so a wrapped ring buffer returns its data in two spans.
+	/// When the SerialType does not provide them, the Arduino byte API is used instead.
+	/// It may also take several buffers in a single call (e.g. writev() on a file descriptor):
+	///		TX: uint16_t WriteGather(const uint8_t* const* data, const uint16_t* sizes, const uint8_t count)
+	/// Otherwise, gathered buffers are written one after the other.
+	/// </summary>
+	namespace Transport
+	{
+		template<typename SerialType>
+		struct HasReadSpan
+		{
+		private:
+			template<typename T>
+			static auto Test(T* serial) -> decltype(serial->ReadSpan(*static_cast<const uint8_t**>(nullptr)), serial->Consume(uint16_t(0)), uint8_t());
+
+			template<typename T>
+			static uint16_t Test(...);
+
+		public:
+			static constexpr bool Value = sizeof(Test<SerialType>(nullptr)) == sizeof(uint8_t);
+		};
+
+		template<typename SerialType>
+		struct HasWriteSpan
+		{
+		private:
+			template<typename T>
+			static auto Test(T* serial) -> decltype(serial->WriteSpan(*static_cast<uint8_t**>(nullptr)), serial->Commit(uint16_t(0)), uint8_t());
+
+			template<typename T>
+			static uint16_t Test(...);
+
+		public:
+			static constexpr bool Value = sizeof(Test<SerialType>(nullptr)) == sizeof(uint8_t);
+		};
+
+		template<typename SerialType>
+		struct HasWriteGather
+		{
+		private:
+			template<typename T>
+			static auto Test(T* serial) -> decltype(serial->WriteGather(static_cast<const uint8_t* const*>(nullptr), static_cast<const uint16_t*>(nullptr), uint8_t(0)), uint8_t());
+
+			template<typename T>
+			static uint16_t Test(...);
+
+		public:
+			static constexpr bool Value = sizeof(Test<SerialType>(nullptr)) == sizeof(uint8_t);
+		};
+
+		/// <summary>
+		/// Gathered TX, forwarded to the driver in a single call.
+		/// </summary>
+		template<typename SerialType,
+			bool NativeGather = HasWriteGather<SerialType>::Value>
+		struct GatherWriter
+		{
+			template<typename WriterType>
+			static uint16_t Write(SerialType& serialInstance, WriterType&, const uint8_t* const* data, const uint16_t* sizes, const uint8_t count)
+			{
+				return serialInstance.WriteGather(data, sizes, count);
+			}
+		};
+
+		/// <summary>
+		/// Gathered TX, fallback one buffer at a time, until the driver takes less than offered.
+		/// </summary>
+		template<typename SerialType>
+		struct GatherWriter<SerialType, false>
+		{
+			template<typename WriterType>
+			static uint16_t Write(SerialType&, WriterType& writer, const uint8_t* const* data, const uint16_t* sizes, const uint8_t count)
+			{
+				uint16_t written = 0;
+				for (uint8_t i = 0; i < count; i++)
+				{
+					const uint16_t size = writer.Write(data[i], sizes[i]);
+					written += size;
+					if (size < sizes[i])
+					{
+						break;
+					}
+				}
+
+				return written;
+			}
+		};
+
+		/// <summary>
+		/// RX span access, fallback for the Arduino byte API.
+		/// Bytes are staged in a small local buffer, at most StagingSize at a time.
+		/// </summary>
+		template<typename SerialType,
+			uint8_t StagingSize,
+			bool NativeSpan = HasReadSpan<SerialType>::Value>
+		class SpanReader
+		{
+		private:
+			SerialType& SerialInstance;
+
+			uint8_t Staging[StagingSize]{};
+			uint8_t StagedStart = 0;
+			uint8_t StagedEnd = 0;
+
+		public:
+			SpanReader(SerialType& serialInstance)
+				: SerialInstance(serialInstance)
+			{
+			}
+
+			void Clear()
+			{
+				StagedStart = 0;
+				StagedEnd = 0;
+			}
+
+			bool Available()
+			{
+				return StagedStart < StagedEnd || SerialInstance.available() > 0;
+			}
+
+			uint16_t ReadSpan(const uint8_t*& data)
+			{
+				if (StagedStart >= StagedEnd)
+				{
+					Clear();
+
+					int available = SerialInstance.available();
+					if (available > StagingSize)
+					{
+						available = StagingSize;
+					}
+
+					while (StagedEnd < available)
+					{
+						Staging[StagedEnd++] = (uint8_t)SerialInstance.read();
+					}
+				}
+
+				data = &Staging[StagedStart];
+
+				return StagedEnd - StagedStart;
+			}
+
+			void Consume(const uint16_t size)
+			{
+				if (size < uint16_t(StagedEnd - StagedStart))
+				{
+					StagedStart += size;
+				}
+				else
+				{
+					Clear();
+				}
+			}
+		};
+
+		/// <summary>
+		/// RX span access, forwarded to the driver's ring buffer.
+		/// </summary>
+		template<typename SerialType,
+			uint8_t StagingSize>
+		class SpanReader<SerialType, StagingSize, true>
+		{
+		private:
+			SerialType& SerialInstance;
+
+		public:
+			SpanReader(SerialType& serialInstance)
+				: SerialInstance(serialInstance)
+			{
+			}
+
+			void Clear()
+			{
+			}
+
+			bool Available()
+			{
+				const uint8_t* data;
+
+				return SerialInstance.ReadSpan(data) > 0;
+			}
+
+			uint16_t ReadSpan(const uint8_t*& data)
+			{
+				return SerialInstance.ReadSpan(data);
+			}
+
+			void Consume(const uint16_t size)
+			{
+				SerialInstance.Consume(size);
+			}
+		};
+
+		/// <summary>
+		/// TX access, fallback for the Arduino byte API.
+		/// </summary>
+		template<typename SerialType,
+			bool NativeSpan = HasWriteSpan<SerialType>::Value>
+		class SpanWriter
+		{
+		private:
+			SerialType& SerialInstance;
+
+		public:
+			SpanWriter(SerialType& serialInstance)
+				: SerialInstance(serialInstance)
+			{
+			}
+
+			uint16_t AvailableForWrite() const
+			{
+#if defined(ARDUINO_ARCH_STM32F4)
+				return USART_TX_BUF_SIZE - SerialInstance.pending();
+#else
+				const int available = SerialInstance.availableForWrite();
+
+				return available > 0 ? (uint16_t)available : 0;
+#endif
+			}
+
+			uint16_t Write(const uint8_t* data, const uint16_t size)
+			{
+				return SerialInstance.write(data, size);
+			}
+
+			bool Write(const uint8_t value)
+			{
+				return SerialInstance.write(value) > 0;
+			}
+
+			/// <summary>
+			/// Several buffers, in as few driver calls as it allows.
+			/// </summary>
+			uint16_t WriteGather(const uint8_t* const* data, const uint16_t* sizes, const uint8_t count)
+			{
+				return GatherWriter<SerialType>::Write(SerialInstance, *this, data, sizes, count);
+			}
+		};
+
+		/// <summary>
+		/// TX access, copied straight into the driver's ring buffer.
+		/// AvailableForWrite() still reports the total free space, as a single span may be cut short by the ring wrap.
+		/// </summary>
+		template<typename SerialType>
+		class SpanWriter<SerialType, true>
+		{
+		private:
+			SerialType& SerialInstance;
+
+		public:
+			SpanWriter(SerialType& serialInstance)
+				: SerialInstance(serialInstance)
+			{
+			}
+
+			uint16_t AvailableForWrite() const
+			{
+				const int available = SerialInstance.availableForWrite();
+
+				return available > 0 ? (uint16_t)available : 0;
+			}
+
+			uint16_t Write(const uint8_t* data, const uint16_t size)
+			{
+				uint16_t written = 0;
+
+				// Up to 2 spans, when the ring buffer wraps around.
+				for (uint8_t i = 0; i < 2 && written < size; i++)
+				{
+					uint8_t* span;
+					uint16_t spanSize = SerialInstance.WriteSpan(span);
+					if (spanSize == 0)
+					{
+						break;
+					}
+					else if (spanSize > size - written)
+					{
+						spanSize = size - written;
+					}
+
+					memcpy(span, &data[written], spanSize);
+					SerialInstance.Commit(spanSize);
+					written += spanSize;
+				}
+
+				return written;
+			}
+
+			bool Write(const uint8_t value)
+			{
+				return Write(&value, 1) > 0;
+			}
+
+			/// <summary>
+			/// Several buffers, copied into the ring one after the other.
+			/// </summary>
+			uint16_t WriteGather(const uint8_t* const* data, const uint16_t* sizes, const uint8_t count)
+			{
+				return GatherWriter<SerialType>::Write(SerialInstance, *this, data, sizes, count);
+			}
+		};
+	}
+}
+#endif
@@ -0,0 +1,419 @@
+#ifndef _UART_INTERFACE_SPSC_RING_h
+#define _UART_INTERFACE_SPSC_RING_h
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(ARDUINO_ARCH_AVR) || defined(ARDUINO_ARCH_MEGAAVR)
+#define UART_INTERFACE_SPSC_VOLATILE
+#include <util/atomic.h>
+#else
+#include <atomic>
+#endif
+
+#if !defined(UART_INTERFACE_CACHE_LINE_SIZE)
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86) || (defined(__aarch64__) && defined(__linux__))
+#define UART_INTERFACE_CACHE_LINE_SIZE 64
+#else
+#define UART_INTERFACE_CACHE_LINE_SIZE 1
+#endif
+#endif
+
+namespace UartInterface
+{
+	namespace Transport
+	{
+		/// <summary>
+		/// Wait-free single-producer/single-consumer byte ring.
+		/// The producer side (Push, WriteSpan/Commit) may run in an ISR or a reader thread,
+		///  the consumer side (ReadSpan/Consume, Clear, TakeSignal) in the protocol task.
+		/// Indexes are free-running, so the whole Capacity is usable.
+		/// Bytes that don't fit are dropped and counted in GetOverruns().
+		/// </summary>
+		/// <typeparam name="Capacity">Power of 2. At most 128 on AVR, where the indexes are single bytes.</typeparam>
+		template<uint16_t Capacity>
+		class SpscByteRing
+		{
+		private:
+			static_assert(Capacity > 1 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2.");
+
+			static constexpr uint16_t Mask = Capacity - 1;
+
+#if defined(UART_INTERFACE_SPSC_VOLATILE)
+			static_assert(Capacity <= 128, "Capacity too large for single byte indexes.");
+
+			using IndexType = uint8_t;
+			using AtomicIndex = volatile uint8_t;
+			using AtomicCounter = volatile uint32_t;
+
+			static IndexType LoadAcquire(const AtomicIndex& index)
+			{
+				const IndexType value = index;
+				__asm__ __volatile__("" ::: "memory");
+
+				return value;
+			}
+
+			static void StoreRelease(AtomicIndex& index, const IndexType value)
+			{
+				__asm__ __volatile__("" ::: "memory");
+				index = value;
+			}
+
+			static IndexType LoadRelaxed(const AtomicIndex& index)
+			{
+				return index;
+			}
+
+			/// <summary>
+			/// 4 byte counter, not read in one access: the producer ISR is held off meanwhile.
+			/// </summary>
+			static uint32_t LoadCounter(const AtomicCounter& counter)
+			{
+				uint32_t value;
+				ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+				{
+					value = counter;
+				}
+
+				return value;
+			}
+#else
+			using IndexType = uint32_t;
+			using AtomicIndex = std::atomic<uint32_t>;
+			using AtomicCounter = std::atomic<uint32_t>;
+
+			static IndexType LoadAcquire(const AtomicIndex& index)
+			{
+				return index.load(std::memory_order_acquire);
+			}
+
+			static void StoreRelease(AtomicIndex& index, const IndexType value)
+			{
+				index.store(value, std::memory_order_release);
+			}
+
+			static IndexType LoadRelaxed(const AtomicIndex& index)
+			{
+				return index.load(std::memory_order_relaxed);
+			}
+
+			static uint32_t LoadCounter(const AtomicCounter& counter)
+			{
+				return counter.load(std::memory_order_relaxed);
+			}
+#endif
+
+		private:
+			// Producer owned.
+			alignas(UART_INTERFACE_CACHE_LINE_SIZE) AtomicIndex Head{ 0 };
+			AtomicCounter Overruns{ 0 };
+
+			// Consumer owned.
+			alignas(UART_INTERFACE_CACHE_LINE_SIZE) AtomicIndex Tail{ 0 };
+			IndexType SignaledHead = 0;
+
+			alignas(UART_INTERFACE_CACHE_LINE_SIZE) uint8_t Buffer[Capacity]{};
+
+		public:
+			static constexpr uint16_t GetCapacity()
+			{
+				return Capacity;
+			}
+
+		public:
+			// Producer side.
+
+			/// <summary>
+			/// Copies as many bytes as fit, the rest are counted as overruns.
+			/// </summary>
+			/// <returns>Number of bytes pushed.</returns>
+			uint16_t Push(const uint8_t* data, const uint16_t size)
+			{
+				const IndexType head = LoadRelaxed(Head);
+				const uint16_t free = Capacity - (uint16_t)(IndexType)(head - LoadAcquire(Tail));
+				const uint16_t pushed = size < free ? size : free;
+
+				if (pushed > 0)
+				{
+					const uint16_t start = head & Mask;
+					const uint16_t first = (pushed < (Capacity - start)) ? pushed : (Capacity - start);
+
+					memcpy(&Buffer[start], data, first);
+					if (pushed > first)
+					{
+						memcpy(Buffer, &data[first], pushed - first);
+					}
+
+					StoreRelease(Head, (IndexType)(head + pushed));
+				}
+
+				if (pushed < size)
+				{
+					Overruns = Overruns + (size - pushed);
+				}
+
+				return pushed;
+			}
+
+			bool Push(const uint8_t value)
+			{
+				return Push(&value, 1) > 0;
+			}
+
+			/// <summary>
+			/// Total free space, possibly in two spans.
+			/// </summary>
+			uint16_t Free() const
+			{
+				return Capacity - (uint16_t)(IndexType)(LoadRelaxed(Head) - LoadAcquire(Tail));
+			}
+
+			/// <summary>
+			/// Contiguous free space, for a driver to fill in place.
+			/// </summary>
+			uint16_t WriteSpan(uint8_t*& data)
+			{
+				const IndexType head = LoadRelaxed(Head);
+				const uint16_t free = Capacity - (uint16_t)(IndexType)(head - LoadAcquire(Tail));
+				const uint16_t start = head & Mask;
+
+				data = &Buffer[start];
+
+				return free < (Capacity - start) ? free : (Capacity - start);
+			}
+
+			void Commit(const uint16_t size)
+			{
+				if (size > 0)
+				{
+					StoreRelease(Head, (IndexType)(LoadRelaxed(Head) + size));
+				}
+			}
+
+			/// <summary>
+			/// Counts bytes the driver had to discard before they reached the ring.
+			/// </summary>
+			void AddOverruns(const uint16_t count)
+			{
+				Overruns = Overruns + count;
+			}
+
+		public:
+			// Consumer side.
+
+			uint16_t Size() const
+			{
+				return (uint16_t)(IndexType)(LoadAcquire(Head) - LoadRelaxed(Tail));
+			}
+
+			uint16_t ReadSpan(const uint8_t*& data)
+			{
+				const IndexType tail = LoadRelaxed(Tail);
+				const uint16_t size = (uint16_t)(IndexType)(LoadAcquire(Head) - tail);
+				const uint16_t start = tail & Mask;
+
+				data = &Buffer[start];
+
+				return size < (Capacity - start) ? size : (Capacity - start);
+			}
+
+			void Consume(const uint16_t size)
+			{
+				StoreRelease(Tail, (IndexType)(LoadRelaxed(Tail) + size));
+			}
+
+			/// <summary>
+			/// Discards all pending bytes.
+			/// </summary>
+			void Clear()
+			{
+				StoreRelease(Tail, LoadAcquire(Head));
+			}
+
+			/// <summary>
+			/// True once after any Push/Commit, for the consumer to forward as a serial event.
+			/// </summary>
+			bool TakeSignal()
+			{
+				const IndexType head = LoadAcquire(Head);
+				const bool signaled = head != SignaledHead;
+				SignaledHead = head;
+
+				return signaled;
+			}
+
+			uint32_t GetOverruns() const
+			{
+				return LoadCounter(Overruns);
+			}
+		};
+
+		/// <summary>
+		/// SerialType adapter that receives through an SpscByteRing.
+		/// Pump() (or GetRing().Push()) runs in the ISR/reader thread and feeds the ring,
+		///  the protocol task reads the ring in spans. TX is forwarded to the serial.
+		/// Forward the producer's signal from the protocol context:
+		///		if (serial.TakeEvent()) { uartTask.OnSerialEvent(); }
+		/// </summary>
+		template<typename SerialType, uint16_t Capacity>
+		class SpscSerial
+		{
+		private:
+			SerialType& SerialInstance;
+			SpscByteRing<Capacity> Ring{};
+
+		public:
+			SpscSerial(SerialType& serialInstance)
+				: SerialInstance(serialInstance)
+			{
+			}
+
+			SerialType& GetSerial()
+			{
+				return SerialInstance;
+			}
+
+			SpscByteRing<Capacity>& GetRing()
+			{
+				return Ring;
+			}
+
+			uint32_t GetOverruns() const
+			{
+				return Ring.GetOverruns();
+			}
+
+		public:
+			// Producer side.
+
+			/// <summary>
+			/// Moves the serial's pending bytes into the ring.
+			/// Bytes that don't fit are still drained and counted as overruns.
+			/// </summary>
+			/// <returns>Number of bytes pushed.</returns>
+			uint16_t Pump()
+			{
+				uint16_t pushed = 0;
+				int available = SerialInstance.available();
+
+				while (available > 0)
+				{
+					uint8_t* span;
+					uint16_t spanSize = Ring.WriteSpan(span);
+					if (spanSize == 0)
+					{
+						Ring.AddOverruns(available);
+						while (available-- > 0)
+						{
+							SerialInstance.read();
+						}
+						break;
+					}
+					else if (spanSize > available)
+					{
+						spanSize = available;
+					}
+
+					for (uint16_t i = 0; i < spanSize; i++)
+					{
+						span[i] = (uint8_t)SerialInstance.read();
+					}
+					Ring.Commit(spanSize);
+					pushed += spanSize;
+					available = SerialInstance.available();
+				}
+
+				return pushed;
+			}
+
+		public:
+			// Consumer side.
+
+			bool TakeEvent()
+			{
+				return Ring.TakeSignal();
+			}
+
+			operator bool()
+			{
+				return (bool)SerialInstance;
+			}
+
+			void begin(const unsigned long baudrate)
+			{
+				SerialInstance.begin(baudrate);
+				Ring.Clear();
+			}
+
+			void end()
+			{
+				SerialInstance.end();
+			}
+
+			int available()
+			{
+				return Ring.Size();
+			}
+
+			int peek()
+			{
+				const uint8_t* data;
+
+				return Ring.ReadSpan(data) > 0 ? data[0] : -1;
+			}
+
+			int read()
+			{
+				const uint8_t* data;
+				if (Ring.ReadSpan(data) > 0)
+				{
+					const uint8_t value = data[0];
+					Ring.Consume(1);
+
+					return value;
+				}
+
+				return -1;
+			}
+
+			uint16_t ReadSpan(const uint8_t*& data)
+			{
+				return Ring.ReadSpan(data);
+			}
+
+			void Consume(const uint16_t size)
+			{
+				Ring.Consume(size);
+			}
+
+			int availableForWrite()
+			{
+				return SerialInstance.availableForWrite();
+			}
+
+#if defined(ARDUINO_ARCH_STM32F4)
+			int pending()
+			{
+				return SerialInstance.pending();
+			}
+#endif
+
+			size_t write(const uint8_t value)
+			{
+				return SerialInstance.write(value);
+			}
+
+			size_t write(const uint8_t* buffer, const size_t size)
+			{
+				return SerialInstance.write(buffer, size);
+			}
+
+			void clearWriteError()
+			{
+				SerialInstance.clearWriteError();
+			}
+		};
+	}
+}
+#endif
@@ -4,6 +4,10 @@
 #include "Codec/KeyedCrc.h"
 #include "Codec/UartCobsCodec.h"
 #include "Codec/MessageCodec.h"
+#include "Codec/MessageStreamDecoder.h"
+#include "Codec/PreEncodedFrame.h"
+#include "Transport/SpanTransport.h"
+#include "Transport/SpscRing.h"
 #include "Model/UartInterface.h"
 
 #endif
\ No newline at end of file
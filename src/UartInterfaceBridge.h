@@ -0,0 +1,6 @@
+#ifndef _UART_INTERFACE_BRIDGE_INCLUDE_h
+#define _UART_INTERFACE_BRIDGE_INCLUDE_h
+
+#include "Bridge/FrameBridge.h"
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef _UART_INTERFACE_CAPTURE_INCLUDE_h
+#define _UART_INTERFACE_CAPTURE_INCLUDE_h
+
+#include "Capture/WireCapture.h"
+#include "Capture/WireReplay.h"
+
+#endif
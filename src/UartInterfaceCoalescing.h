@@ -0,0 +1,6 @@
+#ifndef _UART_INTERFACE_COALESCING_INCLUDE_h
+#define _UART_INTERFACE_COALESCING_INCLUDE_h
+
+#include "Coalescing/CoalescingUartInterface.h"
+
+#endif
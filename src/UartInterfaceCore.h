@@ -0,0 +1,6 @@
+#ifndef _UART_INTERFACE_CORE_INCLUDE_h
+#define _UART_INTERFACE_CORE_INCLUDE_h
+
+#include "Core/UartInterfaceCore.h"
+
+#endif
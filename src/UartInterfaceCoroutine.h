@@ -0,0 +1,6 @@
+#ifndef _UART_INTERFACE_COROUTINE_INCLUDE_h
+#define _UART_INTERFACE_COROUTINE_INCLUDE_h
+
+#include "Coroutine/CoroutineUartInterface.h"
+
+#endif
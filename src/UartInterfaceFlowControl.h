@@ -0,0 +1,6 @@
+#ifndef _UART_INTERFACE_FLOW_CONTROL_INCLUDE_h
+#define _UART_INTERFACE_FLOW_CONTROL_INCLUDE_h
+
+#include "FlowControl/CreditedUartInterface.h"
+
+#endif
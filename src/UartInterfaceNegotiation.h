@@ -0,0 +1,6 @@
+#ifndef _UART_INTERFACE_NEGOTIATION_INCLUDE_h
+#define _UART_INTERFACE_NEGOTIATION_INCLUDE_h
+
+#include "Negotiation/NegotiatedUartInterface.h"
+
+#endif
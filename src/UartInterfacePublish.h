@@ -0,0 +1,6 @@
+#ifndef _UART_INTERFACE_PUBLISH_INCLUDE_h
+#define _UART_INTERFACE_PUBLISH_INCLUDE_h
+
+#include "Publish/PeriodicPublisher.h"
+
+#endif
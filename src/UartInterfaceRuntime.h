@@ -0,0 +1,8 @@
+#ifndef _UART_INTERFACE_RUNTIME_INCLUDE_h
+#define _UART_INTERFACE_RUNTIME_INCLUDE_h
+
+#include "Runtime/SpscQueue.h"
+#include "Runtime/MpscSubmissionQueue.h"
+#include "Runtime/ShardedPortRuntime.h"
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef _UART_INTERFACE_SHARED_MEMORY_INCLUDE_h
+#define _UART_INTERFACE_SHARED_MEMORY_INCLUDE_h
+
+#include "Transport/SharedMemorySerial.h"
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef _UART_INTERFACE_SIMULATION_INCLUDE_h
+#define _UART_INTERFACE_SIMULATION_INCLUDE_h
+
+#include "Simulation/VirtualClock.h"
+#include "Simulation/SimulatedLink.h"
+
+#endif